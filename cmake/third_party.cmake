@@ -181,6 +181,22 @@ if(BUILD_RDMA)
   endif()
 endif()
 
+if(WITH_LIBURING)
+  if(UNIX)
+    include(CheckIncludeFiles)
+    check_include_files(liburing.h HAVE_LIBURING_H)
+    find_library(LIBURING_LIBRARY NAMES uring)
+    if(HAVE_LIBURING_H AND LIBURING_LIBRARY)
+      add_definitions(-DWITH_LIBURING)
+      list(APPEND oneflow_third_party_libs ${LIBURING_LIBRARY})
+    else()
+      message(FATAL_ERROR "liburing not found")
+    endif()
+  else()
+    message(FATAL_ERROR "UNIMPLEMENTED")
+  endif()
+endif()
+
 if(BUILD_HWLOC)
   list(APPEND oneflow_third_party_dependencies hwloc)
   list(APPEND oneflow_third_party_libs ${ONEFLOW_HWLOC_STATIC_LIBRARIES})
@@ -73,6 +73,8 @@ py::object PackTensorTuple(const one::TensorTuple& tp) {
 one::AutogradFunctionBase::FType PackPyFunctionToFType(const py::function& func) {
   return [func](const std::shared_ptr<one::FunctionAutoGradCaptureState>& ctx,
                 const one::TensorTuple& inputs) {
+    // Backward functions may be called by the threads of parallel backward.
+    py::gil_scoped_acquire acquire;
     const py::tuple& a = py::cast(inputs);
     py::object res = func(ctx, *a);
     return UnpackTensorTuple(res).GetPtrOrThrow();
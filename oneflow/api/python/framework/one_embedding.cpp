@@ -38,31 +38,32 @@ class OneEmbeddingHandler final {
   }
 
   void LoadSnapshot(const std::string& snapshot_name) {
-#ifdef WITH_CUDA
     Singleton<embedding::EmbeddingManager>::Get()->LoadSnapshot(embedding_name_, local_rank_id_,
                                                                 rank_id_, snapshot_name);
-#else
-    UNIMPLEMENTED() << "Only Support with CUDA";
-#endif
   }
 
   void SaveSnapshot(const std::string& snapshot_name) {
-#ifdef WITH_CUDA
     Singleton<embedding::EmbeddingManager>::Get()->SaveSnapshot(embedding_name_, local_rank_id_,
                                                                 rank_id_, snapshot_name);
-#else
-    UNIMPLEMENTED() << "Only Support with CUDA";
-#endif
+  }
+
+  std::tuple<uint64_t, uint64_t, uint64_t> GetCacheStatistics() {
+    const embedding::KeyValueStoreStatistics statistics =
+        Singleton<embedding::EmbeddingManager>::Get()->GetKeyValueStoreStatistics(embedding_name_,
+                                                                                  rank_id_);
+    return std::make_tuple(statistics.num_query_keys, statistics.num_cache_missing_keys,
+                           statistics.num_store_missing_keys);
+  }
+
+  void ResetCacheStatistics() {
+    Singleton<embedding::EmbeddingManager>::Get()->ResetKeyValueStoreStatistics(embedding_name_,
+                                                                                rank_id_);
   }
 
  private:
   void CreateKeyValueStore(const embedding::KeyValueStoreOptions& key_value_store_options) {
-#ifdef WITH_CUDA
     Singleton<embedding::EmbeddingManager>::Get()->CreateKeyValueStore(
         key_value_store_options, local_rank_id_, rank_id_, world_size_);
-#else
-    UNIMPLEMENTED() << "Only Support with CUDA";
-#endif
   }
 
   std::string embedding_name_;
@@ -321,7 +322,9 @@ ONEFLOW_API_PYBIND11_MODULE("", m) {
                                                      rank_id, world_size);
       }))
       .def("SaveSnapshot", &OneEmbeddingHandler::SaveSnapshot)
-      .def("LoadSnapshot", &OneEmbeddingHandler::LoadSnapshot);
+      .def("LoadSnapshot", &OneEmbeddingHandler::LoadSnapshot)
+      .def("GetCacheStatistics", &OneEmbeddingHandler::GetCacheStatistics)
+      .def("ResetCacheStatistics", &OneEmbeddingHandler::ResetCacheStatistics);
 
   py::class_<embedding::PersistentTableWriter, std::shared_ptr<embedding::PersistentTableWriter>>(
       m, "PersistentTableWriter")
@@ -61,13 +61,15 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::string& data_dir, int32_t data_part_num,
          const std::string& part_name_prefix, int32_t part_name_suffix_length, int32_t batch_size,
          int32_t shuffle_buffer_size, bool random_shuffle, bool shuffle_after_epoch, int64_t seed,
+         bool lazy_parse, bool random_access, int64_t start_sample,
          const Optional<Symbol<Device>>& device) -> Maybe<Tensor> {
         auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP(
             "data_dir", "data_part_num", "part_name_prefix", "part_name_suffix_length",
-            "batch_size", "shuffle_buffer_size", "random_shuffle", "shuffle_after_epoch", "seed");
+            "batch_size", "shuffle_buffer_size", "random_shuffle", "shuffle_after_epoch", "seed",
+            "lazy_parse", "random_access", "start_sample");
         attrs.SetAllAttrs(data_dir, data_part_num, part_name_prefix, part_name_suffix_length,
                           batch_size, shuffle_buffer_size, random_shuffle, shuffle_after_epoch,
-                          seed);
+                          seed, lazy_parse, random_access, start_sample);
         return OpInterpUtil::Dispatch<Tensor>(*op, {}, OpExprInterpContext(attrs, JUST(device)));
       });
   m.add_functor(
@@ -75,15 +77,17 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::string& data_dir, int32_t data_part_num,
          const std::string& part_name_prefix, int32_t part_name_suffix_length, int32_t batch_size,
          int32_t shuffle_buffer_size, bool random_shuffle, bool shuffle_after_epoch, int64_t seed,
+         bool lazy_parse, bool random_access, int64_t start_sample,
          const Symbol<ParallelDesc>& placement,
          const std::vector<Symbol<SbpParallel>>& sbp_tuple) -> Maybe<Tensor> {
         auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP(
             "data_dir", "data_part_num", "part_name_prefix", "part_name_suffix_length",
             "batch_size", "shuffle_buffer_size", "random_shuffle", "shuffle_after_epoch", "seed",
-            "nd_sbp");
+            "lazy_parse", "random_access", "start_sample", "nd_sbp");
         attrs.SetAllAttrs(data_dir, data_part_num, part_name_prefix, part_name_suffix_length,
                           batch_size, shuffle_buffer_size, random_shuffle, shuffle_after_epoch,
-                          seed, *JUST(GetNdSbpStrList(sbp_tuple)));
+                          seed, lazy_parse, random_access, start_sample,
+                          *JUST(GetNdSbpStrList(sbp_tuple)));
         auto nd_sbp = JUST(GetNdSbp(sbp_tuple));
         return OpInterpUtil::Dispatch<Tensor>(*op, {},
                                               OpExprInterpContext(attrs, placement, nd_sbp));
@@ -188,6 +192,23 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
                                     random_aspect_ratio_max, warmup_size, num_attempts);
                   return OpInterpUtil::Dispatch<Tensor>(*op, {input}, attrs);
                 });
+  m.add_functor(
+      "DispatchImageDecoderRandomCropResizeNormalize",
+      [](const std::shared_ptr<OpExpr>& op, const TensorTuple& input, int64_t target_width,
+         int64_t target_height, const std::string& name, bool random_crop,
+         const std::vector<float>& random_area, const std::vector<float>& random_aspect_ratio,
+         int32_t num_attempts, int64_t seed, bool has_seed, const std::string& color_space,
+         const std::string& output_layout, const std::vector<float>& mean,
+         const std::vector<float>& std) -> Maybe<Tensor> {
+        auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP(
+            "target_width", "target_height", "name", "random_crop", "random_area",
+            "random_aspect_ratio", "num_attempts", "seed", "has_seed", "color_space",
+            "output_layout", "mean", "std");
+        attrs.SetAllAttrs(target_width, target_height, name, random_crop, random_area,
+                          random_aspect_ratio, num_attempts, seed, has_seed, color_space,
+                          output_layout, mean, std);
+        return OpInterpUtil::Dispatch<Tensor>(*op, input, attrs);
+      });
   m.add_functor(
       "DispatchTensorBufferToListOfTensorsV2",
       [](const std::shared_ptr<OpExpr>& op, const std::shared_ptr<Tensor>& input,
@@ -16,6 +16,8 @@ limitations under the License.
 #include <pybind11/pybind11.h>
 #include "oneflow/api/python/of_api_registry.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/vm/allocator_stats.h"
+#include "oneflow/core/vm/instruction_latency_stats.h"
 
 namespace py = pybind11;
 
@@ -34,6 +36,23 @@ ONEFLOW_API_PYBIND11_MODULE("profiler", m) {
 
   m.def("DisableProfilerAndReturnResult", &profiler::DisableProfilerAndReturnResult);
 
+  m.def("DumpMemoryTimeline", &profiler::DumpMemoryTimeline);
+
+  m.def("GetAllocatorStats", []() {
+    nlohmann::json stats = nlohmann::json::array();
+    for (const auto& snapshot : vm::GetAllAllocatorStats()) { stats.push_back(snapshot.ToJson()); }
+    return stats.dump();
+  });
+
+  m.def("ResetAllocatorPeakStats", &vm::ResetAllAllocatorPeakStats);
+
+  m.def("EnableInstructionLatencyStats", &vm::InstructionLatencyStats::SetEnabled);
+
+  m.def("GetInstructionLatencyStats",
+        []() { return vm::InstructionLatencyStats::ToJson().dump(); });
+
+  m.def("ResetInstructionLatencyStats", &vm::InstructionLatencyStats::Reset);
+
   m.def("StartRecord", &profiler::StartRecord);
 
   m.def("EndRecord", &profiler::EndRecord);
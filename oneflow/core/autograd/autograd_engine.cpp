@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include <memory>
+#include <set>
 #include <stack>
 #include <queue>
 #include "fmt/core.h"
@@ -22,8 +23,13 @@ limitations under the License.
 #include "oneflow/core/autograd/autograd_engine.h"
 #include "oneflow/core/autograd/autograd_meta.h"
 #include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/common/container_util.h"
 #include "oneflow/core/common/error.h"
+#include "oneflow/core/common/foreign_lock_helper.h"
+#include "oneflow/core/common/env_var/eager.h"
+#include "oneflow/core/framework/eager_elementwise_fusion.h"
+#include "oneflow/core/framework/eager_graph.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/tensor_arg.h"
 #include "oneflow/core/framework/tensor_methods.h"
@@ -35,6 +41,7 @@ limitations under the License.
 #include "oneflow/core/framework/global_param_grad_sync_mode.h"
 #include "oneflow/core/job/lazy_mode.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/thread/thread_pool.h"
 #include "oneflow/core/common/env_var/debug_mode.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 
@@ -123,6 +130,22 @@ std::string GetDebugGraphFileName(const std::string& mode, const std::string& su
   return fmt::format("autograd_{}_rank{}_suffix_graph.dot", mode, GlobalProcessCtx::Rank(), suffix);
 }
 
+ThreadPool* GetBackwardThreadPool() {
+  // Not the ThreadPool singleton, cpu kernels launched by the backward functions wait on it.
+  // Leaked, like the threads of the singletons it may outlive.
+  static ThreadPool* pool = new ThreadPool(std::max<int64_t>(
+      ThreadLocalEnvInteger<ONEFLOW_EAGER_PARALLEL_BACKWARD_THREAD_NUM>(), 1));
+  return pool;
+}
+
+Maybe<bool> ComputeInputGradsOnThisThread(FunctionNode* node, bool create_graph,
+                                          TensorTuple* output_grads, TensorTuple* input_grads) {
+  bool is_ready = JUST(node->ComputeInputGrads(create_graph, output_grads, input_grads));
+  // Deferred elementwise ops are kept per thread, flush them before the grads are passed on.
+  if (EagerElementwiseFusion::HasDeferredOps()) { JUST(EagerElementwiseFusion::Flush()); }
+  return is_ready;
+}
+
 }  // namespace
 
 Maybe<void> AutogradEngine::RunBackwardAndSaveGrads4LeafTensorIf(const TensorTuple& outputs,
@@ -183,43 +206,60 @@ void FunctionNode::ReleaseOutTensorArgs() {
 }
 
 Maybe<bool> FunctionNode::Apply(bool create_graph) {
+  TensorTuple output_grads(output_meta_data_.size());
+  TensorTuple input_grads(input_meta_data_.size());
+  if (!JUST(ComputeInputGrads(create_graph, &output_grads, &input_grads))) { return false; }
+  JUST(PushInputGrads(output_grads, &input_grads));
+  return true;
+}
+
+Maybe<bool> FunctionNode::ComputeInputGrads(bool create_graph, TensorTuple* output_grads,
+                                            TensorTuple* input_grads) {
   CHECK_NOTNULL_OR_RETURN(backward_fn_)
       << "This FunctionNode with name `" << name() << "` has been released.\n"
       << "Maybe you try to backward through the node a second time. Specify retain_graph=True when "
          "calling .backward() or autograd.grad() the first time.";
   if (!IsReadyToRun(output_meta_data_)) { return false; }
-  TensorTuple input_grads(input_meta_data_.size());
-  TensorTuple output_grads(output_meta_data_.size());
+  output_grads->resize(output_meta_data_.size());
+  input_grads->resize(input_meta_data_.size());
   for (int i = 0; i < output_meta_data_.size(); ++i) {
     if (output_meta_data_[i]->current_grad()->Empty()) {
       // Only initialize out_grads for those requires_grad outputs
       if (output_meta_data_[i]->requires_grad()) {
-        output_grads[i] = JUST(output_tensor_infos_[i].zeros());
+        (*output_grads)[i] = JUST(output_tensor_infos_[i].zeros());
       }
     } else {
-      JUST(oneflow::VectorAt(output_grads, i)) =
+      JUST(oneflow::VectorAt(*output_grads, i)) =
           JUST(JUST(oneflow::VectorAt(output_meta_data_, i))->current_grad_value());
     }
   }
-  JUST(backward_fn_->body(output_grads, &input_grads, create_graph));
+  JUST(backward_fn_->body(*output_grads, input_grads, create_graph));
+  return true;
+}
+
+Maybe<void> FunctionNode::PushInputGrads(const TensorTuple& output_grads,
+                                         TensorTuple* input_grads) {
   for (const auto& hook : hooks_) {
-    auto new_input_grads = hook(input_grads, output_grads);
+    auto new_input_grads = hook(*input_grads, output_grads);
     if (new_input_grads.has_value()) {
       auto new_input_grads_value = *JUST(new_input_grads);
-      CHECK_EQ_OR_RETURN(new_input_grads_value.size(), input_grads.size())
+      CHECK_EQ_OR_RETURN(new_input_grads_value.size(), input_grads->size())
           << "The number of input grads returned by hook is not correct, expected "
-          << input_grads.size() << ", but got " << new_input_grads_value.size() << ".";
-      for (int i = 0; i < input_grads.size(); ++i) { input_grads[i] = new_input_grads_value[i]; }
+          << input_grads->size() << ", but got " << new_input_grads_value.size() << ".";
+      for (int i = 0; i < input_grads->size(); ++i) {
+        (*input_grads)[i] = new_input_grads_value[i];
+      }
     }
   }
   for (int i = 0; i < input_meta_data_.size(); ++i) {
-    if (JUST(VectorAt(input_grads, i))) {
+    if (JUST(VectorAt(*input_grads, i))) {
       CHECK_NOTNULL_OR_RETURN(input_meta_data_[i])
           << name_
           << " calculate grad for tensor which requires_grad is False. Please submit an issue in "
              "`https://github.com/Oneflow-Inc/oneflow/issues` and we will fix it as soon as "
              "possible";
-      JUST(input_meta_data_[i]->current_grad()->PushPartialTensor(JUST(VectorAt(input_grads, i))));
+      JUST(input_meta_data_[i]->current_grad()->PushPartialTensor(
+          JUST(VectorAt(*input_grads, i))));
     } else {
       CHECK_OR_RETURN(!input_meta_data_[i])
           << name() << "'s input[" << i
@@ -228,7 +268,7 @@ Maybe<bool> FunctionNode::Apply(bool create_graph) {
              "possible;";
     }
   }
-  return true;
+  return Maybe<void>::Ok();
 }
 
 void GraphFunctionNode::ReleaseData() {
@@ -270,11 +310,12 @@ GraphFunctionNode::GraphFunctionNode(const std::string& name,
 }
 
 GraphTask::GraphTask(const TensorTuple& outputs, bool retain_graph, bool create_graph)
-    : retain_graph_(retain_graph), create_graph_(create_graph) {
+    : retain_graph_(retain_graph), create_graph_(create_graph), has_global_output_(false) {
   roots_.reserve(outputs.size());
   for (const auto& out_tensor : outputs) {
     FunctionNode* node = out_tensor->mut_grad_fn_node().get();
     roots_.emplace_back(node);
+    if (out_tensor->is_global()) { has_global_output_ = true; }
   }
 }
 
@@ -415,6 +456,7 @@ Maybe<void> GraphTask::ComputeDependenciesAndPruneNode(const TensorTuple& inputs
 }
 
 Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
+  if (CanApplyInParallel()) { return ApplyInParallel(save_grad_for_leaf); }
   std::queue<FunctionNode*> queue;
   for (FunctionNode* node : roots_) {
     if (grad_fn2exec_info_[node].dependencies == 0) { queue.push(node); }
@@ -431,18 +473,7 @@ Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
     }
     BackwardPassScopeGuard backward_guard(node->scope());
     if (/*bool not_ready_to_apply=*/!(JUST(node->Apply(create_graph_)))) { continue; }
-    if (exec_info.capture_indices) {
-      CHECK_NOTNULL_OR_RETURN(captured_grads_.get()) << "captured grads in GraphTask is nullptr";
-      for (const auto& out_idx_and_capture_idx : *exec_info.capture_indices) {
-        JUST(VectorAt(*captured_grads_, out_idx_and_capture_idx.second)) =
-            JUST(JUST(VectorAt(node->output_meta_data_, out_idx_and_capture_idx.first))
-                     ->current_grad_value());
-      }
-    }
-    if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
-    JUST(node->AccGrad4RetainGradTensor(create_graph_));
-    node->ReleaseOutTensorArgs();
-    if (!retain_graph_) { node->ReleaseData(); }
+    JUST(FinishAppliedNode(node, exec_info, save_grad_for_leaf));
 
     for (const auto& next_grad_fn : node->next_functions()) {
       FunctionNode* next_node = std::get<0>(next_grad_fn).get();
@@ -454,6 +485,102 @@ Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
   return Maybe<void>::Ok();
 }
 
+bool GraphTask::CanApplyInParallel() const {
+  if (!ThreadLocalEnvBool<ONEFLOW_EAGER_PARALLEL_BACKWARD>()) { return false; }
+  if (LazyMode::is_enabled() || EagerGraph::CapturingGraph() != nullptr) { return false; }
+  // The collective ops of global backward functions have to be launched in the same order on all
+  // the ranks.
+  if (has_global_output_ || GlobalProcessCtx::WorldSize() > 1) { return false; }
+  // A node is applied once per occurrence in roots_, which must not happen concurrently.
+  std::set<FunctionNode*> roots(roots_.begin(), roots_.end());
+  return roots.size() == roots_.size();
+}
+
+// The nodes popped from the queue of the serial Apply one after another, until it gets to the
+// nodes pushed by them, do not depend on each other. Each of these waves is applied concurrently,
+// then the nodes of the wave are finished in the serial order.
+Maybe<void> GraphTask::ApplyInParallel(bool save_grad_for_leaf) {
+  std::vector<FunctionNode*> wave;
+  for (FunctionNode* node : roots_) {
+    if (grad_fn2exec_info_[node].dependencies == 0) { wave.emplace_back(node); }
+  }
+  const bool grad_mode = autograd::GradMode::is_enabled();
+  std::vector<FunctionNode*> nodes;
+  std::vector<FunctionNode*> next_wave;
+  while (!wave.empty()) {
+    nodes.clear();
+    for (FunctionNode* node : wave) {
+      if (grad_fn2exec_info_[node].need_execute) {
+        nodes.emplace_back(node);
+      } else {
+        node->ReleaseOutTensorArgs();
+      }
+    }
+    if (EagerElementwiseFusion::HasDeferredOps()) { JUST(EagerElementwiseFusion::Flush()); }
+    const size_t num_nodes = nodes.size();
+    std::vector<TensorTuple> output_grads(num_nodes);
+    std::vector<TensorTuple> input_grads(num_nodes);
+    std::vector<Maybe<bool>> is_ready(num_nodes, Maybe<bool>(false));
+    const auto Compute = [&](size_t i) {
+      autograd::AutoGradMode mode(grad_mode);
+      BackwardPassScopeGuard backward_guard(nodes.at(i)->scope());
+      is_ready.at(i) = TRY(ComputeInputGradsOnThisThread(nodes.at(i), create_graph_,
+                                                         &output_grads.at(i), &input_grads.at(i)));
+    };
+    if (num_nodes == 1) {
+      Compute(0);
+    } else if (num_nodes > 1) {
+      // The GIL is released for the python backward functions run by the other threads.
+      JUST(Singleton<ForeignLockHelper>::Get()->WithScopedRelease([&]() -> Maybe<void> {
+        BlockingCounter counter(num_nodes - 1);
+        for (size_t i = 1; i < num_nodes; ++i) {
+          GetBackwardThreadPool()->AddWork([&, i]() {
+            Compute(i);
+            counter.Decrease();
+          });
+        }
+        Compute(0);
+        counter.WaitForeverUntilCntEqualZero();
+        return Maybe<void>::Ok();
+      }));
+    }
+
+    next_wave.clear();
+    for (size_t i = 0; i < num_nodes; ++i) {
+      FunctionNode* node = nodes.at(i);
+      if (/*bool not_ready_to_apply=*/!JUST(is_ready.at(i))) { continue; }
+      BackwardPassScopeGuard backward_guard(node->scope());
+      JUST(node->PushInputGrads(output_grads.at(i), &input_grads.at(i)));
+      JUST(FinishAppliedNode(node, grad_fn2exec_info_[node], save_grad_for_leaf));
+      for (const auto& next_grad_fn : node->next_functions()) {
+        FunctionNode* next_node = std::get<0>(next_grad_fn).get();
+        int32_t& dependencies = grad_fn2exec_info_[next_node].dependencies;
+        dependencies -= 1;
+        if (dependencies == 0) { next_wave.emplace_back(next_node); }
+      }
+    }
+    wave.swap(next_wave);
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> GraphTask::FinishAppliedNode(FunctionNode* node, const ExecInfo& exec_info,
+                                         bool save_grad_for_leaf) {
+  if (exec_info.capture_indices) {
+    CHECK_NOTNULL_OR_RETURN(captured_grads_.get()) << "captured grads in GraphTask is nullptr";
+    for (const auto& out_idx_and_capture_idx : *exec_info.capture_indices) {
+      JUST(VectorAt(*captured_grads_, out_idx_and_capture_idx.second)) =
+          JUST(JUST(VectorAt(node->output_meta_data_, out_idx_and_capture_idx.first))
+                   ->current_grad_value());
+    }
+  }
+  if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
+  JUST(node->AccGrad4RetainGradTensor(create_graph_));
+  node->ReleaseOutTensorArgs();
+  if (!retain_graph_) { node->ReleaseData(); }
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> GraphAutogradEngine::RunBackwardAndSaveGrads4LeafTensor(const TensorTuple& outputs,
                                                                     const TensorTuple& out_grads,
                                                                     bool retain_graph,
@@ -48,6 +48,12 @@ class FunctionNode {
   virtual ~FunctionNode() = default;
 
   Maybe<bool> Apply(bool create_graph);
+  // The two halves of Apply. ComputeInputGrads runs the backward function, and returns false when
+  // none of the outputs has a grad. PushInputGrads runs the hooks and passes the input grads on
+  // to the next nodes.
+  Maybe<bool> ComputeInputGrads(bool create_graph, TensorTuple* output_grads,
+                                TensorTuple* input_grads);
+  Maybe<void> PushInputGrads(const TensorTuple& output_grads, TensorTuple* input_grads);
   Maybe<void> AccGrad4LeafTensor(bool create_graph);
   Maybe<void> AccGrad4RetainGradTensor(bool create_graph);
   void ReleaseOutTensorArgs();
@@ -167,8 +173,17 @@ class GraphTask final {
     std::unique_ptr<std::vector<std::pair<size_t, size_t>>> capture_indices;
   };
 
+  // Computes the grads of the nodes that are ready at the same time concurrently, and passes them
+  // on in the order of the serial Apply, so that grads are accumulated in the same order.
+  Maybe<void> ApplyInParallel(bool save_grad_for_leaf);
+  bool CanApplyInParallel() const;
+  // Captures and accumulates the grads of a node that has been applied, and releases them.
+  Maybe<void> FinishAppliedNode(FunctionNode* node, const ExecInfo& exec_info,
+                                bool save_grad_for_leaf);
+
   bool retain_graph_;
   bool create_graph_;
+  bool has_global_output_;
   std::vector<FunctionNode*> roots_;
   HashMap<FunctionNode*, ExecInfo> grad_fn2exec_info_;
   std::shared_ptr<TensorTuple> captured_grads_;
@@ -16,13 +16,14 @@ limitations under the License.
 #ifdef __linux__
 
 #include "oneflow/core/comm_network/epoll/io_event_poller.h"
+#include "oneflow/core/common/env_var/comm_net.h"
 #include <sys/eventfd.h>
 
 namespace oneflow {
 
 const int IOEventPoller::max_event_num_ = 32;
 
-IOEventPoller::IOEventPoller() {
+IOEventPoller::IOEventPoller() : busy_poll_us_(EnvInteger<ONEFLOW_COMM_NET_BUSY_POLL_US>()) {
   epfd_ = epoll_create1(0);
   ep_events_ = new epoll_event[max_event_num_];
   io_handlers_.clear();
@@ -42,11 +43,17 @@ IOEventPoller::~IOEventPoller() {
 
 void IOEventPoller::AddFd(int fd, std::function<void()> read_handler,
                           std::function<void()> write_handler) {
-  AddFd(fd, &read_handler, &write_handler);
+  AddFd(fd, &read_handler, &write_handler, nullptr);
+}
+
+void IOEventPoller::AddFd(int fd, std::function<void()> read_handler,
+                          std::function<void()> write_handler,
+                          std::function<void()> error_handler) {
+  AddFd(fd, &read_handler, &write_handler, &error_handler);
 }
 
 void IOEventPoller::AddFdWithOnlyReadHandler(int fd, std::function<void()> read_handler) {
-  AddFd(fd, &read_handler, nullptr);
+  AddFd(fd, &read_handler, nullptr, nullptr);
 }
 
 void IOEventPoller::Start() { thread_ = std::thread(&IOEventPoller::EpollLoop, this); }
@@ -58,7 +65,8 @@ void IOEventPoller::Stop() {
 }
 
 void IOEventPoller::AddFd(int fd, std::function<void()>* read_handler,
-                          std::function<void()>* write_handler) {
+                          std::function<void()>* write_handler,
+                          std::function<void()>* error_handler) {
   // Set Fd NONBLOCK
   int opt = fcntl(fd, F_GETFL);
   PCHECK(opt != -1);
@@ -71,6 +79,7 @@ void IOEventPoller::AddFd(int fd, std::function<void()>* read_handler,
   IOHandler* io_handler = new IOHandler;
   if (read_handler) { io_handler->read_handler = *read_handler; }
   if (write_handler) { io_handler->write_handler = *write_handler; }
+  if (error_handler) { io_handler->error_handler = *error_handler; }
   io_handler->fd = fd;
   io_handlers_.push_front(io_handler);
   // Add Fd to Epoll
@@ -83,16 +92,30 @@ void IOEventPoller::AddFd(int fd, std::function<void()>* read_handler,
 }
 
 void IOEventPoller::EpollLoop() {
+  // With busy polling, epoll_wait does not sleep until busy_poll_us_ after the last event, which
+  // saves the wake-ups of a stream of small messages.
+  const auto busy_poll_duration = std::chrono::microseconds(busy_poll_us_);
+  auto last_event_time = std::chrono::steady_clock::now();
   while (true) {
-    int event_num = epoll_wait(epfd_, ep_events_, max_event_num_, -1);
+    int timeout = -1;
+    if (busy_poll_us_ > 0
+        && std::chrono::steady_clock::now() - last_event_time < busy_poll_duration) {
+      timeout = 0;
+    }
+    int event_num = epoll_wait(epfd_, ep_events_, max_event_num_, timeout);
     if (event_num == -1) {
       PCHECK(errno == EINTR);
       continue;
     }
+    if (event_num == 0) { continue; }
+    if (busy_poll_us_ > 0) { last_event_time = std::chrono::steady_clock::now(); }
     const epoll_event* cur_event = ep_events_;
     for (int event_idx = 0; event_idx < event_num; ++event_idx, ++cur_event) {
       auto io_handler = static_cast<IOHandler*>(cur_event->data.ptr);
-      PCHECK(!(cur_event->events & EPOLLERR)) << "fd: " << io_handler->fd;
+      if (cur_event->events & EPOLLERR) {
+        PCHECK(io_handler->error_handler) << "fd: " << io_handler->fd;
+        io_handler->error_handler();
+      }
       if (io_handler->fd == break_epoll_loop_fd_) { return; }
       if (cur_event->events & EPOLLIN) {
         if (cur_event->events & EPOLLRDHUP) {
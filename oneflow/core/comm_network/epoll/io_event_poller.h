@@ -29,6 +29,9 @@ class IOEventPoller final {
   ~IOEventPoller();
 
   void AddFd(int fd, std::function<void()> read_handler, std::function<void()> write_handler);
+  // `error_handler` is called on EPOLLERR, which is fatal for the fds without one.
+  void AddFd(int fd, std::function<void()> read_handler, std::function<void()> write_handler,
+             std::function<void()> error_handler);
   void AddFdWithOnlyReadHandler(int fd, std::function<void()> read_handler);
 
   void Start();
@@ -43,13 +46,16 @@ class IOEventPoller final {
     }
     std::function<void()> read_handler;
     std::function<void()> write_handler;
+    std::function<void()> error_handler;
     int fd;
   };
 
-  void AddFd(int fd, std::function<void()>* read_handler, std::function<void()>* write_handler);
+  void AddFd(int fd, std::function<void()>* read_handler, std::function<void()>* write_handler,
+             std::function<void()>* error_handler);
 
   void EpollLoop();
   static const int max_event_num_;
+  const int64_t busy_poll_us_;
 
   int epfd_;
   epoll_event* ep_events_;
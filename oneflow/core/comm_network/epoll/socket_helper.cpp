@@ -16,6 +16,7 @@ limitations under the License.
 #ifdef __linux__
 
 #include "oneflow/core/comm_network/epoll/socket_helper.h"
+#include "oneflow/core/common/env_var/comm_net.h"
 
 namespace oneflow {
 
@@ -24,7 +25,13 @@ SocketHelper::SocketHelper(int sockfd, IOEventPoller* poller) {
   write_helper_ = new SocketWriteHelper(sockfd, poller);
   poller->AddFd(
       sockfd, [this]() { read_helper_->NotifyMeSocketReadable(); },
-      [this]() { write_helper_->NotifyMeSocketWriteable(); });
+      [this]() { write_helper_->NotifyMeSocketWriteable(); },
+      [this]() { write_helper_->NotifyMeSocketError(); });
+  const int busy_poll_us = EnvInteger<ONEFLOW_COMM_NET_BUSY_POLL_US>();
+  if (busy_poll_us > 0
+      && setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(int)) != 0) {
+    PLOG(WARNING) << "failed to set SO_BUSY_POLL of sockfd " << sockfd;
+  }
 }
 
 SocketHelper::~SocketHelper() {
@@ -17,11 +17,32 @@ limitations under the License.
 
 #include "oneflow/core/comm_network/epoll/socket_write_helper.h"
 #include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+#include "oneflow/core/common/env_var/comm_net.h"
 
 #include <sys/eventfd.h>
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define OF_WITH_MSG_ZEROCOPY
+#endif
 
 namespace oneflow {
 
+namespace {
+
+// Messages gathered into one sendmsg at most.
+constexpr size_t kMaxBatchMsgNum = 64;
+
+// The payload that follows the head of a message on the socket, if any.
+bool GetMsgBody(const SocketMsg& msg, iovec* body) {
+  if (msg.msg_type != SocketMsgType::kRequestRead) { return false; }
+  auto src_mem_desc = static_cast<const SocketMemDesc*>(msg.request_read_msg.src_token);
+  body->iov_base = src_mem_desc->mem_ptr;
+  body->iov_len = src_mem_desc->byte_size;
+  return body->iov_len > 0;
+}
+
+}  // namespace
+
 SocketWriteHelper::~SocketWriteHelper() {
   delete cur_msg_queue_;
   cur_msg_queue_ = nullptr;
@@ -32,17 +53,36 @@ SocketWriteHelper::~SocketWriteHelper() {
   }
 }
 
-SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
+SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller)
+    : SocketWriteHelper(sockfd, poller, &sendmsg) {}
+
+SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller,
+                                     std::function<ssize_t(int, const msghdr*, int)> send_msg)
+    : send_msg_(std::move(send_msg)) {
   sockfd_ = sockfd;
   queue_not_empty_fd_ = eventfd(0, 0);
   PCHECK(queue_not_empty_fd_ != -1);
   poller->AddFdWithOnlyReadHandler(queue_not_empty_fd_,
                                    std::bind(&SocketWriteHelper::ProcessQueueNotEmptyEvent, this));
+  zerocopy_min_bytes_ = EnvInteger<ONEFLOW_COMM_NET_ZEROCOPY_MIN_BYTES>();
+#ifdef OF_WITH_MSG_ZEROCOPY
+  const int enable_zerocopy = 1;
+  if (zerocopy_min_bytes_ > 0
+      && setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &enable_zerocopy, sizeof(int)) != 0) {
+    PLOG(WARNING) << "SO_ZEROCOPY is not supported by sockfd " << sockfd_;
+    zerocopy_min_bytes_ = 0;
+  }
+#else
+  zerocopy_min_bytes_ = 0;
+#endif
   cur_msg_queue_ = new std::queue<SocketMsg>;
   pending_msg_queue_ = new std::queue<SocketMsg>;
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-  write_ptr_ = nullptr;
-  write_size_ = 0;
+  batch_msgs_.reserve(kMaxBatchMsgNum);
+  batch_iovecs_.reserve(2 * kMaxBatchMsgNum);
+  batch_iovec_idx_ = 0;
+  is_batch_zerocopy_ = false;
+  zerocopy_body_.iov_base = nullptr;
+  zerocopy_body_.iov_len = 0;
 }
 
 void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
@@ -55,6 +95,39 @@ void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
 
 void SocketWriteHelper::NotifyMeSocketWriteable() { WriteUntilMsgQueueEmptyOrSocketNotWriteable(); }
 
+void SocketWriteHelper::NotifyMeSocketError() {
+  int error = 0;
+  socklen_t len = sizeof(error);
+  PCHECK(getsockopt(sockfd_, SOL_SOCKET, SO_ERROR, &error, &len) == 0);
+  CHECK_EQ(error, 0) << "sockfd " << sockfd_ << ": " << strerror(error);
+#ifdef OF_WITH_MSG_ZEROCOPY
+  // The pages of a payload are unpinned once their completion is queued. Nothing waits for it:
+  // the peer acknowledges the payload by a message of its own, which implies it was sent.
+  while (true) {
+    char control[128];
+    msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sockfd_, &msg, MSG_ERRQUEUE) == -1) {
+      PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+      return;
+    }
+    CHECK_EQ(msg.msg_flags & MSG_CTRUNC, 0) << "sockfd " << sockfd_ << ": truncated error queue";
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      const bool is_recv_err = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                               || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+      CHECK(is_recv_err) << "sockfd " << sockfd_ << ": unexpected control message of level "
+                         << cmsg->cmsg_level << " and type " << cmsg->cmsg_type;
+      const auto* err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+      // Any other origin is a real error of the socket, e.g. an ICMP error.
+      CHECK_EQ(err->ee_origin, SO_EE_ORIGIN_ZEROCOPY)
+          << "sockfd " << sockfd_ << ": " << strerror(err->ee_errno);
+      CHECK_EQ(err->ee_errno, 0) << "sockfd " << sockfd_ << ": " << strerror(err->ee_errno);
+    }
+  }
+#endif
+}
+
 void SocketWriteHelper::SendQueueNotEmptyEvent() {
   uint64_t event_num = 1;
   PCHECK(write(queue_not_empty_fd_, &event_num, 8) == 8);
@@ -67,81 +140,78 @@ void SocketWriteHelper::ProcessQueueNotEmptyEvent() {
 }
 
 void SocketWriteHelper::WriteUntilMsgQueueEmptyOrSocketNotWriteable() {
-  while ((this->*cur_write_handle_)()) {}
-}
-
-bool SocketWriteHelper::InitMsgWriteHandle() {
-  if (cur_msg_queue_->empty()) {
-    {
-      std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
-      std::swap(cur_msg_queue_, pending_msg_queue_);
-    }
-    if (cur_msg_queue_->empty()) { return false; }
+  while (true) {
+    if (batch_iovec_idx_ == batch_iovecs_.size() && !InitBatch()) { return; }
+    if (!WriteBatch()) { return; }
   }
-  cur_msg_ = cur_msg_queue_->front();
-  cur_msg_queue_->pop();
-  write_ptr_ = reinterpret_cast<const char*>(&cur_msg_);
-  write_size_ = sizeof(cur_msg_);
-  cur_write_handle_ = &SocketWriteHelper::MsgHeadWriteHandle;
-  return true;
-}
-
-bool SocketWriteHelper::MsgHeadWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgHeadDone);
-}
-
-bool SocketWriteHelper::MsgBodyWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgBodyDone);
 }
 
-bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
-  ssize_t n = write(sockfd_, write_ptr_, write_size_);
-  if (n == write_size_) {
-    (this->*set_cur_write_done)();
+bool SocketWriteHelper::InitBatch() {
+  batch_msgs_.clear();
+  batch_iovecs_.clear();
+  batch_iovec_idx_ = 0;
+  is_batch_zerocopy_ = false;
+  if (zerocopy_body_.iov_len > 0) {
+    batch_iovecs_.emplace_back(zerocopy_body_);
+    is_batch_zerocopy_ = true;
+    zerocopy_body_.iov_len = 0;
     return true;
-  } else if (n >= 0) {
-    write_ptr_ += n;
-    write_size_ -= n;
-    return true;
-  } else {
-    CHECK_EQ(n, -1);
+  }
+  while (batch_msgs_.size() < kMaxBatchMsgNum) {
+    if (cur_msg_queue_->empty()) {
+      {
+        std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
+        std::swap(cur_msg_queue_, pending_msg_queue_);
+      }
+      if (cur_msg_queue_->empty()) { break; }
+    }
+    batch_msgs_.emplace_back(cur_msg_queue_->front());
+    cur_msg_queue_->pop();
+    iovec head;
+    head.iov_base = &batch_msgs_.back();
+    head.iov_len = sizeof(SocketMsg);
+    batch_iovecs_.emplace_back(head);
+    iovec body;
+    if (!GetMsgBody(batch_msgs_.back(), &body)) { continue; }
+    if (zerocopy_min_bytes_ > 0 && body.iov_len >= zerocopy_min_bytes_) {
+      zerocopy_body_ = body;
+      break;
+    }
+    batch_iovecs_.emplace_back(body);
+  }
+  return !batch_iovecs_.empty();
+}
+
+bool SocketWriteHelper::WriteBatch() {
+  msghdr msg{};
+  msg.msg_iov = batch_iovecs_.data() + batch_iovec_idx_;
+  msg.msg_iovlen = std::min<size_t>(batch_iovecs_.size() - batch_iovec_idx_, IOV_MAX);
+  int flags = 0;
+#ifdef OF_WITH_MSG_ZEROCOPY
+  if (is_batch_zerocopy_) { flags |= MSG_ZEROCOPY; }
+#endif
+  ssize_t n = send_msg_(sockfd_, &msg, flags);
+  if (n == -1) {
+    if (is_batch_zerocopy_ && errno == ENOBUFS) {
+      // Out of the memory to pin pages for, copy the payload instead.
+      is_batch_zerocopy_ = false;
+      return true;
+    }
     PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
     return false;
   }
-}
-
-void SocketWriteHelper::SetStatusWhenMsgHeadDone() {
-  switch (cur_msg_.msg_type) {
-#define MAKE_ENTRY(x, y) \
-  case SocketMsgType::k##x: return SetStatusWhen##x##MsgHeadDone();
-    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
-    default: UNIMPLEMENTED();
+  size_t written = n;
+  while (written > 0) {
+    iovec* iov = &batch_iovecs_.at(batch_iovec_idx_);
+    if (written < iov->iov_len) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+      iov->iov_len -= written;
+      break;
+    }
+    written -= iov->iov_len;
+    batch_iovec_idx_ += 1;
   }
-}
-
-void SocketWriteHelper::SetStatusWhenMsgBodyDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestReadMsgHeadDone() {
-  const void* src_token = cur_msg_.request_read_msg.src_token;
-  auto src_mem_desc = static_cast<const SocketMemDesc*>(src_token);
-  write_ptr_ = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
-  write_size_ = src_mem_desc->byte_size;
-  cur_write_handle_ = &SocketWriteHelper::MsgBodyWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenActorMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenTransportMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+  return true;
 }
 
 }  // namespace oneflow
@@ -21,6 +21,8 @@ limitations under the License.
 
 #ifdef OF_PLATFORM_POSIX
 
+#include <sys/uio.h>
+
 namespace oneflow {
 
 class SocketWriteHelper final {
@@ -30,40 +32,44 @@ class SocketWriteHelper final {
   ~SocketWriteHelper();
 
   SocketWriteHelper(int sockfd, IOEventPoller* poller);
+  // Writes with send_msg instead of sendmsg(2), so that tests can inject errors and short writes.
+  SocketWriteHelper(int sockfd, IOEventPoller* poller,
+                    std::function<ssize_t(int, const msghdr*, int)> send_msg);
 
   void AsyncWrite(const SocketMsg& msg);
 
   void NotifyMeSocketWriteable();
+  // Reaps the completions of MSG_ZEROCOPY sends from the error queue of the socket.
+  void NotifyMeSocketError();
 
  private:
   void SendQueueNotEmptyEvent();
   void ProcessQueueNotEmptyEvent();
 
   void WriteUntilMsgQueueEmptyOrSocketNotWriteable();
-  bool InitMsgWriteHandle();
-  bool MsgHeadWriteHandle();
-  bool MsgBodyWriteHandle();
-
-  bool DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)());
-  void SetStatusWhenMsgHeadDone();
-  void SetStatusWhenMsgBodyDone();
-
-#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
-  OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
+  // Gathers the heads and bodies of queued messages into one batch, returns false if there are
+  // none. A body sent with MSG_ZEROCOPY makes a batch of its own.
+  bool InitBatch();
+  // Writes as much of the batch as the socket takes, returns false if it is not writeable.
+  bool WriteBatch();
 
+  std::function<ssize_t(int, const msghdr*, int)> send_msg_;
   int sockfd_;
   int queue_not_empty_fd_;
+  size_t zerocopy_min_bytes_;
 
   std::queue<SocketMsg>* cur_msg_queue_;
 
   std::mutex pending_msg_queue_mtx_;
   std::queue<SocketMsg>* pending_msg_queue_;
 
-  SocketMsg cur_msg_;
-  bool (SocketWriteHelper::*cur_write_handle_)();
-  const char* write_ptr_;
-  size_t write_size_;
+  // The heads of the messages in the batch, never reallocated while the batch is written.
+  std::vector<SocketMsg> batch_msgs_;
+  std::vector<iovec> batch_iovecs_;
+  size_t batch_iovec_idx_;
+  bool is_batch_zerocopy_;
+  // The body of the last message of the batch, written after it with MSG_ZEROCOPY.
+  iovec zerocopy_body_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,219 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef __linux__
+
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include "oneflow/core/comm_network/epoll/socket_write_helper.h"
+#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+
+namespace oneflow {
+
+namespace {
+
+using SendMsgFn = std::function<ssize_t(int, const msghdr*, int)>;
+
+// A connected pair of tcp sockets over the loopback, the writer is non-blocking like the sockets
+// of EpollCommNet.
+void NewLoopbackSocketPair(int* writer, int* reader) {
+  const int listener = socket(AF_INET, SOCK_STREAM, 0);
+  PCHECK(listener != -1);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  PCHECK(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+  PCHECK(listen(listener, 1) == 0);
+  socklen_t addr_len = sizeof(addr);
+  PCHECK(getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0);
+  *writer = socket(AF_INET, SOCK_STREAM, 0);
+  PCHECK(*writer != -1);
+  PCHECK(connect(*writer, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+  *reader = accept(listener, nullptr, nullptr);
+  PCHECK(*reader != -1);
+  PCHECK(close(listener) == 0);
+  const int opt = fcntl(*writer, F_GETFL);
+  PCHECK(opt != -1);
+  PCHECK(fcntl(*writer, F_SETFL, opt | O_NONBLOCK) == 0);
+}
+
+bool IsZerocopySupported(int sockfd) {
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+  const int enable_zerocopy = 1;
+  return setsockopt(sockfd, SOL_SOCKET, SO_ZEROCOPY, &enable_zerocopy, sizeof(int)) == 0;
+#else
+  return false;
+#endif
+}
+
+SocketMsg NewRequestReadMsg(SocketMemDesc* mem_desc) {
+  SocketMsg msg{};
+  msg.msg_type = SocketMsgType::kRequestRead;
+  msg.request_read_msg.src_token = mem_desc;
+  return msg;
+}
+
+// Writes every body as the payload of a kRequestRead message, and returns what the reader got.
+std::string WriteAll(int writer, int reader, const SendMsgFn& send_msg,
+                     std::vector<std::string>* bodies, std::vector<SocketMsg>* msgs) {
+  std::vector<SocketMemDesc> mem_descs(bodies->size());
+  size_t total_bytes = 0;
+  IOEventPoller poller;
+  SocketWriteHelper write_helper(writer, &poller, send_msg);
+  for (size_t i = 0; i < bodies->size(); ++i) {
+    mem_descs.at(i).mem_ptr = &bodies->at(i)[0];
+    mem_descs.at(i).byte_size = bodies->at(i).size();
+    msgs->emplace_back(NewRequestReadMsg(&mem_descs.at(i)));
+    write_helper.AsyncWrite(msgs->back());
+    total_bytes += sizeof(SocketMsg) + bodies->at(i).size();
+  }
+  std::string received(total_bytes, '\0');
+  std::atomic<bool> done(false);
+  std::thread read_thread([&]() {
+    size_t offset = 0;
+    while (offset < total_bytes) {
+      const ssize_t n = read(reader, &received[offset], total_bytes - offset);
+      PCHECK(n > 0);
+      offset += n;
+    }
+    done = true;
+  });
+  while (!done) {
+    write_helper.NotifyMeSocketWriteable();
+    pollfd fd{};
+    fd.fd = writer;
+    fd.events = POLLOUT;
+    PCHECK(poll(&fd, 1, 100) != -1);
+  }
+  read_thread.join();
+  return received;
+}
+
+std::string ExpectedBytes(const std::vector<std::string>& bodies,
+                          const std::vector<SocketMsg>& msgs) {
+  std::string expected;
+  for (size_t i = 0; i < bodies.size(); ++i) {
+    expected.append(reinterpret_cast<const char*>(&msgs.at(i)), sizeof(SocketMsg));
+    expected.append(bodies.at(i));
+  }
+  return expected;
+}
+
+std::string RandomBody(size_t size, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::string body(size, '\0');
+  for (char& c : body) { c = static_cast<char>(gen()); }
+  return body;
+}
+
+}  // namespace
+
+TEST(SocketWriteHelper, partial_write) {
+  setenv("ONEFLOW_COMM_NET_ZEROCOPY_MIN_BYTES", "0", 1);
+  int writer = -1;
+  int reader = -1;
+  NewLoopbackSocketPair(&writer, &reader);
+  // Takes at most 777 bytes per call, so that writes stop in the middle of heads and bodies.
+  std::atomic<int64_t> num_short_writes(0);
+  SendMsgFn send_msg = [&](int sockfd, const msghdr* msg, int flags) -> ssize_t {
+    msghdr short_msg = *msg;
+    iovec iov = msg->msg_iov[0];
+    iov.iov_len = std::min<size_t>(iov.iov_len, 777);
+    short_msg.msg_iov = &iov;
+    short_msg.msg_iovlen = 1;
+    const ssize_t n = sendmsg(sockfd, &short_msg, flags);
+    if (n > 0 && (msg->msg_iovlen > 1 || static_cast<size_t>(n) < msg->msg_iov[0].iov_len)) {
+      num_short_writes += 1;
+    }
+    return n;
+  };
+  std::vector<std::string> bodies{RandomBody(100000, 0), RandomBody(10, 1), RandomBody(5000, 2)};
+  std::vector<SocketMsg> msgs;
+  const std::string received = WriteAll(writer, reader, send_msg, &bodies, &msgs);
+  ASSERT_GT(num_short_writes, 0);
+  ASSERT_TRUE(received == ExpectedBytes(bodies, msgs));
+  PCHECK(close(writer) == 0);
+  PCHECK(close(reader) == 0);
+}
+
+TEST(SocketWriteHelper, zerocopy_enobufs_fallback) {
+  setenv("ONEFLOW_COMM_NET_ZEROCOPY_MIN_BYTES", "1024", 1);
+  int writer = -1;
+  int reader = -1;
+  NewLoopbackSocketPair(&writer, &reader);
+  if (!IsZerocopySupported(writer)) {
+    PCHECK(close(writer) == 0);
+    PCHECK(close(reader) == 0);
+    GTEST_SKIP() << "SO_ZEROCOPY is not supported";
+  }
+  // Fails every MSG_ZEROCOPY send as if the pages could not be pinned.
+  std::atomic<int64_t> num_zerocopy_sends(0);
+  SendMsgFn send_msg = [&](int sockfd, const msghdr* msg, int flags) -> ssize_t {
+    if (flags & MSG_ZEROCOPY) {
+      num_zerocopy_sends += 1;
+      errno = ENOBUFS;
+      return -1;
+    }
+    return sendmsg(sockfd, msg, flags);
+  };
+  std::vector<std::string> bodies{RandomBody(10, 0), RandomBody(65536, 1), RandomBody(100, 2)};
+  std::vector<SocketMsg> msgs;
+  const std::string received = WriteAll(writer, reader, send_msg, &bodies, &msgs);
+  ASSERT_EQ(num_zerocopy_sends, 1);
+  ASSERT_TRUE(received == ExpectedBytes(bodies, msgs));
+  PCHECK(close(writer) == 0);
+  PCHECK(close(reader) == 0);
+}
+
+TEST(SocketWriteHelper, zerocopy_completions) {
+  setenv("ONEFLOW_COMM_NET_ZEROCOPY_MIN_BYTES", "1024", 1);
+  int writer = -1;
+  int reader = -1;
+  NewLoopbackSocketPair(&writer, &reader);
+  if (!IsZerocopySupported(writer)) {
+    PCHECK(close(writer) == 0);
+    PCHECK(close(reader) == 0);
+    GTEST_SKIP() << "SO_ZEROCOPY is not supported";
+  }
+  std::vector<std::string> bodies{RandomBody(262144, 0), RandomBody(262144, 1)};
+  std::vector<SocketMsg> msgs;
+  const std::string received = WriteAll(writer, reader, &sendmsg, &bodies, &msgs);
+  ASSERT_TRUE(received == ExpectedBytes(bodies, msgs));
+  // The completions are queued once the payloads are acknowledged, POLLERR is always reported.
+  IOEventPoller poller;
+  SocketWriteHelper write_helper(writer, &poller);
+  pollfd fd{};
+  fd.fd = writer;
+  fd.events = 0;
+  ASSERT_EQ(poll(&fd, 1, 10000), 1);
+  ASSERT_TRUE(fd.revents & POLLERR);
+  write_helper.NotifyMeSocketError();
+  char control[128];
+  msghdr msg{};
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ASSERT_EQ(recvmsg(writer, &msg, MSG_ERRQUEUE), -1);
+  ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+  PCHECK(close(writer) == 0);
+  PCHECK(close(reader) == 0);
+}
+
+}  // namespace oneflow
+
+#endif  // __linux__
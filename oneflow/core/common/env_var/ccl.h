@@ -0,0 +1,35 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_ENV_VAR_CCL_H_
+#define ONEFLOW_CORE_COMMON_ENV_VAR_CCL_H_
+
+#include "oneflow/core/common/env_var/env_var.h"
+
+namespace oneflow {
+
+// CPU all-reduce of at most this many bytes uses recursive doubling, larger ones a pipelined ring.
+// All ranks must agree on both values, or they wait for messages that are never sent.
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_CCL_CPU_ALL_REDUCE_RECURSIVE_DOUBLING_MAX_BYTES, 64 * 1024);
+// Bytes of the chunks the CPU ring all-reduce sends, so that reducing a chunk overlaps with the
+// transfer of the next ones.
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_CCL_CPU_ALL_REDUCE_CHUNK_BYTES, 1024 * 1024);
+// CPU collectives exchange data between the ranks on a host through shared memory, with a buffer
+// of this many bytes per rank.
+DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_CCL_CPU_ENABLE_SHM, true);
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_CCL_CPU_SHM_BUFFER_BYTES, 4 * 1024 * 1024);
+
+}  // namespace oneflow
+#endif  // ONEFLOW_CORE_COMMON_ENV_VAR_CCL_H_
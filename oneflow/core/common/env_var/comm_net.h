@@ -0,0 +1,31 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_ENV_VAR_COMM_NET_H_
+#define ONEFLOW_CORE_COMMON_ENV_VAR_COMM_NET_H_
+
+#include "oneflow/core/common/env_var/env_var.h"
+
+namespace oneflow {
+
+// Register payloads of EpollCommNet of at least this many bytes are sent with MSG_ZEROCOPY, 0
+// disables it.
+DEFINE_ENV_INTEGER(ONEFLOW_COMM_NET_ZEROCOPY_MIN_BYTES, 1024 * 1024);
+// Microseconds the pollers of EpollCommNet keep polling after an event before they sleep in
+// epoll_wait, also set as SO_BUSY_POLL of the sockets. 0 disables busy polling.
+DEFINE_ENV_INTEGER(ONEFLOW_COMM_NET_BUSY_POLL_US, 0);
+
+}  // namespace oneflow
+#endif  // ONEFLOW_CORE_COMMON_ENV_VAR_COMM_NET_H_
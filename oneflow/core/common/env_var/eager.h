@@ -28,11 +28,23 @@ namespace oneflow {
 DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_EAGER_ENABLE_LOCAL_INFER_CACHE, true);
 
 // NOTE: use env variable 'ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE' indicate the size of
-// infer cache in op interpret.
-DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE, 128 * 1024);
+// infer cache of each op in op interpret, the least recently used results are dropped beyond it.
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE, 4096);
 
 DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_EAGER_NCCL_USE_COMPUTE_STREAM, false);
 
+// NOTE: use env variable 'ONEFLOW_EAGER_ELEMENTWISE_FUSION' indicate whether consecutive
+// elementwise ops on cpu tensors are deferred and run by one fused kernel, at most
+// 'ONEFLOW_EAGER_ELEMENTWISE_FUSION_MAX_OPS' ops at a time.
+DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_EAGER_ELEMENTWISE_FUSION, false);
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_EAGER_ELEMENTWISE_FUSION_MAX_OPS, 64);
+
+// NOTE: use env variable 'ONEFLOW_EAGER_PARALLEL_BACKWARD' indicate whether the backward
+// functions of the autograd nodes that are ready at the same time run concurrently, on at most
+// 'ONEFLOW_EAGER_PARALLEL_BACKWARD_THREAD_NUM' threads.
+DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_EAGER_PARALLEL_BACKWARD, false);
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_EAGER_PARALLEL_BACKWARD_THREAD_NUM, 4);
+
 inline bool EagerNcclUseComputeStream() {
 #if defined(WITH_CUDA) && NCCL_VERSION_CODE > 2700
   static bool eager_nccl_use_compute_stream =
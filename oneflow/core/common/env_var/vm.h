@@ -26,6 +26,21 @@ DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_VM_PENDING_HANDLE_WINDOW_SIZE, 10)
 DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_VM_ENABLE_SCHEDULE_YIELD, true)
 DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_VM_WORKER_THREAD_LIMIT, 16);
 DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_VM_MULTI_THREAD, true);
+// Bytes of small pieces each thread may keep cached in front of a BinAllocator, 0 disables it.
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_VM_BIN_ALLOCATOR_THREAD_CACHE_SIZE, 4 * 1024 * 1024);
+// Rounds the scheduler and the worker threads poll for new work before they park: rounds of
+// busy polling, adapted to the rate of work up to the given count, then rounds of yielding.
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_VM_SCHEDULER_SPIN_COUNT, 1024);
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_VM_SCHEDULER_YIELD_COUNT, 0);
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_VM_WORKER_SPIN_COUNT, 1024);
+DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_VM_WORKER_YIELD_COUNT, 0);
+// CPUs to pin the scheduler thread and the worker threads to, lists like "0-3,8". Each worker is
+// pinned to one of the worker CPUs, round robin in creation order. Empty lists leave the threads
+// unpinned.
+DEFINE_THREAD_LOCAL_ENV_STRING(ONEFLOW_VM_SCHEDULER_CPUS, "");
+DEFINE_THREAD_LOCAL_ENV_STRING(ONEFLOW_VM_WORKER_CPUS, "");
+// Whether to record instruction latencies from the start, see InstructionLatencyStats.
+DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_VM_INSTRUCTION_LATENCY_STATS, false);
 
 }  // namespace oneflow
 #endif  // ONEFLOW_CORE_COMMON_ENV_VAR_VM_H_
@@ -0,0 +1,179 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/channel.h"
+
+namespace oneflow {
+
+// Channel with many senders and exactly one receiver. Senders push onto a lock-free stack with a
+// single CAS, the receiver takes the whole stack with one exchange and hands it out in sending
+// order, so neither side takes a lock while the receiver is busy. An idle receiver spins for a
+// while before it parks, the spin budget grows when spinning pays off and shrinks when it does not.
+// Items sent by one sender are received in the order they were sent.
+template<typename T>
+class MpscChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MpscChannel);
+  MpscChannel()
+      : head_(nullptr), is_closed_(false), is_parked_(false), spin_count_(kMaxSpinCount) {}
+  ~MpscChannel() { FreeNodes(head_.exchange(nullptr)); }
+
+  template<typename U>
+  ChannelStatus Send(U&& item);
+  template<typename InputIt>
+  ChannelStatus SendMany(InputIt first, InputIt last);
+  // Must only be called from the receiver thread.
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  void Close();
+
+ private:
+  static constexpr int32_t kMinSpinCount = 16;
+  static constexpr int32_t kMaxSpinCount = 4096;
+
+  struct Node {
+    template<typename U>
+    explicit Node(U&& item) : item(std::forward<U>(item)), next(nullptr) {}
+    T item;
+    Node* next;
+  };
+
+  // Pushes the chain from `first` to `last`, linked through Node::next, as a whole.
+  void Push(Node* first, Node* last);
+  Node* TakeAll();
+  static void FreeNodes(Node* node);
+
+  std::atomic<Node*> head_;
+  std::atomic<bool> is_closed_;
+  std::atomic<bool> is_parked_;
+  int32_t spin_count_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
+template<typename T>
+template<typename U>
+ChannelStatus MpscChannel<T>::Send(U&& item) {
+  if (is_closed_.load(std::memory_order_relaxed)) { return kChannelStatusErrorClosed; }
+  Node* node = new Node(std::forward<U>(item));
+  Push(node, node);
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+template<typename InputIt>
+ChannelStatus MpscChannel<T>::SendMany(InputIt first, InputIt last) {
+  if (is_closed_.load(std::memory_order_relaxed)) { return kChannelStatusErrorClosed; }
+  if (first == last) { return kChannelStatusSuccess; }
+  // The stack is popped newest first, so the chain is linked from the last item backwards.
+  Node* chain_last = new Node(*first);
+  Node* chain_first = chain_last;
+  for (auto it = std::next(first); it != last; ++it) {
+    Node* node = new Node(*it);
+    node->next = chain_first;
+    chain_first = node;
+  }
+  Push(chain_first, chain_last);
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+void MpscChannel<T>::Push(Node* first, Node* last) {
+  Node* head = head_.load(std::memory_order_relaxed);
+  do {
+    last->next = head;
+  } while (!head_.compare_exchange_weak(head, first, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed));
+  // Pairs with the store of is_parked_ and the exchange of head_ in ReceiveMany: either the
+  // receiver finds this chain before parking or this sender finds the receiver parked.
+  if (is_parked_.load(std::memory_order_seq_cst)) {
+    { std::unique_lock<std::mutex> lock(mutex_); }
+    cond_.notify_one();
+  }
+}
+
+template<typename T>
+typename MpscChannel<T>::Node* MpscChannel<T>::TakeAll() {
+  Node* node = head_.exchange(nullptr, std::memory_order_seq_cst);
+  Node* reversed = nullptr;
+  while (node != nullptr) {
+    Node* next = node->next;
+    node->next = reversed;
+    reversed = node;
+    node = next;
+  }
+  return reversed;
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::ReceiveMany(std::queue<T>* items) {
+  Node* node = TakeAll();
+  if (node == nullptr) {
+    FOR_RANGE(int32_t, i, 0, spin_count_) {
+      if (head_.load(std::memory_order_relaxed) != nullptr) {
+        node = TakeAll();
+        break;
+      }
+      std::this_thread::yield();
+    }
+    if (node != nullptr) {
+      spin_count_ = std::min(spin_count_ * 2, kMaxSpinCount);
+    } else {
+      spin_count_ = std::max(spin_count_ / 2, kMinSpinCount);
+      is_parked_.store(true, std::memory_order_seq_cst);
+      node = TakeAll();
+      if (node == nullptr) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() {
+          return head_.load(std::memory_order_relaxed) != nullptr || is_closed_.load();
+        });
+        lock.unlock();
+        node = TakeAll();
+      }
+      is_parked_.store(false, std::memory_order_relaxed);
+    }
+  }
+  if (node == nullptr) { return kChannelStatusErrorClosed; }
+  while (node != nullptr) {
+    items->push(std::move(node->item));
+    Node* next = node->next;
+    delete node;
+    node = next;
+  }
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+void MpscChannel<T>::Close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  is_closed_ = true;
+  cond_.notify_all();
+}
+
+template<typename T>
+void MpscChannel<T>::FreeNodes(Node* node) {
+  while (node != nullptr) {
+    Node* next = node->next;
+    delete node;
+    node = next;
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
@@ -0,0 +1,60 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/common/mpsc_channel.h"
+
+namespace oneflow {
+
+TEST(MpscChannel, 30sender1receiver) {
+  MpscChannel<std::pair<int, int>> channel;
+  const int sender_num = 30;
+  const int msg_num = 2000;
+  std::vector<std::thread> senders;
+  for (int i = 0; i < sender_num; ++i) {
+    senders.emplace_back([&channel, i]() {
+      for (int j = 0; j < msg_num; j += 2) {
+        if (j % 4 == 0) {
+          ASSERT_EQ(channel.Send(std::make_pair(i, j)), kChannelStatusSuccess);
+          ASSERT_EQ(channel.Send(std::make_pair(i, j + 1)), kChannelStatusSuccess);
+        } else {
+          std::vector<std::pair<int, int>> msgs{{i, j}, {i, j + 1}};
+          ASSERT_EQ(channel.SendMany(msgs.begin(), msgs.end()), kChannelStatusSuccess);
+        }
+      }
+    });
+  }
+  // Messages of each sender must come out in the order they were sent.
+  std::vector<int> next(sender_num, 0);
+  std::thread receiver([&]() {
+    std::queue<std::pair<int, int>> msgs;
+    while (channel.ReceiveMany(&msgs) == kChannelStatusSuccess) {
+      while (!msgs.empty()) {
+        ASSERT_EQ(msgs.front().second, next.at(msgs.front().first));
+        next.at(msgs.front().first) += 1;
+        msgs.pop();
+      }
+    }
+  });
+  for (std::thread& sender : senders) { sender.join(); }
+  // Give the receiver a chance to park before closing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  channel.Close();
+  receiver.join();
+  for (int i = 0; i < sender_num; ++i) { ASSERT_EQ(next.at(i), msg_num); }
+  ASSERT_EQ(channel.Send(std::make_pair(0, 0)), kChannelStatusErrorClosed);
+}
+
+}  // namespace oneflow
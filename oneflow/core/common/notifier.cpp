@@ -13,41 +13,85 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <thread>
 #include "oneflow/core/common/notifier.h"
 #include "oneflow/core/common/foreign_lock_helper.h"
 #include "oneflow/core/common/env_var/env_var.h"
 
 namespace oneflow {
 
+namespace {
+
+// Spin rounds never adapt below this, so that a spinning waiter can recover after a quiet spell.
+constexpr size_t kMinSpinCount = 16;
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+}  // namespace
+
 NotifierStatus Notifier::Notify() {
-  bool notify = false;
-  {
-    std::unique_lock<std::mutex> lock(mutex_);
-    if (is_closed_) { return kNotifierStatusErrorClosed; }
-    notify = (notified_cnt_ == 0);
-    ++notified_cnt_;
+  if (is_closed_.load(std::memory_order_acquire)) { return kNotifierStatusErrorClosed; }
+  if (notified_cnt_.fetch_add(1) == 0 && num_parked_waiters_.load() > 0) {
+    // Taking the mutex makes sure the parked waiter is waiting on cond_ before it is notified.
+    { std::unique_lock<std::mutex> lock(mutex_); }
+    cond_.notify_one();
   }
-  if (notify) { cond_.notify_one(); }
   return kNotifierStatusSuccess;
 }
 
 NotifierStatus Notifier::WaitAndClearNotifiedCnt() {
-  std::unique_lock<std::mutex> lock(mutex_);
-  cond_.wait(lock, [this]() { return notified_cnt_ > 0 || is_closed_; });
-  if (notified_cnt_ == 0) { return kNotifierStatusErrorClosed; }
-  notified_cnt_ = 0;
+  if (notified_cnt_.load(std::memory_order_acquire) == 0) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    num_parked_waiters_.fetch_add(1);
+    cond_.wait(lock, [this]() { return notified_cnt_.load() > 0 || is_closed_.load(); });
+    num_parked_waiters_.fetch_sub(1);
+  }
+  if (notified_cnt_.exchange(0) == 0) { return kNotifierStatusErrorClosed; }
   return kNotifierStatusSuccess;
 }
 
+NotifierStatus Notifier::WaitAndClearNotifiedCnt(const NotifierSpinPolicy& policy) {
+  const size_t max_spin_count = policy.max_spin_count;
+  spin_count_ = std::max(spin_count_, std::min(kMinSpinCount, max_spin_count));
+  spin_count_ = std::min(spin_count_, max_spin_count);
+  const auto& Notified = [this]() {
+    return notified_cnt_.load(std::memory_order_acquire) > 0
+           || is_closed_.load(std::memory_order_acquire);
+  };
+  bool notified = Notified();
+  for (size_t i = 0; !notified && i < spin_count_; ++i) {
+    CpuRelax();
+    notified = Notified();
+  }
+  for (size_t i = 0; !notified && i < policy.yield_count; ++i) {
+    std::this_thread::yield();
+    notified = Notified();
+  }
+  if (notified) {
+    spin_count_ = std::min(spin_count_ * 2, max_spin_count);
+  } else {
+    spin_count_ = std::max(spin_count_ / 2, std::min(kMinSpinCount, max_spin_count));
+  }
+  return WaitAndClearNotifiedCnt();
+}
+
 Maybe<void> Notifier::TimedWaitAndClearNotifiedCnt(size_t timeout_seconds) {
   return Singleton<ForeignLockHelper>::Get()->WithScopedRelease([&, this]() -> Maybe<void> {
     std::chrono::duration<size_t> seconds(timeout_seconds);
     std::unique_lock<std::mutex> lock(mutex_);
-    CHECK_OR_RETURN(cond_.wait_for(lock, seconds, [this]() {
-      return notified_cnt_ > 0 || is_closed_;
-    })) << Error::TimeoutError();
-    CHECK_GT_OR_RETURN(notified_cnt_, 0) << "notifier closed.";
-    notified_cnt_ = 0;
+    num_parked_waiters_.fetch_add(1);
+    const bool ready = cond_.wait_for(
+        lock, seconds, [this]() { return notified_cnt_.load() > 0 || is_closed_.load(); });
+    num_parked_waiters_.fetch_sub(1);
+    CHECK_OR_RETURN(ready) << Error::TimeoutError();
+    const size_t notified_cnt = notified_cnt_.exchange(0);
+    CHECK_GT_OR_RETURN(notified_cnt, 0) << "notifier closed.";
     return Maybe<void>::Ok();
   });
 }
@@ -65,7 +109,7 @@ Maybe<void> Notifier::TimedWaitAndClearNotifiedCnt(
 
 void Notifier::Close() {
   std::unique_lock<std::mutex> lock(mutex_);
-  is_closed_ = true;
+  is_closed_.store(true);
   cond_.notify_all();
 }
 
@@ -0,0 +1,51 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <atomic>
+#include <thread>
+#include "gtest/gtest.h"
+#include "oneflow/core/common/notifier.h"
+
+namespace oneflow {
+namespace test {
+
+TEST(Notifier, spin_then_park) {
+  Notifier notifier;
+  NotifierSpinPolicy policy;
+  policy.max_spin_count = 64;
+  policy.yield_count = 4;
+  const int notify_num = 1000;
+  std::atomic<int> sent(0);
+  std::atomic<int> received(0);
+  std::thread waiter([&]() {
+    while (notifier.WaitAndClearNotifiedCnt(policy) == kNotifierStatusSuccess) {
+      received.store(sent.load());
+    }
+  });
+  for (int i = 0; i < notify_num; ++i) {
+    sent.store(i + 1);
+    ASSERT_EQ(notifier.Notify(), kNotifierStatusSuccess);
+    // Let the waiter park now and then.
+    if (i % 100 == 0) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+  }
+  // Every notification wakes up the waiter, so it never misses the last one.
+  while (received.load() != notify_num) { std::this_thread::yield(); }
+  notifier.Close();
+  waiter.join();
+  ASSERT_EQ(notifier.Notify(), kNotifierStatusErrorClosed);
+}
+
+}  // namespace test
+}  // namespace oneflow
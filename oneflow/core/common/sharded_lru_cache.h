@@ -0,0 +1,110 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_SHARDED_LRU_CACHE_H_
+#define ONEFLOW_CORE_COMMON_SHARDED_LRU_CACHE_H_
+
+#include <array>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// A map from keys to values that drops its least recently used entries beyond `capacity`.
+// Threads look up and insert in one of kNumShards shards picked by the thread, each with its own
+// lock and its own `capacity`, so that threads sharing a cache rarely contend. A key may thus be
+// cached in several shards when it is used by several threads.
+template<typename K, typename V, typename Hash = std::hash<K>, size_t kNumShards = 4>
+class ShardedLruCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShardedLruCache);
+  explicit ShardedLruCache(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+  ~ShardedLruCache() = default;
+
+  size_t capacity() const { return capacity_; }
+
+  // Copies the value of `key` to `value` and marks it as the most recently used.
+  bool Find(const K& key, V* value) {
+    Shard* shard = MutThreadShard();
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    const auto& iter = shard->key2entry.find(key);
+    if (iter == shard->key2entry.end()) { return false; }
+    shard->entries.splice(shard->entries.begin(), shard->entries, iter->second);
+    *value = iter->second->second;
+    return true;
+  }
+
+  // Inserts or replaces the value of `key`, dropping the least recently used entry when full.
+  void Insert(const K& key, const V& value) {
+    Shard* shard = MutThreadShard();
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    const auto& iter = shard->key2entry.find(key);
+    if (iter != shard->key2entry.end()) {
+      iter->second->second = value;
+      shard->entries.splice(shard->entries.begin(), shard->entries, iter->second);
+      return;
+    }
+    if (shard->entries.size() >= capacity_) {
+      shard->key2entry.erase(shard->entries.back().first);
+      shard->entries.pop_back();
+    }
+    shard->entries.emplace_front(key, value);
+    shard->key2entry.emplace(key, shard->entries.begin());
+  }
+
+  // Entries in all shards.
+  size_t size() const {
+    size_t size = 0;
+    for (const Shard& shard : shards_) {
+      std::unique_lock<std::mutex> lock(shard.mutex);
+      size += shard.entries.size();
+    }
+    return size;
+  }
+
+  void Clear() {
+    for (Shard& shard : shards_) {
+      std::unique_lock<std::mutex> lock(shard.mutex);
+      shard.key2entry.clear();
+      shard.entries.clear();
+    }
+  }
+
+ private:
+  using EntryList = std::list<std::pair<K, V>>;
+
+  struct Shard {
+    mutable std::mutex mutex;
+    // Most recently used first.
+    EntryList entries;
+    std::unordered_map<K, typename EntryList::iterator, Hash> key2entry;
+  };
+
+  Shard* MutThreadShard() {
+    static std::atomic<size_t> next_thread_index(0);
+    thread_local const size_t thread_index = next_thread_index++;
+    return &shards_[thread_index % kNumShards];
+  }
+
+  const size_t capacity_;
+  std::array<Shard, kNumShards> shards_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_SHARDED_LRU_CACHE_H_
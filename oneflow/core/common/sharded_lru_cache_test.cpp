@@ -0,0 +1,65 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "gtest/gtest.h"
+#include "oneflow/core/common/sharded_lru_cache.h"
+
+namespace oneflow {
+namespace test {
+
+TEST(ShardedLruCache, drop_least_recently_used) {
+  ShardedLruCache<int, int> cache(3);
+  for (int i = 0; i < 3; ++i) { cache.Insert(i, i * 10); }
+  int value = 0;
+  ASSERT_TRUE(cache.Find(0, &value));
+  ASSERT_EQ(value, 0);
+  // 1 is the least recently used now.
+  cache.Insert(3, 30);
+  ASSERT_FALSE(cache.Find(1, &value));
+  ASSERT_TRUE(cache.Find(0, &value));
+  ASSERT_TRUE(cache.Find(2, &value));
+  ASSERT_TRUE(cache.Find(3, &value));
+  ASSERT_EQ(value, 30);
+  cache.Insert(3, 31);
+  ASSERT_TRUE(cache.Find(3, &value));
+  ASSERT_EQ(value, 31);
+  ASSERT_EQ(cache.size(), 3);
+  cache.Clear();
+  ASSERT_EQ(cache.size(), 0);
+}
+
+TEST(ShardedLruCache, bounded_in_every_shard) {
+  const int capacity = 16;
+  ShardedLruCache<int, int, std::hash<int>, 4> cache(capacity);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&cache, t]() {
+      for (int i = 0; i < 1000; ++i) {
+        const int key = t * 1000 + i;
+        cache.Insert(key, key);
+        // Another thread of the same shard may have dropped the key already.
+        int value = 0;
+        if (cache.Find(key, &value)) { ASSERT_EQ(value, key); }
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  // Which shards the threads use is not known, only that none holds more than its capacity.
+  ASSERT_LE(cache.size(), 4 * capacity);
+}
+
+}  // namespace test
+}  // namespace oneflow
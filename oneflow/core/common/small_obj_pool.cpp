@@ -0,0 +1,143 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "oneflow/core/common/small_obj_pool.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace obj_pool {
+
+namespace {
+
+constexpr size_t kNumClasses = SmallObjPool::kMaxBlockSize / SmallObjPool::kClassBytes;
+// Bytes of free blocks a thread keeps per size class, and blocks moved at once between a thread
+// cache and the shared free list.
+constexpr size_t kThreadCacheBytesPerClass = 64 << 10;  // 64KiB
+constexpr size_t kBatchSize = 32;
+
+size_t Class4Size(size_t size) {
+  return (size + SmallObjPool::kClassBytes - 1) / SmallObjPool::kClassBytes - 1;
+}
+
+size_t ClassBytes(size_t size_class) { return (size_class + 1) * SmallObjPool::kClassBytes; }
+
+size_t MaxCachedBlocks(size_t size_class) {
+  return std::max(2 * kBatchSize, kThreadCacheBytesPerClass / ClassBytes(size_class));
+}
+
+struct SharedFreeList {
+  std::mutex mutex;
+  std::vector<void*> blocks;
+};
+
+std::array<SharedFreeList, kNumClasses>* MutSharedFreeLists() {
+  // Leaked, blocks may be freed by static objects destroyed after it.
+  static auto* lists = new std::array<SharedFreeList, kNumClasses>();
+  return lists;
+}
+
+// Takes a block of the size class, and moves a batch more into `blocks` unless it is null.
+void* TakeFromSharedFreeList(size_t size_class, std::vector<void*>* blocks) {
+  SharedFreeList* list = &MutSharedFreeLists()->at(size_class);
+  std::unique_lock<std::mutex> lock(list->mutex);
+  if (list->blocks.empty()) {
+    lock.unlock();
+    return ::operator new(ClassBytes(size_class));
+  }
+  void* ptr = list->blocks.back();
+  list->blocks.pop_back();
+  if (blocks != nullptr) {
+    const size_t num = std::min(kBatchSize - 1, list->blocks.size());
+    blocks->insert(blocks->end(), list->blocks.end() - num, list->blocks.end());
+    list->blocks.resize(list->blocks.size() - num);
+  }
+  return ptr;
+}
+
+void GiveToSharedFreeList(size_t size_class, void* const* begin, void* const* end) {
+  SharedFreeList* list = &MutSharedFreeLists()->at(size_class);
+  std::unique_lock<std::mutex> lock(list->mutex);
+  list->blocks.insert(list->blocks.end(), begin, end);
+}
+
+struct ThreadCache {
+  std::array<std::vector<void*>, kNumClasses> blocks;
+
+  ~ThreadCache();
+};
+
+// Plain thread locals, they can still be read once the ThreadCache of the thread is destroyed.
+thread_local ThreadCache* thread_cache = nullptr;
+thread_local bool is_thread_cache_destroyed = false;
+
+ThreadCache::~ThreadCache() {
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    if (blocks.at(i).empty()) { continue; }
+    GiveToSharedFreeList(i, blocks.at(i).data(), blocks.at(i).data() + blocks.at(i).size());
+  }
+  thread_cache = nullptr;
+  is_thread_cache_destroyed = true;
+}
+
+ThreadCache* GetThreadCache() {
+  if (likely(thread_cache != nullptr)) { return thread_cache; }
+  // Objects freed by the destructors of other thread locals go to the shared free lists.
+  if (is_thread_cache_destroyed) { return nullptr; }
+  thread_local ThreadCache cache;
+  thread_cache = &cache;
+  return thread_cache;
+}
+
+}  // namespace
+
+/*static*/ void* SmallObjPool::Allocate(size_t size) {
+  if (unlikely(size == 0 || size > kMaxBlockSize)) { return ::operator new(size); }
+  const size_t size_class = Class4Size(size);
+  ThreadCache* cache = GetThreadCache();
+  if (unlikely(cache == nullptr)) { return TakeFromSharedFreeList(size_class, nullptr); }
+  std::vector<void*>* blocks = &cache->blocks.at(size_class);
+  if (unlikely(blocks->empty())) { return TakeFromSharedFreeList(size_class, blocks); }
+  void* ptr = blocks->back();
+  blocks->pop_back();
+  return ptr;
+}
+
+/*static*/ void SmallObjPool::Deallocate(void* ptr, size_t size) {
+  if (unlikely(size == 0 || size > kMaxBlockSize)) {
+    ::operator delete(ptr);
+    return;
+  }
+  const size_t size_class = Class4Size(size);
+  ThreadCache* cache = GetThreadCache();
+  if (unlikely(cache == nullptr)) {
+    GiveToSharedFreeList(size_class, &ptr, &ptr + 1);
+    return;
+  }
+  std::vector<void*>* blocks = &cache->blocks.at(size_class);
+  blocks->push_back(ptr);
+  if (unlikely(blocks->size() > MaxCachedBlocks(size_class))) {
+    // The oldest blocks go, the most recently freed ones are the most likely to be in cache.
+    GiveToSharedFreeList(size_class, blocks->data(), blocks->data() + kBatchSize);
+    blocks->erase(blocks->begin(), blocks->begin() + kBatchSize);
+  }
+}
+
+}  // namespace obj_pool
+}  // namespace oneflow
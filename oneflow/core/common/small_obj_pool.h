@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_SMALL_OBJ_POOL_H_
+#define ONEFLOW_CORE_COMMON_SMALL_OBJ_POOL_H_
+
+#include <cstddef>
+#include <memory>
+
+namespace oneflow {
+namespace obj_pool {
+
+// Pool of small memory blocks in size classes, for objects created and destroyed by every eager
+// op, like the EagerBlobObject of each output. Unlike SingleThreadObjPool, blocks may be freed on
+// any thread: each thread keeps a bounded cache of free blocks per size class, and exchanges
+// batches of them with a shared free list. Blocks are never given back to the system.
+class SmallObjPool final {
+ public:
+  static constexpr size_t kClassBytes = 32;
+  static constexpr size_t kMaxBlockSize = 2048;
+
+  static void* Allocate(size_t size);
+  static void Deallocate(void* ptr, size_t size);
+};
+
+// Allocator of std::allocate_shared, so that an object and its control block are one block of
+// SmallObjPool.
+template<typename T>
+class PoolAllocator final {
+ public:
+  using value_type = T;
+
+  PoolAllocator() noexcept = default;
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}  // NOLINT
+
+  T* allocate(size_t n) {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not pooled");
+    return static_cast<T*>(SmallObjPool::Allocate(n * sizeof(T)));
+  }
+  void deallocate(T* ptr, size_t n) noexcept { SmallObjPool::Deallocate(ptr, n * sizeof(T)); }
+
+  template<typename U>
+  bool operator==(const PoolAllocator<U>&) const noexcept {
+    return true;
+  }
+  template<typename U>
+  bool operator!=(const PoolAllocator<U>&) const noexcept {
+    return false;
+  }
+};
+
+// std::make_shared drawing from SmallObjPool.
+template<typename T, typename... Args>
+std::shared_ptr<T> make_shared(Args&&... args) {
+  return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+}  // namespace obj_pool
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_SMALL_OBJ_POOL_H_
@@ -0,0 +1,86 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "gtest/gtest.h"
+#include "oneflow/core/common/small_obj_pool.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace obj_pool {
+namespace test {
+
+namespace {
+
+struct Counted {  // NOLINT
+  explicit Counted(int64_t* num_alive) : num_alive(num_alive) { *num_alive += 1; }
+  ~Counted() { *num_alive -= 1; }
+  int64_t* num_alive;
+  char payload[100];
+};
+
+}  // namespace
+
+TEST(SmallObjPool, reuse) {
+  void* ptr = SmallObjPool::Allocate(40);
+  SmallObjPool::Deallocate(ptr, 40);
+  // Sizes of the same class share the blocks.
+  ASSERT_EQ(ptr, SmallObjPool::Allocate(64));
+  SmallObjPool::Deallocate(ptr, 64);
+  void* large = SmallObjPool::Allocate(SmallObjPool::kMaxBlockSize + 1);
+  SmallObjPool::Deallocate(large, SmallObjPool::kMaxBlockSize + 1);
+}
+
+TEST(SmallObjPool, make_shared) {
+  int64_t num_alive = 0;
+  std::weak_ptr<Counted> weak;
+  {
+    auto ptr = make_shared<Counted>(&num_alive);
+    weak = ptr;
+    ASSERT_EQ(num_alive, 1);
+  }
+  ASSERT_EQ(num_alive, 0);
+  ASSERT_TRUE(weak.expired());
+}
+
+TEST(SmallObjPool, free_on_other_threads) {
+  const int thread_num = 4;
+  const int obj_num = 10000;
+  std::vector<std::vector<std::shared_ptr<int64_t>>> objs(thread_num);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&objs, t]() {
+      for (int i = 0; i < obj_num; ++i) { objs.at(t).emplace_back(make_shared<int64_t>(i)); }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  threads.clear();
+  // Each thread frees the objects of another one, and allocates again from what it freed.
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&objs, t]() {
+      auto& others = objs.at((t + 1) % thread_num);
+      for (int i = 0; i < obj_num; ++i) { ASSERT_EQ(*others.at(i), i); }
+      others.clear();
+      std::vector<std::shared_ptr<int64_t>> again;
+      for (int i = 0; i < obj_num; ++i) { again.emplace_back(make_shared<int64_t>(-i)); }
+      for (int i = 0; i < obj_num; ++i) { ASSERT_EQ(*again.at(i), -i); }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+}
+
+}  // namespace test
+}  // namespace obj_pool
+}  // namespace oneflow
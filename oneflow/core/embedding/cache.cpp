@@ -26,7 +26,8 @@ std::unique_ptr<Cache> NewCache(const CacheOptions& options) {
   CHECK_GT(options.key_size, 0);
   CHECK_GT(options.value_size, 0);
   CHECK_GT(options.capacity, 0);
-  if (options.policy == CacheOptions::Policy::kLRU) {
+  if (options.policy == CacheOptions::Policy::kLRU
+      || options.policy == CacheOptions::Policy::kLFU) {
     return NewLruCache(options);
   } else if (options.policy == CacheOptions::Policy::kFull) {
     return NewFullCache(options);
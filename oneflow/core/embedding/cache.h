@@ -29,6 +29,9 @@ struct CacheOptions {
   enum class Policy {
     kLRU,
     kFull,
+    // Set associative LRU with TinyLFU admission: on a full set a new key only replaces the LRU
+    // victim if it has been accessed more often recently, rejected keys are returned as evicted.
+    kLFU,
   };
   enum class MemoryKind {
     kDevice,
@@ -104,6 +104,14 @@ class CacheKeyValueStoreImpl : public KeyValueStore {
   void SaveSnapshot(const std::string& name) override;
   void LoadSnapshot(const std::string& name,
                     const std::function<void(KVIterator* iter)>& Hook) override;
+  KeyValueStoreStatistics GetStatistics() override {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return statistics_;
+  }
+  void ResetStatistics() override {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    statistics_ = KeyValueStoreStatistics();
+  }
 
  private:
   void SyncCacheToStore();
@@ -122,6 +130,7 @@ class CacheKeyValueStoreImpl : public KeyValueStore {
   uint32_t num_elems_per_value_{};
   std::recursive_mutex mutex_;
   bool synced_;
+  KeyValueStoreStatistics statistics_;
 };
 
 template<typename Key, typename Elem>
@@ -140,6 +149,8 @@ void CacheKeyValueStoreImpl<Key, Elem>::Get(ep::Stream* stream, uint32_t num_key
                                 cuda_stream->cuda_stream()));
   CHECK_JUST(cuda_stream->Sync());
   const uint32_t num_cache_missing = *host_num_buffer_;
+  statistics_.num_query_keys += num_keys;
+  statistics_.num_cache_missing_keys += num_cache_missing;
   if (num_cache_missing == 0) {
     OF_CUDA_CHECK(cudaMemsetAsync(n_missing, 0, sizeof(uint32_t),
                                   stream->As<ep::CudaStream>()->cuda_stream()));
@@ -150,6 +161,7 @@ void CacheKeyValueStoreImpl<Key, Elem>::Get(ep::Stream* stream, uint32_t num_key
                                 cuda_stream->cuda_stream()));
   CHECK_JUST(cuda_stream->Sync());
   const uint32_t num_store_missing = *host_num_buffer_;
+  statistics_.num_store_missing_keys += num_store_missing;
   RUN_CUDA_KERNEL((PostStoreGetKernel<Key, Elem>), stream, num_cache_missing * num_elems_per_value_,
                   num_cache_missing, num_store_missing, num_elems_per_value_, indices_buffer0_,
                   indices_buffer1_, values_buffer_, static_cast<Elem*>(values), missing_indices);
@@ -0,0 +1,487 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/cpu_cache.h"
+#include "oneflow/core/embedding/hash_functions.cuh"
+#include "oneflow/core/embedding/frequency_sketch.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include <atomic>
+#include <limits>
+#include <mutex>
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+constexpr int64_t kParallelForGrainSize = 1024;
+constexpr uint32_t kLruNumWays = 8;
+constexpr size_t kLruNumLockStripes = 1024;
+
+template<typename F>
+void ParallelForKeys(ep::Stream* stream, uint32_t n_keys, const F& func) {
+  stream->As<ep::CpuStream>()->ParallelFor(0, n_keys, func, kParallelForGrainSize);
+}
+
+// Also serves the kLFU policy, which only differs in the admission check done before a full set
+// evicts its LRU way.
+template<typename Key>
+class CpuLruCache : public Cache {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuLruCache);
+  explicit CpuLruCache(const CacheOptions& options)
+      : options_(options),
+        n_set_((options.capacity - 1 + kLruNumWays) / kLruNumWays),
+        max_query_length_(0),
+        sketch_width_(0),
+        num_sketch_records_(0) {
+    CHECK_GT(n_set_, 0);
+    keys_.resize(n_set_ * kLruNumWays);
+    ages_.resize(n_set_ * kLruNumWays);
+    set_clocks_.resize(n_set_);
+    lines_.resize(n_set_ * kLruNumWays * options_.value_size);
+    locks_.reset(new std::mutex[kLruNumLockStripes]);
+    if (options_.policy == CacheOptions::Policy::kLFU) {
+      sketch_width_ = FrequencySketchWidth(n_set_ * kLruNumWays);
+      sketch_.reset(new std::atomic<uint32_t>[kFrequencySketchDepth * sketch_width_]);
+    }
+    Clear();
+  }
+  ~CpuLruCache() override = default;
+
+  uint32_t KeySize() const override { return sizeof(Key); }
+  uint32_t ValueSize() const override { return options_.value_size; }
+  DataType ValueType() const override { return options_.value_type; }
+  uint64_t Capacity() const override { return n_set_ * kLruNumWays; }
+  uint32_t MaxQueryLength() const override { return max_query_length_; }
+
+  void ReserveQueryLength(uint32_t query_length) override {
+    max_query_length_ = std::max(max_query_length_, query_length);
+  }
+
+  CacheOptions::Policy Policy() const override { return options_.policy; }
+
+  void Test(ep::Stream* stream, uint32_t n_keys, const void* keys, uint32_t* n_missing,
+            void* missing_keys, uint32_t* missing_indices) override {
+    Lookup<true>(stream, n_keys, static_cast<const Key*>(keys), nullptr, n_missing,
+                 static_cast<Key*>(missing_keys), missing_indices);
+  }
+
+  using Cache::Get;
+  void Get(ep::Stream* stream, uint32_t n_keys, const void* keys, void* values, uint32_t* n_missing,
+           void* missing_keys, uint32_t* missing_indices) override {
+    Lookup<false>(stream, n_keys, static_cast<const Key*>(keys), static_cast<char*>(values),
+                  n_missing, static_cast<Key*>(missing_keys), missing_indices);
+  }
+
+  void Put(ep::Stream* stream, uint32_t n_keys, const void* keys, const void* values,
+           uint32_t* n_evicted, void* evicted_keys, void* evicted_values) override {
+    CHECK_LE(n_keys, max_query_length_);
+    const Key* keys_ptr = static_cast<const Key*>(keys);
+    const char* values_ptr = static_cast<const char*>(values);
+    Key* evicted_keys_ptr = static_cast<Key*>(evicted_keys);
+    char* evicted_values_ptr = static_cast<char*>(evicted_values);
+    const uint32_t value_size = options_.value_size;
+    std::atomic<uint32_t> evicted_count(0);
+    ParallelForKeys(stream, n_keys, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const Key key = keys_ptr[i];
+        const uint64_t set_id = SetId(key);
+        std::lock_guard<std::mutex> lock(SetMutex(set_id));
+        int64_t slot = FindSlot(set_id, key);
+        if (slot < 0) {
+          slot = VictimSlot(set_id);
+          if (ages_[slot] != 0 && sketch_
+              && EstimateFrequency(key) <= EstimateFrequency(keys_[slot])) {
+            // Not admitted, hand the key back to the caller as if it had been evicted.
+            const uint32_t evicted_idx = evicted_count.fetch_add(1, std::memory_order_relaxed);
+            evicted_keys_ptr[evicted_idx] = key;
+            std::memcpy(evicted_values_ptr + evicted_idx * value_size, values_ptr + i * value_size,
+                        value_size);
+            continue;
+          }
+          if (ages_[slot] != 0) {
+            const uint32_t evicted_idx = evicted_count.fetch_add(1, std::memory_order_relaxed);
+            evicted_keys_ptr[evicted_idx] = keys_[slot];
+            std::memcpy(evicted_values_ptr + evicted_idx * value_size, Line(slot), value_size);
+          }
+          keys_[slot] = key;
+        }
+        std::memcpy(Line(slot), values_ptr + i * value_size, value_size);
+        ages_[slot] = ++set_clocks_[set_id];
+      }
+    });
+    *n_evicted = evicted_count.load();
+  }
+
+  void Dump(ep::Stream* stream, uint64_t start_key_index, uint64_t end_key_index,
+            uint32_t* n_dumped, void* keys, void* values) override {
+    Key* keys_ptr = static_cast<Key*>(keys);
+    char* values_ptr = static_cast<char*>(values);
+    const uint32_t value_size = options_.value_size;
+    std::atomic<uint32_t> dumped_count(0);
+    stream->As<ep::CpuStream>()->ParallelFor(
+        start_key_index, end_key_index,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t slot = begin; slot < end; ++slot) {
+            if (ages_[slot] == 0) { continue; }
+            const uint32_t idx = dumped_count.fetch_add(1, std::memory_order_relaxed);
+            keys_ptr[idx] = keys_[slot];
+            std::memcpy(values_ptr + idx * value_size, Line(slot), value_size);
+          }
+        },
+        kParallelForGrainSize);
+    *n_dumped = dumped_count.load();
+  }
+
+  void ClearDirtyFlags() override {
+    // do nothing.
+    return;
+  }
+
+  void Clear() override {
+    std::fill(ages_.begin(), ages_.end(), 0);
+    std::fill(set_clocks_.begin(), set_clocks_.end(), 0);
+    if (sketch_) {
+      for (uint64_t i = 0; i < kFrequencySketchDepth * sketch_width_; ++i) { sketch_[i] = 0; }
+      num_sketch_records_ = 0;
+    }
+  }
+
+ private:
+  template<bool test_only>
+  void Lookup(ep::Stream* stream, uint32_t n_keys, const Key* keys, char* values,
+              uint32_t* n_missing, Key* missing_keys, uint32_t* missing_indices) {
+    CHECK_LE(n_keys, max_query_length_);
+    const uint32_t value_size = options_.value_size;
+    std::atomic<uint32_t> missing_count(0);
+    ParallelForKeys(stream, n_keys, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const Key key = keys[i];
+        const uint64_t set_id = SetId(key);
+        int64_t slot = -1;
+        {
+          std::lock_guard<std::mutex> lock(SetMutex(set_id));
+          slot = FindSlot(set_id, key);
+          if (!test_only && slot >= 0) {
+            std::memcpy(values + i * value_size, Line(slot), value_size);
+            ages_[slot] = ++set_clocks_[set_id];
+          }
+        }
+        if (slot < 0) {
+          const uint32_t missing_idx = missing_count.fetch_add(1, std::memory_order_relaxed);
+          missing_keys[missing_idx] = key;
+          missing_indices[missing_idx] = i;
+        }
+        if (!test_only && sketch_) { RecordAccess(key); }
+      }
+    });
+    *n_missing = missing_count.load();
+    if (!test_only && sketch_) {
+      num_sketch_records_ += n_keys;
+      if (num_sketch_records_ >= FrequencySketchSampleSize(sketch_width_)) {
+        AgeSketch(stream);
+        num_sketch_records_ /= 2;
+      }
+    }
+  }
+
+  void RecordAccess(Key key) {
+    const uint64_t hash = FrequencySketchHash()(static_cast<uint64_t>(key));
+    for (uint32_t row = 0; row < kFrequencySketchDepth; ++row) {
+      sketch_[FrequencySketchIndex(hash, row, sketch_width_)].fetch_add(
+          1, std::memory_order_relaxed);
+    }
+  }
+
+  uint32_t EstimateFrequency(Key key) const {
+    const uint64_t hash = FrequencySketchHash()(static_cast<uint64_t>(key));
+    uint32_t count = std::numeric_limits<uint32_t>::max();
+    for (uint32_t row = 0; row < kFrequencySketchDepth; ++row) {
+      count = std::min(count, sketch_[FrequencySketchIndex(hash, row, sketch_width_)].load(
+                                  std::memory_order_relaxed));
+    }
+    return count;
+  }
+
+  void AgeSketch(ep::Stream* stream) {
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, kFrequencySketchDepth * sketch_width_,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            sketch_[i].store(sketch_[i].load(std::memory_order_relaxed) / 2,
+                             std::memory_order_relaxed);
+          }
+        },
+        kParallelForGrainSize);
+  }
+
+  uint64_t SetId(Key key) const { return LruCacheHash()(static_cast<uint64_t>(key)) % n_set_; }
+
+  std::mutex& SetMutex(uint64_t set_id) { return locks_[set_id % kLruNumLockStripes]; }
+
+  char* Line(uint64_t slot) { return lines_.data() + slot * options_.value_size; }
+
+  int64_t FindSlot(uint64_t set_id, Key key) const {
+    const uint64_t base = set_id * kLruNumWays;
+    for (uint32_t way = 0; way < kLruNumWays; ++way) {
+      if (ages_[base + way] != 0 && keys_[base + way] == key) { return base + way; }
+    }
+    return -1;
+  }
+
+  int64_t VictimSlot(uint64_t set_id) const {
+    const uint64_t base = set_id * kLruNumWays;
+    int64_t victim = base;
+    for (uint32_t way = 0; way < kLruNumWays; ++way) {
+      if (ages_[base + way] == 0) { return base + way; }
+      if (ages_[base + way] < ages_[victim]) { victim = base + way; }
+    }
+    return victim;
+  }
+
+  CacheOptions options_;
+  uint64_t n_set_;
+  uint32_t max_query_length_;
+  std::vector<Key> keys_;
+  // age 0 marks an empty way, a larger age means a more recent access within the set.
+  std::vector<uint64_t> ages_;
+  std::vector<uint64_t> set_clocks_;
+  std::vector<char> lines_;
+  std::unique_ptr<std::mutex[]> locks_;
+  // Only allocated for kLFU.
+  std::unique_ptr<std::atomic<uint32_t>[]> sketch_;
+  uint64_t sketch_width_;
+  uint64_t num_sketch_records_;
+};
+
+template<typename Key>
+class CpuFullCache : public Cache {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuFullCache);
+  explicit CpuFullCache(const CacheOptions& options)
+      : if_dump_dirty_(ParseBooleanFromEnv("ONEFLOW_ONE_EMBEDDING_DUMP_DIRTY_ONLY", false)),
+        options_(options),
+        table_capacity_(options.capacity / options.load_factor),
+        table_size_(0),
+        max_query_length_(0) {
+    CHECK_GE(table_capacity_, options_.capacity);
+    table_keys_.resize(table_capacity_);
+    table_indices_.resize(table_capacity_);
+    if (if_dump_dirty_) { table_dirty_flags_.resize(table_capacity_); }
+    values_.resize(options_.capacity * options_.value_size);
+    Clear();
+  }
+  ~CpuFullCache() override = default;
+
+  uint32_t KeySize() const override { return sizeof(Key); }
+  uint32_t ValueSize() const override { return options_.value_size; }
+  DataType ValueType() const override { return options_.value_type; }
+  uint64_t Capacity() const override { return options_.capacity; }
+  uint64_t DumpCapacity() const override { return table_capacity_; }
+  uint32_t MaxQueryLength() const override { return max_query_length_; }
+
+  void ReserveQueryLength(uint32_t query_length) override {
+    if (query_length <= max_query_length_) { return; }
+    slots_buffer_.resize(query_length);
+    max_query_length_ = query_length;
+  }
+
+  CacheOptions::Policy Policy() const override { return CacheOptions::Policy::kFull; }
+
+  void Test(ep::Stream* stream, uint32_t n_keys, const void* keys, uint32_t* n_missing,
+            void* missing_keys, uint32_t* missing_indices) override {
+    Lookup<true>(stream, n_keys, static_cast<const Key*>(keys), nullptr, n_missing,
+                 static_cast<Key*>(missing_keys), missing_indices);
+  }
+
+  void Get(ep::Stream* stream, uint32_t n_keys, const void* keys, void* values, uint32_t* n_missing,
+           void* missing_keys, uint32_t* missing_indices) override {
+    Lookup<false>(stream, n_keys, static_cast<const Key*>(keys), static_cast<char*>(values),
+                  n_missing, static_cast<Key*>(missing_keys), missing_indices);
+  }
+
+  void Get(ep::Stream* stream, uint32_t n_keys, const void* keys, void* values,
+           uint8_t* mask) override {
+    CHECK_LE(n_keys, max_query_length_);
+    const Key* keys_ptr = static_cast<const Key*>(keys);
+    char* values_ptr = static_cast<char*>(values);
+    const uint32_t value_size = options_.value_size;
+    ParallelForKeys(stream, n_keys, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const uint64_t slot = FindSlot(keys_ptr[i]);
+        mask[i] = slot != table_capacity_;
+        if (mask[i]) { std::memcpy(values_ptr + i * value_size, Row(slot), value_size); }
+      }
+    });
+  }
+
+  void Put(ep::Stream* stream, uint32_t n_keys, const void* keys, const void* values,
+           uint32_t* n_evicted, void* evicted_keys, void* evicted_values) override {
+    CHECK_LE(n_keys, max_query_length_);
+    *n_evicted = 0;
+    const Key* keys_ptr = static_cast<const Key*>(keys);
+    const char* values_ptr = static_cast<const char*>(values);
+    const uint32_t value_size = options_.value_size;
+    uint64_t* slots = slots_buffer_.data();
+    ParallelForKeys(stream, n_keys, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) { slots[i] = FindSlot(keys_ptr[i]); }
+    });
+    // Inserting new keys is kept serial so that rows are assigned without contention, the copy of
+    // the values below is the part that scales with the line size.
+    for (uint32_t i = 0; i < n_keys; ++i) {
+      if (slots[i] == table_capacity_) { slots[i] = InsertSlot(keys_ptr[i]); }
+      if (if_dump_dirty_) { table_dirty_flags_[slots[i]] = 1; }
+    }
+    ParallelForKeys(stream, n_keys, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        std::memcpy(Row(slots[i]), values_ptr + i * value_size, value_size);
+      }
+    });
+  }
+
+  void Dump(ep::Stream* stream, uint64_t start_key_index, uint64_t end_key_index,
+            uint32_t* n_dumped, void* keys, void* values) override {
+    Key* keys_ptr = static_cast<Key*>(keys);
+    char* values_ptr = static_cast<char*>(values);
+    const uint32_t value_size = options_.value_size;
+    std::atomic<uint32_t> dumped_count(0);
+    stream->As<ep::CpuStream>()->ParallelFor(
+        start_key_index, end_key_index,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t slot = begin; slot < end; ++slot) {
+            if (table_indices_[slot] == 0) { continue; }
+            if (if_dump_dirty_ && table_dirty_flags_[slot] == 0) { continue; }
+            const uint32_t idx = dumped_count.fetch_add(1, std::memory_order_relaxed);
+            keys_ptr[idx] = table_keys_[slot];
+            std::memcpy(values_ptr + idx * value_size, Row(slot), value_size);
+          }
+        },
+        kParallelForGrainSize);
+    *n_dumped = dumped_count.load();
+  }
+
+  void ClearDirtyFlags() override {
+    if (!if_dump_dirty_) { return; }
+    std::fill(table_dirty_flags_.begin(), table_dirty_flags_.end(), 0);
+  }
+
+  void Clear() override {
+    std::fill(table_indices_.begin(), table_indices_.end(), 0);
+    std::fill(table_dirty_flags_.begin(), table_dirty_flags_.end(), 0);
+    table_size_ = 0;
+  }
+
+ private:
+  template<bool test_only>
+  void Lookup(ep::Stream* stream, uint32_t n_keys, const Key* keys, char* values,
+              uint32_t* n_missing, Key* missing_keys, uint32_t* missing_indices) {
+    CHECK_LE(n_keys, max_query_length_);
+    const uint32_t value_size = options_.value_size;
+    std::atomic<uint32_t> missing_count(0);
+    ParallelForKeys(stream, n_keys, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const uint64_t slot = FindSlot(keys[i]);
+        if (slot == table_capacity_) {
+          const uint32_t missing_idx = missing_count.fetch_add(1, std::memory_order_relaxed);
+          missing_keys[missing_idx] = keys[i];
+          missing_indices[missing_idx] = i;
+        } else if (!test_only) {
+          std::memcpy(values + i * value_size, Row(slot), value_size);
+        }
+      }
+    });
+    *n_missing = missing_count.load();
+  }
+
+  // Returns table_capacity_ if the key is not in the table.
+  uint64_t FindSlot(Key key) const {
+    const uint64_t start = FullCacheHash()(static_cast<uint64_t>(key)) % table_capacity_;
+    for (uint64_t count = 0; count < table_capacity_; ++count) {
+      const uint64_t slot = (start + count) % table_capacity_;
+      if (table_indices_[slot] == 0) { return table_capacity_; }
+      if (table_keys_[slot] == key) { return slot; }
+    }
+    return table_capacity_;
+  }
+
+  uint64_t InsertSlot(Key key) {
+    const uint64_t start = FullCacheHash()(static_cast<uint64_t>(key)) % table_capacity_;
+    for (uint64_t count = 0; count < table_capacity_; ++count) {
+      const uint64_t slot = (start + count) % table_capacity_;
+      if (table_indices_[slot] == 0) {
+        CHECK_LT(table_size_, options_.capacity)
+            << "The number of keys exceeds the capacity of the full cache";
+        table_keys_[slot] = key;
+        table_size_ += 1;
+        table_indices_[slot] = table_size_;
+        return slot;
+      }
+      if (table_keys_[slot] == key) { return slot; }
+    }
+    UNIMPLEMENTED();
+    return table_capacity_;
+  }
+
+  char* Row(uint64_t slot) {
+    return values_.data() + (table_indices_[slot] - 1) * options_.value_size;
+  }
+
+  bool if_dump_dirty_;
+  CacheOptions options_;
+  uint64_t table_capacity_;
+  uint64_t table_size_;
+  uint32_t max_query_length_;
+  std::vector<Key> table_keys_;
+  // index of the value row plus one, 0 marks an empty slot.
+  std::vector<uint64_t> table_indices_;
+  std::vector<uint8_t> table_dirty_flags_;
+  std::vector<char> values_;
+  std::vector<uint64_t> slots_buffer_;
+};
+
+template<typename Key>
+std::unique_ptr<Cache> DispatchPolicy(const CacheOptions& options) {
+  if (options.policy == CacheOptions::Policy::kLRU
+      || options.policy == CacheOptions::Policy::kLFU) {
+    return std::unique_ptr<Cache>(new CpuLruCache<Key>(options));
+  } else if (options.policy == CacheOptions::Policy::kFull) {
+    return std::unique_ptr<Cache>(new CpuFullCache<Key>(options));
+  } else {
+    UNIMPLEMENTED();
+    return nullptr;
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<Cache> NewCpuCache(const CacheOptions& options) {
+  CHECK_GT(options.key_size, 0);
+  CHECK_GT(options.value_size, 0);
+  CHECK_GT(options.capacity, 0);
+  if (options.key_size == sizeof(uint32_t)) {
+    return DispatchPolicy<uint32_t>(options);
+  } else if (options.key_size == sizeof(uint64_t)) {
+    return DispatchPolicy<uint64_t>(options);
+  } else {
+    UNIMPLEMENTED();
+    return nullptr;
+  }
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
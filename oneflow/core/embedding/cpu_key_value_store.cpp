@@ -0,0 +1,317 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/cpu_key_value_store.h"
+#include "oneflow/core/embedding/persistent_table.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include <mutex>
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+constexpr int64_t kParallelForGrainSize = 1024;
+
+class CpuIteratorImpl : public KVIterator {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuIteratorImpl);
+  CpuIteratorImpl(PersistentTable::Iterator* base_iter, uint32_t max_query_length)
+      : base_iter_(base_iter), max_query_length_(max_query_length) {}
+  ~CpuIteratorImpl() override = default;
+
+  void NextN(ep::Stream* stream, uint32_t n_request, uint32_t* n_result, void* keys,
+             void* values) override {
+    CHECK_LE(n_request, max_query_length_);
+    base_iter_->Next(n_request, n_result, keys, values);
+  }
+
+  void Reset() override { base_iter_->Reset(); }
+
+ private:
+  PersistentTable::Iterator* base_iter_;
+  uint32_t max_query_length_;
+};
+
+class CpuPersistentTableKeyValueStore : public KeyValueStore {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuPersistentTableKeyValueStore);
+  explicit CpuPersistentTableKeyValueStore(const PersistentTableKeyValueStoreOptions& options)
+      : max_query_length_(0) {
+    table_ = NewPersistentTable(options.table_options);
+  }
+  ~CpuPersistentTableKeyValueStore() override = default;
+
+  uint32_t KeySize() const override { return table_->KeySize(); }
+
+  uint32_t ValueSize() const override { return table_->ValueSize(); }
+
+  uint32_t MaxQueryLength() const override { return max_query_length_; }
+
+  void ReserveQueryLength(uint32_t query_length) override {
+    max_query_length_ = std::max(max_query_length_, query_length);
+  }
+
+  using KeyValueStore::Get;
+  void Get(ep::Stream* stream, uint32_t num_keys, const void* keys, void* values,
+           uint32_t* n_missing, uint32_t* missing_indices) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_LE(num_keys, max_query_length_);
+    if (num_keys == 0) {
+      *n_missing = 0;
+      return;
+    }
+    table_->Get(num_keys, keys, values, n_missing, missing_indices);
+  }
+
+  void Put(ep::Stream* stream, uint32_t num_keys, const void* keys, const void* values) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_LE(num_keys, max_query_length_);
+    if (num_keys == 0) { return; }
+    table_->Put(num_keys, keys, values);
+  }
+
+  bool SnapshotExists(const std::string& name) override { return table_->SnapshotExists(name); }
+
+  void LoadSnapshot(const std::string& name) override { LoadSnapshot(name, nullptr); }
+
+  void LoadSnapshot(const std::string& name,
+                    const std::function<void(KVIterator* iter)>& Hook) override {
+    if (Hook) {
+      table_->LoadSnapshot(name, [&](PersistentTable::Iterator* chunk_iterator) {
+        CpuIteratorImpl iterator(chunk_iterator, max_query_length_);
+        Hook(&iterator);
+      });
+    } else {
+      table_->LoadSnapshot(name);
+    }
+  }
+
+  void SaveSnapshot(const std::string& name) override { table_->SaveSnapshot(name); }
+
+ private:
+  uint32_t max_query_length_;
+  std::mutex mutex_;
+  std::unique_ptr<PersistentTable> table_;
+};
+
+class CpuCacheKeyValueStoreImpl : public KeyValueStore {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCacheKeyValueStoreImpl);
+  CpuCacheKeyValueStoreImpl(std::unique_ptr<KeyValueStore>&& store, std::unique_ptr<Cache>&& cache)
+      : store_(std::move(store)), cache_(std::move(cache)), synced_(true), max_query_length_(0) {
+    CHECK_EQ(store_->KeySize(), cache_->KeySize());
+    CHECK_EQ(store_->ValueSize(), cache_->ValueSize());
+  }
+  ~CpuCacheKeyValueStoreImpl() override {
+    cache_.reset();
+    store_.reset();
+  }
+
+  uint32_t KeySize() const override { return store_->KeySize(); }
+  uint32_t ValueSize() const override { return store_->ValueSize(); }
+  uint32_t MaxQueryLength() const override { return max_query_length_; }
+
+  void ReserveQueryLength(uint32_t query_length) override {
+    if (query_length <= max_query_length_) { return; }
+    if (query_length > cache_->MaxQueryLength()) { cache_->ReserveQueryLength(query_length); }
+    if (query_length > store_->MaxQueryLength()) { store_->ReserveQueryLength(query_length); }
+    keys_buffer_.resize(query_length * store_->KeySize());
+    values_buffer_.resize(query_length * store_->ValueSize());
+    indices_buffer0_.resize(query_length);
+    indices_buffer1_.resize(query_length);
+    max_query_length_ = query_length;
+  }
+
+  void Get(ep::Stream* stream, uint32_t num_keys, const void* keys, void* values,
+           uint32_t* n_missing, uint32_t* missing_indices) override;
+  void Get(ep::Stream* stream, uint32_t num_keys, const void* keys, void* values,
+           uint8_t* mask) override;
+  void Put(ep::Stream* stream, uint32_t num_keys, const void* keys, const void* values) override;
+  bool SnapshotExists(const std::string& name) override;
+  void LoadSnapshot(const std::string& name) override;
+  void SaveSnapshot(const std::string& name) override;
+  void LoadSnapshot(const std::string& name,
+                    const std::function<void(KVIterator* iter)>& Hook) override;
+  KeyValueStoreStatistics GetStatistics() override {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return statistics_;
+  }
+  void ResetStatistics() override {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    statistics_ = KeyValueStoreStatistics();
+  }
+
+ private:
+  void SyncCacheToStore();
+
+  std::unique_ptr<KeyValueStore> store_;
+  std::unique_ptr<Cache> cache_;
+
+  std::vector<char> keys_buffer_;
+  std::vector<char> values_buffer_;
+  std::vector<uint32_t> indices_buffer0_;
+  std::vector<uint32_t> indices_buffer1_;
+  std::recursive_mutex mutex_;
+  bool synced_;
+  uint32_t max_query_length_;
+  KeyValueStoreStatistics statistics_;
+};
+
+void CpuCacheKeyValueStoreImpl::Get(ep::Stream* stream, uint32_t num_keys, const void* keys,
+                                    void* values, uint32_t* n_missing,
+                                    uint32_t* missing_indices) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (cache_->Policy() == CacheOptions::Policy::kFull) {
+    cache_->Get(stream, num_keys, keys, values, n_missing, keys_buffer_.data(), missing_indices);
+    return;
+  }
+  uint32_t num_cache_missing = 0;
+  cache_->Get(stream, num_keys, keys, values, &num_cache_missing, keys_buffer_.data(),
+              indices_buffer0_.data());
+  statistics_.num_query_keys += num_keys;
+  statistics_.num_cache_missing_keys += num_cache_missing;
+  if (num_cache_missing == 0) {
+    *n_missing = 0;
+    return;
+  }
+  store_->Get(stream, num_cache_missing, keys_buffer_.data(), values_buffer_.data(), n_missing,
+              indices_buffer1_.data());
+  const uint32_t num_store_missing = *n_missing;
+  statistics_.num_store_missing_keys += num_store_missing;
+  const uint32_t value_size = store_->ValueSize();
+  const uint32_t* cache_missing_indices = indices_buffer0_.data();
+  const uint32_t* store_missing_indices = indices_buffer1_.data();
+  const char* store_values = values_buffer_.data();
+  char* values_ptr = static_cast<char*>(values);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_cache_missing,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          std::memcpy(values_ptr + cache_missing_indices[i] * value_size,
+                      store_values + i * value_size, value_size);
+        }
+      },
+      kParallelForGrainSize);
+  for (uint32_t i = 0; i < num_store_missing; ++i) {
+    missing_indices[i] = cache_missing_indices[store_missing_indices[i]];
+  }
+}
+
+void CpuCacheKeyValueStoreImpl::Get(ep::Stream* stream, uint32_t num_keys, const void* keys,
+                                    void* values, uint8_t* mask) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (cache_->Policy() == CacheOptions::Policy::kFull) {
+    cache_->Get(stream, num_keys, keys, values, mask);
+    return;
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+void CpuCacheKeyValueStoreImpl::Put(ep::Stream* stream, uint32_t num_keys, const void* keys,
+                                    const void* values) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  synced_ = false;
+  uint32_t num_evicted = 0;
+  cache_->Put(stream, num_keys, keys, values, &num_evicted, keys_buffer_.data(),
+              values_buffer_.data());
+  if (cache_->Policy() == CacheOptions::Policy::kFull) { return; }
+  store_->Put(stream, num_evicted, keys_buffer_.data(), values_buffer_.data());
+}
+
+bool CpuCacheKeyValueStoreImpl::SnapshotExists(const std::string& name) {
+  return store_->SnapshotExists(name);
+}
+
+void CpuCacheKeyValueStoreImpl::LoadSnapshot(const std::string& name) {
+  LoadSnapshot(name, nullptr);
+}
+
+void CpuCacheKeyValueStoreImpl::LoadSnapshot(const std::string& name,
+                                             const std::function<void(KVIterator* iter)>& Hook) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  CHECK_GT(max_query_length_, 0);
+  cache_->Clear();
+  auto device = Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0);
+  CHECK(device);
+  auto* stream = device->CreateStream();
+  store_->LoadSnapshot(name, [&](KVIterator* iter) {
+    if (cache_->Policy() == CacheOptions::Policy::kFull) {
+      while (true) {
+        uint32_t num_keys = 0;
+        iter->NextN(stream, max_query_length_, &num_keys, keys_buffer_.data(),
+                    values_buffer_.data());
+        if (num_keys == 0) { return; }
+        uint32_t num_evicted = 0;
+        cache_->Put(stream, num_keys, keys_buffer_.data(), values_buffer_.data(), &num_evicted,
+                    nullptr, nullptr);
+      }
+    }
+    if (Hook) {
+      iter->Reset();
+      Hook(iter);
+    }
+  });
+  device->DestroyStream(stream);
+}
+
+void CpuCacheKeyValueStoreImpl::SaveSnapshot(const std::string& name) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  SyncCacheToStore();
+  store_->SaveSnapshot(name);
+}
+
+void CpuCacheKeyValueStoreImpl::SyncCacheToStore() {
+  if (synced_) { return; }
+  auto device = Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0);
+  CHECK(device);
+  auto* stream = device->CreateStream();
+  const uint64_t dump_capacity = cache_->DumpCapacity();
+  CHECK_GT(max_query_length_, 0);
+  for (uint64_t start_key_index = 0; start_key_index < dump_capacity;
+       start_key_index += max_query_length_) {
+    uint32_t num_dumped = 0;
+    cache_->Dump(stream, start_key_index,
+                 std::min(start_key_index + max_query_length_, dump_capacity), &num_dumped,
+                 keys_buffer_.data(), values_buffer_.data());
+    if (num_dumped == 0) { continue; }
+    store_->Put(stream, num_dumped, keys_buffer_.data(), values_buffer_.data());
+  }
+  cache_->ClearDirtyFlags();
+  device->DestroyStream(stream);
+  synced_ = true;
+}
+
+}  // namespace
+
+std::unique_ptr<KeyValueStore> NewCpuPersistentTableKeyValueStore(
+    const PersistentTableKeyValueStoreOptions& options) {
+  CHECK(options.table_options.key_size == sizeof(uint64_t)
+        || options.table_options.key_size == sizeof(uint32_t));
+  return std::unique_ptr<KeyValueStore>(new CpuPersistentTableKeyValueStore(options));
+}
+
+std::unique_ptr<KeyValueStore> NewCpuCachedKeyValueStore(std::unique_ptr<KeyValueStore>&& store,
+                                                         std::unique_ptr<Cache>&& cache) {
+  return std::unique_ptr<KeyValueStore>(
+      new CpuCacheKeyValueStoreImpl(std::move(store), std::move(cache)));
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
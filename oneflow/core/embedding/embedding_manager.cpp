@@ -17,15 +17,17 @@ limitations under the License.
 #include "oneflow/core/embedding/persistent_table_key_value_store.h"
 #include "oneflow/core/ep/include/device_manager_registry.h"
 #include "oneflow/core/embedding/cached_key_value_store.h"
+#include "oneflow/core/embedding/cpu_cache.h"
+#include "oneflow/core/embedding/cpu_key_value_store.h"
 
 namespace oneflow {
 
 namespace embedding {
 
-#ifdef WITH_CUDA
-
 constexpr size_t kDefaultMaxQueryLength = 131072;
 
+#ifdef WITH_CUDA
+
 constexpr int64_t kRingBufferSize = 8;
 
 struct IdStatistics {
@@ -465,8 +467,11 @@ class StaticAllocationEmbeddingState final : public EmbeddingState {
   std::mutex mutex_;
 };
 
+#endif  // WITH_CUDA
+
 EmbeddingState* EmbeddingManager::GetEmbeddingState(const std::string& embedding_name,
                                                     int64_t rank_id) {
+#ifdef WITH_CUDA
   std::pair<std::string, int64_t> map_key = std::make_pair(embedding_name, rank_id);
   std::unique_lock<std::mutex> lock(mutex_);
   auto it = embedding_state_map_.find(map_key);
@@ -487,6 +492,10 @@ EmbeddingState* EmbeddingManager::GetEmbeddingState(const std::string& embedding
     }
   }
   return it->second.get();
+#else
+  UNIMPLEMENTED() << "EmbeddingState is only used by the cuda kernels";
+  return nullptr;
+#endif  // WITH_CUDA
 }
 
 KeyValueStore* EmbeddingManager::GetKeyValueStore(const std::string& embedding_name,
@@ -499,10 +508,24 @@ KeyValueStore* EmbeddingManager::GetKeyValueStore(const std::string& embedding_n
   return it->second.get();
 }
 
+KeyValueStoreStatistics EmbeddingManager::GetKeyValueStoreStatistics(
+    const std::string& embedding_name, int64_t rank_id) {
+  return GetKeyValueStore(embedding_name, rank_id)->GetStatistics();
+}
+
+void EmbeddingManager::ResetKeyValueStoreStatistics(const std::string& embedding_name,
+                                                    int64_t rank_id) {
+  GetKeyValueStore(embedding_name, rank_id)->ResetStatistics();
+}
+
 void EmbeddingManager::CreateKeyValueStore(const KeyValueStoreOptions& key_value_store_options,
                                            int64_t local_rank_id, int64_t rank_id,
                                            int64_t world_size) {
-  CudaCurrentDeviceGuard guard(local_rank_id);
+  const DeviceType device_type = key_value_store_options.StoreDeviceType();
+#ifdef WITH_CUDA
+  std::unique_ptr<CudaCurrentDeviceGuard> guard;
+  if (device_type == DeviceType::kCUDA) { guard.reset(new CudaCurrentDeviceGuard(local_rank_id)); }
+#endif  // WITH_CUDA
   const std::string& name = key_value_store_options.Name();
   const uint32_t line_size = key_value_store_options.LineSize();
   std::pair<std::string, int64_t> map_key = std::make_pair(name, rank_id);
@@ -520,16 +543,39 @@ void EmbeddingManager::CreateKeyValueStore(const KeyValueStoreOptions& key_value
       key_value_store_options.PersistentTablePhysicalBlockSize();
   options.table_options.target_chunk_size_mb = 4 * 1024;
   options.table_options.capacity_hint = key_value_store_options.PersistentTableCapacityHint();
-  store = NewPersistentTableKeyValueStore(options);
+  options.table_options.io_engine = key_value_store_options.PersistentTableIoEngine();
+  options.table_options.io_uring_sq_poll = key_value_store_options.PersistentTableIoUringSqPoll();
+  options.table_options.max_snapshot_chain_length =
+      key_value_store_options.PersistentTableMaxSnapshotChainLength();
+  options.table_options.max_space_amplification =
+      key_value_store_options.PersistentTableMaxSpaceAmplification();
   const std::vector<CacheOptions>& cache_options = key_value_store_options.GetCachesOptions();
-  for (int i = cache_options.size() - 1; i >= 0; --i) {
-    std::unique_ptr<Cache> cache = NewCache(cache_options.at(i));
-    store = NewCachedKeyValueStore(std::move(store), std::move(cache));
+  if (device_type == DeviceType::kCPU) {
+    store = NewCpuPersistentTableKeyValueStore(options);
+    for (int i = cache_options.size() - 1; i >= 0; --i) {
+      std::unique_ptr<Cache> cache = NewCpuCache(cache_options.at(i));
+      store = NewCpuCachedKeyValueStore(std::move(store), std::move(cache));
+    }
+  } else if (device_type == DeviceType::kCUDA) {
+#ifdef WITH_CUDA
+    store = NewPersistentTableKeyValueStore(options);
+    for (int i = cache_options.size() - 1; i >= 0; --i) {
+      std::unique_ptr<Cache> cache = NewCache(cache_options.at(i));
+      store = NewCachedKeyValueStore(std::move(store), std::move(cache));
+    }
+#else
+    UNIMPLEMENTED() << "OneEmbedding with device_type cuda requires building with CUDA";
+#endif  // WITH_CUDA
+  } else {
+    UNIMPLEMENTED() << "Unsupported one embedding device_type";
   }
   store->ReserveQueryLength(kDefaultMaxQueryLength);
   CHECK(key_value_store_map_.emplace(map_key, std::move(store)).second)
       << "Can't create an embedding with same name of an existing embedding, the name: " << name;
+  device_type_map_[map_key] = device_type;
+  if (device_type != DeviceType::kCUDA) { return; }
 
+#ifdef WITH_CUDA
   if (UseDynamicMemoryAllocation()) {
 #if CUDA_VERSION >= 11020
     CHECK(embedding_state_map_.emplace(map_key, std::make_unique<DynamicAllocationEmbeddingState>())
@@ -545,27 +591,38 @@ void EmbeddingManager::CreateKeyValueStore(const KeyValueStoreOptions& key_value
         << "Can't create an embedding state with same name of an existing embedding, the name: "
         << name;
   }
+#endif  // WITH_CUDA
 }
 
 void EmbeddingManager::SaveSnapshot(const std::string& embedding_name, int64_t local_rank_id,
                                     int64_t rank_id, const std::string& snapshot_name) {
-  CudaCurrentDeviceGuard guard(local_rank_id);
   std::pair<std::string, int64_t> map_key = std::make_pair(embedding_name, rank_id);
   std::unique_lock<std::mutex> lock(mutex_);
 
   auto it = key_value_store_map_.find(map_key);
   CHECK(it != key_value_store_map_.end())
       << "Can not find embedding: " << embedding_name << "-" << rank_id;
+#ifdef WITH_CUDA
+  std::unique_ptr<CudaCurrentDeviceGuard> guard;
+  if (device_type_map_.at(map_key) == DeviceType::kCUDA) {
+    guard.reset(new CudaCurrentDeviceGuard(local_rank_id));
+  }
+#endif  // WITH_CUDA
   it->second->SaveSnapshot(snapshot_name);
 }
 
 void EmbeddingManager::LoadSnapshot(const std::string& embedding_name, int64_t local_rank_id,
                                     int64_t rank_id, const std::string& snapshot_name) {
-  CudaCurrentDeviceGuard guard(local_rank_id);
   std::pair<std::string, int64_t> map_key = std::make_pair(embedding_name, rank_id);
   auto it = key_value_store_map_.find(map_key);
   CHECK(it != key_value_store_map_.end())
       << "Can not find embedding: " << embedding_name << "-" << rank_id;
+#ifdef WITH_CUDA
+  std::unique_ptr<CudaCurrentDeviceGuard> guard;
+  if (device_type_map_.at(map_key) == DeviceType::kCUDA) {
+    guard.reset(new CudaCurrentDeviceGuard(local_rank_id));
+  }
+#endif  // WITH_CUDA
   if (it->second->SnapshotExists(snapshot_name)) {
     it->second->LoadSnapshot(snapshot_name);
   } else {
@@ -574,8 +631,6 @@ void EmbeddingManager::LoadSnapshot(const std::string& embedding_name, int64_t l
   }
 }
 
-#endif  // WITH_CUDA
-
 }  // namespace embedding
 
 }  // namespace oneflow
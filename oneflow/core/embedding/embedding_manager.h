@@ -112,8 +112,6 @@ inline bool UseEmbeddingGradientShuffleP2PKernel(DataType embedding_dtype, DataT
 #endif
 }
 
-#ifdef WITH_CUDA
-
 class TmpBufferAllocator {
  public:
   TmpBufferAllocator() = default;
@@ -175,6 +173,9 @@ class EmbeddingManager final {
                     const std::string& snapshot_name);
 
   KeyValueStore* GetKeyValueStore(const std::string& embedding_name, int64_t rank_id);
+  KeyValueStoreStatistics GetKeyValueStoreStatistics(const std::string& embedding_name,
+                                                     int64_t rank_id);
+  void ResetKeyValueStoreStatistics(const std::string& embedding_name, int64_t rank_id);
   EmbeddingState* GetEmbeddingState(const std::string& embedding_name, int64_t rank_id);
   void CreateKeyValueStore(const KeyValueStoreOptions& options, int64_t local_rank_id,
                            int64_t rank_id, int64_t world_size);
@@ -182,11 +183,10 @@ class EmbeddingManager final {
  private:
   HashMap<std::pair<std::string, int64_t>, std::unique_ptr<KeyValueStore>> key_value_store_map_;
   HashMap<std::pair<std::string, int64_t>, std::unique_ptr<EmbeddingState>> embedding_state_map_;
+  HashMap<std::pair<std::string, int64_t>, DeviceType> device_type_map_;
   std::mutex mutex_;
 };
 
-#endif  // WITH_CUDA
-
 }  // namespace embedding
 }  // namespace oneflow
 
@@ -0,0 +1,49 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EMBEDDING_FREQUENCY_SKETCH_H_
+#define ONEFLOW_CORE_EMBEDDING_FREQUENCY_SKETCH_H_
+
+#include "oneflow/core/embedding/hash_functions.cuh"
+
+namespace oneflow {
+
+namespace embedding {
+
+// Geometry of the count-min sketch behind the kLFU (TinyLFU) admission policy. The sketch has
+// kFrequencySketchDepth rows of width counters, a key is counted once per row at a position
+// derived from one 64-bit hash by double hashing. All counters are halved after every
+// FrequencySketchSampleSize() recorded accesses so that old popularity fades out.
+constexpr uint32_t kFrequencySketchDepth = 4;
+
+inline uint64_t FrequencySketchWidth(uint64_t capacity) {
+  uint64_t width = 64;
+  while (width < capacity) { width *= 2; }
+  return width;
+}
+
+inline uint64_t FrequencySketchSampleSize(uint64_t width) { return width * 10; }
+
+OF_DEVICE_FUNC uint64_t FrequencySketchIndex(uint64_t hash, uint32_t row, uint64_t width) {
+  const uint64_t h1 = hash & 0xFFFFFFFFULL;
+  const uint64_t h2 = (hash >> 32) | 1ULL;
+  return row * width + ((h1 + row * h2) & (width - 1));
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EMBEDDING_FREQUENCY_SKETCH_H_
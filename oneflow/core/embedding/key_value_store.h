@@ -24,6 +24,14 @@ namespace oneflow {
 
 namespace embedding {
 
+// Accumulated query counters of a store. Only stores fronted by a cache that is not kFull
+// count them, since those are the ones that already know the number of missing keys on host.
+struct KeyValueStoreStatistics {
+  uint64_t num_query_keys = 0;
+  uint64_t num_cache_missing_keys = 0;
+  uint64_t num_store_missing_keys = 0;
+};
+
 class KeyValueStore {
  public:
   OF_DISALLOW_COPY_AND_MOVE(KeyValueStore);
@@ -53,6 +61,8 @@ class KeyValueStore {
   virtual void LoadSnapshot(const std::string& name,
                             const std::function<void(KVIterator* iter)>& Hook) = 0;
   virtual void SaveSnapshot(const std::string& name) = 0;
+  virtual KeyValueStoreStatistics GetStatistics() { return KeyValueStoreStatistics(); }
+  virtual void ResetStatistics() {}
 };
 
 }  // namespace embedding
@@ -18,6 +18,7 @@ limitations under the License.
 #include "nlohmann/json.hpp"
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/embedding/cache.h"
+#include "oneflow/core/embedding/persistent_table.h"
 
 namespace oneflow {
 namespace embedding {
@@ -34,6 +35,8 @@ void ParseCacheOptions(const nlohmann::json& cache_obj, CacheOptions* cache_opti
     cache_options->policy = CacheOptions::Policy::kLRU;
   } else if (policy == "full") {
     cache_options->policy = CacheOptions::Policy::kFull;
+  } else if (policy == "lfu") {
+    cache_options->policy = CacheOptions::Policy::kLFU;
   } else {
     UNIMPLEMENTED() << "Unsupported cache policy";
   }
@@ -96,6 +99,19 @@ class KeyValueStoreOptions final {
     CHECK(json_object["name"].is_string());
     name_ = json_object["name"].get<std::string>();
 
+    device_type_ = DeviceType::kCUDA;
+    if (json_object.contains("device_type")) {
+      CHECK(json_object["device_type"].is_string());
+      const std::string device_type = json_object["device_type"].get<std::string>();
+      if (device_type == "cuda") {
+        device_type_ = DeviceType::kCUDA;
+      } else if (device_type == "cpu") {
+        device_type_ = DeviceType::kCPU;
+      } else {
+        UNIMPLEMENTED() << "Unsupported one embedding device_type";
+      }
+    }
+
     CHECK(json_object.contains("storage_dim"));
     CHECK(json_object["storage_dim"].is_number());
     line_size_ = json_object["storage_dim"].get<int64_t>();
@@ -147,17 +163,60 @@ class KeyValueStoreOptions final {
     } else {
       persistent_table_capacity_hint_ = 0;
     }
+    persistent_table_io_engine_ = PersistentTableOptions::IoEngine::kAio;
+    if (persistent_table.contains("io_engine")) {
+      CHECK(persistent_table["io_engine"].is_string());
+      const std::string io_engine = persistent_table["io_engine"].get<std::string>();
+      if (io_engine == "aio") {
+        persistent_table_io_engine_ = PersistentTableOptions::IoEngine::kAio;
+      } else if (io_engine == "io_uring") {
+        persistent_table_io_engine_ = PersistentTableOptions::IoEngine::kUring;
+      } else {
+        UNIMPLEMENTED() << "Unsupported persistent table io_engine";
+      }
+    }
+    if (persistent_table.contains("io_uring_sq_poll")) {
+      CHECK(persistent_table["io_uring_sq_poll"].is_boolean());
+      persistent_table_io_uring_sq_poll_ = persistent_table["io_uring_sq_poll"].get<bool>();
+    } else {
+      persistent_table_io_uring_sq_poll_ = false;
+    }
+    if (persistent_table.contains("max_snapshot_chain_length")) {
+      CHECK(persistent_table["max_snapshot_chain_length"].is_number());
+      persistent_table_max_snapshot_chain_length_ =
+          persistent_table["max_snapshot_chain_length"].get<int64_t>();
+    } else {
+      persistent_table_max_snapshot_chain_length_ = 0;
+    }
+    if (persistent_table.contains("max_space_amplification")) {
+      CHECK(persistent_table["max_space_amplification"].is_number());
+      persistent_table_max_space_amplification_ =
+          persistent_table["max_space_amplification"].get<double>();
+    } else {
+      persistent_table_max_space_amplification_ = 0;
+    }
   }
   ~KeyValueStoreOptions() = default;
   int64_t KeyTypeSize() const { return key_type_size_; }
   int64_t ValueTypeSize() const { return value_type_size_; }
   DataType ValueType() const { return value_type_; }
   const std::string& Name() const { return name_; }
+  DeviceType StoreDeviceType() const { return device_type_; }
   int64_t LineSize() const { return line_size_; }
   const std::vector<CacheOptions>& GetCachesOptions() const { return cache_options_; }
   const std::vector<std::string>& PersistentTablePaths() const { return persistent_table_paths_; }
   int64_t PersistentTablePhysicalBlockSize() const { return persistent_table_physical_block_size_; }
   int64_t PersistentTableCapacityHint() const { return persistent_table_capacity_hint_; }
+  PersistentTableOptions::IoEngine PersistentTableIoEngine() const {
+    return persistent_table_io_engine_;
+  }
+  bool PersistentTableIoUringSqPoll() const { return persistent_table_io_uring_sq_poll_; }
+  int64_t PersistentTableMaxSnapshotChainLength() const {
+    return persistent_table_max_snapshot_chain_length_;
+  }
+  double PersistentTableMaxSpaceAmplification() const {
+    return persistent_table_max_space_amplification_;
+  }
   bool IsFullCache() const {
     if (cache_options_.size() > 0 && cache_options_.at(0).policy == CacheOptions::Policy::kFull) {
       return true;
@@ -170,10 +229,15 @@ class KeyValueStoreOptions final {
   int64_t value_type_size_;
   DataType value_type_;
   std::string name_;
+  DeviceType device_type_;
   int64_t line_size_;
   std::vector<std::string> persistent_table_paths_;
   int64_t persistent_table_physical_block_size_;
   int64_t persistent_table_capacity_hint_;
+  PersistentTableOptions::IoEngine persistent_table_io_engine_;
+  bool persistent_table_io_uring_sq_poll_;
+  int64_t persistent_table_max_snapshot_chain_length_;
+  double persistent_table_max_space_amplification_;
   std::vector<CacheOptions> cache_options_;
 };
 
@@ -16,6 +16,8 @@ limitations under the License.
 #include "oneflow/core/embedding/persistent_table_key_value_store.h"
 #include "oneflow/core/embedding/cached_key_value_store.h"
 #include "oneflow/core/embedding/mock_key_value_store.h"
+#include "oneflow/core/embedding/cpu_key_value_store.h"
+#include "oneflow/core/embedding/cpu_cache.h"
 #include "oneflow/core/embedding/cache.h"
 #include "oneflow/core/device/cuda_util.h"
 #include <gtest/gtest.h>
@@ -28,8 +30,6 @@ namespace embedding {
 
 namespace {
 
-#ifdef WITH_CUDA
-
 std::string CreateTempDirectory() {
   const char* tmp_env = getenv("TMPDIR");
   const char* tmp_dir = tmp_env == nullptr ? "/tmp" : tmp_env;
@@ -39,6 +39,8 @@ std::string CreateTempDirectory() {
   return std::string(path);
 }
 
+#ifdef WITH_CUDA
+
 bool HasCudaDevice() {
   int device_count = 0;
   if (cudaGetDeviceCount(&device_count) != cudaSuccess) { return false; }
@@ -263,6 +265,295 @@ TEST(MockKeyValueStore, Mock) {
 
 #endif  // WITH_CUDA
 
+void TestCpuKeyValueStore(KeyValueStore* store, size_t num_embeddings, size_t test_embeddings,
+                          size_t embedding_vec_size) {
+  auto device = Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0);
+  ep::Stream* stream = device->CreateStream();
+
+  store->SaveSnapshot("init");
+
+  const size_t batch_size = 128;
+  std::vector<uint64_t> keys(num_embeddings);
+  std::vector<float> values(embedding_vec_size * num_embeddings);
+  std::vector<float> values1(embedding_vec_size * num_embeddings);
+  uint32_t n_missing = 0;
+  std::vector<uint32_t> missing_indices(batch_size);
+  for (size_t i = 0; i < num_embeddings; ++i) {
+    uint64_t key = i + 1;
+    keys[i] = key;
+    for (size_t j = 0; j < embedding_vec_size; j++) { values[i * embedding_vec_size + j] = key; }
+  }
+
+  store->Put(stream, 0, keys.data(), values.data());
+
+  for (size_t offset = 0; offset < test_embeddings; offset += batch_size) {
+    const size_t num_keys = std::min(batch_size, test_embeddings - offset);
+    store->Get(stream, num_keys, keys.data() + offset,
+               values1.data() + offset * embedding_vec_size, &n_missing, missing_indices.data());
+    ASSERT_EQ(n_missing, num_keys);
+    store->Put(stream, num_keys, keys.data() + offset, values.data() + offset * embedding_vec_size);
+  }
+
+  store->SaveSnapshot("final");
+
+  std::fill(values1.begin(), values1.end(), 0);
+  for (size_t offset = 0; offset < test_embeddings; offset += batch_size) {
+    const size_t num_keys = std::min(batch_size, test_embeddings - offset);
+    store->Get(stream, num_keys, keys.data() + offset,
+               values1.data() + offset * embedding_vec_size, &n_missing, missing_indices.data());
+    ASSERT_EQ(n_missing, 0);
+  }
+  for (size_t i = 0; i < test_embeddings; ++i) {
+    for (size_t j = 0; j < embedding_vec_size; j++) {
+      ASSERT_EQ(values1[i * embedding_vec_size + j], keys[i]);
+    }
+  }
+
+  store->LoadSnapshot("init");
+
+  for (size_t offset = 0; offset < test_embeddings; offset += batch_size) {
+    const size_t num_keys = std::min(batch_size, test_embeddings - offset);
+    store->Get(stream, num_keys, keys.data() + offset,
+               values1.data() + offset * embedding_vec_size, &n_missing, missing_indices.data());
+    ASSERT_EQ(n_missing, num_keys);
+  }
+
+  store->LoadSnapshot("final");
+
+  std::fill(values1.begin(), values1.end(), 0);
+  for (size_t offset = 0; offset < test_embeddings; offset += batch_size) {
+    const size_t num_keys = std::min(batch_size, test_embeddings - offset);
+    store->Get(stream, num_keys, keys.data() + offset,
+               values1.data() + offset * embedding_vec_size, &n_missing, missing_indices.data());
+    ASSERT_EQ(n_missing, 0);
+  }
+  for (size_t i = 0; i < test_embeddings; ++i) {
+    for (size_t j = 0; j < embedding_vec_size; j++) {
+      ASSERT_EQ(values1[i * embedding_vec_size + j], keys[i]);
+    }
+  }
+  device->DestroyStream(stream);
+}
+
+TEST(CpuPersistentTableKeyValueStore, PersistentTableKeyValueStore) {
+  Singleton<ep::DeviceManagerRegistry>::New();
+  PersistentTableKeyValueStoreOptions options{};
+  uint32_t value_length = 128;
+  std::string path = CreateTempDirectory();
+  options.table_options.path = path;
+  options.table_options.value_size = value_length * sizeof(float);
+  options.table_options.key_size = GetSizeOfDataType(DataType::kUInt64);
+  options.table_options.physical_block_size = 512;
+  std::unique_ptr<KeyValueStore> store = NewCpuPersistentTableKeyValueStore(options);
+  store->ReserveQueryLength(128);
+  TestCpuKeyValueStore(store.get(), 1024, 1024, value_length);
+  store.reset();
+  PosixFile::RecursiveDelete(path);
+  Singleton<ep::DeviceManagerRegistry>::Delete();
+}
+
+TEST(CpuPersistentTableKeyValueStore, IncrementalSnapshot) {
+  Singleton<ep::DeviceManagerRegistry>::New();
+  PersistentTableKeyValueStoreOptions options{};
+  uint32_t value_length = 128;
+  std::string path = CreateTempDirectory();
+  options.table_options.path = path;
+  options.table_options.value_size = value_length * sizeof(float);
+  options.table_options.key_size = GetSizeOfDataType(DataType::kUInt64);
+  options.table_options.physical_block_size = 512;
+  options.table_options.max_snapshot_chain_length = 4;
+  std::unique_ptr<KeyValueStore> store = NewCpuPersistentTableKeyValueStore(options);
+  store->ReserveQueryLength(128);
+  TestCpuKeyValueStore(store.get(), 1024, 1024, value_length);
+  store.reset();
+  // "final" is a delta of "init", overwrite half of the keys in a delta of "final" and merge the
+  // chain, the latest values must win.
+  std::unique_ptr<PersistentTable> table = NewPersistentTable(options.table_options);
+  table->LoadSnapshot("final");
+  const uint32_t num_keys = 1024;
+  std::vector<uint64_t> keys(num_keys);
+  std::iota(keys.begin(), keys.end(), 1);
+  std::vector<float> values(num_keys * value_length);
+  for (size_t i = 0; i < values.size(); ++i) { values[i] = keys[i / value_length] + 1; }
+  table->Put(num_keys / 2, keys.data(), values.data());
+  table->SaveSnapshot("next");
+  ASSERT_TRUE(PosixFile::FileExists(PosixFile::JoinPath(path, "snapshots/next/BASE")));
+  std::unique_ptr<PersistentTable::Iterator> iter(table->ReadSnapshot("next"));
+  std::vector<uint64_t> read_keys(num_keys);
+  uint32_t n_read = 0;
+  uint32_t n_total_read = 0;
+  do {
+    iter->Next(num_keys, &n_read, read_keys.data(), values.data());
+    n_total_read += n_read;
+  } while (n_read != 0);
+  ASSERT_EQ(n_total_read, num_keys);
+  iter.reset();
+  table->CompactSnapshot("next");
+  ASSERT_FALSE(PosixFile::FileExists(PosixFile::JoinPath(path, "snapshots/next/BASE")));
+  table->LoadSnapshot("init");
+  table->LoadSnapshot("next");
+  uint32_t n_missing = 0;
+  std::vector<uint32_t> missing_indices(num_keys);
+  table->Get(num_keys, keys.data(), values.data(), &n_missing, missing_indices.data());
+  ASSERT_EQ(n_missing, 0);
+  for (size_t i = 0; i < values.size(); ++i) {
+    const uint64_t key = keys[i / value_length];
+    ASSERT_EQ(values[i], i < values.size() / 2 ? key + 1 : key);
+  }
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+  Singleton<ep::DeviceManagerRegistry>::Delete();
+}
+
+TEST(CpuPersistentTableKeyValueStore, OverwriteSnapshot) {
+  PersistentTableOptions options{};
+  const uint32_t value_length = 128;
+  std::string path = CreateTempDirectory();
+  options.path = path;
+  options.value_size = value_length * sizeof(float);
+  options.key_size = GetSizeOfDataType(DataType::kUInt64);
+  options.physical_block_size = 512;
+  options.max_snapshot_chain_length = 4;
+  std::unique_ptr<PersistentTable> table = NewPersistentTable(options);
+  const uint32_t num_keys = 1024;
+  std::vector<uint64_t> keys(num_keys);
+  std::iota(keys.begin(), keys.end(), 1);
+  std::vector<float> values(num_keys * value_length);
+  const auto& PutRound = [&](uint32_t round) {
+    for (size_t i = 0; i < values.size(); ++i) { values[i] = keys[i / value_length] + round; }
+    table->Put(num_keys, keys.data(), values.data());
+  };
+  const auto& CheckRound = [&](uint32_t round) {
+    uint32_t n_missing = 0;
+    std::vector<uint32_t> missing_indices(num_keys);
+    table->Get(num_keys, keys.data(), values.data(), &n_missing, missing_indices.data());
+    ASSERT_EQ(n_missing, 0);
+    for (size_t i = 0; i < values.size(); ++i) {
+      ASSERT_EQ(values[i], keys[i / value_length] + round);
+    }
+  };
+  PutRound(0);
+  table->SaveSnapshot("a");
+  PutRound(1);
+  table->SaveSnapshot("b");
+  ASSERT_TRUE(PosixFile::FileExists(PosixFile::JoinPath(path, "snapshots/b/BASE")));
+  PutRound(2);
+  // "b" is a delta of "a", it is merged before "a" is overwritten, and "a" does not become a delta
+  // of "b".
+  table->SaveSnapshot("a");
+  ASSERT_FALSE(PosixFile::FileExists(PosixFile::JoinPath(path, "snapshots/a/BASE")));
+  ASSERT_FALSE(PosixFile::FileExists(PosixFile::JoinPath(path, "snapshots/b/BASE")));
+  table->LoadSnapshot("b");
+  CheckRound(1);
+  table->LoadSnapshot("a");
+  CheckRound(2);
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+}
+
+TEST(CpuPersistentTableKeyValueStore, Compaction) {
+  PersistentTableOptions options{};
+  const uint32_t value_length = 128;
+  std::string path = CreateTempDirectory();
+  options.path = path;
+  options.value_size = value_length * sizeof(float);
+  options.key_size = GetSizeOfDataType(DataType::kUInt64);
+  options.physical_block_size = 512;
+  options.target_chunk_size_mb = 1;
+  options.max_space_amplification = 1.5;
+  std::unique_ptr<PersistentTable> table = NewPersistentTable(options);
+  const uint32_t num_keys = 1024;
+  std::vector<uint64_t> keys(num_keys);
+  std::iota(keys.begin(), keys.end(), 1);
+  std::vector<float> values(num_keys * value_length);
+  const uint32_t num_rounds = 32;
+  for (uint32_t round = 0; round < num_rounds; ++round) {
+    for (size_t i = 0; i < values.size(); ++i) { values[i] = keys[i / value_length] + round; }
+    table->Put(num_keys, keys.data(), values.data());
+    // The snapshot of the first round pins the chunks it refers to.
+    if (round == 0) { table->SaveSnapshot("first"); }
+  }
+  // Each round writes half a chunk, wait for the background compaction to delete the stale ones.
+  const std::string values_dir = PosixFile::JoinPath(path, "values");
+  auto CountValueFiles = [&]() {
+    size_t count = 0;
+    DIR* dir = opendir(values_dir.c_str());
+    struct dirent* ent = nullptr;
+    while ((ent = readdir(dir)) != nullptr) { count += (ent->d_name[0] != '.'); }
+    closedir(dir);
+    return count;
+  };
+  for (int i = 0; i < 100 && CountValueFiles() > 4; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  ASSERT_LE(CountValueFiles(), 4);
+  uint32_t n_missing = 0;
+  std::vector<uint32_t> missing_indices(num_keys);
+  table->Get(num_keys, keys.data(), values.data(), &n_missing, missing_indices.data());
+  ASSERT_EQ(n_missing, 0);
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(values[i], keys[i / value_length] + num_rounds - 1);
+  }
+  table->LoadSnapshot("first");
+  table->Get(num_keys, keys.data(), values.data(), &n_missing, missing_indices.data());
+  ASSERT_EQ(n_missing, 0);
+  for (size_t i = 0; i < values.size(); ++i) { ASSERT_EQ(values[i], keys[i / value_length]); }
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+}
+
+TEST(CpuCachedKeyValueStore, LRU) {
+  Singleton<ep::DeviceManagerRegistry>::New();
+  PersistentTableKeyValueStoreOptions store_options{};
+  std::string path = CreateTempDirectory();
+  store_options.table_options.path = path;
+  uint32_t value_length = 128;
+  store_options.table_options.value_size = value_length * sizeof(float);
+  store_options.table_options.key_size = GetSizeOfDataType(DataType::kUInt64);
+  store_options.table_options.physical_block_size = 512;
+  std::unique_ptr<KeyValueStore> store = NewCpuPersistentTableKeyValueStore(store_options);
+  CacheOptions cache_options{};
+  cache_options.policy = CacheOptions::Policy::kLRU;
+  cache_options.value_memory_kind = CacheOptions::MemoryKind::kHost;
+  cache_options.value_size = 512;
+  cache_options.capacity = 512;
+  cache_options.key_size = 8;
+  std::unique_ptr<Cache> cache = NewCpuCache(cache_options);
+  std::unique_ptr<KeyValueStore> cached_store =
+      NewCpuCachedKeyValueStore(std::move(store), std::move(cache));
+  cached_store->ReserveQueryLength(128);
+  TestCpuKeyValueStore(cached_store.get(), 1024, 1024, value_length);
+  cached_store.reset();
+  PosixFile::RecursiveDelete(path);
+  Singleton<ep::DeviceManagerRegistry>::Delete();
+}
+
+TEST(CpuCachedKeyValueStore, Full) {
+  Singleton<ep::DeviceManagerRegistry>::New();
+  PersistentTableKeyValueStoreOptions store_options{};
+  std::string path = CreateTempDirectory();
+  store_options.table_options.path = path;
+  uint32_t value_length = 128;
+  store_options.table_options.value_size = value_length * sizeof(float);
+  store_options.table_options.key_size = GetSizeOfDataType(DataType::kUInt64);
+  store_options.table_options.physical_block_size = 512;
+  std::unique_ptr<KeyValueStore> store = NewCpuPersistentTableKeyValueStore(store_options);
+  CacheOptions cache_options{};
+  cache_options.policy = CacheOptions::Policy::kFull;
+  cache_options.value_memory_kind = CacheOptions::MemoryKind::kHost;
+  cache_options.value_size = 512;
+  cache_options.capacity = 1024 * 2;
+  cache_options.key_size = 8;
+  std::unique_ptr<Cache> cache = NewCpuCache(cache_options);
+  std::unique_ptr<KeyValueStore> cached_store =
+      NewCpuCachedKeyValueStore(std::move(store), std::move(cache));
+  cached_store->ReserveQueryLength(128);
+  TestCpuKeyValueStore(cached_store.get(), 1024, 1024, value_length);
+  cached_store.reset();
+  PosixFile::RecursiveDelete(path);
+  Singleton<ep::DeviceManagerRegistry>::Delete();
+}
+
 }  // namespace
 
 }  // namespace embedding
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/embedding/lru_cache.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/embedding/hash_functions.cuh"
+#include "oneflow/core/embedding/frequency_sketch.h"
 #include <new>
 #include <cuda.h>
 
@@ -117,6 +118,9 @@ struct LruCacheContext {
   uint64_t n_set;
   uint32_t line_size;
   CacheOptions::MemoryKind value_memory_kind;
+  // Count-min sketch of the TinyLFU admission, nullptr unless the policy is kLFU.
+  uint32_t* sketch;
+  uint64_t sketch_width;
 };
 
 __global__ void InitCacheSetMutex(uint32_t n_set, void* mutex) {
@@ -134,6 +138,10 @@ template<typename Key, typename Elem>
 void ClearLruCacheContext(LruCacheContext<Key, Elem>* ctx) {
   OF_CUDA_CHECK(cudaMemset(ctx->keys, 0, ctx->n_set * kWarpSize * sizeof(Key)));
   OF_CUDA_CHECK(cudaMemset(ctx->ages, 0, ctx->n_set * kWarpSize * sizeof(uint8_t)));
+  if (ctx->sketch != nullptr) {
+    OF_CUDA_CHECK(cudaMemset(ctx->sketch, 0,
+                             kFrequencySketchDepth * ctx->sketch_width * sizeof(uint32_t)));
+  }
   InitCacheSetMutex<<<(ctx->n_set - 1 + 256) / 256, 256>>>(ctx->n_set, ctx->mutex);
 }
 
@@ -185,6 +193,14 @@ void InitLruCacheContext(const CacheOptions& options, LruCacheContext<Key, Elem>
   OF_CUDA_CHECK(cudaMalloc(&(ctx->ages), ages_size));
   const size_t mutex_size = n_set * mutex_size_per_set;
   OF_CUDA_CHECK(cudaMalloc(&(ctx->mutex), mutex_size));
+  if (options.policy == CacheOptions::Policy::kLFU) {
+    ctx->sketch_width = FrequencySketchWidth(n_set * kWarpSize);
+    OF_CUDA_CHECK(
+        cudaMalloc(&(ctx->sketch), kFrequencySketchDepth * ctx->sketch_width * sizeof(uint32_t)));
+  } else {
+    ctx->sketch_width = 0;
+    ctx->sketch = nullptr;
+  }
 
   ClearLruCacheContext(ctx);
 }
@@ -201,6 +217,37 @@ void DestroyLruCacheContext(LruCacheContext<Key, Elem>* ctx) {
   }
   OF_CUDA_CHECK(cudaFree(ctx->ages));
   OF_CUDA_CHECK(cudaFree(ctx->mutex));
+  if (ctx->sketch != nullptr) { OF_CUDA_CHECK(cudaFree(ctx->sketch)); }
+}
+
+template<typename Key, typename Elem>
+__device__ void RecordAccess(const LruCacheContext<Key, Elem>& cache_ctx,
+                             const ThreadContext& thread_ctx, Key key) {
+  if (thread_ctx.lane_id < kFrequencySketchDepth) {
+    const uint64_t hash = FrequencySketchHash()(key);
+    atomicAdd(cache_ctx.sketch
+                  + FrequencySketchIndex(hash, thread_ctx.lane_id, cache_ctx.sketch_width),
+              1U);
+  }
+}
+
+template<typename Key, typename Elem>
+__device__ uint32_t EstimateFrequency(const LruCacheContext<Key, Elem>& cache_ctx,
+                                      const ThreadContext& thread_ctx, Key key) {
+  uint32_t count = 0xFFFFFFFFU;
+  if (thread_ctx.lane_id < kFrequencySketchDepth) {
+    const uint64_t hash = FrequencySketchHash()(key);
+    count = cache_ctx.sketch[FrequencySketchIndex(hash, thread_ctx.lane_id,
+                                                  cache_ctx.sketch_width)];
+  }
+  for (int offset = kFrequencySketchDepth / 2; offset > 0; offset /= 2) {
+    count = min(count, __shfl_down_sync(kFullMask, count, offset));
+  }
+  return __shfl_sync(kFullMask, count, 0);
+}
+
+__global__ void AgeSketchKernel(uint64_t n, uint32_t* sketch) {
+  CUDA_1D_KERNEL_LOOP_T(uint64_t, i, n) { sketch[i] >>= 1; }
 }
 
 template<typename Key, typename Elem>
@@ -270,6 +317,13 @@ struct SetContext {
     return insert_way;
   }
 
+  __device__ Key LruKey(const ThreadContext& thread_ctx) {
+    const Key lane_key = keys[thread_ctx.lane_id];
+    const int lane_age = ages[thread_ctx.lane_id];
+    const int lru_way = __ffs(__ballot_sync(kFullMask, lane_age == 1)) - 1;
+    return __shfl_sync(kFullMask, lane_key, lru_way);
+  }
+
   __device__ void Evict(const LruCacheContext<Key, Elem>& cache_ctx,
                         const ThreadContext& thread_ctx, Key key, int* way, Key* evicted_key) {
     const Key lane_key = keys[thread_ctx.lane_id];
@@ -342,6 +396,7 @@ __global__ void GetKernel(LruCacheContext<Key, Elem> cache_ctx, uint32_t num_key
       } else if (!test_only) {
         set_ctx.Read(cache_ctx, thread_ctx, way, values + key_idx * cache_ctx.line_size);
       }
+      if (!test_only && cache_ctx.sketch != nullptr) { RecordAccess(cache_ctx, thread_ctx, key); }
     }
     if (n_warp_missing > 0) {
       uint32_t base_missing_idx = 0;
@@ -438,6 +493,19 @@ __global__ void EvictKernel(LruCacheContext<Key, Elem> cache_ctx, const Key* key
       const uint32_t set_id = block_set_ids[thread_ctx.warp_id_in_block][i];
       SetContext<Key, Elem> set_ctx(cache_ctx, set_id);
       set_ctx.Lock(thread_ctx);
+      if (cache_ctx.sketch != nullptr
+          && EstimateFrequency(cache_ctx, thread_ctx, key)
+                 <= EstimateFrequency(cache_ctx, thread_ctx, set_ctx.LruKey(thread_ctx))) {
+        // Not admitted, hand the key back to the caller as if it had been evicted.
+        if (thread_ctx.lane_id == 0) { evicted_keys[key_idx] = key; }
+        const Elem* from_line = values + cache_ctx.line_size * indices[key_idx];
+        Elem* to_line = evicted_values + cache_ctx.line_size * key_idx;
+        for (int j = thread_ctx.lane_id; j < cache_ctx.line_size; j += kWarpSize) {
+          to_line[j] = from_line[j];
+        }
+        set_ctx.Unlock(thread_ctx);
+        continue;
+      }
       int evicted_way = -1;
       Key evicted_key = 0;
       set_ctx.Evict(cache_ctx, thread_ctx, key, &evicted_way, &evicted_key);
@@ -502,7 +570,9 @@ class LruCache : public Cache {
         max_query_length_(0),
         query_indices_buffer_(nullptr),
         query_keys_buffer_(nullptr),
-        value_type_(options.value_type) {
+        value_type_(options.value_type),
+        policy_(options.policy),
+        num_sketch_records_(0) {
     OF_CUDA_CHECK(cudaGetDevice(&device_index_));
     InitLruCacheContext(options, &ctx_);
   }
@@ -533,7 +603,7 @@ class LruCache : public Cache {
     max_query_length_ = query_length;
   }
 
-  CacheOptions::Policy Policy() const override { return CacheOptions::Policy::kLRU; }
+  CacheOptions::Policy Policy() const override { return policy_; }
 
   void Test(ep::Stream* stream, uint32_t n_keys, const void* keys, uint32_t* n_missing,
             void* missing_keys, uint32_t* missing_indices) override {
@@ -556,6 +626,14 @@ class LruCache : public Cache {
     cuda_stream->LaunchKernel(GetKernel<Key, Elem, false>, GetLaunchConfig(n_keys), ctx_, n_keys,
                               static_cast<const Key*>(keys), static_cast<Elem*>(values), n_missing,
                               static_cast<Key*>(missing_keys), missing_indices);
+    if (ctx_.sketch != nullptr) {
+      num_sketch_records_ += n_keys;
+      if (num_sketch_records_ >= FrequencySketchSampleSize(ctx_.sketch_width)) {
+        const uint64_t n_counters = kFrequencySketchDepth * ctx_.sketch_width;
+        RUN_CUDA_KERNEL(AgeSketchKernel, stream, n_counters, n_counters, ctx_.sketch);
+        num_sketch_records_ /= 2;
+      }
+    }
   }
 
   void Put(ep::Stream* stream, uint32_t n_keys, const void* keys, const void* values,
@@ -592,7 +670,10 @@ class LruCache : public Cache {
     return;
   }
 
-  void Clear() override { ClearLruCacheContext<Key, Elem>(&ctx_); }
+  void Clear() override {
+    ClearLruCacheContext<Key, Elem>(&ctx_);
+    num_sketch_records_ = 0;
+  }
 
  private:
   int device_index_;
@@ -601,6 +682,8 @@ class LruCache : public Cache {
   uint32_t* query_indices_buffer_;
   Key* query_keys_buffer_;
   DataType value_type_;
+  CacheOptions::Policy policy_;
+  uint64_t num_sketch_records_;
 };
 
 template<typename Key>
@@ -23,6 +23,7 @@ limitations under the License.
 #include "oneflow/core/embedding/posix_file.h"
 #include "oneflow/core/common/blocking_counter.h"
 #include <robin_hood.h>
+#include <condition_variable>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <dirent.h>
@@ -30,6 +31,10 @@ limitations under the License.
 #include <linux/aio_abi.h>
 #include <unistd.h>
 
+#ifdef WITH_LIBURING
+#include <liburing.h>
+#endif  // WITH_LIBURING
+
 #endif  // __linux__
 
 namespace oneflow {
@@ -41,8 +46,11 @@ namespace embedding {
 namespace {
 
 constexpr uint32_t kDefaultNumWorkerThreads = 4;
+constexpr uint32_t kDefaultNumIndexShards = 64;
 constexpr uint32_t kRingQueueDepth = 128;
 constexpr uint32_t kRingSubmitBatch = 32;
+constexpr uint32_t kRingMaxFixedFiles = 4096;
+constexpr uint32_t kRingSqThreadIdleMs = 2000;
 constexpr uint32_t kAioQueueDepth = 128;
 constexpr uint32_t kChunkNameSuffixLength = 12;
 constexpr char const* kKeyFileNamePrefix = "key-";
@@ -57,7 +65,13 @@ constexpr char const* kKeysDirName = "keys";
 constexpr char const* kValuesDirName = "values";
 constexpr char const* kSnapshotsDirName = "snapshots";
 constexpr char const* kSnapshotListFileName = "LIST";
+constexpr char const* kSnapshotBaseFileName = "BASE";
+constexpr char const* kSnapshotWatermarkFileName = "WATERMARK";
+constexpr char const* kCompactingSnapshotSuffix = ".compacting";
+constexpr char const* kCompactedSnapshotSuffix = ".compacted";
 constexpr size_t kParallelForStride = 256;
+constexpr uint32_t kCompactionBatchSize = 4096;
+constexpr uint32_t kCompactionCheckFraction = 16;
 
 template<typename T>
 T* BytesOffset(T* ptr, size_t bytes) {
@@ -197,7 +211,7 @@ class ChunkIteratorImpl : public PersistentTable::Iterator {
 class AioEngine final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(AioEngine);
-  AioEngine() : ctx_{}, num_readings_(0) {
+  explicit AioEngine(const PersistentTableOptions& options) : ctx_{}, num_readings_(0) {
     PCHECK(syscall(__NR_io_setup, kAioQueueDepth, &ctx_) >= 0);
     cbs_.resize(kAioQueueDepth);
     cbs_ptr_.resize(kAioQueueDepth);
@@ -232,6 +246,10 @@ class AioEngine final {
     }
   }
 
+  void RegisterFile(int fd) {}
+
+  void UnregisterFile(int fd) {}
+
  private:
   aio_context_t ctx_;
   long num_readings_;
@@ -240,8 +258,188 @@ class AioEngine final {
   std::vector<struct io_event> events_;
 };
 
+#ifdef WITH_LIBURING
+
+class RingEngine final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(RingEngine);
+  explicit RingEngine(const PersistentTableOptions& options)
+      : ring_{}, num_pending_submit_(0), num_readings_(0), use_fixed_files_(false) {
+    struct io_uring_params params {};
+    if (options.io_uring_sq_poll) {
+      params.flags |= IORING_SETUP_SQPOLL;
+      params.sq_thread_idle = kRingSqThreadIdleMs;
+    }
+    int ret = io_uring_queue_init_params(kRingQueueDepth, &ring_, &params);
+    if (ret != 0 && options.io_uring_sq_poll) {
+      LOG(WARNING) << "Failed to setup io_uring with SQPOLL, error: " << strerror(-ret)
+                   << ", fallback to interrupt driven submission";
+      params = {};
+      ret = io_uring_queue_init_params(kRingQueueDepth, &ring_, &params);
+    }
+    CHECK_EQ(ret, 0) << strerror(-ret);
+    // Register a sparse file table and use the fd itself as the slot, so that the kernel can skip
+    // the per-request fget/fput on the value files.
+    std::vector<int> fds(kRingMaxFixedFiles, -1);
+    if (io_uring_register_files(&ring_, fds.data(), fds.size()) == 0) {
+      use_fixed_files_ = true;
+      fixed_files_.resize(kRingMaxFixedFiles, false);
+    }
+    cqes_.resize(kRingQueueDepth);
+  }
+  ~RingEngine() {
+    WaitUntilDone();
+    io_uring_queue_exit(&ring_);
+  }
+
+  void AsyncPread(int fd, void* buf, size_t count, off_t offset) {
+    if (num_readings_ == kRingQueueDepth) { ReapCompletions(1); }
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+    CHECK(sqe != nullptr);
+    io_uring_prep_read(sqe, fd, buf, count, offset);
+    if (IsFixedFile(fd)) { sqe->flags |= IOSQE_FIXED_FILE; }
+    num_pending_submit_ += 1;
+    num_readings_ += 1;
+    if (num_pending_submit_ == kRingSubmitBatch) { Submit(); }
+  }
+
+  void WaitUntilDone() {
+    Submit();
+    while (num_readings_ != 0) { ReapCompletions(num_readings_); }
+  }
+
+  void RegisterFile(int fd) {
+    if (!use_fixed_files_ || fd < 0 || static_cast<uint32_t>(fd) >= kRingMaxFixedFiles) { return; }
+    CHECK_EQ(io_uring_register_files_update(&ring_, fd, &fd, 1), 1);
+    fixed_files_.at(fd) = true;
+  }
+
+  void UnregisterFile(int fd) {
+    if (!IsFixedFile(fd)) { return; }
+    WaitUntilDone();
+    int empty = -1;
+    CHECK_EQ(io_uring_register_files_update(&ring_, fd, &empty, 1), 1);
+    fixed_files_.at(fd) = false;
+  }
+
+ private:
+  bool IsFixedFile(int fd) const {
+    return use_fixed_files_ && fd >= 0 && static_cast<uint32_t>(fd) < kRingMaxFixedFiles
+           && fixed_files_.at(fd);
+  }
+
+  void Submit() {
+    if (num_pending_submit_ == 0) { return; }
+    const int ret = io_uring_submit(&ring_);
+    CHECK_EQ(ret, static_cast<int>(num_pending_submit_)) << strerror(-ret);
+    num_pending_submit_ = 0;
+  }
+
+  void ReapCompletions(uint32_t wait_nr) {
+    Submit();
+    struct io_uring_cqe* cqe = nullptr;
+    const int ret = io_uring_wait_cqe_nr(&ring_, &cqe, wait_nr);
+    CHECK_EQ(ret, 0) << strerror(-ret);
+    const uint32_t n_completed = io_uring_peek_batch_cqe(&ring_, cqes_.data(), kRingQueueDepth);
+    for (uint32_t i = 0; i < n_completed; ++i) { CHECK_GT(cqes_.at(i)->res, 0); }
+    io_uring_cq_advance(&ring_, n_completed);
+    num_readings_ -= n_completed;
+  }
+
+  struct io_uring ring_;
+  uint32_t num_pending_submit_;
+  uint32_t num_readings_;
+  bool use_fixed_files_;
+  std::vector<bool> fixed_files_;
+  std::vector<struct io_uring_cqe*> cqes_;
+};
+
+bool RingEngineSupported() {
+  struct io_uring ring {};
+  if (io_uring_queue_init(1, &ring, 0) != 0) { return false; }
+  io_uring_queue_exit(&ring);
+  return true;
+}
+
+#endif  // WITH_LIBURING
+
 constexpr size_t kCacheLineSize = 64;
 
+template<typename Key>
+class ShardedIndex final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShardedIndex);
+  using Map = robin_hood::unordered_flat_map<Key, uint64_t>;
+  explicit ShardedIndex(uint32_t num_shards) : num_shards_(num_shards), shards_(num_shards) {
+    CHECK_GT(num_shards_, 0);
+    CHECK_EQ(num_shards_ & (num_shards_ - 1), 0) << "The number of shards must be a power of 2";
+  }
+  ~ShardedIndex() = default;
+
+  uint32_t NumShards() const { return num_shards_; }
+
+  uint32_t ShardId(Key key) const {
+    return PersistentTableIndexHash()(static_cast<uint64_t>(key)) & (num_shards_ - 1);
+  }
+
+  bool Find(Key key, uint64_t* row_id) const {
+    const Map& map = shards_[ShardId(key)].map;
+    auto it = map.find(key);
+    if (it == map.end()) { return false; }
+    *row_id = it->second;
+    return true;
+  }
+
+  Map* MutableShard(uint32_t shard_id) { return &shards_[shard_id].map; }
+
+  const Map& Shard(uint32_t shard_id) const { return shards_[shard_id].map; }
+
+  std::mutex* ShardMutex(uint32_t shard_id) { return &shards_[shard_id].mutex; }
+
+  size_t Size() const {
+    size_t size = 0;
+    for (const auto& shard : shards_) { size += shard.map.size(); }
+    return size;
+  }
+
+  bool Empty() const { return Size() == 0; }
+
+  void Clear() {
+    for (auto& shard : shards_) { shard.map.clear(); }
+  }
+
+  void Reserve(size_t capacity) {
+    const size_t shard_capacity = RoundUp(capacity, num_shards_) / num_shards_;
+    for (auto& shard : shards_) { shard.map.reserve(shard_capacity); }
+  }
+
+  // Stable counting sort of the positions [0, n) by the shard of their keys, the positions of the
+  // i-th shard are grouped in [(*offsets)[i], (*offsets)[i + 1]).
+  template<typename GetKey>
+  void GroupByShard(size_t n, const GetKey& get_key, std::vector<uint64_t>* offsets,
+                    std::vector<uint64_t>* positions) const {
+    offsets->assign(num_shards_ + 1, 0);
+    std::vector<uint32_t> shard_ids(n);
+    for (size_t i = 0; i < n; ++i) {
+      shard_ids[i] = ShardId(get_key(i));
+      (*offsets)[shard_ids[i] + 1] += 1;
+    }
+    for (uint32_t i = 0; i < num_shards_; ++i) { (*offsets)[i + 1] += (*offsets)[i]; }
+    positions->resize(n);
+    std::vector<uint64_t> cursors(offsets->begin(), offsets->end() - 1);
+    for (size_t i = 0; i < n; ++i) { (*positions)[cursors[shard_ids[i]]++] = i; }
+  }
+
+ private:
+  struct alignas(kCacheLineSize) IndexShard {
+    std::mutex mutex;
+    Map map;
+  };
+
+  uint32_t num_shards_;
+  std::vector<IndexShard> shards_;
+};
+
 template<typename Engine>
 using IoTask = std::function<void(Engine* engine)>;
 
@@ -252,7 +450,9 @@ template<typename Engine>
 class Worker final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(Worker);
-  Worker() { thread_ = std::thread(&Worker<Engine>::PullTask, this); }
+  explicit Worker(const PersistentTableOptions& options) : engine_(options) {
+    thread_ = std::thread(&Worker<Engine>::PullTask, this);
+  }
   ~Worker() {
     Shutdown();
     thread_.join();
@@ -302,18 +502,43 @@ class PersistentTableImpl : public PersistentTable {
   void LoadSnapshot(const std::string& name,
                     const std::function<void(Iterator* iter)>& Hook) override;
   void SaveSnapshot(const std::string& name) override;
+  void CompactSnapshot(const std::string& name) override;
   Iterator* ReadSnapshot(const std::string& name) override;
 
  private:
   friend class SnapshotIteratorImpl<Key, Engine>;
+  using AllocateChunkIndex = std::function<uint64_t*(uint64_t chunk_id, uint64_t count)>;
   std::string KeyFilePath(uint64_t chunk_id) const;
   std::string ValueFilePath(uint64_t chunk_id) const;
   std::string IndexFilePath(const std::string& name, uint64_t chunk_id) const;
   std::string SnapshotDirPath(const std::string& name) const;
   std::string SnapshotListFilePath(const std::string& name) const;
+  std::string SnapshotBaseFilePath(const std::string& name) const;
+  std::string SnapshotWatermarkFilePath(const std::string& name) const;
+  void GetSnapshotChain(const std::string& name, std::vector<std::string>* chain) const;
+  bool GetSnapshotWatermark(const std::string& name, uint64_t* watermark) const;
   void LoadSnapshotImpl(const std::string& name);
   void SaveSnapshotImpl(const std::string& name);
-  void ParallelFor(size_t total, const ForRange<Engine>& for_range);
+  void LoadIndex(const std::string& name, int mmap_flags, std::vector<uint64_t>* chunk_ids);
+  void ReadIndex(const std::string& name, int mmap_flags, ShardedIndex<Key>* mapping,
+                 std::vector<uint64_t>* chunk_ids);
+  void WriteIndex(const std::string& name, const ShardedIndex<Key>& mapping, uint64_t min_row_id);
+  void ScatterIndexByChunk(const ShardedIndex<Key>& mapping, uint64_t min_row_id,
+                           const AllocateChunkIndex& Allocate);
+  void GroupIndexByChunk(const ShardedIndex<Key>& mapping, std::vector<uint64_t>* chunk_ids,
+                         std::vector<std::vector<uint64_t>>* chunk_indices);
+  void ParallelFor(size_t total, const ForRange<Engine>& for_range,
+                   size_t stride = kParallelForStride);
+  void RegisterValueFiles(size_t start_chunk_id);
+  void CountLiveRows();
+  void NotifyCompaction();
+  void CompactionLoop();
+  bool CompactOnce();
+  int64_t PickCompactionVictim();
+  void DrainChunk(uint64_t chunk_id);
+  void ReclaimChunk(uint64_t chunk_id);
+  void ListSnapshotChunks(std::unordered_set<uint64_t>* chunk_ids);
+  void ListSnapshotsBasedOn(const std::string& name, std::vector<std::string>* names);
 
   std::string root_dir_;
   std::string keys_dir_;
@@ -331,15 +556,35 @@ class PersistentTableImpl : public PersistentTable {
 
   std::vector<uint32_t> offsets_buffer_;
   AlignedBuffer blocks_buffer_;
+  std::vector<uint64_t> shard_offsets_buffer_;
+  std::vector<uint64_t> grouped_positions_buffer_;
 
   std::recursive_mutex mutex_;
   uint64_t physical_table_size_;
-  robin_hood::unordered_flat_map<Key, uint64_t> row_id_mapping_;
+  ShardedIndex<Key> row_id_mapping_;
   std::vector<PosixFile> value_files_;
   PosixFile writable_key_file_;
   uint64_t writable_key_file_chunk_id_;
   PosixFileLockGuard lock_;
   bool read_only_;
+  uint32_t max_snapshot_chain_length_;
+  // The snapshot that the current index derives from, the next snapshot can be saved as a delta
+  // of it. Empty if there is no such snapshot or it was saved before watermarks were recorded.
+  std::string last_snapshot_name_;
+  uint64_t last_snapshot_watermark_;
+  uint32_t last_snapshot_chain_length_;
+
+  // Background compaction, which moves the live rows out of sparse chunks and deletes the chunks
+  // that are referenced by neither the index nor any snapshot.
+  double max_space_amplification_;
+  std::vector<uint64_t> chunk_num_live_rows_;
+  std::mutex live_rows_mutex_;
+  uint64_t last_compaction_check_size_;
+  std::mutex compaction_mutex_;
+  std::condition_variable compaction_cv_;
+  bool compaction_pending_;
+  std::atomic<bool> compaction_shutdown_;
+  std::thread compaction_thread_;
 };
 
 template<typename Key, typename Engine>
@@ -350,11 +595,20 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
       physical_block_size_(options.physical_block_size),
       logical_block_size_(GetLogicalBlockSize(options.physical_block_size, value_size_)),
       blocks_buffer_(options.physical_block_size),
+      row_id_mapping_(ParseIntegerFromEnv("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_NUM_INDEX_SHARDS",
+                                          kDefaultNumIndexShards)),
       writable_key_file_chunk_id_(-1),
-      read_only_(options.read_only) {
+      read_only_(options.read_only),
+      max_snapshot_chain_length_(options.max_snapshot_chain_length),
+      last_snapshot_watermark_(0),
+      last_snapshot_chain_length_(0),
+      max_space_amplification_(options.max_space_amplification),
+      last_compaction_check_size_(0),
+      compaction_pending_(false),
+      compaction_shutdown_(false) {
   const uint64_t capacity_hint = ParseIntegerFromEnv(
       "ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_CAPACITY_HINT", options.capacity_hint);
-  if (capacity_hint > 0) { row_id_mapping_.reserve(capacity_hint); }
+  if (capacity_hint > 0) { row_id_mapping_.Reserve(capacity_hint); }
   PosixFile::RecursiveCreateDirectory(options.path, 0755);
   const std::string lock_filename = PosixFile::JoinPath(options.path, kLockFileName);
   const bool init = !PosixFile::FileExists(lock_filename);
@@ -385,7 +639,7 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
       "ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_NUM_WORKERS", kDefaultNumWorkerThreads);
   workers_.resize(num_workers);
   for (uint32_t tid = 0; tid < workers_.size(); ++tid) {
-    workers_.at(tid).reset(new Worker<Engine>);
+    workers_.at(tid).reset(new Worker<Engine>(options));
   }
   std::unordered_map<uint64_t, std::string> chunks;
   ListChunkFiles(values_dir_, kValueFileNamePrefix, &chunks);
@@ -403,10 +657,25 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
   } else {
     physical_table_size_ = 0;
   }
+  RegisterValueFiles(0);
+  if (max_space_amplification_ > 0 && !read_only_) {
+    CHECK_GE(max_space_amplification_, 1.0);
+    chunk_num_live_rows_.resize(value_files_.size());
+    last_compaction_check_size_ = physical_table_size_;
+    compaction_thread_ = std::thread(&PersistentTableImpl<Key, Engine>::CompactionLoop, this);
+  }
 }
 
 template<typename Key, typename Engine>
 PersistentTableImpl<Key, Engine>::~PersistentTableImpl() {
+  if (compaction_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(compaction_mutex_);
+      compaction_shutdown_ = true;
+    }
+    compaction_cv_.notify_one();
+    compaction_thread_.join();
+  }
   for (uint32_t tid = 0; tid < workers_.size(); ++tid) { workers_.at(tid)->Shutdown(); }
 }
 
@@ -422,11 +691,10 @@ void PersistentTableImpl<Key, Engine>::GetBlocks(uint32_t num_keys, const void*
   ParallelFor(num_keys, [&](Engine* engine, size_t start, size_t end) {
     for (uint64_t i = start; i < end; ++i) {
       const Key key = static_cast<const Key*>(keys)[i];
-      auto it = row_id_mapping_.find(key);
-      if (it == row_id_mapping_.end()) {
+      uint64_t id = 0;
+      if (!row_id_mapping_.Find(key, &id)) {
         offsets[i] = logical_block_size_;
       } else {
-        const uint64_t id = it->second;
         const uint64_t block_id = id / num_values_per_block_;
         const uint32_t id_in_block = id - block_id * num_values_per_block_;
         const uint32_t offset_in_block = id_in_block * value_size_;
@@ -462,7 +730,7 @@ void PersistentTableImpl<Key, Engine>::Get(uint32_t num_keys, const void* keys,
       missing_indices[missing_count] = i;
       missing_count += 1;
     } else {
-      if (value_size_ != logical_block_size_) {
+      if (blocks_ptr != values) {
         MemcpyOffset(values, i * value_size_, blocks_ptr,
                      (i * logical_block_size_) + offsets_buffer_[i], value_size_);
       }
@@ -484,6 +752,7 @@ void PersistentTableImpl<Key, Engine>::PutBlocks(uint32_t num_keys, const void*
   const uint64_t start_block_id = start_index / num_values_per_block_;
   uint64_t written_blocks = 0;
   const uint64_t block_keys_size = num_values_per_block_ * sizeof(Key);
+  const size_t num_value_files = value_files_.size();
   BlockingCounter bc(1);
   workers_.at(0)->Schedule([&](Engine*) {
     while (written_blocks < num_blocks) {
@@ -522,10 +791,47 @@ void PersistentTableImpl<Key, Engine>::PutBlocks(uint32_t num_keys, const void*
     }
     bc.Decrease();
   });
-  for (uint64_t i = 0; i < num_keys; ++i) {
-    row_id_mapping_[static_cast<const Key*>(keys)[i]] = start_index + i;
-  }
+  const Key* keys_ptr = static_cast<const Key*>(keys);
+  row_id_mapping_.GroupByShard(
+      num_keys, [&](size_t i) { return keys_ptr[i]; }, &shard_offsets_buffer_,
+      &grouped_positions_buffer_);
+  const bool count_live_rows = compaction_thread_.joinable();
+  const size_t num_chunks = RoundUp(physical_table_size_, num_values_per_chunk_)
+                            / num_values_per_chunk_;
+  if (count_live_rows) { chunk_num_live_rows_.resize(num_chunks); }
+  // Shards are disjoint, so each of them can be updated without locking. The first worker may be
+  // still busy writing the values, the other workers will take over its share of the shards.
+  ParallelFor(
+      row_id_mapping_.NumShards(),
+      [&](Engine*, size_t start, size_t end) {
+        std::vector<int64_t> live_rows_delta(count_live_rows ? num_chunks : 0);
+        for (size_t shard_id = start; shard_id < end; ++shard_id) {
+          auto* map = row_id_mapping_.MutableShard(shard_id);
+          const uint64_t shard_end = shard_offsets_buffer_[shard_id + 1];
+          for (uint64_t j = shard_offsets_buffer_[shard_id]; j < shard_end; ++j) {
+            const uint64_t i = grouped_positions_buffer_[j];
+            const uint64_t row_id = start_index + i;
+            auto result = map->emplace(keys_ptr[i], row_id);
+            if (!result.second) {
+              if (count_live_rows) {
+                live_rows_delta[result.first->second / num_values_per_chunk_] -= 1;
+              }
+              result.first->second = row_id;
+            }
+            if (count_live_rows) { live_rows_delta[row_id / num_values_per_chunk_] += 1; }
+          }
+        }
+        if (count_live_rows) {
+          std::lock_guard<std::mutex> lock(live_rows_mutex_);
+          for (size_t chunk_id = 0; chunk_id < num_chunks; ++chunk_id) {
+            chunk_num_live_rows_[chunk_id] += live_rows_delta[chunk_id];
+          }
+        }
+      },
+      1);
   bc.WaitForeverUntilCntEqualZero();
+  if (value_files_.size() != num_value_files) { RegisterValueFiles(num_value_files); }
+  NotifyCompaction();
 }
 
 template<typename Key, typename Engine>
@@ -580,67 +886,242 @@ std::string PersistentTableImpl<Key, Engine>::SnapshotListFilePath(const std::st
 }
 
 template<typename Key, typename Engine>
-void PersistentTableImpl<Key, Engine>::LoadSnapshotImpl(const std::string& name) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  const std::string snapshot_base = SnapshotDirPath(name);
-  const std::string snapshot_list = SnapshotListFilePath(name);
-  row_id_mapping_.clear();
-  std::ifstream list_if(snapshot_list);
-  std::string index_filename;
-  while (std::getline(list_if, index_filename)) {
-    const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
-    PosixFile index_file(PosixFile::JoinPath(snapshot_base, index_filename), O_RDONLY, 0644);
-    const size_t index_file_size = index_file.Size();
-    CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
-    if (index_file_size == 0) { return; }
-    const size_t n_entries = index_file_size / sizeof(uint64_t);
-    PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ);
-    PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
-    PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ);
-    const uint64_t* indices = static_cast<const uint64_t*>(mapped_index.ptr());
-    const Key* keys = static_cast<const Key*>(mapped_key.ptr());
-    const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
-    row_id_mapping_.reserve(row_id_mapping_.size() + n_entries);
-    for (size_t i = 0; i < n_entries; ++i) {
-      CHECK(row_id_mapping_.emplace(keys[indices[i] - chunk_start_index], indices[i]).second);
+std::string PersistentTableImpl<Key, Engine>::SnapshotBaseFilePath(const std::string& name) const {
+  return PosixFile::JoinPath(SnapshotDirPath(name), kSnapshotBaseFileName);
+}
+
+template<typename Key, typename Engine>
+std::string PersistentTableImpl<Key, Engine>::SnapshotWatermarkFilePath(
+    const std::string& name) const {
+  return PosixFile::JoinPath(SnapshotDirPath(name), kSnapshotWatermarkFileName);
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::GetSnapshotChain(const std::string& name,
+                                                        std::vector<std::string>* chain) const {
+  chain->clear();
+  std::string current = name;
+  while (true) {
+    CHECK(PosixFile::FileExists(SnapshotListFilePath(current)))
+        << "Can not find snapshot " << current << " of the snapshot chain of " << name;
+    CHECK(std::find(chain->begin(), chain->end(), current) == chain->end())
+        << "Cyclic snapshot chain of " << name;
+    chain->push_back(current);
+    const std::string base_filename = SnapshotBaseFilePath(current);
+    if (!PosixFile::FileExists(base_filename)) { break; }
+    std::ifstream base_if(base_filename);
+    CHECK(std::getline(base_if, current)) << base_filename;
+  }
+}
+
+template<typename Key, typename Engine>
+bool PersistentTableImpl<Key, Engine>::GetSnapshotWatermark(const std::string& name,
+                                                            uint64_t* watermark) const {
+  const std::string watermark_filename = SnapshotWatermarkFilePath(name);
+  if (!PosixFile::FileExists(watermark_filename)) { return false; }
+  std::ifstream watermark_if(watermark_filename);
+  CHECK(watermark_if >> *watermark) << watermark_filename;
+  return true;
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::LoadIndex(const std::string& name, int mmap_flags,
+                                                 std::vector<uint64_t>* chunk_ids) {
+  ReadIndex(name, mmap_flags, &row_id_mapping_, chunk_ids);
+  if (compaction_thread_.joinable()) { CountLiveRows(); }
+  std::vector<std::string> chain;
+  GetSnapshotChain(name, &chain);
+  if (GetSnapshotWatermark(name, &last_snapshot_watermark_)) {
+    last_snapshot_name_ = name;
+    last_snapshot_chain_length_ = chain.size() - 1;
+  } else {
+    last_snapshot_name_.clear();
+  }
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ReadIndex(const std::string& name, int mmap_flags,
+                                                 ShardedIndex<Key>* mapping,
+                                                 std::vector<uint64_t>* chunk_ids) {
+  std::vector<std::string> chain;
+  GetSnapshotChain(name, &chain);
+  mapping->Clear();
+  // (position in the chain, chunk id) of every index file of the base snapshot and its deltas.
+  std::vector<std::pair<size_t, uint64_t>> index_files;
+  for (size_t chain_idx = 0; chain_idx < chain.size(); ++chain_idx) {
+    std::ifstream list_if(SnapshotListFilePath(chain.at(chain_idx)));
+    std::string index_filename;
+    while (std::getline(list_if, index_filename)) {
+      index_files.emplace_back(chain_idx, GetChunkId(index_filename, kIndexFileNamePrefix));
     }
   }
+  chunk_ids->clear();
+  for (const auto& index_file : index_files) { chunk_ids->push_back(index_file.second); }
+  std::sort(chunk_ids->begin(), chunk_ids->end());
+  chunk_ids->erase(std::unique(chunk_ids->begin(), chunk_ids->end()), chunk_ids->end());
+  ParallelFor(
+      index_files.size(),
+      [&](Engine*, size_t start, size_t end) {
+        std::vector<uint64_t> shard_offsets;
+        std::vector<uint64_t> positions;
+        for (size_t file_idx = start; file_idx < end; ++file_idx) {
+          const std::string& snapshot_name = chain.at(index_files.at(file_idx).first);
+          const uint64_t chunk_id = index_files.at(file_idx).second;
+          PosixFile index_file(IndexFilePath(snapshot_name, chunk_id), O_RDONLY, 0644);
+          const size_t index_file_size = index_file.Size();
+          CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
+          if (index_file_size == 0) { continue; }
+          const size_t n_entries = index_file_size / sizeof(uint64_t);
+          PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ,
+                                       mmap_flags);
+          PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
+          PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ, mmap_flags);
+          const uint64_t* indices = static_cast<const uint64_t*>(mapped_index.ptr());
+          const Key* keys = static_cast<const Key*>(mapped_key.ptr());
+          const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
+          auto GetKey = [&](size_t i) { return keys[indices[i] - chunk_start_index]; };
+          mapping->GroupByShard(n_entries, GetKey, &shard_offsets, &positions);
+          for (uint32_t shard_id = 0; shard_id < mapping->NumShards(); ++shard_id) {
+            if (shard_offsets[shard_id] == shard_offsets[shard_id + 1]) { continue; }
+            std::lock_guard<std::mutex> shard_lock(*mapping->ShardMutex(shard_id));
+            auto* map = mapping->MutableShard(shard_id);
+            for (uint64_t j = shard_offsets[shard_id]; j < shard_offsets[shard_id + 1]; ++j) {
+              const uint64_t i = positions[j];
+              auto result = map->emplace(GetKey(i), indices[i]);
+              if (!result.second) {
+                // Rows are only appended, so the latest version of a key that appears in several
+                // snapshots of the chain is the one with the largest row id.
+                CHECK_GT(chain.size(), 1);
+                result.first->second = std::max(result.first->second, indices[i]);
+              }
+            }
+          }
+        }
+      },
+      1);
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::LoadSnapshotImpl(const std::string& name) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::vector<uint64_t> chunk_ids;
+  LoadIndex(name, MAP_SHARED, &chunk_ids);
 }
 
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::SaveSnapshotImpl(const std::string& name) {
   CHECK(!read_only_);
   std::lock_guard<std::recursive_mutex> lock(mutex_);
+  const bool overwrite = PosixFile::FileExists(SnapshotListFilePath(name));
+  if (overwrite) {
+    // The deltas based on the old content would be applied to the new one, merge them with
+    // their chain first.
+    std::vector<std::string> dependents;
+    ListSnapshotsBasedOn(name, &dependents);
+    for (const std::string& dependent : dependents) { CompactSnapshot(dependent); }
+    PosixFile::RecursiveDelete(SnapshotDirPath(name));
+  }
+  // A delta only records the rows put since its base snapshot, which are exactly the rows at or
+  // above the watermark of the base since PutBlocks never overwrites a row in place. A snapshot
+  // that is overwritten is saved in full, it may be the base of the last snapshot.
+  const bool incremental = !overwrite && max_snapshot_chain_length_ > 0
+                           && !last_snapshot_name_.empty()
+                           && last_snapshot_chain_length_ < max_snapshot_chain_length_
+                           && PosixFile::FileExists(SnapshotListFilePath(last_snapshot_name_));
   PosixFile::RecursiveCreateDirectory(SnapshotDirPath(name), 0755);
+  if (incremental) {
+    std::ofstream base_ofs(SnapshotBaseFilePath(name));
+    base_ofs << last_snapshot_name_ << std::endl;
+  }
+  WriteIndex(name, row_id_mapping_, incremental ? last_snapshot_watermark_ : 0);
+  std::ofstream watermark_ofs(SnapshotWatermarkFilePath(name));
+  watermark_ofs << physical_table_size_ << std::endl;
+  last_snapshot_chain_length_ = incremental ? last_snapshot_chain_length_ + 1 : 0;
+  last_snapshot_name_ = name;
+  last_snapshot_watermark_ = physical_table_size_;
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::WriteIndex(const std::string& name,
+                                                  const ShardedIndex<Key>& mapping,
+                                                  uint64_t min_row_id) {
   std::ofstream list_ofs(SnapshotListFilePath(name));
-  if (row_id_mapping_.empty()) { return; }
   std::vector<PosixMappedFile> index_files(value_files_.size());
-  std::vector<uint64_t> counters(value_files_.size());
-  const uint64_t max_index_file_size = num_values_per_chunk_ * sizeof(uint64_t);
-  for (const auto& pair : row_id_mapping_) {
-    const uint64_t chunk_id = pair.second / num_values_per_chunk_;
-    CHECK(chunk_id < value_files_.size());
-    if (index_files[chunk_id].ptr() == nullptr) {
-      PosixFile snapshot_file(IndexFilePath(name, chunk_id), O_CREAT | O_RDWR, 0644);
-      snapshot_file.Truncate(max_index_file_size);
-      index_files[chunk_id] =
-          PosixMappedFile(std::move(snapshot_file), max_index_file_size, PROT_READ | PROT_WRITE);
-    }
-    uint64_t* indices = static_cast<uint64_t*>(index_files[chunk_id].ptr());
-    uint64_t& count = counters[chunk_id];
-    CHECK_LT(count, num_values_per_chunk_);
-    indices[count] = pair.second;
-    count += 1;
-  }
-  for (size_t i = 0; i < value_files_.size(); ++i) {
-    const uint64_t count = counters[i];
-    if (count > 0) {
-      index_files[i].file().Truncate(count * sizeof(uint64_t));
-      list_ofs << kIndexFileNamePrefix + GetChunkName(i) << std::endl;
-    } else {
-      CHECK(index_files[i].ptr() == nullptr);
+  ScatterIndexByChunk(mapping, min_row_id, [&](uint64_t chunk_id, uint64_t count) {
+    const uint64_t index_file_size = count * sizeof(uint64_t);
+    PosixFile snapshot_file(IndexFilePath(name, chunk_id), O_CREAT | O_RDWR, 0644);
+    snapshot_file.Truncate(index_file_size);
+    index_files[chunk_id] =
+        PosixMappedFile(std::move(snapshot_file), index_file_size, PROT_READ | PROT_WRITE);
+    list_ofs << kIndexFileNamePrefix + GetChunkName(chunk_id) << std::endl;
+    return static_cast<uint64_t*>(index_files[chunk_id].ptr());
+  });
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::GroupIndexByChunk(
+    const ShardedIndex<Key>& mapping, std::vector<uint64_t>* chunk_ids,
+    std::vector<std::vector<uint64_t>>* chunk_indices) {
+  chunk_ids->clear();
+  chunk_indices->clear();
+  chunk_indices->resize(value_files_.size());
+  ScatterIndexByChunk(mapping, 0, [&](uint64_t chunk_id, uint64_t count) {
+    chunk_ids->push_back(chunk_id);
+    chunk_indices->at(chunk_id).resize(count);
+    return chunk_indices->at(chunk_id).data();
+  });
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ScatterIndexByChunk(const ShardedIndex<Key>& mapping,
+                                                           uint64_t min_row_id,
+                                                           const AllocateChunkIndex& Allocate) {
+  if (mapping.Empty()) { return; }
+  const size_t num_chunks = value_files_.size();
+  const uint32_t num_shards = mapping.NumShards();
+  // counters[shard_id * num_chunks + chunk_id] first counts the rows of each shard in each chunk,
+  // and then becomes the write cursor of the shard in the index of the chunk.
+  std::vector<uint64_t> counters(num_shards * num_chunks);
+  ParallelFor(
+      num_shards,
+      [&](Engine*, size_t start, size_t end) {
+        for (size_t shard_id = start; shard_id < end; ++shard_id) {
+          uint64_t* shard_counters = counters.data() + shard_id * num_chunks;
+          for (const auto& pair : mapping.Shard(shard_id)) {
+            if (pair.second < min_row_id) { continue; }
+            const uint64_t chunk_id = pair.second / num_values_per_chunk_;
+            CHECK(chunk_id < num_chunks);
+            shard_counters[chunk_id] += 1;
+          }
+        }
+      },
+      1);
+  std::vector<uint64_t*> index_ptrs(num_chunks);
+  for (size_t chunk_id = 0; chunk_id < num_chunks; ++chunk_id) {
+    uint64_t count = 0;
+    for (uint32_t shard_id = 0; shard_id < num_shards; ++shard_id) {
+      uint64_t& counter = counters[shard_id * num_chunks + chunk_id];
+      const uint64_t shard_count = counter;
+      counter = count;
+      count += shard_count;
     }
+    CHECK_LE(count, num_values_per_chunk_);
+    if (count > 0) { index_ptrs[chunk_id] = Allocate(chunk_id, count); }
   }
+  ParallelFor(
+      num_shards,
+      [&](Engine*, size_t start, size_t end) {
+        for (size_t shard_id = start; shard_id < end; ++shard_id) {
+          uint64_t* shard_counters = counters.data() + shard_id * num_chunks;
+          for (const auto& pair : mapping.Shard(shard_id)) {
+            if (pair.second < min_row_id) { continue; }
+            const uint64_t chunk_id = pair.second / num_values_per_chunk_;
+            index_ptrs[chunk_id][shard_counters[chunk_id]] = pair.second;
+            shard_counters[chunk_id] += 1;
+          }
+        }
+      },
+      1);
 }
 
 template<typename Key, typename Engine>
@@ -663,36 +1144,43 @@ void PersistentTableImpl<Key, Engine>::LoadSnapshot(
                           true)) {
     mmap_flags |= MAP_POPULATE;
   }
-  const std::string snapshot_base = SnapshotDirPath(name);
-  const std::string snapshot_list = SnapshotListFilePath(name);
-  row_id_mapping_.clear();
-  std::ifstream list_if(snapshot_list);
-  std::string index_filename;
-  while (std::getline(list_if, index_filename)) {
-    const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
-    PosixFile index_file(PosixFile::JoinPath(snapshot_base, index_filename), O_RDONLY, 0644);
+  std::vector<uint64_t> chunk_ids;
+  LoadIndex(name, mmap_flags, &chunk_ids);
+  if (!Hook) { return; }
+  if (PosixFile::FileExists(SnapshotBaseFilePath(name))) {
+    // The index files of a delta are partial, iterate over the merged index instead.
+    std::vector<std::vector<uint64_t>> chunk_indices;
+    GroupIndexByChunk(row_id_mapping_, &chunk_ids, &chunk_indices);
+    for (const uint64_t chunk_id : chunk_ids) {
+      PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
+      PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ, mmap_flags);
+      PosixFile value_file(ValueFilePath(chunk_id), O_RDONLY, 0644);
+      PosixMappedFile mapped_value(std::move(value_file), value_file.Size(), PROT_READ,
+                                   mmap_flags);
+      ChunkIteratorImpl<Key> chunk_iterator(
+          value_size_, logical_block_size_, num_values_per_block_, num_values_per_chunk_, chunk_id,
+          chunk_indices.at(chunk_id).size(), static_cast<const Key*>(mapped_key.ptr()),
+          chunk_indices.at(chunk_id).data(), mapped_value.ptr());
+      Hook(&chunk_iterator);
+    }
+    return;
+  }
+  for (const uint64_t chunk_id : chunk_ids) {
+    PosixFile index_file(IndexFilePath(name, chunk_id), O_RDONLY, 0644);
     const size_t index_file_size = index_file.Size();
-    CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
-    if (index_file_size == 0) { return; }
+    if (index_file_size == 0) { continue; }
     const size_t n_entries = index_file_size / sizeof(uint64_t);
     PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ, mmap_flags);
     PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
     PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ, mmap_flags);
     const uint64_t* indices = static_cast<const uint64_t*>(mapped_index.ptr());
     const Key* keys = static_cast<const Key*>(mapped_key.ptr());
-    const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
-    row_id_mapping_.reserve(row_id_mapping_.size() + n_entries);
-    for (size_t i = 0; i < n_entries; ++i) {
-      CHECK(row_id_mapping_.emplace(keys[indices[i] - chunk_start_index], indices[i]).second);
-    }
-    if (Hook) {
-      PosixFile value_file(ValueFilePath(chunk_id), O_RDONLY, 0644);
-      PosixMappedFile mapped_value(std::move(value_file), value_file.Size(), PROT_READ, mmap_flags);
-      ChunkIteratorImpl<Key> chunk_iterator(value_size_, logical_block_size_, num_values_per_block_,
-                                            num_values_per_chunk_, chunk_id, n_entries, keys,
-                                            indices, mapped_value.ptr());
-      Hook(&chunk_iterator);
-    }
+    PosixFile value_file(ValueFilePath(chunk_id), O_RDONLY, 0644);
+    PosixMappedFile mapped_value(std::move(value_file), value_file.Size(), PROT_READ, mmap_flags);
+    ChunkIteratorImpl<Key> chunk_iterator(value_size_, logical_block_size_, num_values_per_block_,
+                                          num_values_per_chunk_, chunk_id, n_entries, keys,
+                                          indices, mapped_value.ptr());
+    Hook(&chunk_iterator);
   }
 }
 
@@ -701,23 +1189,62 @@ void PersistentTableImpl<Key, Engine>::SaveSnapshot(const std::string& name) {
   SaveSnapshotImpl(name);
 }
 
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::CompactSnapshot(const std::string& name) {
+  CHECK(!read_only_);
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::vector<std::string> chain;
+  GetSnapshotChain(name, &chain);
+  if (chain.size() == 1) { return; }
+  ShardedIndex<Key> mapping(row_id_mapping_.NumShards());
+  std::vector<uint64_t> chunk_ids;
+  ReadIndex(name, MAP_SHARED, &mapping, &chunk_ids);
+  // Build the merged snapshot aside and swap it in, so that a failure on the way leaves the chain
+  // untouched. Deltas based on this snapshot stay valid since its content does not change.
+  const std::string compacting_name = name + kCompactingSnapshotSuffix;
+  const std::string compacted_name = name + kCompactedSnapshotSuffix;
+  PosixFile::RecursiveDelete(SnapshotDirPath(compacting_name));
+  PosixFile::RecursiveCreateDirectory(SnapshotDirPath(compacting_name), 0755);
+  WriteIndex(compacting_name, mapping, 0);
+  uint64_t watermark = 0;
+  if (GetSnapshotWatermark(name, &watermark)) {
+    std::ofstream watermark_ofs(SnapshotWatermarkFilePath(compacting_name));
+    watermark_ofs << watermark << std::endl;
+  }
+  PosixFile::RecursiveDelete(SnapshotDirPath(compacted_name));
+  PCHECK(rename(SnapshotDirPath(name).c_str(), SnapshotDirPath(compacted_name).c_str()) == 0);
+  PCHECK(rename(SnapshotDirPath(compacting_name).c_str(), SnapshotDirPath(name).c_str()) == 0);
+  PosixFile::RecursiveDelete(SnapshotDirPath(compacted_name));
+  if (last_snapshot_name_ == name) { last_snapshot_chain_length_ = 0; }
+}
+
 template<typename Key, typename Engine>
 PersistentTable::Iterator* PersistentTableImpl<Key, Engine>::ReadSnapshot(const std::string& name) {
-  return new SnapshotIteratorImpl<Key, Engine>(this, name, value_size_, logical_block_size_,
-                                               num_values_per_block_, num_values_per_chunk_);
+  auto* iter = new SnapshotIteratorImpl<Key, Engine>(
+      this, name, value_size_, logical_block_size_, num_values_per_block_, num_values_per_chunk_);
+  if (PosixFile::FileExists(SnapshotBaseFilePath(name))) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    ShardedIndex<Key> mapping(row_id_mapping_.NumShards());
+    std::vector<uint64_t> chunk_ids;
+    ReadIndex(name, MAP_SHARED, &mapping, &chunk_ids);
+    GroupIndexByChunk(mapping, &chunk_ids, &iter->chunk_indices_);
+    iter->chunk_ids_ = std::move(chunk_ids);
+    iter->merged_ = true;
+  }
+  return iter;
 }
 
 template<typename Key, typename Engine>
-void PersistentTableImpl<Key, Engine>::ParallelFor(size_t total,
-                                                   const ForRange<Engine>& for_range) {
+void PersistentTableImpl<Key, Engine>::ParallelFor(size_t total, const ForRange<Engine>& for_range,
+                                                   size_t stride) {
   BlockingCounter bc(workers_.size());
   std::atomic<size_t> counter(0);
   for (size_t i = 0; i < workers_.size(); ++i) {
     workers_.at(i)->Schedule([&](Engine* engine) {
       while (true) {
-        const size_t start = counter.fetch_add(kParallelForStride, std::memory_order_relaxed);
+        const size_t start = counter.fetch_add(stride, std::memory_order_relaxed);
         if (start >= total) { break; }
-        const size_t next_start = start + kParallelForStride;
+        const size_t next_start = start + stride;
         const size_t end = std::min(next_start, total);
         for_range(engine, start, end);
       }
@@ -728,6 +1255,208 @@ void PersistentTableImpl<Key, Engine>::ParallelFor(size_t total,
   bc.WaitForeverUntilCntEqualZero();
 }
 
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::RegisterValueFiles(size_t start_chunk_id) {
+  BlockingCounter bc(workers_.size());
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_.at(i)->Schedule([&](Engine* engine) {
+      for (size_t chunk_id = start_chunk_id; chunk_id < value_files_.size(); ++chunk_id) {
+        engine->RegisterFile(value_files_.at(chunk_id).fd());
+      }
+      bc.Decrease();
+    });
+  }
+  bc.WaitForeverUntilCntEqualZero();
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::CountLiveRows() {
+  const size_t num_chunks = value_files_.size();
+  chunk_num_live_rows_.assign(num_chunks, 0);
+  ParallelFor(
+      row_id_mapping_.NumShards(),
+      [&](Engine*, size_t start, size_t end) {
+        std::vector<uint64_t> live_rows(num_chunks);
+        for (size_t shard_id = start; shard_id < end; ++shard_id) {
+          for (const auto& pair : row_id_mapping_.Shard(shard_id)) {
+            live_rows[pair.second / num_values_per_chunk_] += 1;
+          }
+        }
+        std::lock_guard<std::mutex> lock(live_rows_mutex_);
+        for (size_t chunk_id = 0; chunk_id < num_chunks; ++chunk_id) {
+          chunk_num_live_rows_[chunk_id] += live_rows[chunk_id];
+        }
+      },
+      1);
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::NotifyCompaction() {
+  if (!compaction_thread_.joinable()) { return; }
+  // The space amplification changes slowly, only check it again every a fraction of a chunk.
+  if (physical_table_size_
+      < last_compaction_check_size_ + num_values_per_chunk_ / kCompactionCheckFraction) {
+    return;
+  }
+  last_compaction_check_size_ = physical_table_size_;
+  {
+    std::lock_guard<std::mutex> lock(compaction_mutex_);
+    compaction_pending_ = true;
+  }
+  compaction_cv_.notify_one();
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::CompactionLoop() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(compaction_mutex_);
+      compaction_cv_.wait(lock, [&]() { return compaction_pending_ || compaction_shutdown_; });
+      if (compaction_shutdown_) { return; }
+      compaction_pending_ = false;
+    }
+    while (!compaction_shutdown_ && CompactOnce()) {}
+  }
+}
+
+template<typename Key, typename Engine>
+bool PersistentTableImpl<Key, Engine>::CompactOnce() {
+  int64_t victim = -1;
+  {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    victim = PickCompactionVictim();
+    if (victim < 0) { return false; }
+  }
+  // Rows are moved in small batches so that lookups and updates are only briefly blocked.
+  DrainChunk(victim);
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (chunk_num_live_rows_.at(victim) != 0) { return false; }
+  std::unordered_set<uint64_t> snapshot_chunks;
+  ListSnapshotChunks(&snapshot_chunks);
+  if (snapshot_chunks.count(victim) == 0) { ReclaimChunk(victim); }
+  return true;
+}
+
+template<typename Key, typename Engine>
+int64_t PersistentTableImpl<Key, Engine>::PickCompactionVictim() {
+  // The last chunk is still being appended to and never compacted.
+  if (value_files_.size() < 2) { return -1; }
+  const uint64_t last_chunk_id = value_files_.size() - 1;
+  uint64_t num_physical_rows = physical_table_size_ - last_chunk_id * num_values_per_chunk_;
+  uint64_t num_live_rows = 0;
+  for (uint64_t chunk_id = 0; chunk_id < value_files_.size(); ++chunk_id) {
+    if (chunk_id != last_chunk_id && value_files_.at(chunk_id).IsOpen()) {
+      num_physical_rows += num_values_per_chunk_;
+    }
+    num_live_rows += chunk_num_live_rows_.at(chunk_id);
+  }
+  if (num_physical_rows <= max_space_amplification_ * num_live_rows) { return -1; }
+  // Only chunks that are sparser than the target on their own are worth rewriting, denser ones
+  // would cost more writes than the space they give back.
+  const double max_occupancy = 1.0 / max_space_amplification_;
+  std::unordered_set<uint64_t> snapshot_chunks;
+  ListSnapshotChunks(&snapshot_chunks);
+  int64_t victim = -1;
+  double victim_occupancy = max_occupancy;
+  for (uint64_t chunk_id = 0; chunk_id < last_chunk_id; ++chunk_id) {
+    if (!value_files_.at(chunk_id).IsOpen()) { continue; }
+    const uint64_t num_chunk_live_rows = chunk_num_live_rows_.at(chunk_id);
+    // A drained chunk that a snapshot still refers to has to wait until the snapshot is removed.
+    if (num_chunk_live_rows == 0 && snapshot_chunks.count(chunk_id) != 0) { continue; }
+    const double occupancy = static_cast<double>(num_chunk_live_rows) / num_values_per_chunk_;
+    if (occupancy < victim_occupancy) {
+      victim = chunk_id;
+      victim_occupancy = occupancy;
+    }
+  }
+  return victim;
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::DrainChunk(uint64_t chunk_id) {
+  PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
+  const uint64_t num_rows = key_file.Size() / sizeof(Key);
+  if (num_rows == 0) { return; }
+  PosixMappedFile mapped_key(std::move(key_file), num_rows * sizeof(Key), PROT_READ);
+  const Key* chunk_keys = static_cast<const Key*>(mapped_key.ptr());
+  const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
+  std::vector<Key> keys;
+  std::vector<char> values;
+  for (uint64_t start = 0; start < num_rows; start += kCompactionBatchSize) {
+    if (compaction_shutdown_) { return; }
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (chunk_num_live_rows_.at(chunk_id) == 0) { return; }
+    keys.clear();
+    const uint64_t end = std::min<uint64_t>(start + kCompactionBatchSize, num_rows);
+    for (uint64_t i = start; i < end; ++i) {
+      uint64_t row_id = 0;
+      if (row_id_mapping_.Find(chunk_keys[i], &row_id) && row_id == chunk_start_index + i) {
+        keys.push_back(chunk_keys[i]);
+      }
+    }
+    if (keys.empty()) { continue; }
+    values.resize(keys.size() * value_size_);
+    uint32_t n_missing = 0;
+    std::vector<uint32_t> missing_indices(keys.size());
+    Get(keys.size(), keys.data(), values.data(), &n_missing, missing_indices.data());
+    CHECK_EQ(n_missing, 0);
+    Put(keys.size(), keys.data(), values.data());
+  }
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ReclaimChunk(uint64_t chunk_id) {
+  const int fd = value_files_.at(chunk_id).fd();
+  BlockingCounter bc(workers_.size());
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_.at(i)->Schedule([&](Engine* engine) {
+      engine->UnregisterFile(fd);
+      bc.Decrease();
+    });
+  }
+  bc.WaitForeverUntilCntEqualZero();
+  value_files_.at(chunk_id).Close();
+  PCHECK(unlink(ValueFilePath(chunk_id).c_str()) == 0);
+  const std::string key_filename = KeyFilePath(chunk_id);
+  if (PosixFile::FileExists(key_filename)) { PCHECK(unlink(key_filename.c_str()) == 0); }
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ListSnapshotChunks(std::unordered_set<uint64_t>* chunk_ids) {
+  chunk_ids->clear();
+  if (!PosixFile::FileExists(snapshots_dir_)) { return; }
+  DIR* dir = opendir(snapshots_dir_.c_str());
+  PCHECK(dir != nullptr);
+  struct dirent* ent = nullptr;
+  while ((ent = readdir(dir)) != nullptr) {
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) { continue; }
+    std::ifstream list_if(SnapshotListFilePath(ent->d_name));
+    std::string index_filename;
+    while (std::getline(list_if, index_filename)) {
+      chunk_ids->insert(GetChunkId(index_filename, kIndexFileNamePrefix));
+    }
+  }
+  PCHECK(closedir(dir) == 0);
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ListSnapshotsBasedOn(const std::string& name,
+                                                            std::vector<std::string>* names) {
+  names->clear();
+  DIR* dir = opendir(snapshots_dir_.c_str());
+  PCHECK(dir != nullptr);
+  struct dirent* ent = nullptr;
+  while ((ent = readdir(dir)) != nullptr) {
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) { continue; }
+    const std::string base_filename = SnapshotBaseFilePath(ent->d_name);
+    if (!PosixFile::FileExists(base_filename)) { continue; }
+    std::ifstream base_if(base_filename);
+    std::string base;
+    if (std::getline(base_if, base) && base == name) { names->emplace_back(ent->d_name); }
+  }
+  PCHECK(closedir(dir) == 0);
+}
+
 template<typename Key, typename Engine>
 class SnapshotIteratorImpl : public PersistentTable::Iterator {
  public:
@@ -741,7 +1470,8 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
         logical_block_size_(logical_block_size),
         num_values_per_block_(num_values_per_block),
         num_values_per_chunk_(num_values_per_chunk),
-        current_chunk_(0) {
+        current_chunk_(0),
+        merged_(false) {
     const std::string snapshot_list = table_->SnapshotListFilePath(snapshot_name);
     std::ifstream list_if(snapshot_list);
     std::string index_filename;
@@ -751,6 +1481,10 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
 
   void Next(uint32_t num_keys, uint32_t* return_keys, void* keys, void* values) override {
     *return_keys = 0;
+    if (merged_) {
+      NextMerged(num_keys, return_keys, keys, values);
+      return;
+    }
     while (current_chunk_ < indices_names_.size()) {
       if (!chunk_iterator_) {
         const std::string snapshot_base = table_->SnapshotDirPath(snapshot_name_);
@@ -792,6 +1526,33 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
   void Reset() override { UNIMPLEMENTED(); }
 
  private:
+  friend class PersistentTableImpl<Key, Engine>;
+
+  // Iterates over the index merged from a delta snapshot and its bases.
+  void NextMerged(uint32_t num_keys, uint32_t* return_keys, void* keys, void* values) {
+    while (current_chunk_ < chunk_ids_.size()) {
+      const uint64_t chunk_id = chunk_ids_.at(current_chunk_);
+      if (!chunk_iterator_) {
+        PosixFile key_file(table_->KeyFilePath(chunk_id), O_RDONLY, 0644);
+        keys_file_.reset(new PosixMappedFile(std::move(key_file), key_file.Size(), PROT_READ));
+        PosixFile value_file(table_->ValueFilePath(chunk_id), O_RDONLY, 0644);
+        values_file_.reset(
+            new PosixMappedFile(std::move(value_file), value_file.Size(), PROT_READ));
+        chunk_iterator_.reset(new ChunkIteratorImpl<Key>(
+            value_size_, logical_block_size_, num_values_per_block_, num_values_per_chunk_,
+            chunk_id, chunk_indices_.at(chunk_id).size(),
+            static_cast<const Key*>(keys_file_->ptr()), chunk_indices_.at(chunk_id).data(),
+            values_file_->ptr()));
+      }
+      chunk_iterator_->Next(num_keys, return_keys, keys, values);
+      if (*return_keys != 0) { return; }
+      chunk_iterator_.reset();
+      keys_file_.reset();
+      values_file_.reset();
+      current_chunk_ += 1;
+    }
+  }
+
   PersistentTableImpl<Key, Engine>* table_;
   std::string snapshot_name_;
   uint32_t value_size_;
@@ -800,6 +1561,9 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
   uint64_t num_values_per_chunk_;
   size_t current_chunk_;
   std::vector<std::string> indices_names_;
+  bool merged_;
+  std::vector<uint64_t> chunk_ids_;
+  std::vector<std::vector<uint64_t>> chunk_indices_;
   std::unique_ptr<PosixMappedFile> keys_file_;
   std::unique_ptr<PosixMappedFile> values_file_;
   std::unique_ptr<PosixMappedFile> indices_file_;
@@ -819,6 +1583,15 @@ std::unique_ptr<PersistentTable> DispatchKeyType(const PersistentTableOptions& o
 }
 
 std::unique_ptr<PersistentTable> DispatchEngine(const PersistentTableOptions& options) {
+  if (options.io_engine == PersistentTableOptions::IoEngine::kUring) {
+#ifdef WITH_LIBURING
+    static const bool ring_engine_supported = RingEngineSupported();
+    if (ring_engine_supported) { return DispatchKeyType<RingEngine>(options); }
+    LOG(WARNING) << "io_uring is not supported by the kernel, fallback to aio engine";
+#else
+    LOG(WARNING) << "OneFlow is not built with liburing, fallback to aio engine";
+#endif  // WITH_LIBURING
+  }
   return DispatchKeyType<AioEngine>(options);
 }
 
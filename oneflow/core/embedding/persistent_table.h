@@ -23,6 +23,10 @@ namespace oneflow {
 namespace embedding {
 
 struct PersistentTableOptions {
+  enum class IoEngine {
+    kAio,
+    kUring,
+  };
   std::string path;
   uint32_t key_size = 0;
   uint32_t value_size = 0;
@@ -30,6 +34,14 @@ struct PersistentTableOptions {
   uint16_t physical_block_size = 4096;
   uint64_t capacity_hint = 0;
   bool read_only = false;
+  IoEngine io_engine = IoEngine::kAio;
+  bool io_uring_sq_poll = false;
+  // Maximum number of delta snapshots on top of a full one, 0 saves every snapshot in full. A
+  // delta depends on its base snapshot, which must be kept or compacted into the delta first.
+  uint32_t max_snapshot_chain_length = 0;
+  // Target ratio of the rows on disk to the live rows, above which a background thread rewrites
+  // the live rows of sparse chunks and deletes the chunks. 0 disables the compaction.
+  double max_space_amplification = 0;
 };
 
 class PersistentTable {
@@ -61,6 +73,8 @@ class PersistentTable {
   virtual void LoadSnapshot(const std::string& name,
                             const std::function<void(Iterator* iter)>& Hook) = 0;
   virtual void SaveSnapshot(const std::string& name) = 0;
+  // Merges a delta snapshot with its bases into a full snapshot of the same name.
+  virtual void CompactSnapshot(const std::string& name) = 0;
   virtual Iterator* ReadSnapshot(const std::string& name) = 0;
 };
 
@@ -0,0 +1,302 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cstring>
+#include "oneflow/core/framework/eager_elementwise_fusion.h"
+#include "oneflow/core/common/decorator.h"
+#include "oneflow/core/common/env_var/eager.h"
+#include "oneflow/core/common/small_obj_pool.h"
+#include "oneflow/core/eager/local_dep_object.h"
+#include "oneflow/core/framework/eager_graph.h"
+#include "oneflow/core/framework/id_util.h"
+#include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
+#include "oneflow/core/framework/mutable_attr_map.h"
+#include "oneflow/core/framework/op_builder.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_impl.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/user/kernels/fused_eager_elementwise_kernel.h"
+#include "oneflow/user/kernels/stateful_opkernel.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+// Deferred ops read at most this many tensors which are not made by deferred ops.
+constexpr size_t kMaxDeferredInputs = 64;
+
+const HashMap<std::string, FusedEagerElementwiseOpcode>& OpTypeName2Opcode() {
+  static const HashMap<std::string, FusedEagerElementwiseOpcode> op_type_name2opcode{
+      {"relu", FusedEagerElementwiseOpcode::kRelu},
+      {"sigmoid", FusedEagerElementwiseOpcode::kSigmoid},
+      {"tanh", FusedEagerElementwiseOpcode::kTanh},
+      {"exp", FusedEagerElementwiseOpcode::kExp},
+      {"negative", FusedEagerElementwiseOpcode::kNegative},
+      {"abs", FusedEagerElementwiseOpcode::kAbs},
+      {"sqrt", FusedEagerElementwiseOpcode::kSqrt},
+      {"rsqrt", FusedEagerElementwiseOpcode::kRsqrt},
+      {"square", FusedEagerElementwiseOpcode::kSquare},
+      {"reciprocal", FusedEagerElementwiseOpcode::kReciprocal},
+      {"silu", FusedEagerElementwiseOpcode::kSilu},
+      {"scalar_add", FusedEagerElementwiseOpcode::kScalarAdd},
+      {"scalar_mul", FusedEagerElementwiseOpcode::kScalarMul},
+      {"scalar_div", FusedEagerElementwiseOpcode::kScalarDiv},
+      {"add_n", FusedEagerElementwiseOpcode::kAdd},
+      {"broadcast_add", FusedEagerElementwiseOpcode::kAdd},
+      {"broadcast_sub", FusedEagerElementwiseOpcode::kSub},
+      {"broadcast_mul", FusedEagerElementwiseOpcode::kMul},
+      {"broadcast_div", FusedEagerElementwiseOpcode::kDiv},
+  };
+  return op_type_name2opcode;
+}
+
+bool IsScalarOpcode(FusedEagerElementwiseOpcode opcode) {
+  return opcode == FusedEagerElementwiseOpcode::kScalarAdd
+         || opcode == FusedEagerElementwiseOpcode::kScalarMul
+         || opcode == FusedEagerElementwiseOpcode::kScalarDiv;
+}
+
+// A value read by a deferred op, an input of the group or the output of a deferred op.
+struct ValueRef {
+  bool is_input;
+  int32_t index;
+};
+
+struct DeferredOp {
+  FusedEagerElementwiseOpcode opcode;
+  ValueRef x;
+  // {true, -1} unless the op is binary.
+  ValueRef y;
+  double scalar;
+  std::shared_ptr<vm::EagerBlobObject> output;
+};
+
+struct DeferredGroup {
+  Symbol<Stream> stream;
+  Symbol<LocalTensorMeta> tensor_meta;
+  std::vector<std::shared_ptr<vm::EagerBlobObject>> inputs;
+  std::vector<DeferredOp> ops;
+  // The blob objects are held by the group, so that their addresses are not reused before the
+  // flush.
+  HashMap<const vm::EagerBlobObject*, ValueRef> eager_blob_object2value;
+  // Storages of the outputs, also shared by the views of them.
+  HashSet<const vm::TensorStorage*> output_storages;
+
+  bool empty() const { return ops.empty(); }
+  void Clear() {
+    inputs.clear();
+    ops.clear();
+    eager_blob_object2value.clear();
+    output_storages.clear();
+  }
+};
+
+DeferredGroup* MutThreadLocalDeferredGroup() {
+  thread_local DeferredGroup group;
+  return &group;
+}
+
+ValueRef Value4Input(DeferredGroup* group,
+                     const std::shared_ptr<vm::EagerBlobObject>& eager_blob_object) {
+  const auto& it = group->eager_blob_object2value.find(eager_blob_object.get());
+  if (it != group->eager_blob_object2value.end()) { return it->second; }
+  const ValueRef value{true, static_cast<int32_t>(group->inputs.size())};
+  group->inputs.emplace_back(eager_blob_object);
+  group->eager_blob_object2value.emplace(eager_blob_object.get(), value);
+  return value;
+}
+
+// Inputs are the same shape as the output or have one element.
+bool IsFusableInput(const LocalTensorMeta& input_meta, const LocalTensorMeta& output_meta) {
+  if (input_meta.dtype() != output_meta.dtype()) { return false; }
+  if (input_meta.device() != output_meta.device()) { return false; }
+  if (input_meta.shape().elem_cnt() == 1) { return true; }
+  return input_meta.shape() == output_meta.shape()
+         && IsContiguous(input_meta.shape(), input_meta.stride());
+}
+
+Maybe<one::UserOpExpr> FusedEagerElementwise(int32_t input_size, int32_t output_size) {
+  return one::OpBuilder("fused_eager_elementwise", *JUST(UniqueStr("fused_eager_elementwise")))
+      .Input("in", input_size)
+      .Output("out", output_size)
+      .Build();
+}
+
+auto* CachedFusedEagerElementwiseOpExpr =
+    DECORATE(&FusedEagerElementwise, ThreadLocalCachedCopiable);
+
+}  // namespace
+
+/*static*/ bool EagerElementwiseFusion::IsEnabled() {
+  return ThreadLocalEnvBool<ONEFLOW_EAGER_ELEMENTWISE_FUSION>();
+}
+
+/*static*/ bool EagerElementwiseFusion::HasDeferredOps() {
+  return !MutThreadLocalDeferredGroup()->empty();
+}
+
+/*static*/ Maybe<bool> EagerElementwiseFusion::TryDefer(const UserOpExpr& user_op_expr,
+                                                        const vm::EagerBlobObjectList& inputs,
+                                                        TensorTuple* outputs,
+                                                        const OpExprInterpContext& ctx,
+                                                        const LocalTensorInferResult& result) {
+  // Captured graphs record the ops as they run.
+  if (EagerGraph::CapturingGraph() != nullptr) { return false; }
+  if (outputs->size() != 1 || outputs->at(0)) { return false; }
+  const auto& it = OpTypeName2Opcode().find(user_op_expr.op_type_name());
+  if (it == OpTypeName2Opcode().end()) { return false; }
+  const FusedEagerElementwiseOpcode opcode = it->second;
+  if (inputs.size() != (IsBinaryFusedEagerElementwiseOpcode(opcode) ? 2 : 1)) { return false; }
+  const Symbol<LocalTensorMeta>& tensor_meta = result.output_tensor_metas().at(0);
+  if (tensor_meta->device()->enum_type() != DeviceType::kCPU) { return false; }
+  if (tensor_meta->dtype() != DataType::kFloat && tensor_meta->dtype() != DataType::kDouble) {
+    return false;
+  }
+  if (tensor_meta->shape().elem_cnt() == 0
+      || !IsContiguous(tensor_meta->shape(), tensor_meta->stride())) {
+    return false;
+  }
+  for (const auto& input : inputs) {
+    if (!IsFusableInput(*input->tensor_meta(), *tensor_meta)) { return false; }
+  }
+  double scalar = 0;
+  if (IsScalarOpcode(opcode)) {
+    if (JUST(ctx.attrs.GetAttr<bool>("has_float_operand"))) {
+      scalar = JUST(ctx.attrs.GetAttr<double>("float_operand"));
+    } else {
+      scalar = static_cast<double>(JUST(ctx.attrs.GetAttr<int64_t>("int_operand")));
+    }
+  }
+
+  DeferredGroup* group = MutThreadLocalDeferredGroup();
+  if (!group->empty()
+      && (group->stream != result.stream()
+          || group->tensor_meta->shape() != tensor_meta->shape()
+          || group->tensor_meta->dtype() != tensor_meta->dtype()
+          || static_cast<int64_t>(group->ops.size())
+                 >= ThreadLocalEnvInteger<ONEFLOW_EAGER_ELEMENTWISE_FUSION_MAX_OPS>()
+          || group->inputs.size() + inputs.size() > kMaxDeferredInputs)) {
+    JUST(Flush());
+  }
+  // Views of deferred outputs are not made by ops, the deferred ops have to run before their use.
+  for (const auto& input : inputs) {
+    if (group->eager_blob_object2value.count(input.get()) == 0
+        && group->output_storages.count(input->tensor_storage().get()) > 0) {
+      JUST(Flush());
+      break;
+    }
+  }
+  if (group->empty()) {
+    group->stream = result.stream();
+    group->tensor_meta = tensor_meta;
+  }
+  DeferredOp op{opcode, Value4Input(group, inputs.at(0)), ValueRef{true, -1}, scalar, nullptr};
+  if (inputs.size() > 1) { op.y = Value4Input(group, inputs.at(1)); }
+
+  std::shared_ptr<EagerLocalTensorImpl> tensor_impl =
+      obj_pool::make_shared<EagerLocalTensorImpl>(false, false);
+  JUST(tensor_impl->InitEagerBlobObject(tensor_meta, NewLocalDepObject()));
+  op.output = JUST(tensor_impl->eager_blob_object());
+  (*outputs)[0] = obj_pool::make_shared<LocalTensor>(tensor_impl);
+
+  group->eager_blob_object2value.emplace(op.output.get(),
+                                         ValueRef{false, static_cast<int32_t>(group->ops.size())});
+  group->output_storages.insert(op.output->tensor_storage().get());
+  group->ops.emplace_back(std::move(op));
+  return true;
+}
+
+/*static*/ Maybe<void> EagerElementwiseFusion::Flush() {
+  DeferredGroup* group = MutThreadLocalDeferredGroup();
+  if (group->empty()) { return Maybe<void>::Ok(); }
+  const int32_t op_size = group->ops.size();
+  // Outputs are still used if their tensors or views of them are alive, the group holds one
+  // reference to each of them.
+  std::vector<bool> is_output(op_size);
+  std::vector<bool> is_needed(op_size);
+  for (int32_t i = op_size - 1; i >= 0; --i) {
+    const DeferredOp& op = group->ops.at(i);
+    is_output.at(i) = op.output.use_count() > 1 || op.output->tensor_storage().use_count() > 1;
+    if (!is_output.at(i) && !is_needed.at(i)) { continue; }
+    is_needed.at(i) = true;
+    for (const ValueRef& operand : {op.x, op.y}) {
+      if (!operand.is_input) { is_needed.at(operand.index) = true; }
+    }
+  }
+
+  // Values of the program are its inputs, then the outputs of the needed ops.
+  vm::EagerBlobObjectList input_eager_blob_objects;
+  std::vector<int32_t> input_values(group->inputs.size(), -1);
+  for (int32_t i = 0; i < op_size; ++i) {
+    if (!is_needed.at(i)) { continue; }
+    for (const ValueRef& operand : {group->ops.at(i).x, group->ops.at(i).y}) {
+      if (!operand.is_input || operand.index < 0 || input_values.at(operand.index) >= 0) {
+        continue;
+      }
+      input_values.at(operand.index) = input_eager_blob_objects.size();
+      input_eager_blob_objects.emplace_back(group->inputs.at(operand.index));
+    }
+  }
+  std::vector<int32_t> op_values(op_size, -1);
+  int32_t value_size = input_eager_blob_objects.size();
+  for (int32_t i = 0; i < op_size; ++i) {
+    if (is_needed.at(i)) { op_values.at(i) = value_size++; }
+  }
+  const auto& Value4Ref = [&](const ValueRef& ref) -> int32_t {
+    if (ref.is_input) { return ref.index < 0 ? -1 : input_values.at(ref.index); }
+    return op_values.at(ref.index);
+  };
+  std::vector<int32_t> opcodes;
+  std::vector<int32_t> operands;
+  std::vector<int64_t> scalars;
+  std::vector<int32_t> output_values;
+  vm::EagerBlobObjectList output_eager_blob_objects;
+  for (int32_t i = 0; i < op_size; ++i) {
+    if (!is_needed.at(i)) { continue; }
+    const DeferredOp& op = group->ops.at(i);
+    opcodes.emplace_back(static_cast<int32_t>(op.opcode));
+    operands.emplace_back(Value4Ref(op.x));
+    operands.emplace_back(Value4Ref(op.y));
+    int64_t scalar_bits = 0;
+    std::memcpy(&scalar_bits, &op.scalar, sizeof(scalar_bits));
+    scalars.emplace_back(scalar_bits);
+    if (is_output.at(i)) {
+      output_values.emplace_back(op_values.at(i));
+      output_eager_blob_objects.emplace_back(op.output);
+    }
+  }
+  const Symbol<Stream> stream = group->stream;
+  const Shape shape = group->tensor_meta->shape();
+  // Cleared before the instructions are built, or PhysicalRun would flush the group again.
+  group->Clear();
+  if (output_eager_blob_objects.empty()) { return Maybe<void>::Ok(); }
+
+  const auto& op_expr = JUST(CachedFusedEagerElementwiseOpExpr(input_eager_blob_objects.size(),
+                                                               output_eager_blob_objects.size()));
+  const auto& kernel = JUST(op_expr->MutKernel4Stream(stream));
+  auto& attrs =
+      THREAD_CACHED_MUTABLE_ATTR_MAP("opcodes", "operands", "scalars", "output_values", "shape");
+  attrs.SetAllAttrs(opcodes, operands, scalars, output_values, shape);
+  return PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+    return builder->Call(kernel, std::move(input_eager_blob_objects),
+                         std::move(output_eager_blob_objects), OpExprInterpContext(attrs), stream);
+  });
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,55 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_EAGER_ELEMENTWISE_FUSION_H_
+#define ONEFLOW_CORE_FRAMEWORK_EAGER_ELEMENTWISE_FUSION_H_
+
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/eager/eager_blob_object.h"
+
+namespace oneflow {
+namespace one {
+
+class UserOpExpr;
+class TensorTuple;
+struct OpExprInterpContext;
+class LocalTensorInferResult;
+
+// With ONEFLOW_EAGER_ELEMENTWISE_FUSION, the eager local interpreter does not run elementwise ops
+// on cpu tensors of one shape as they come: it makes their outputs and defers them, and the
+// deferred ops run as one fused_eager_elementwise op, which takes each block of elements through
+// all of them while the block is in cache. The outputs that are dropped before that, like the
+// temporaries of `(x * a + b).relu()`, are neither allocated nor written.
+//
+// The deferred ops of a thread run before the next instructions of the thread are built, so that
+// every later op, sync or release of the thread sees them. Other threads must not use their
+// outputs before such a sync.
+class EagerElementwiseFusion final {
+ public:
+  static bool IsEnabled();
+  // Defers the op and makes its outputs if it can be fused, returns whether it is deferred.
+  static Maybe<bool> TryDefer(const UserOpExpr& user_op_expr,
+                              const vm::EagerBlobObjectList& inputs, TensorTuple* outputs,
+                              const OpExprInterpContext& ctx,
+                              const LocalTensorInferResult& result);
+  static bool HasDeferredOps();
+  // Runs the deferred ops of this thread.
+  static Maybe<void> Flush();
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_EAGER_ELEMENTWISE_FUSION_H_
@@ -0,0 +1,221 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include "oneflow/core/framework/eager_graph.h"
+#include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/common/small_obj_pool.h"
+#include "oneflow/core/eager/local_dep_object.h"
+#include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_impl.h"
+#include "oneflow/user/kernels/stateful_opkernel.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+thread_local EagerGraph* capturing_graph = nullptr;
+
+// The storage offset and the view flag of the inputs may differ between replays.
+bool IsSameMeta(const LocalTensorMeta& lhs, const LocalTensorMeta& rhs) {
+  return lhs.shape() == rhs.shape() && lhs.stride() == rhs.stride() && lhs.dtype() == rhs.dtype()
+         && lhs.device() == rhs.device();
+}
+
+}  // namespace
+
+EagerGraph::EagerGraph() : is_capturing_(false), is_captured_(false), value_size_(0) {}
+
+EagerGraph::~EagerGraph() {
+  if (capturing_graph == this) { capturing_graph = nullptr; }
+}
+
+/*static*/ EagerGraph* EagerGraph::CapturingGraph() { return capturing_graph; }
+
+Maybe<void> EagerGraph::BeginCapture(const TensorTuple& inputs) {
+  CHECK_OR_RETURN(!is_capturing_ && !is_captured_)
+      << Error::RuntimeError() << "an eager graph can only be captured once";
+  CHECK_OR_RETURN(capturing_graph == nullptr)
+      << Error::RuntimeError() << "another eager graph is capturing on this thread";
+  CHECK_OR_RETURN(!autograd::GradMode::is_enabled())
+      << Error::RuntimeError() << "eager graphs do not record autograd, capture under no_grad";
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    CHECK_OR_RETURN(inputs.at(i)->is_local())
+        << Error::RuntimeError() << "inputs of eager graphs must be local tensors";
+    const auto& eager_blob_object = JUST(inputs.at(i)->eager_blob_object());
+    CHECK_OR_RETURN(eager_blob_object2value_id_.count(eager_blob_object.get()) == 0)
+        << Error::RuntimeError() << "input " << i << " of the eager graph is given twice";
+    input_metas_.emplace_back(eager_blob_object->tensor_meta());
+    NewValueId(eager_blob_object);
+  }
+  is_capturing_ = true;
+  capturing_graph = this;
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> EagerGraph::EndCapture(const TensorTuple& outputs) {
+  CHECK_OR_RETURN(is_capturing_ && capturing_graph == this)
+      << Error::RuntimeError() << "the eager graph is not capturing on this thread";
+  is_capturing_ = false;
+  capturing_graph = nullptr;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    const auto& eager_blob_object = JUST(outputs.at(i)->eager_blob_object());
+    const auto& it = eager_blob_object2value_id_.find(eager_blob_object.get());
+    const bool is_constant =
+        it != eager_blob_object2value_id_.end()
+        && std::any_of(constants_.begin(), constants_.end(),
+                       [&](const auto& pair) { return pair.first == it->second; });
+    if (it == eager_blob_object2value_id_.end() || is_constant) {
+      ClearCaptureStates();
+      return Error::RuntimeError() << "output " << i
+                                   << " of the eager graph is neither an input nor made by the "
+                                      "captured ops";
+    }
+    output_value_ids_.emplace_back(it->second);
+  }
+  eager_blob_object2value_id_.clear();
+  captured_values_.clear();
+  captured_storages_.clear();
+  is_captured_ = true;
+  return Maybe<void>::Ok();
+}
+
+void EagerGraph::AbortCapture() {
+  if (capturing_graph == this) { capturing_graph = nullptr; }
+  is_capturing_ = false;
+  ClearCaptureStates();
+}
+
+void EagerGraph::ClearCaptureStates() {
+  ops_.clear();
+  value_size_ = 0;
+  input_metas_.clear();
+  constants_.clear();
+  output_value_ids_.clear();
+  eager_blob_object2value_id_.clear();
+  captured_values_.clear();
+  captured_storages_.clear();
+}
+
+int64_t EagerGraph::NewValueId(const std::shared_ptr<vm::EagerBlobObject>& eager_blob_object) {
+  const int64_t value_id = value_size_++;
+  eager_blob_object2value_id_[eager_blob_object.get()] = value_id;
+  captured_values_.emplace_back(eager_blob_object);
+  captured_storages_.insert(eager_blob_object->tensor_storage().get());
+  return value_id;
+}
+
+Maybe<int64_t> EagerGraph::ValueId4Input(
+    const std::shared_ptr<vm::EagerBlobObject>& eager_blob_object) {
+  const auto& it = eager_blob_object2value_id_.find(eager_blob_object.get());
+  if (it != eager_blob_object2value_id_.end()) { return it->second; }
+  CHECK_OR_RETURN(captured_storages_.count(eager_blob_object->tensor_storage().get()) == 0)
+      << Error::RuntimeError() << "views of the tensors of an eager graph can not be captured";
+  const int64_t value_id = value_size_++;
+  eager_blob_object2value_id_.emplace(eager_blob_object.get(), value_id);
+  constants_.emplace_back(value_id, eager_blob_object);
+  return value_id;
+}
+
+Maybe<void> EagerGraph::RecordOp(const UserOpExpr& user_op_expr,
+                                 const std::shared_ptr<StatefulOpKernel>& kernel,
+                                 const vm::EagerBlobObjectList& inputs,
+                                 const vm::EagerBlobObjectList& outputs,
+                                 const std::vector<bool>& is_output_inplace,
+                                 const OpExprInterpContext& ctx,
+                                 const LocalTensorInferResult& result) {
+  CHECK_OR_RETURN(is_capturing_);  // NOLINT
+  CHECK_OR_RETURN(kernel->output_tuple_indexes4mut2_obns().empty())
+      << Error::RuntimeError() << "the output shapes of " << user_op_expr.op_type_name()
+      << " are known after it runs, it can not be captured by eager graphs";
+  Op op{kernel, ctx, result.stream(), {}, {}, {}};
+  op.input_value_ids.reserve(inputs.size());
+  for (const auto& input : inputs) { op.input_value_ids.emplace_back(JUST(ValueId4Input(input))); }
+  op.output_value_ids.reserve(outputs.size());
+  op.output_metas.reserve(outputs.size());
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    if (is_output_inplace.at(i)) {
+      op.output_value_ids.emplace_back(JUST(ValueId4Input(outputs.at(i))));
+      op.output_metas.emplace_back();
+    } else {
+      op.output_value_ids.emplace_back(NewValueId(outputs.at(i)));
+      op.output_metas.emplace_back(result.output_tensor_metas().at(i));
+    }
+  }
+  ops_.emplace_back(std::move(op));
+  return Maybe<void>::Ok();
+}
+
+Maybe<TensorTuple> EagerGraph::Replay(const TensorTuple& inputs) const {
+  CHECK_OR_RETURN(is_captured_) << Error::RuntimeError() << "the eager graph is not captured";
+  // The ops of a replay are not seen by the interpreter, so they would be missed by a capture.
+  CHECK_OR_RETURN(capturing_graph == nullptr)
+      << Error::RuntimeError() << "eager graphs can not be replayed while capturing";
+  CHECK_EQ_OR_RETURN(inputs.size(), input_metas_.size())
+      << Error::RuntimeError() << "the eager graph takes " << input_metas_.size()
+      << " inputs, but got " << inputs.size();
+  std::vector<std::shared_ptr<vm::EagerBlobObject>> values(value_size_);
+  std::vector<std::shared_ptr<Tensor>> tensors(value_size_);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    CHECK_OR_RETURN(inputs.at(i)->is_local())
+        << Error::RuntimeError() << "inputs of eager graphs must be local tensors";
+    const auto& eager_blob_object = JUST(inputs.at(i)->eager_blob_object());
+    const auto& meta = eager_blob_object->tensor_meta();
+    CHECK_OR_RETURN(IsSameMeta(*meta, *input_metas_.at(i)))
+        << Error::RuntimeError() << "input " << i << " of the eager graph is captured as "
+        << input_metas_.at(i)->shape().ToString() << " " << DataType_Name(input_metas_.at(i)->dtype())
+        << " on " << input_metas_.at(i)->device()->ToString() << ", but got "
+        << meta->shape().ToString() << " " << DataType_Name(meta->dtype()) << " on "
+        << meta->device()->ToString();
+    values.at(i) = eager_blob_object;
+    tensors.at(i) = inputs.at(i);
+  }
+  for (const auto& pair : constants_) { values.at(pair.first) = pair.second; }
+  JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+    for (const auto& op : ops_) {
+      vm::EagerBlobObjectList input_eager_blob_objects(op.input_value_ids.size());
+      for (size_t i = 0; i < op.input_value_ids.size(); ++i) {
+        input_eager_blob_objects.at(i) = values.at(op.input_value_ids.at(i));
+      }
+      vm::EagerBlobObjectList output_eager_blob_objects(op.output_value_ids.size());
+      for (size_t i = 0; i < op.output_value_ids.size(); ++i) {
+        const int64_t value_id = op.output_value_ids.at(i);
+        if (op.output_metas.at(i)) {
+          std::shared_ptr<EagerLocalTensorImpl> tensor_impl =
+              obj_pool::make_shared<EagerLocalTensorImpl>(false, false);
+          JUST(tensor_impl->InitEagerBlobObject(op.output_metas.at(i), NewLocalDepObject()));
+          values.at(value_id) = JUST(tensor_impl->eager_blob_object());
+          tensors.at(value_id) = obj_pool::make_shared<LocalTensor>(tensor_impl);
+        }
+        output_eager_blob_objects.at(i) = values.at(value_id);
+      }
+      JUST(builder->Call(op.kernel, std::move(input_eager_blob_objects),
+                         std::move(output_eager_blob_objects), op.ctx, op.stream));
+    }
+    return Maybe<void>::Ok();
+  }));
+  auto outputs = std::make_shared<TensorTuple>(output_value_ids_.size());
+  for (size_t i = 0; i < output_value_ids_.size(); ++i) {
+    (*outputs)[i] = tensors.at(output_value_ids_.at(i));
+  }
+  return outputs;
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,110 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_EAGER_GRAPH_H_
+#define ONEFLOW_CORE_FRAMEWORK_EAGER_GRAPH_H_
+
+#include <memory>
+#include <vector>
+#include "oneflow/core/common/hash_container.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/symbol.h"
+#include "oneflow/core/common/tensor_meta.h"
+#include "oneflow/core/eager/eager_blob_object.h"
+#include "oneflow/core/framework/op_interpreter.h"
+#include "oneflow/core/framework/stream.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+
+namespace oneflow {
+namespace one {
+
+class StatefulOpKernel;
+class UserOpExpr;
+class LocalTensorInferResult;
+
+// The eager local ops run by a thread between BeginCapture and EndCapture, recorded so that
+// Replay runs them again on new inputs of the same metas. A replay skips the interpreting, the
+// meta inference and the per op vm::Run of eager mode: the ops are issued by one PhysicalRun,
+// in the order they were captured.
+//
+// Tensors used by the ops that are neither graph inputs nor made by captured ops, like module
+// parameters, are captured by reference, replays read and write them in place. Capturing is
+// refused under autograd, for ops whose output shapes are only known after they run, and for
+// views made of captured tensors, which are not ops of the interpreter.
+class EagerGraph final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(EagerGraph);
+  EagerGraph();
+  ~EagerGraph();
+
+  Maybe<void> BeginCapture(const TensorTuple& inputs);
+  // `outputs` are the tensors replays return, they must be graph inputs or made by captured ops.
+  Maybe<void> EndCapture(const TensorTuple& outputs);
+  // Drops what is recorded so far, for when the captured code fails.
+  void AbortCapture();
+  Maybe<TensorTuple> Replay(const TensorTuple& inputs) const;
+
+  bool is_capturing() const { return is_capturing_; }
+  bool is_captured() const { return is_captured_; }
+  size_t op_size() const { return ops_.size(); }
+
+  // The graph capturing on this thread, or nullptr.
+  static EagerGraph* CapturingGraph();
+
+  // Called by the eager local interpreter for each op while capturing. `is_output_inplace` tells
+  // the outputs given by the caller from the ones made by the op.
+  Maybe<void> RecordOp(const UserOpExpr& user_op_expr,
+                       const std::shared_ptr<StatefulOpKernel>& kernel,
+                       const vm::EagerBlobObjectList& inputs,
+                       const vm::EagerBlobObjectList& outputs,
+                       const std::vector<bool>& is_output_inplace, const OpExprInterpContext& ctx,
+                       const LocalTensorInferResult& result);
+
+ private:
+  struct Op {
+    std::shared_ptr<StatefulOpKernel> kernel;
+    OpExprInterpContext ctx;
+    Symbol<Stream> stream;
+    std::vector<int64_t> input_value_ids;
+    std::vector<int64_t> output_value_ids;
+    // Metas of the outputs made by the op, empty for the outputs written in place.
+    std::vector<Symbol<LocalTensorMeta>> output_metas;
+  };
+
+  Maybe<int64_t> ValueId4Input(const std::shared_ptr<vm::EagerBlobObject>& eager_blob_object);
+  int64_t NewValueId(const std::shared_ptr<vm::EagerBlobObject>& eager_blob_object);
+  void ClearCaptureStates();
+
+  bool is_capturing_;
+  bool is_captured_;
+  std::vector<Op> ops_;
+  // Values are numbered as they are seen, the graph inputs first.
+  int64_t value_size_;
+  std::vector<Symbol<LocalTensorMeta>> input_metas_;
+  // Tensors captured by reference, by value id.
+  std::vector<std::pair<int64_t, std::shared_ptr<vm::EagerBlobObject>>> constants_;
+  std::vector<int64_t> output_value_ids_;
+
+  // Only used while capturing. Values are held so that their addresses are not reused by other
+  // tensors before the capture ends.
+  HashMap<const vm::EagerBlobObject*, int64_t> eager_blob_object2value_id_;
+  std::vector<std::shared_ptr<vm::EagerBlobObject>> captured_values_;
+  HashSet<const vm::TensorStorage*> captured_storages_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_EAGER_GRAPH_H_
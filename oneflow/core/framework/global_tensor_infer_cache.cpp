@@ -55,7 +55,7 @@ void InputGlobalTensorMeta::assign(Symbol<GlobalTensorMeta> tensor_meta,
   consumer_nd_sbp_constraint_ = consumer_nd_sbp_constraint;
 }
 
-size_t GlobalTensorMetaInferArgs::hash_value() const {
+size_t GlobalTensorMetaInferArgs::CalcHashValue() const {
   size_t hash_value = std::hash<AttrMap>()(attrs_);
   const auto& tensor_meta_hash_functor = std::hash<InputGlobalTensorMeta>();
   for (const auto& tensor_meta : input_global_tensor_metas_) {
@@ -64,7 +64,7 @@ size_t GlobalTensorMetaInferArgs::hash_value() const {
   return hash_value;
 }
 
-size_t SrcOpGlobalTensorMetaInferArgs::hash_value() const {
+size_t SrcOpGlobalTensorMetaInferArgs::CalcHashValue() const {
   size_t hash_value = std::hash<AttrMap>()(attrs_);
   AddHash(&hash_value, parallel_desc_);
   AddHash(&hash_value, nd_sbp_);
@@ -72,13 +72,13 @@ size_t SrcOpGlobalTensorMetaInferArgs::hash_value() const {
 }
 
 bool GlobalTensorMetaInferArgs::operator==(const GlobalTensorMetaInferArgs& other) const {
-  return this->attrs_ == other.attrs_
+  return this->hash_value_ == other.hash_value_ && this->attrs_ == other.attrs_
          && this->input_global_tensor_metas_ == other.input_global_tensor_metas_;
 }
 
 bool SrcOpGlobalTensorMetaInferArgs::operator==(const SrcOpGlobalTensorMetaInferArgs& other) const {
-  return this->attrs_ == other.attrs_ && this->parallel_desc_ == other.parallel_desc_
-         && this->nd_sbp_ == other.nd_sbp_;
+  return this->hash_value_ == other.hash_value_ && this->attrs_ == other.attrs_
+         && this->parallel_desc_ == other.parallel_desc_ && this->nd_sbp_ == other.nd_sbp_;
 }
 
 Maybe<void> GlobalTensorMetaInferArgs::MakeNdSbpConstraints(
@@ -127,6 +127,7 @@ Maybe<GlobalTensorMetaInferArgs> GlobalTensorMetaInferArgs::New(const AttrMap& a
   infer_args->attrs_ = attrs;
   infer_args->input_global_tensor_metas_.resize(input_tensors.size());
   JUST(infer_args->InitInputGlobalTensorMetas(input_tensors));
+  infer_args->hash_value_ = infer_args->CalcHashValue();
   return infer_args;
 }
 
@@ -136,6 +137,7 @@ Maybe<SrcOpGlobalTensorMetaInferArgs> SrcOpGlobalTensorMetaInferArgs::New(
   infer_args->attrs_ = attrs;
   infer_args->parallel_desc_ = parallel_desc;
   infer_args->nd_sbp_ = nd_sbp;
+  infer_args->hash_value_ = infer_args->CalcHashValue();
   return infer_args;
 }
 
@@ -355,35 +357,34 @@ class UserOpExprDeviceAndStreamInferContext final : public user_op::DeviceAndStr
   return std::shared_ptr<const GlobalTensorInferResult>(std::move(result));
 }
 
+GlobalTensorInferCache::GlobalTensorInferCache(
+    const std::shared_ptr<const UserOpExpr>& user_op_expr)
+    : user_op_expr_(user_op_expr),
+      cache_(ThreadLocalEnvInteger<ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE>()),
+      src_op_cache_(ThreadLocalEnvInteger<ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE>()) {}
+
 Maybe<const GlobalTensorInferResult> GlobalTensorInferCache::GetOrInfer(
     const GlobalTensorMetaInferArgs& infer_args) {
-  auto iter = cache_.find(infer_args);
-  if (iter == cache_.end()) {
-    if (unlikely(cache_.size() >= ThreadLocalEnvInteger<ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE>())) {
-      cache_.clear();
-    }
+  std::shared_ptr<const GlobalTensorInferResult> result;
+  if (!cache_.Find(infer_args, &result)) {
     const auto& user_op_expr = user_op_expr_.lock();
     CHECK_OR_RETURN(static_cast<bool>(user_op_expr));
-    const auto& output_tensor_metas = JUST(Infer(*user_op_expr, infer_args));
-    iter = cache_.emplace(infer_args, output_tensor_metas).first;
+    result = JUST(Infer(*user_op_expr, infer_args));
+    cache_.Insert(infer_args, result);
   }
-  return iter->second;
+  return result;
 }
 
 Maybe<const GlobalTensorInferResult> GlobalTensorInferCache::GetOrInfer(
     const SrcOpGlobalTensorMetaInferArgs& infer_args) {
-  auto iter = src_op_cache_.find(infer_args);
-  if (iter == src_op_cache_.end()) {
-    if (unlikely(src_op_cache_.size()
-                 >= ThreadLocalEnvInteger<ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE>())) {
-      src_op_cache_.clear();
-    }
+  std::shared_ptr<const GlobalTensorInferResult> result;
+  if (!src_op_cache_.Find(infer_args, &result)) {
     const auto& user_op_expr = user_op_expr_.lock();
     CHECK_OR_RETURN(static_cast<bool>(user_op_expr));
-    const auto& output_tensor_metas = JUST(Infer(*user_op_expr, infer_args));
-    iter = src_op_cache_.emplace(infer_args, output_tensor_metas).first;
+    result = JUST(Infer(*user_op_expr, infer_args));
+    src_op_cache_.Insert(infer_args, result);
   }
-  return iter->second;
+  return result;
 }
 
 }  // namespace one
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/common/maybe.h"
 #include "oneflow/core/common/optional.h"
+#include "oneflow/core/common/sharded_lru_cache.h"
 #include "oneflow/core/framework/attr_map.h"
 #include "oneflow/core/framework/device.h"
 #include "oneflow/core/framework/stream.h"
@@ -75,7 +76,8 @@ class GlobalTensorMetaInferArgs final {
   }
   const AttrMap& attrs() const { return attrs_; }
 
-  size_t hash_value() const;
+  // Computed once by New.
+  size_t hash_value() const { return hash_value_; }
 
   bool operator==(const GlobalTensorMetaInferArgs& other) const;
 
@@ -93,11 +95,13 @@ class GlobalTensorMetaInferArgs final {
                                               const TensorTuple& input_tensors);
 
  private:
-  GlobalTensorMetaInferArgs() = default;
+  GlobalTensorMetaInferArgs() : hash_value_(0) {}
   Maybe<void> InitInputGlobalTensorMetas(const TensorTuple& input_tensors);
+  size_t CalcHashValue() const;
 
   AttrMap attrs_;
   std::vector<InputGlobalTensorMeta> input_global_tensor_metas_;
+  size_t hash_value_;
 };
 
 class SrcOpGlobalTensorMetaInferArgs final {
@@ -110,7 +114,8 @@ class SrcOpGlobalTensorMetaInferArgs final {
   Symbol<NdSbp> nd_sbp() const { return nd_sbp_; }
   const AttrMap& attrs() const { return attrs_; }
 
-  size_t hash_value() const;
+  // Computed once by New.
+  size_t hash_value() const { return hash_value_; }
 
   bool operator==(const SrcOpGlobalTensorMetaInferArgs& other) const;
 
@@ -119,11 +124,13 @@ class SrcOpGlobalTensorMetaInferArgs final {
                                                    Symbol<NdSbp> nd_sbp);
 
  private:
-  SrcOpGlobalTensorMetaInferArgs() = default;
+  SrcOpGlobalTensorMetaInferArgs() : hash_value_(0) {}
+  size_t CalcHashValue() const;
 
   AttrMap attrs_;
   Symbol<ParallelDesc> parallel_desc_;
   Symbol<NdSbp> nd_sbp_;
+  size_t hash_value_;
 };
 
 class OpArgMutGlobalTensorMeta final {
@@ -202,10 +209,10 @@ class GlobalTensorInferResult final {
   Symbol<Stream> stream_;
 };
 
+// Bounded the same way as LocalTensorInferCache.
 class GlobalTensorInferCache final {
  public:
-  GlobalTensorInferCache(const std::shared_ptr<const UserOpExpr>& user_op_expr)
-      : user_op_expr_(user_op_expr) {}
+  explicit GlobalTensorInferCache(const std::shared_ptr<const UserOpExpr>& user_op_expr);
 
   Maybe<const GlobalTensorInferResult> GetOrInfer(const GlobalTensorMetaInferArgs& infer_args);
 
@@ -222,8 +229,9 @@ class GlobalTensorInferCache final {
                                                     const GlobalTensorMetaInferArgs& infer_args);
 
   std::weak_ptr<const UserOpExpr> user_op_expr_;
-  HashMap<GlobalTensorMetaInferArgs, std::shared_ptr<const GlobalTensorInferResult>> cache_;
-  HashMap<SrcOpGlobalTensorMetaInferArgs, std::shared_ptr<const GlobalTensorInferResult>>
+  ShardedLruCache<GlobalTensorMetaInferArgs, std::shared_ptr<const GlobalTensorInferResult>>
+      cache_;
+  ShardedLruCache<SrcOpGlobalTensorMetaInferArgs, std::shared_ptr<const GlobalTensorInferResult>>
       src_op_cache_;
 };
 
@@ -790,6 +790,9 @@ Maybe<vm::Instruction*> MutThreadLocalInstruction(Symbol<Stream> stream) {
 
 template<typename T, typename InstructionPolicyT>
 Maybe<void> SyncAccessSmallMem(char* mem_ptr, size_t bytes, const T tensor) {
+  if (unlikely(one::EagerElementwiseFusion::HasDeferredOps())) {
+    JUST(one::EagerElementwiseFusion::Flush());
+  }
   static thread_local vm::InstructionList instruction_list;
   static thread_local InstructionsBuilder instructions_builder(&instruction_list);
   const std::shared_ptr<vm::EagerBlobObject>& eager_blob_object = JUST(tensor->eager_blob_object());
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/eager/eager_blob_object.h"
 #include "oneflow/core/eager/local_dep_object.h"
+#include "oneflow/core/framework/eager_elementwise_fusion.h"
 #include "oneflow/core/framework/op_interpreter.h"
 #include "oneflow/core/vm/instruction.h"
 #include "oneflow/core/job/job_desc.h"
@@ -161,6 +162,10 @@ class InstructionsBuilder : public std::enable_shared_from_this<InstructionsBuil
 // Make VM instructions with instruction builder and run instructions with physical/local view.
 template<typename CallbackT>
 Maybe<void> PhysicalRun(const CallbackT& Build) {
+  // Deferred elementwise ops go first, the instructions built below may use their outputs.
+  if (unlikely(one::EagerElementwiseFusion::HasDeferredOps())) {
+    JUST(one::EagerElementwiseFusion::Flush());
+  }
   vm::InstructionList instruction_list;
   InstructionsBuilder instructions_builder(&instruction_list);
   JUST(Build(&instructions_builder));
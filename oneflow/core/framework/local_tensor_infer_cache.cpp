@@ -126,7 +126,7 @@ Maybe<Symbol<Stream>> InferDeviceAndStream(const UserOpExpr& user_op_expr,
 
 }  // namespace
 
-size_t LocalTensorMetaInferArgs::hash_value() const {
+size_t LocalTensorMetaInferArgs::CalcHashValue() const {
   size_t hash_value = std::hash<AttrMap>()(attrs_);
   HashCombine(&hash_value, std::hash<Symbol<Device>>()(default_device_));
   const auto& tensor_meta_hash_functor = std::hash<Symbol<LocalTensorMeta>>();
@@ -137,7 +137,8 @@ size_t LocalTensorMetaInferArgs::hash_value() const {
 }
 
 bool LocalTensorMetaInferArgs::operator==(const LocalTensorMetaInferArgs& other) const {
-  return this->attrs_ == other.attrs_ && this->default_device_ == other.default_device_
+  return this->hash_value_ == other.hash_value_ && this->attrs_ == other.attrs_
+         && this->default_device_ == other.default_device_
          && this->input_local_tensor_metas_ == other.input_local_tensor_metas_;
 }
 
@@ -147,6 +148,7 @@ Maybe<void> LocalTensorMetaInferArgs::Init(const AttrMap& attrs, Symbol<Device>
   this->default_device_ = default_device;
   this->input_local_tensor_metas_.resize(input_tensors.size());
   JUST(this->InitInputLocalTensorMetas(input_tensors));
+  this->hash_value_ = CalcHashValue();
   return Maybe<void>::Ok();
 }
 
@@ -157,6 +159,11 @@ Maybe<void> LocalTensorMetaInferArgs::InitInputLocalTensorMetas(const TensorTupl
   return Maybe<void>::Ok();
 }
 
+LocalTensorInferCache::LocalTensorInferCache(
+    const std::shared_ptr<const UserOpExpr>& user_op_expr)
+    : user_op_expr_(user_op_expr),
+      cache_(ThreadLocalEnvInteger<ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE>()) {}
+
 /* static */ Maybe<const LocalTensorInferResult> LocalTensorInferCache::Infer(
     const UserOpExpr& user_op_expr, const LocalTensorMetaInferArgs& infer_args) {
   const auto& default_device = infer_args.default_device();
@@ -199,18 +206,14 @@ Maybe<void> LocalTensorMetaInferArgs::InitInputLocalTensorMetas(const TensorTupl
 Maybe<const LocalTensorInferResult> LocalTensorInferCache::GetOrInfer(
     const LocalTensorMetaInferArgs& infer_args) {
   if (ThreadLocalEnvBool<ONEFLOW_EAGER_ENABLE_LOCAL_INFER_CACHE>()) {
-    auto iter = cache_.find(infer_args);
-    if (iter == cache_.end()) {
-      if (unlikely(cache_.size()
-                   >= ThreadLocalEnvInteger<ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE>())) {
-        cache_.clear();
-      }
+    std::shared_ptr<const LocalTensorInferResult> result;
+    if (!cache_.Find(infer_args, &result)) {
       const auto& user_op_expr = user_op_expr_.lock();
       CHECK_OR_RETURN(static_cast<bool>(user_op_expr));  // NOLINT
-      const auto& output_tensor_metas = JUST(Infer(*user_op_expr, infer_args));
-      iter = cache_.emplace(infer_args, output_tensor_metas).first;
+      result = JUST(Infer(*user_op_expr, infer_args));
+      cache_.Insert(infer_args, result);
     }
-    return iter->second;
+    return result;
   } else {
     const auto& user_op_expr = user_op_expr_.lock();
     return JUST(Infer(*user_op_expr, infer_args));
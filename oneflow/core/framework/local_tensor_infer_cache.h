@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/common/maybe.h"
 #include "oneflow/core/common/op_args_vector.h"
+#include "oneflow/core/common/sharded_lru_cache.h"
 #include "oneflow/core/framework/attr_map.h"
 #include "oneflow/core/framework/device.h"
 #include "oneflow/core/framework/stream.h"
@@ -35,7 +36,7 @@ class UserOpExpr;
 
 class LocalTensorMetaInferArgs final {
  public:
-  LocalTensorMetaInferArgs() = default;
+  LocalTensorMetaInferArgs() : hash_value_(0) {}
   LocalTensorMetaInferArgs(const LocalTensorMetaInferArgs&) = default;
   LocalTensorMetaInferArgs(LocalTensorMetaInferArgs&&) = default;
   ~LocalTensorMetaInferArgs() = default;
@@ -47,7 +48,8 @@ class LocalTensorMetaInferArgs final {
 
   const Symbol<Device>& default_device() const { return default_device_; }
 
-  size_t hash_value() const;
+  // Computed once by Init, the args are looked up in the caches of several ops.
+  size_t hash_value() const { return hash_value_; }
 
   bool operator==(const LocalTensorMetaInferArgs& other) const;
 
@@ -56,10 +58,12 @@ class LocalTensorMetaInferArgs final {
 
  private:
   Maybe<void> InitInputLocalTensorMetas(const TensorTuple& input_tensors);
+  size_t CalcHashValue() const;
 
   AttrMap attrs_;
   Symbol<Device> default_device_;
   OpArgsVector<Symbol<LocalTensorMeta>> input_local_tensor_metas_;
+  size_t hash_value_;
 };
 
 }  // namespace one
@@ -99,10 +103,12 @@ class LocalTensorInferResult final {
   Symbol<Stream> stream_;
 };
 
+// Results of an op by its infer args, with at most ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE least
+// recently used ones per thread shard, so that ops fed with ever changing shapes keep bounded
+// caches.
 class LocalTensorInferCache final {
  public:
-  LocalTensorInferCache(const std::shared_ptr<const UserOpExpr>& user_op_expr)
-      : user_op_expr_(user_op_expr) {}
+  explicit LocalTensorInferCache(const std::shared_ptr<const UserOpExpr>& user_op_expr);
 
   Maybe<const LocalTensorInferResult> GetOrInfer(const LocalTensorMetaInferArgs& infer_args);
 
@@ -111,7 +117,7 @@ class LocalTensorInferCache final {
                                                    const LocalTensorMetaInferArgs& infer_args);
 
   std::weak_ptr<const UserOpExpr> user_op_expr_;
-  HashMap<LocalTensorMetaInferArgs, std::shared_ptr<const LocalTensorInferResult>> cache_;
+  ShardedLruCache<LocalTensorMetaInferArgs, std::shared_ptr<const LocalTensorInferResult>> cache_;
 };
 
 }  // namespace one
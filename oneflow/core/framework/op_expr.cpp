@@ -112,6 +112,7 @@ Maybe<void> BuiltinOpExprImpl<UserOpConf>::BuildOpConf(OperatorConf* op_conf,
 }
 
 Maybe<StatefulOpKernel> UserOpExpr::MutKernel4Stream(Symbol<Stream> stream) const {
+  std::unique_lock<std::mutex> lock(stream2kernel_mutex_);
   const auto& it = stream2kernel_.find(stream);
   if (it != stream2kernel_.end()) { return it->second; }
 
@@ -145,6 +146,7 @@ Maybe<bool> BuiltinOpExprImpl<UserOpConf>::SupportNonContiguous() const {
 
 template<>
 Maybe<OpExprGradClosure> BuiltinOpExprImpl<UserOpConf>::GetOrCreateOpGradClosure() const {
+  std::unique_lock<std::mutex> lock(lazy_init_mutex_);
   if (!op_grad_func_.get()) {
     CHECK_OR_RETURN((IsClassRegistered<std::string, OpExprGradFunctionIf>(proto().op_type_name())))
         << "The gradient function for op " << proto().op_type_name()
@@ -157,6 +159,7 @@ Maybe<OpExprGradClosure> BuiltinOpExprImpl<UserOpConf>::GetOrCreateOpGradClosure
 
 template<>
 Maybe<autocast::AutoCastMeta> BuiltinOpExprImpl<UserOpConf>::GetOrCreateAutoCastMeta() const {
+  std::unique_lock<std::mutex> lock(lazy_init_mutex_);
   if (!autocast_meta_) {
     autocast_meta_ =
         autocast::MakeAutoCastMeta(proto().op_type_name(), this->indexed_input_pairs());
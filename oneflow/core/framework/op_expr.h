@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_FRAMEWORK_OP_EXPR_H_
 #define ONEFLOW_CORE_FRAMEWORK_OP_EXPR_H_
 
+#include <mutex>
 #include <string>
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/common/symbol.h"
@@ -127,6 +128,8 @@ class BuiltinOpExprImpl : public BuiltinOpExpr {
       : BuiltinOpExpr(op_name, indexed_ibns, indexed_obns), op_proto_(std::move(op_proto)) {}
 
   ProtoType op_proto_;
+  // Guards the members created on first use.
+  mutable std::mutex lazy_init_mutex_;
   mutable std::shared_ptr<OpExprGradFunctionIf> op_grad_func_;
   mutable std::shared_ptr<autocast::AutoCastMeta> autocast_meta_;
 };
@@ -188,6 +191,8 @@ class UserOpExpr final : public BuiltinOpExprImpl<UserOpConf> {
   user_op::TensorDescInferFn physical_tensor_desc_infer_fn_;
   user_op::DataTypeInferFn dtype_infer_fn_;
   user_op::DeviceAndStreamInferFn device_and_stream_infer_fn_;
+  // Ops may be called by several threads at a time, e.g. by parallel backward.
+  mutable std::mutex stream2kernel_mutex_;
   mutable HashMap<Symbol<Stream>, std::shared_ptr<StatefulOpKernel>> stream2kernel_;
   std::shared_ptr<LocalTensorInferCache> local_tensor_infer_cache_;
   std::shared_ptr<GlobalTensorInferCache> global_tensor_infer_cache_;
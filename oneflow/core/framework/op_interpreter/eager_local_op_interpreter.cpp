@@ -15,9 +15,12 @@ limitations under the License.
 */
 #include "oneflow/core/common/container_util.h"
 #include "oneflow/core/common/decorator.h"
+#include "oneflow/core/common/small_obj_pool.h"
 #include "oneflow/core/common/device_type.pb.h"
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/eager_elementwise_fusion.h"
+#include "oneflow/core/framework/eager_graph.h"
 #include "oneflow/core/framework/mutable_attr_map.h"
 #include "oneflow/core/framework/op_interpreter.h"
 #include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
@@ -101,11 +104,24 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
     }
   }
 
+  if (unlikely(EagerElementwiseFusion::IsEnabled())) {
+    if (JUST(EagerElementwiseFusion::TryDefer(user_op_expr, input_eager_blob_objects, outputs, ctx,
+                                              *result))) {
+      return Maybe<void>::Ok();
+    }
+  }
+
   const auto& output_tensor_metas = result->output_tensor_metas();
   vm::EagerBlobObjectList output_eager_blob_objects(outputs->size());
 
   const auto& kernel = JUST(user_op_expr.MutKernel4Stream(result->stream()));
 
+  EagerGraph* capturing_graph = EagerGraph::CapturingGraph();
+  std::vector<bool> is_output_inplace;
+  if (unlikely(capturing_graph != nullptr)) {
+    for (const auto& output : *outputs) { is_output_inplace.emplace_back(output != nullptr); }
+  }
+
   for (int i = 0; i < outputs->size(); i++) {
     if (!outputs->at(i)) {
       // NOTE: if op support stride(non-contiguous input), then output tensor's stride
@@ -114,19 +130,19 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
       std::shared_ptr<MutLocalTensorMeta> mut_tensor_meta;
       {
         if (kernel->output_is_mut2_type(i)) {
-          mut_tensor_meta = std::make_shared<MutLocalTensorMeta>(
+          mut_tensor_meta = obj_pool::make_shared<MutLocalTensorMeta>(
               output_tensor_metas.at(i)->shape(), output_tensor_metas.at(i)->stride(),
               output_tensor_metas.at(i)->dtype(), output_tensor_metas.at(i)->memory_format(),
               output_tensor_metas.at(i)->device());
         }
       }
       std::shared_ptr<EagerLocalTensorImpl> tensor_impl =
-          std::make_shared<EagerLocalTensorImpl>(false, false);
+          obj_pool::make_shared<EagerLocalTensorImpl>(false, false);
       const auto& dep_object = NewLocalDepObject();
       JUST(
           tensor_impl->InitEagerBlobObject(output_tensor_metas.at(i), mut_tensor_meta, dep_object));
       output_eager_blob_objects.at(i) = JUST(tensor_impl->eager_blob_object());
-      (*outputs)[i] = std::make_shared<LocalTensor>(tensor_impl);
+      (*outputs)[i] = obj_pool::make_shared<LocalTensor>(tensor_impl);
     } else {
       const auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
       // output i is inplaced.
@@ -152,6 +168,10 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
 
   if (default_device->enum_type() == DeviceType::kMeta) { return Maybe<void>::Ok(); }
 
+  if (unlikely(capturing_graph != nullptr)) {
+    JUST(capturing_graph->RecordOp(user_op_expr, kernel, input_eager_blob_objects,
+                                   output_eager_blob_objects, is_output_inplace, ctx, *result));
+  }
   JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
     return builder->Call(kernel, std::move(input_eager_blob_objects),
                          std::move(output_eager_blob_objects), ctx, result->stream());
@@ -16,6 +16,7 @@ limitations under the License.
 #include <type_traits>
 #include "oneflow/core/common/blocking_then_busy.h"
 #include "oneflow/core/common/data_type.h"
+#include "oneflow/core/common/small_obj_pool.h"
 #include "oneflow/core/common/stream_type.h"
 #include "oneflow/core/common/tensor_meta.h"
 #include "oneflow/core/vm/virtual_machine.h"
@@ -82,13 +83,14 @@ EagerLocalTensorImpl::~EagerLocalTensorImpl() {}
 
 Maybe<void> EagerLocalTensorImpl::UpdateTensorStorage() {
   const auto& eager_blob_object = eager_blob_object_;
-  tensor_storage_ = std::make_shared<TensorStorage>(eager_blob_object->tensor_storage());
+  tensor_storage_ = obj_pool::make_shared<TensorStorage>(eager_blob_object->tensor_storage());
   tensor_storage_->set_releaser_hook([eager_blob_object](
                                          const std::shared_ptr<vm::TensorStorage>&) {
+    // Outputs of deferred eager ops may be dropped before they are made, there is nothing to
+    // release then, and no reason to run the deferred ops.
+    if (!eager_blob_object->producer_stream().has_value()) { return; }
     auto ret = PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
-      if (eager_blob_object->producer_stream().has_value()) {
-        JUST(builder->ReleaseTensor(eager_blob_object));
-      }
+      JUST(builder->ReleaseTensor(eager_blob_object));
       return Maybe<void>::Ok();
     });
     // We should not use CHECK_JUST here because it will throw an exception
@@ -124,16 +126,17 @@ Maybe<void> EagerLocalTensorImpl::InitEagerBlobObject(
   CHECK_OR_RETURN(static_cast<bool>(local_tensor_meta->device()));  // NOLINT
   const auto& mem_case = local_tensor_meta->device()->mem_case();
 
+  // Every output of every eager op gets these, they come from a pool rather than the heap.
   if (tensor_storage_) {
     auto tensor_storage = tensor_storage_->storage();
-    eager_blob_object_ = std::make_shared<vm::EagerBlobObject>(
+    eager_blob_object_ = obj_pool::make_shared<vm::EagerBlobObject>(
         mem_case, local_tensor_meta, mut_local_tensor_meta, local_tensor_meta->dtype(),
         local_tensor_meta->memory_format(), tensor_storage, dep_object);
   } else {
     auto device = local_tensor_meta->device();
     auto storage = device->rematable() ? std::make_shared<vm::RematableTensorStorage>(device)
-                                       : std::make_shared<vm::TensorStorage>(true, device);
-    const auto& eager_blob_object = std::make_shared<vm::EagerBlobObject>(
+                                       : obj_pool::make_shared<vm::TensorStorage>(true, device);
+    const auto& eager_blob_object = obj_pool::make_shared<vm::EagerBlobObject>(
         mem_case, local_tensor_meta, mut_local_tensor_meta, local_tensor_meta->dtype(),
         local_tensor_meta->memory_format(), storage, dep_object);
     JUST(set_eager_blob_object(eager_blob_object));
@@ -144,6 +147,8 @@ Maybe<void> EagerLocalTensorImpl::InitEagerBlobObject(
 Maybe<bool> EagerLocalTensorImpl::is_pinned() const {
   if (this->device() == JUST(Device::New("meta"))) { return false; }
   if (!eager_blob_object_) { return false; }
+  // Not made yet, like the outputs of deferred eager ops, which are on cpu compute streams.
+  if (!eager_blob_object_->producer_stream().has_value()) { return false; }
   return IsStreamAllocatorPinned::Visit(JUST(eager_blob_object_->producer_stream())->stream_type());
 }
 
@@ -195,8 +195,8 @@ Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
 #ifdef WITH_CUDA
   Singleton<CudnnConvAlgoCache>::New();
   Singleton<CudnnHandlePool>::New();
-  Singleton<embedding::EmbeddingManager>::New();
 #endif
+  Singleton<embedding::EmbeddingManager>::New();
   const auto& vaild_ccl_comm_mgr_device_types =
       EagerCclCommMgrBuilder::Get().vaild_ccl_comm_mgr_device_types();
   CHECK_LE_OR_RETURN(vaild_ccl_comm_mgr_device_types.size(), 1)
@@ -249,8 +249,8 @@ EnvGlobalObjectsScope::~EnvGlobalObjectsScope() {
   Singleton<EpollCommNet>::Delete();
 #endif  // __linux__
   Singleton<vm::VirtualMachineScope>::Delete();
-#ifdef WITH_CUDA
   Singleton<embedding::EmbeddingManager>::Delete();
+#ifdef WITH_CUDA
   Singleton<CudnnConvAlgoCache>::Delete();
   Singleton<CudnnHandlePool>::Delete();
 #endif
@@ -33,6 +33,8 @@ class BinaryInStream {
   virtual uint64_t cur_file_pos() const = 0;
   virtual void set_cur_file_pos(uint64_t val) = 0;
   virtual bool IsEof() const = 0;
+  // Hints that the next `n` bytes are going to be read soon.
+  virtual void WillRead(uint64_t n) const {}
 
  protected:
   BinaryInStream() = default;
@@ -34,6 +34,9 @@ class BinaryInStreamWithoutLocalCopy final : public BinaryInStream {
   uint64_t cur_file_pos() const override { return cur_file_pos_; }
   void set_cur_file_pos(uint64_t val) override { cur_file_pos_ = val; }
   bool IsEof() const override { return cur_file_pos_ == file_size_; }
+  void WillRead(uint64_t n) const override {
+    if (!IsEof()) { file_->WillRead(cur_file_pos_, std::min(n, file_size_ - cur_file_pos_)); }
+  }
 
  private:
   std::unique_ptr<fs::RandomAccessFile> file_;
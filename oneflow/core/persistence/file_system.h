@@ -36,6 +36,10 @@ class RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual void Read(uint64_t offset, size_t n, char* result) const = 0;
 
+  // Hints that `n` bytes starting at `offset` are going to be read soon, so that the file system
+  // may start fetching them. Does nothing by default.
+  virtual void WillRead(uint64_t offset, size_t n) const {}
+
  private:
 };
 
@@ -41,6 +41,15 @@ size_t GetBufferSize() {
   return kDefaultBufferSize;
 }
 
+// Bytes read ahead of the reader in the background, 0 reads synchronously.
+size_t GetReadaheadSize() {
+  constexpr int64_t kDefaultReadaheadSize = 4 * 1024 * 1024;  // 4MB
+  return std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_SIZE_BYTES",
+                          kDefaultReadaheadSize),
+      0);
+}
+
 }  // namespace
 
 PersistentInStream::PersistentInStream(fs::FileSystem* fs,
@@ -65,10 +74,37 @@ PersistentInStream::PersistentInStream(int64_t session_id, fs::FileSystem* fs,
   } else {
     stream_scanner_.reset(new AcyclicStreamScanner(fs, streams, offset));
   }
-  buffer_.resize(GetBufferSize() + 1);
+  size_t readahead_size = GetReadaheadSize();
+  if (readahead_size > 0 && !cyclic && stream_scanner_->whole_file_size() <= readahead_size) {
+    // Readahead is turned off for streams whose files fit in one readahead buffer, e.g. one per
+    // image, which the fetch thread and the second buffer would only make slower to open.
+    readahead_size = 0;
+  }
+  readahead_ = readahead_size > 0;
+  is_fetch_done_ = false;
+  is_closed_ = false;
+  // Double buffered: the reader consumes one buffer of the readahead size while the fetch thread
+  // fills the other.
+  const size_t buffer_size = std::max(GetBufferSize(), readahead_size);
+  buffer_.resize(buffer_size + 1);
   cur_buf_begin_ = buffer_.data();
   cur_buf_end_ = buffer_.data();
   *cur_buf_end_ = '\0';
+  if (readahead_) {
+    free_buffers_.emplace_back(buffer_size + 1);
+    fetch_thrd_ = std::thread(&PersistentInStream::FetchBuffers, this);
+  }
+}
+
+PersistentInStream::~PersistentInStream() {
+  if (readahead_) {
+    {
+      std::unique_lock<std::mutex> lock(fetch_mutex_);
+      is_closed_ = true;
+    }
+    fetch_cond_.notify_all();
+    fetch_thrd_.join();
+  }
 }
 
 PersistentInStream::PersistentInStream(fs::FileSystem* fs,
@@ -126,13 +162,55 @@ int32_t PersistentInStream::ReadFully(char* s, size_t n) {
 
 void PersistentInStream::UpdateBuffer() {
   CHECK_EQ(cur_buf_begin_, cur_buf_end_);
-  uint64_t n = stream_scanner_->UpdateBuffer(&buffer_);
+  uint64_t n = 0;
+  if (readahead_) {
+    std::unique_lock<std::mutex> lock(fetch_mutex_);
+    if (!is_fetch_done_) {
+      free_buffers_.emplace_back(std::move(buffer_));
+      fetch_cond_.notify_all();
+      fetch_cond_.wait(lock, [this]() { return !fetched_buffers_.empty(); });
+      buffer_ = std::move(fetched_buffers_.front().first);
+      n = fetched_buffers_.front().second;
+      fetched_buffers_.pop();
+      is_fetch_done_ = (n == 0);
+    }
+  } else {
+    n = stream_scanner_->UpdateBuffer(&buffer_);
+  }
   cur_buf_begin_ = buffer_.data();
   cur_buf_end_ = buffer_.data() + n;
   *cur_buf_end_ = '\0';
 }
 
-bool PersistentInStream::IsEof() const {
-  return cur_buf_begin_ == cur_buf_end_ && stream_scanner_->IsEof();
+void PersistentInStream::FetchBuffers() {
+  while (true) {
+    std::vector<char> buffer;
+    {
+      std::unique_lock<std::mutex> lock(fetch_mutex_);
+      fetch_cond_.wait(lock, [this]() { return is_closed_ || !free_buffers_.empty(); });
+      if (is_closed_) { return; }
+      buffer = std::move(free_buffers_.back());
+      free_buffers_.pop_back();
+    }
+    const uint64_t n = stream_scanner_->UpdateBuffer(&buffer);
+    // Let the file system start on the buffer after this one as well.
+    stream_scanner_->WillRead(buffer.size() - 1);
+    {
+      std::unique_lock<std::mutex> lock(fetch_mutex_);
+      fetched_buffers_.emplace(std::move(buffer), n);
+    }
+    fetch_cond_.notify_all();
+    if (n == 0) { return; }
+  }
+}
+
+bool PersistentInStream::IsEof() {
+  if (cur_buf_begin_ != cur_buf_end_) { return false; }
+  if (readahead_) {
+    // The scanner belongs to the fetch thread, the end is known from the next fetched buffer.
+    UpdateBuffer();
+    return cur_buf_begin_ == cur_buf_end_;
+  }
+  return stream_scanner_->IsEof();
 }
 }  // namespace oneflow
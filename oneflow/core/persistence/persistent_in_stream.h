@@ -16,6 +16,10 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_PERSISTENCE_PERSISTENT_IN_STREAM_H_
 #define ONEFLOW_CORE_PERSISTENCE_PERSISTENT_IN_STREAM_H_
 
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
 #include "oneflow/core/persistence/file_system.h"
 #include "oneflow/core/persistence/stream_scanner.h"
 
@@ -24,7 +28,7 @@ namespace oneflow {
 class PersistentInStream {
  public:
   OF_DISALLOW_COPY_AND_MOVE(PersistentInStream);
-  virtual ~PersistentInStream() {}
+  virtual ~PersistentInStream();
   PersistentInStream(fs::FileSystem* fs, const std::vector<std::string>& file_paths,
                      uint64_t offset, bool cyclic, bool with_local_copy);
   PersistentInStream(fs::FileSystem* fs, const std::vector<std::string>& file_paths, bool cyclic,
@@ -45,14 +49,27 @@ class PersistentInStream {
   int32_t ReadFully(char* s, size_t n);
 
  private:
-  bool IsEof() const;
+  bool IsEof();
   void UpdateBuffer();
+  void FetchBuffers();
 
   std::unique_ptr<StreamScanner> stream_scanner_;
 
   std::vector<char> buffer_;
   char* cur_buf_begin_;
   char* cur_buf_end_;
+
+  // With readahead, a fetch thread owns stream_scanner_ and fills the next buffer while the
+  // current one is being read. Fetched buffers come with the number of bytes read into them, 0
+  // at the end of the streams.
+  bool readahead_;
+  std::thread fetch_thrd_;
+  std::mutex fetch_mutex_;
+  std::condition_variable fetch_cond_;
+  std::vector<std::vector<char>> free_buffers_;
+  std::queue<std::pair<std::vector<char>, uint64_t>> fetched_buffers_;
+  bool is_fetch_done_;
+  bool is_closed_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,73 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+std::vector<std::string> ReadAllLines(fs::FileSystem* file_system,
+                                      const std::vector<std::string>& file_names,
+                                      const std::string& readahead_size) {
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_SIZE_BYTES", readahead_size.c_str(), 1);
+  PersistentInStream in_stream(file_system, file_names, false, false);
+  std::vector<std::string> lines;
+  std::string line;
+  while (in_stream.ReadLine(&line) == 0) { lines.emplace_back(line); }
+  return lines;
+}
+
+}  // namespace
+
+TEST(PersistentInStream, readahead) {
+  fs::PosixFileSystem file_system;
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  std::vector<std::string> file_names;
+  std::vector<std::string> expected_lines;
+  for (int i = 0; i < 3; ++i) {
+    file_names.emplace_back(JoinPath(current_dir, "/tmp_test_in_stream_" + std::to_string(i)));
+    std::unique_ptr<fs::WritableFile> file;
+    file_system.NewWritableFile(file_names.back(), &file);
+    for (int j = 0; j < 100 * i; ++j) {
+      expected_lines.emplace_back(std::to_string(i) + "-" + std::to_string(j * j));
+      const std::string line = expected_lines.back() + "\n";
+      file->Append(line.data(), line.size());
+    }
+    file->Close();
+  }
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_BUFFER_SIZE_BYTES", "7", 1);
+  ASSERT_EQ(ReadAllLines(&file_system, file_names, "0"), expected_lines);
+  ASSERT_EQ(ReadAllLines(&file_system, file_names, "7"), expected_lines);
+  // Larger than the files, read synchronously with the buffer size of the env.
+  ASSERT_EQ(ReadAllLines(&file_system, file_names, "4096"), expected_lines);
+  // The fetch thread may be blocked on a full buffer or in flight when the stream goes away.
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_SIZE_BYTES", "16", 1);
+  for (int i = 0; i < 10; ++i) {
+    PersistentInStream in_stream(&file_system, file_names, true, false);
+    char c = 0;
+    for (int j = 0; j < i * 10; ++j) { ASSERT_EQ(in_stream.ReadFully(&c, 1), 0); }
+  }
+  unsetenv("ONEFLOW_PERSISTENT_IN_STREAM_BUFFER_SIZE_BYTES");
+  unsetenv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_SIZE_BYTES");
+  for (const auto& file_name : file_names) { file_system.DelFile(file_name); }
+}
+
+}  // namespace oneflow
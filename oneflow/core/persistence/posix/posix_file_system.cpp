@@ -60,6 +60,13 @@ class PosixRandomAccessFile : public RandomAccessFile {
       }
     }
   }
+
+  void WillRead(uint64_t offset, size_t n) const override {
+#ifdef __linux__
+    // Starts asynchronous readahead of the range into the page cache, failures are harmless.
+    posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(n), POSIX_FADV_WILLNEED);
+#endif
+  }
 };
 
 class PosixWritableFile : public WritableFile {
@@ -64,6 +64,10 @@ uint64_t StreamScanner::UpdateBuffer(std::vector<char>* buffer) {
   return n;
 }
 
+void StreamScanner::WillRead(uint64_t n) const {
+  if (cur_stream_id_ < stream_num_) { streams_[cur_stream_id_]->WillRead(n); }
+}
+
 void AcyclicStreamScanner::AddNForCurFilePos(uint64_t n) {
   whole_file_pos_ += n;
   if (streams_[cur_stream_id_]->IsEof()) { ++cur_stream_id_; }
@@ -32,6 +32,9 @@ class StreamScanner {
                 uint64_t offset);
   bool IsEof() const;
   uint64_t UpdateBuffer(std::vector<char>* buffer);
+  // Hints that the next `n` bytes of the current stream are going to be read soon.
+  void WillRead(uint64_t n) const;
+  uint64_t whole_file_size() const { return whole_file_size_; }
 
  protected:
   virtual void AddNForCurFilePos(uint64_t n) = 0;
@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/profiler/kineto_shim.h"
 #include "oneflow/core/profiler/profile_manager.h"
 #include "oneflow/core/profiler/event.h"
+#include "oneflow/core/vm/allocator_stats.h"
 #if defined(WITH_CUDA)
 #include <libkineto.h>
 #endif  // WITH_CUDA
@@ -29,6 +30,15 @@ using json = nlohmann::json;
 namespace oneflow {
 namespace profiler {
 
+ProfileManager::~ProfileManager() {
+  if (profile_memory_ && vm::MemoryTimeline::IsRecording()) {
+    HashMap<int64_t, std::string> allocator_names;
+    vm::MemoryTimeline::Stop(&allocator_names);
+  }
+}
+
+void ProfileManager::StartMemoryTimeline() { vm::MemoryTimeline::Start(); }
+
 std::string ProfileManager::RegisterEventRecorder(
     const std::shared_ptr<EventRecorder>& event_recorder, const std::string& name) {
   std::string recorder_key = GetNextEventRecorderKey(name);
@@ -47,6 +57,43 @@ std::string ProfileManager::DumpResultsJson() {
   return j.dump();
 }
 
+std::string ProfileManager::DumpMemoryTimelineJson() {
+  HashMap<int64_t, std::string> allocator_names;
+  const auto samples = vm::MemoryTimeline::Stop(&allocator_names);
+  json trace_events = json::array();
+  // The events are left in the queue for DumpResultsJson.
+  std::queue<std::shared_ptr<IEvent>> events = events_;
+  while (!events.empty()) {
+    const auto& evt = events.front();
+    const double started_at = evt->GetStartedAt<double>(EventTimeUnit::kUS);
+    const double finished_at = evt->GetFinishedAt<double>(EventTimeUnit::kUS);
+    // Skip the events that are still running.
+    if (finished_at >= started_at) {
+      trace_events.push_back({{"name", evt->GetName()},
+                              {"ph", "X"},
+                              {"ts", started_at},
+                              {"dur", finished_at - started_at},
+                              {"pid", 0},
+                              {"tid", 0}});
+    }
+    events.pop();
+  }
+  for (const auto& sample : samples) {
+    // Several allocators of a device have the same name.
+    const std::string name =
+        fmt::format("{} #{}", allocator_names.at(sample.allocator_id), sample.allocator_id);
+    trace_events.push_back({{"name", name},
+                            {"ph", "C"},
+                            {"ts", static_cast<double>(sample.time) / 1000},
+                            {"pid", 0},
+                            {"args",
+                             {{"allocated_bytes", sample.allocated_bytes},
+                              {"reserved_bytes", sample.reserved_bytes}}}});
+  }
+  const json j = {{"traceEvents", trace_events}, {"displayTimeUnit", "ms"}};
+  return j.dump();
+}
+
 std::vector<std::shared_ptr<IEvent>> ProfileManager::ExportEvents() {
 #if defined(WITH_CUDA)
   auto trace = StopTrace();
@@ -33,12 +33,14 @@ class ProfileManager {
   friend class EventRecorder;
 
   ProfileManager(bool use_cpu, bool use_cuda, bool record_shapes, bool record_attrs,
-                 bool record_bandwidth)
+                 bool record_bandwidth, bool profile_memory)
       : use_cpu_(use_cpu),
         use_cuda_(use_cuda),
         record_shapes_(record_shapes),
         record_attrs_(record_attrs),
-        record_bandwidth_(record_bandwidth) {
+        record_bandwidth_(record_bandwidth),
+        profile_memory_(profile_memory) {
+    if (profile_memory_) { StartMemoryTimeline(); }
 #if defined(WITH_CUDA)
     std::set<ActivityType> activities{};
     if (use_cpu) { activities.insert(ActivityType::CPU); }
@@ -51,7 +53,13 @@ class ProfileManager {
   std::string RegisterEventRecorder(const std::shared_ptr<EventRecorder>& event_recorder,
                                     const std::string& name);
   void UnregisterEventRecorder(const std::string& event_recorder_key);
+  ~ProfileManager();
+
   std::string DumpResultsJson();
+  // Stops the memory timeline and returns it with the events recorded so far, in the Chrome trace
+  // format: a counter of allocated and reserved bytes per allocator, over spans of the events.
+  std::string DumpMemoryTimelineJson();
+  bool profile_memory() const { return profile_memory_; }
 
  private:
   bool use_cpu_;
@@ -59,6 +67,7 @@ class ProfileManager {
   bool record_shapes_;
   bool record_attrs_;
   bool record_bandwidth_;
+  bool profile_memory_;
 
   std::queue<std::shared_ptr<IEvent>> events_;
   std::unordered_map<std::string, std::shared_ptr<EventRecorder>> event_recorders_;
@@ -67,6 +76,7 @@ class ProfileManager {
 
   std::string GetNextEventRecorderKey(const std::string& name);
   std::vector<std::shared_ptr<IEvent>> ExportEvents();
+  void StartMemoryTimeline();
 };
 
 }  // namespace profiler
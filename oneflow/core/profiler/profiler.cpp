@@ -93,14 +93,21 @@ void ProfilerStop() {
 }
 
 void EnableProfiler(bool use_cpu, bool use_cuda, bool record_shapes, bool record_attrs,
-                    bool record_bandwidth) {
+                    bool record_bandwidth, bool profile_memory) {
   CHECK_JUST(vm::ClusterSync());
   if (Singleton<ProfileManager>::Get() == nullptr) {
     Singleton<ProfileManager>::New(use_cpu, use_cuda, record_shapes, record_attrs,
-                                   record_bandwidth);
+                                   record_bandwidth, profile_memory);
   }
 }
 
+Maybe<std::string> DumpMemoryTimeline() {
+  JUST(vm::ClusterSync());
+  auto* pmgr = JUST(SingletonMaybe<ProfileManager>());
+  CHECK_OR_RETURN(pmgr->profile_memory()) << "The profiler is not enabled with profile_memory";
+  return pmgr->DumpMemoryTimelineJson();
+}
+
 // DisableProfilerAndReturnResult will return a json of profile results.
 Maybe<std::string> DisableProfilerAndReturnResult() {
   JUST(vm::ClusterSync());
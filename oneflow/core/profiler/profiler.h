@@ -64,7 +64,11 @@ class RangeGuard final {
 #endif
 
 void EnableProfiler(bool use_cpu, bool use_cuda, bool record_shapes, bool record_attrs,
-                    bool record_bandwidth);
+                    bool record_bandwidth, bool profile_memory);
+
+// DumpMemoryTimeline will return a Chrome trace json of the memory timeline of the profiler
+// enabled with profile_memory. It has to be called before DisableProfilerAndReturnResult.
+Maybe<std::string> DumpMemoryTimeline();
 
 // DisableProfilerAndReturnResult will return a json of profile results.
 Maybe<std::string> DisableProfilerAndReturnResult();
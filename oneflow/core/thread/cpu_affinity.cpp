@@ -0,0 +1,64 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif  // __linux__
+#include "oneflow/core/thread/cpu_affinity.h"
+#include <cstring>
+#include <sstream>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+Maybe<std::vector<int>> ParseCpuList(const std::string& cpu_list) {
+  std::vector<int> cpus;
+  std::istringstream ss(cpu_list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty()) { continue; }
+    const size_t dash = range.find('-');
+    int first = 0;
+    int last = 0;
+    try {
+      first = std::stoi(range.substr(0, dash));
+      last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    } catch (const std::exception&) {
+      return Error::InvalidValueError() << "invalid cpu list " << cpu_list;
+    }
+    CHECK_OR_RETURN(first >= 0 && first <= last)
+        << Error::InvalidValueError() << "invalid cpu range " << range << " in " << cpu_list;
+    for (int cpu = first; cpu <= last; ++cpu) { cpus.push_back(cpu); }
+  }
+  return cpus;
+}
+
+Maybe<void> SetCurrentThreadCpuAffinity(const std::vector<int>& cpus) {
+  if (cpus.empty()) { return Maybe<void>::Ok(); }
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    CHECK_LT_OR_RETURN(cpu, CPU_SETSIZE) << Error::InvalidValueError() << "invalid cpu " << cpu;
+    CPU_SET(cpu, &cpu_set);
+  }
+  const int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  CHECK_EQ_OR_RETURN(ret, 0) << "failed to set the cpu affinity of thread: " << std::strerror(ret);
+#endif  // __linux__
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
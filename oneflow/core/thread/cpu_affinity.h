@@ -0,0 +1,34 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_THREAD_CPU_AFFINITY_H_
+#define ONEFLOW_CORE_THREAD_CPU_AFFINITY_H_
+
+#include <string>
+#include <vector>
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+// Parses a list of CPUs like "0-3,8", in the format of taskset and of /sys/devices/system/cpu.
+Maybe<std::vector<int>> ParseCpuList(const std::string& cpu_list);
+
+// Pins the calling thread to `cpus`. An empty list leaves the thread where it is, and so do
+// platforms without thread affinity.
+Maybe<void> SetCurrentThreadCpuAffinity(const std::vector<int>& cpus);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_THREAD_CPU_AFFINITY_H_
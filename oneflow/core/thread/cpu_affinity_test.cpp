@@ -0,0 +1,31 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/thread/cpu_affinity.h"
+
+namespace oneflow {
+namespace test {
+
+TEST(CpuAffinity, parse_cpu_list) {
+  ASSERT_TRUE(CHECK_JUST(ParseCpuList(""))->empty());
+  ASSERT_EQ(*CHECK_JUST(ParseCpuList("3")), (std::vector<int>{3}));
+  ASSERT_EQ(*CHECK_JUST(ParseCpuList("0-3,8,10-11")), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_FALSE(TRY(ParseCpuList("3-1")).IsOk());
+  ASSERT_FALSE(TRY(ParseCpuList("a,b")).IsOk());
+}
+
+}  // namespace test
+}  // namespace oneflow
@@ -0,0 +1,115 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_THREAD_INLINE_TASK_H_
+#define ONEFLOW_CORE_THREAD_INLINE_TASK_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace oneflow {
+
+// Move-only void() callable. Callables up to kInlineSize bytes, e.g. lambdas capturing a few
+// references or a std::function, are stored in place, larger ones are allocated on the heap.
+class InlineTask final {
+ public:
+  static constexpr size_t kInlineSize = 48;
+
+  InlineTask() : invoke_(nullptr), manage_(nullptr) {}
+  template<typename F, typename = typename std::enable_if<
+                           !std::is_same<typename std::decay<F>::type, InlineTask>::value>::type>
+  InlineTask(F&& f) : InlineTask() {  // NOLINT
+    Init<typename std::decay<F>::type>(std::forward<F>(f));
+  }
+  InlineTask(InlineTask&& other) noexcept : InlineTask() { *this = std::move(other); }
+  InlineTask(const InlineTask&) = delete;
+  ~InlineTask() { Reset(); }
+
+  InlineTask& operator=(InlineTask&& other) noexcept {
+    if (this == &other) { return *this; }
+    Reset();
+    if (other.manage_ != nullptr) {
+      other.manage_(kMove, &other.storage_, &storage_);
+      invoke_ = other.invoke_;
+      manage_ = other.manage_;
+      other.invoke_ = nullptr;
+      other.manage_ = nullptr;
+    }
+    return *this;
+  }
+  InlineTask& operator=(const InlineTask&) = delete;
+
+  explicit operator bool() const { return invoke_ != nullptr; }
+
+  void operator()() { invoke_(&storage_); }
+
+  void Reset() {
+    if (manage_ != nullptr) {
+      manage_(kDestroy, &storage_, nullptr);
+      invoke_ = nullptr;
+      manage_ = nullptr;
+    }
+  }
+
+ private:
+  enum Op { kMove, kDestroy };
+  using Storage = typename std::aligned_storage<kInlineSize, alignof(std::max_align_t)>::type;
+
+  template<typename F>
+  using IsInline =
+      std::integral_constant<bool, sizeof(F) <= kInlineSize
+                                       && alignof(F) <= alignof(std::max_align_t)
+                                       && std::is_nothrow_move_constructible<F>::value>;
+
+  template<typename F, typename U>
+  void Init(U&& f) {
+    InitImpl<F>(std::forward<U>(f), IsInline<F>());
+  }
+
+  template<typename F, typename U>
+  void InitImpl(U&& f, std::true_type) {
+    new (&storage_) F(std::forward<U>(f));
+    invoke_ = [](void* storage) { (*static_cast<F*>(storage))(); };
+    manage_ = [](Op op, void* src, void* dst) {
+      F* src_f = static_cast<F*>(src);
+      if (op == kMove) { new (dst) F(std::move(*src_f)); }
+      src_f->~F();
+    };
+  }
+
+  template<typename F, typename U>
+  void InitImpl(U&& f, std::false_type) {
+    new (&storage_) F*(new F(std::forward<U>(f)));
+    invoke_ = [](void* storage) { (**static_cast<F**>(storage))(); };
+    manage_ = [](Op op, void* src, void* dst) {
+      F** src_f = static_cast<F**>(src);
+      if (op == kMove) {
+        new (dst) F*(*src_f);
+      } else {
+        delete *src_f;
+      }
+    };
+  }
+
+  Storage storage_;
+  void (*invoke_)(void* storage);
+  void (*manage_)(Op op, void* src, void* dst);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_THREAD_INLINE_TASK_H_
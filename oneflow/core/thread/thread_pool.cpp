@@ -18,29 +18,114 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+constexpr size_t kQueueCapacity = 1024;
+constexpr int32_t kSpinCount = 1024;
+
+thread_local ThreadPool* current_pool = nullptr;
+thread_local int32_t current_thread_id = -1;
+
+}  // namespace
+
 ThreadPool::ThreadPool(int32_t thread_num)
-    : work_chans_(thread_num), threads_(thread_num), work_cnt_(0) {
+    : queues_(thread_num),
+      threads_(thread_num),
+      overflow_size_(0),
+      work_cnt_(0),
+      pending_work_cnt_(0),
+      parked_thread_cnt_(0),
+      is_closed_(false) {
   FOR_RANGE(int32_t, i, 0, thread_num) {
-    Channel<std::function<void()>>* chan = &(work_chans_.at(i));
-    threads_[i] = std::thread([chan]() {
+    queues_.at(i).reset(new WorkStealingQueue<InlineTask>(kQueueCapacity));
+  }
+  FOR_RANGE(int32_t, i, 0, thread_num) {
+    threads_[i] = std::thread([this, i]() {
       SyncVmModeGuard guard(SyncVmMode::kEnable);
-      std::function<void()> work;
-      while (chan->Receive(&work) == kChannelStatusSuccess) { work(); }
+      Loop(i);
     });
   }
 }
 
 ThreadPool::~ThreadPool() {
-  FOR_RANGE(int32_t, i, 0, work_chans_.size()) {
-    work_chans_.at(i).Close();
-    threads_.at(i).join();
+  {
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    is_closed_ = true;
+    park_cond_.notify_all();
+  }
+  for (auto& thread : threads_) { thread.join(); }
+}
+
+void ThreadPool::Submit(InlineTask&& task) {
+  // Counted before being queued, so that a thread seeing no pending work can safely park.
+  pending_work_cnt_.fetch_add(1);
+  const int32_t num_queues = queues_.size();
+  const int32_t start = current_pool == this
+                            ? current_thread_id
+                            : work_cnt_.fetch_add(1, std::memory_order_relaxed) % num_queues;
+  bool pushed = false;
+  for (int32_t i = 0; i < num_queues && !pushed; ++i) {
+    pushed = queues_.at((start + i) % num_queues)->TryPush(std::move(task));
+  }
+  if (!pushed) {
+    std::unique_lock<std::mutex> lock(overflow_mutex_);
+    overflow_queue_.emplace_back(std::move(task));
+    overflow_size_.fetch_add(1);
+  }
+  if (parked_thread_cnt_.load() > 0) {
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    park_cond_.notify_one();
+  }
+}
+
+bool ThreadPool::TryGetWork(int32_t thread_id, InlineTask* task) {
+  const int32_t num_queues = queues_.size();
+  if (queues_.at(thread_id)->TryPop(task)) { return true; }
+  if (overflow_size_.load() > 0) {
+    std::unique_lock<std::mutex> lock(overflow_mutex_);
+    if (!overflow_queue_.empty()) {
+      *task = std::move(overflow_queue_.front());
+      overflow_queue_.pop_front();
+      overflow_size_.fetch_sub(1);
+      return true;
+    }
   }
+  FOR_RANGE(int32_t, i, 1, num_queues) {
+    if (queues_.at((thread_id + i) % num_queues)->TryPop(task)) { return true; }
+  }
+  return false;
 }
 
-void ThreadPool::AddWork(const std::function<void()>& work) {
-  const size_t cur_chan_idx =
-      work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_chans_.size();
-  work_chans_.at(cur_chan_idx).Send(work);
+void ThreadPool::Loop(int32_t thread_id) {
+  current_pool = this;
+  current_thread_id = thread_id;
+  InlineTask task;
+  int32_t spin_cnt = 0;
+  while (true) {
+    if (TryGetWork(thread_id, &task)) {
+      pending_work_cnt_.fetch_sub(1);
+      task();
+      task.Reset();
+      spin_cnt = 0;
+      continue;
+    }
+    if (spin_cnt < kSpinCount && pending_work_cnt_.load() > 0) {
+      // Some work is counted but not queued yet, or being stolen by another thread.
+      spin_cnt += 1;
+      continue;
+    }
+    if (spin_cnt < kSpinCount) {
+      spin_cnt += 1;
+      std::this_thread::yield();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    parked_thread_cnt_.fetch_add(1);
+    park_cond_.wait(lock, [this]() { return pending_work_cnt_.load() > 0 || is_closed_; });
+    parked_thread_cnt_.fetch_sub(1);
+    if (is_closed_ && pending_work_cnt_.load() == 0) { break; }
+    spin_cnt = 0;
+  }
 }
 
 }  // namespace oneflow
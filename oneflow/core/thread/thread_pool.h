@@ -18,9 +18,14 @@ limitations under the License.
 
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/common/channel.h"
+#include "oneflow/core/thread/inline_task.h"
+#include "oneflow/core/thread/work_stealing_queue.h"
 
 namespace oneflow {
 
+// Work stealing thread pool. Work added from a pool thread goes to the queue of that thread, work
+// added from elsewhere is spread over the queues round-robin, and an idle thread steals from the
+// other queues before it parks, so that a long task does not hold back the work queued behind it.
 class ThreadPool final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ThreadPool);
@@ -29,13 +34,30 @@ class ThreadPool final {
   ~ThreadPool();
 
   int32_t thread_num() const { return threads_.size(); }
-  void AddWork(const std::function<void()>& work);
+
+  template<typename F>
+  void AddWork(F&& work) {
+    Submit(InlineTask(std::forward<F>(work)));
+  }
 
  private:
-  std::vector<Channel<std::function<void()>>> work_chans_;
+  void Submit(InlineTask&& task);
+  bool TryGetWork(int32_t thread_id, InlineTask* task);
+  void Loop(int32_t thread_id);
+
+  std::vector<std::unique_ptr<WorkStealingQueue<InlineTask>>> queues_;
   std::vector<std::thread> threads_;
+  // Only used when all the queues are full.
+  std::mutex overflow_mutex_;
+  std::deque<InlineTask> overflow_queue_;
+  std::atomic<size_t> overflow_size_;
 
   std::atomic<size_t> work_cnt_;
+  std::atomic<int64_t> pending_work_cnt_;
+  std::atomic<int32_t> parked_thread_cnt_;
+  std::mutex park_mutex_;
+  std::condition_variable park_cond_;
+  std::atomic<bool> is_closed_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,124 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <array>
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+namespace test {
+
+TEST(InlineTask, small_and_large) {
+  int64_t sum = 0;
+  InlineTask small([&sum]() { sum += 1; });
+  std::array<int64_t, 16> values{};
+  values.fill(2);
+  InlineTask large([&sum, values]() {
+    for (int64_t v : values) { sum += v; }
+  });
+  InlineTask moved_small(std::move(small));
+  InlineTask moved_large(std::move(large));
+  ASSERT_FALSE(small);
+  ASSERT_FALSE(large);
+  moved_small();
+  moved_large();
+  ASSERT_EQ(sum, 33);
+  moved_large.Reset();
+  ASSERT_FALSE(moved_large);
+}
+
+TEST(WorkStealingQueue, multi_producer_multi_consumer) {
+  constexpr int64_t kNumThreads = 4;
+  constexpr int64_t kNumItemsPerThread = 10000;
+  WorkStealingQueue<int64_t> queue(256);
+  std::atomic<int64_t> sum(0);
+  std::atomic<int64_t> num_popped(0);
+  std::vector<std::thread> threads;
+  FOR_RANGE(int64_t, i, 0, kNumThreads) {
+    threads.emplace_back([&]() {
+      FOR_RANGE(int64_t, j, 1, kNumItemsPerThread + 1) {
+        int64_t item = j;
+        while (!queue.TryPush(std::move(item))) { std::this_thread::yield(); }
+      }
+    });
+    threads.emplace_back([&]() {
+      int64_t item = 0;
+      while (num_popped.load() < kNumThreads * kNumItemsPerThread) {
+        if (queue.TryPop(&item)) {
+          sum += item;
+          num_popped += 1;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  ASSERT_TRUE(queue.Empty());
+  ASSERT_EQ(sum.load(), kNumThreads * kNumItemsPerThread * (kNumItemsPerThread + 1) / 2);
+}
+
+TEST(ThreadPool, run_all_work) {
+  constexpr int64_t kNumWork = 10000;
+  std::atomic<int64_t> sum(0);
+  BlockingCounter bc(kNumWork);
+  {
+    ThreadPool pool(4);
+    // Half of the work is added from inside the pool.
+    FOR_RANGE(int64_t, i, 0, kNumWork / 2) {
+      pool.AddWork([&pool, &sum, &bc, i]() {
+        sum += i;
+        bc.Decrease();
+        pool.AddWork([&sum, &bc]() {
+          sum += 1;
+          bc.Decrease();
+        });
+      });
+    }
+    bc.WaitForeverUntilCntEqualZero();
+  }
+  ASSERT_EQ(sum.load(), (kNumWork / 2) * (kNumWork / 2 - 1) / 2 + kNumWork / 2);
+}
+
+TEST(ThreadPool, steal_work_behind_long_task) {
+  ThreadPool pool(2);
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done = false;
+  BlockingCounter bc(3);
+  // The first and the third work are queued to the same thread, the third one can only run before
+  // the first one finishes if it is stolen by the other thread.
+  pool.AddWork([&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait_for(lock, std::chrono::seconds(10), [&]() { return done; });
+    bc.Decrease();
+  });
+  pool.AddWork([&]() { bc.Decrease(); });
+  pool.AddWork([&]() {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      done = true;
+    }
+    cond.notify_all();
+    bc.Decrease();
+  });
+  const auto start = std::chrono::steady_clock::now();
+  bc.WaitForeverUntilCntEqualZero();
+  ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+}  // namespace test
+}  // namespace oneflow
@@ -76,14 +76,16 @@ class OfRuntime final : public RuntimeBase {
       return SeqFor(begin, end, func);
     }
     const size_t num_elements = end - begin;
-    num_threads = std::min(num_elements, num_threads);
+    num_threads = std::min(DivUp(num_elements, std::max<size_t>(grain_size, 1)), num_threads);
+    if (num_threads == 1) { return SeqFor(begin, end, func); }
     BalancedSplitter bs(num_elements, num_threads);
     BlockingCounter bc(num_threads);
 
     FOR_RANGE(size_t, range_id, 0, num_threads) {
-      Singleton<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, func] {
-        const size_t begin_ = bs.At(range_id).begin();
-        const size_t end_ = bs.At(range_id).end();
+      // Captures by reference only, so that the work is stored inline in the pool queues.
+      Singleton<ThreadPool>::Get()->AddWork([&bc, &bs, &func, begin, range_id] {
+        const size_t begin_ = begin + bs.At(range_id).begin();
+        const size_t end_ = begin + bs.At(range_id).end();
         SeqFor(begin_, end_, func);
         bc.Decrease();
       });
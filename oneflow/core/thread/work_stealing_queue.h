@@ -0,0 +1,104 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_THREAD_WORK_STEALING_QUEUE_H_
+#define ONEFLOW_CORE_THREAD_WORK_STEALING_QUEUE_H_
+
+#include <atomic>
+#include <memory>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Bounded lock-free queue of a worker. Any thread may push into it and any thread may pop from it,
+// so the owner, the threads submitting work from outside the pool and the thieves all go through
+// the same two operations. Each cell carries a sequence number telling whether it is ready to be
+// written or read in the current lap, which makes the items safe to be stored in place.
+template<typename T>
+class WorkStealingQueue final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WorkStealingQueue);
+  explicit WorkStealingQueue(size_t capacity)
+      : capacity_(capacity), cells_(new Cell[capacity]), push_pos_(0), pop_pos_(0) {
+    CHECK_GT(capacity_, 0);
+    CHECK_EQ(capacity_ & (capacity_ - 1), 0) << "The capacity must be a power of 2";
+    for (size_t i = 0; i < capacity_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  ~WorkStealingQueue() = default;
+
+  bool TryPush(T&& item) {
+    size_t pos = push_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell* cell = &cells_[pos & (capacity_ - 1)];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (push_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell->item = std::move(item);
+          cell->sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool TryPop(T* item) {
+    size_t pos = pop_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell* cell = &cells_[pos & (capacity_ - 1)];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (pop_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          *item = std::move(cell->item);
+          cell->sequence.store(pos + capacity_, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = pop_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Only a hint, the queue may change right after.
+  bool Empty() const {
+    return push_pos_.load(std::memory_order_relaxed) == pop_pos_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+
+  const size_t capacity_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(kCacheLineSize) std::atomic<size_t> push_pos_;
+  alignas(kCacheLineSize) std::atomic<size_t> pop_pos_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_THREAD_WORK_STEALING_QUEUE_H_
@@ -0,0 +1,267 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <mutex>
+#include "oneflow/core/vm/allocator_stats.h"
+#include "oneflow/core/profiler/util.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+// Samples kept by the memory timeline, later changes are dropped.
+constexpr size_t kMaxMemoryTimelineSamples = 1 << 20;
+
+struct AllocatorRegistry {
+  std::mutex mutex;
+  std::map<int64_t, AllocatorStats*> id2stats;
+};
+
+AllocatorRegistry* MutAllocatorRegistry() {
+  // Leaked, allocators owned by singletons may be destroyed after static objects.
+  static AllocatorRegistry* registry = new AllocatorRegistry();
+  return registry;
+}
+
+int64_t NewAllocatorStatsId() {
+  static std::atomic<int64_t> next_id(0);
+  return next_id++;
+}
+
+struct MemoryTimelineState {
+  std::mutex mutex;
+  std::vector<MemoryTimelineSample> samples;
+  HashMap<int64_t, std::string> allocator_names;
+  int64_t num_dropped_samples = 0;
+};
+
+MemoryTimelineState* MutMemoryTimelineState() {
+  static MemoryTimelineState* state = new MemoryTimelineState();
+  return state;
+}
+
+void UpdatePeak(std::atomic<size_t>* peak, size_t value) {
+  size_t current = peak->load(std::memory_order_relaxed);
+  while (value > current
+         && !peak->compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+}  // namespace
+
+void AllocatorStatsSnapshot::AddFreePiece(size_t size) {
+  if (bins.empty()) {
+    bins.resize(kAllocatorStatsNumBins);
+    for (int32_t i = 0; i < kAllocatorStatsNumBins; ++i) {
+      bins.at(i).bin_size = kAllocatorStatsMinBinSize << i;
+    }
+  }
+  const uint64_t value = std::max(size, kAllocatorStatsMinBinSize) / kAllocatorStatsMinBinSize;
+  const int32_t bin_num =
+      std::min(kAllocatorStatsNumBins - 1, static_cast<int32_t>(63 ^ __builtin_clzll(value)));
+  AllocatorBinStats* bin = &bins.at(bin_num);
+  bin->num_free_pieces += 1;
+  bin->free_bytes += size;
+  bin->largest_free_bytes = std::max(bin->largest_free_bytes, size);
+  free_bytes += size;
+  largest_free_bytes = std::max(largest_free_bytes, size);
+}
+
+double AllocatorStatsSnapshot::fragmentation() const {
+  if (free_bytes == 0) { return 0; }
+  return 1.0 - static_cast<double>(largest_free_bytes) / static_cast<double>(free_bytes);
+}
+
+nlohmann::json AllocatorStatsSnapshot::ToJson() const {
+  nlohmann::json bins_json = nlohmann::json::array();
+  for (const auto& bin : bins) {
+    if (bin.num_free_pieces == 0) { continue; }
+    bins_json.push_back({{"bin_size", bin.bin_size},
+                         {"num_free_pieces", bin.num_free_pieces},
+                         {"free_bytes", bin.free_bytes},
+                         {"largest_free_bytes", bin.largest_free_bytes}});
+  }
+  return {{"id", id},
+          {"name", name},
+          {"num_allocs", num_allocs},
+          {"num_frees", num_frees},
+          {"num_ooms", num_ooms},
+          {"num_backend_allocs", num_backend_allocs},
+          {"num_backend_frees", num_backend_frees},
+          {"allocated_bytes", allocated_bytes},
+          {"peak_allocated_bytes", peak_allocated_bytes},
+          {"reserved_bytes", reserved_bytes},
+          {"peak_reserved_bytes", peak_reserved_bytes},
+          {"cached_bytes", cached_bytes},
+          {"free_bytes", free_bytes},
+          {"largest_free_bytes", largest_free_bytes},
+          {"fragmentation", fragmentation()},
+          {"bins", bins_json}};
+}
+
+AllocatorStats::AllocatorStats(const std::string& name,
+                               const std::function<void(AllocatorStatsSnapshot*)>& add_free_pieces)
+    : id_(NewAllocatorStatsId()),
+      name_(name),
+      add_free_pieces_(add_free_pieces),
+      registered_(false),
+      num_allocs_(0),
+      num_frees_(0),
+      num_ooms_(0),
+      num_backend_allocs_(0),
+      num_backend_frees_(0),
+      allocated_bytes_(0),
+      peak_allocated_bytes_(0),
+      reserved_bytes_(0),
+      peak_reserved_bytes_(0) {}
+
+void AllocatorStats::Register() {
+  auto* registry = MutAllocatorRegistry();
+  std::unique_lock<std::mutex> lock(registry->mutex);
+  CHECK(!registered_);
+  registry->id2stats.emplace(id_, this);
+  registered_ = true;
+}
+
+void AllocatorStats::Unregister() {
+  if (!registered_) { return; }
+  auto* registry = MutAllocatorRegistry();
+  std::unique_lock<std::mutex> lock(registry->mutex);
+  registry->id2stats.erase(id_);
+  registered_ = false;
+}
+
+void AllocatorStats::OnAllocate(size_t bytes) {
+  num_allocs_.fetch_add(1, std::memory_order_relaxed);
+  UpdatePeak(&peak_allocated_bytes_,
+             allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+  if (MemoryTimeline::IsRecording()) { RecordTimelineSample(); }
+}
+
+void AllocatorStats::OnDeallocate(size_t bytes) {
+  num_frees_.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  if (MemoryTimeline::IsRecording()) { RecordTimelineSample(); }
+}
+
+void AllocatorStats::OnReserve(size_t bytes) {
+  num_backend_allocs_.fetch_add(1, std::memory_order_relaxed);
+  UpdatePeak(&peak_reserved_bytes_,
+             reserved_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+  if (MemoryTimeline::IsRecording()) { RecordTimelineSample(); }
+}
+
+void AllocatorStats::OnRelease(size_t bytes) {
+  num_backend_frees_.fetch_add(1, std::memory_order_relaxed);
+  reserved_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  if (MemoryTimeline::IsRecording()) { RecordTimelineSample(); }
+}
+
+void AllocatorStats::RecordTimelineSample() const {
+  MemoryTimeline::Record(id_, name_, allocated_bytes_.load(std::memory_order_relaxed),
+                         reserved_bytes_.load(std::memory_order_relaxed));
+}
+
+AllocatorStatsSnapshot AllocatorStats::Snapshot() const {
+  AllocatorStatsSnapshot snapshot;
+  if (add_free_pieces_) { add_free_pieces_(&snapshot); }
+  snapshot.id = id_;
+  snapshot.name = name_;
+  snapshot.num_allocs = num_allocs_.load(std::memory_order_relaxed);
+  snapshot.num_frees = num_frees_.load(std::memory_order_relaxed);
+  snapshot.num_ooms = num_ooms_.load(std::memory_order_relaxed);
+  snapshot.num_backend_allocs = num_backend_allocs_.load(std::memory_order_relaxed);
+  snapshot.num_backend_frees = num_backend_frees_.load(std::memory_order_relaxed);
+  snapshot.allocated_bytes = allocated_bytes_.load(std::memory_order_relaxed);
+  snapshot.peak_allocated_bytes = peak_allocated_bytes_.load(std::memory_order_relaxed);
+  snapshot.reserved_bytes = reserved_bytes_.load(std::memory_order_relaxed);
+  snapshot.peak_reserved_bytes = peak_reserved_bytes_.load(std::memory_order_relaxed);
+  // The counters are read one by one while other threads keep allocating.
+  snapshot.cached_bytes = snapshot.reserved_bytes > snapshot.allocated_bytes
+                              ? snapshot.reserved_bytes - snapshot.allocated_bytes
+                              : 0;
+  return snapshot;
+}
+
+void AllocatorStats::ResetPeaks() {
+  peak_allocated_bytes_.store(allocated_bytes_.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+  peak_reserved_bytes_.store(reserved_bytes_.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+}
+
+std::vector<AllocatorStatsSnapshot> GetAllAllocatorStats() {
+  auto* registry = MutAllocatorRegistry();
+  std::unique_lock<std::mutex> lock(registry->mutex);
+  std::vector<AllocatorStatsSnapshot> snapshots;
+  snapshots.reserve(registry->id2stats.size());
+  for (const auto& pair : registry->id2stats) { snapshots.emplace_back(pair.second->Snapshot()); }
+  return snapshots;
+}
+
+void ResetAllAllocatorPeakStats() {
+  auto* registry = MutAllocatorRegistry();
+  std::unique_lock<std::mutex> lock(registry->mutex);
+  for (const auto& pair : registry->id2stats) { pair.second->ResetPeaks(); }
+}
+
+/*static*/ std::atomic<bool>* MemoryTimeline::MutIsRecording() {
+  static std::atomic<bool> is_recording(false);
+  return &is_recording;
+}
+
+/*static*/ void MemoryTimeline::Start() {
+  auto* state = MutMemoryTimelineState();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->samples.clear();
+  state->allocator_names.clear();
+  state->num_dropped_samples = 0;
+  MutIsRecording()->store(true);
+}
+
+/*static*/ std::vector<MemoryTimelineSample> MemoryTimeline::Stop(
+    HashMap<int64_t, std::string>* allocator_names) {
+  MutIsRecording()->store(false);
+  auto* state = MutMemoryTimelineState();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  if (state->num_dropped_samples > 0) {
+    LOG(WARNING) << "Memory timeline is full, " << state->num_dropped_samples
+                 << " samples are dropped";
+  }
+  *allocator_names = std::move(state->allocator_names);
+  state->allocator_names.clear();
+  std::vector<MemoryTimelineSample> samples;
+  samples.swap(state->samples);
+  return samples;
+}
+
+/*static*/ void MemoryTimeline::Record(int64_t allocator_id, const std::string& allocator_name,
+                                       size_t allocated_bytes, size_t reserved_bytes) {
+  const time_t now = profiler::GetTimeNow();
+  auto* state = MutMemoryTimelineState();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  if (!IsRecording()) { return; }
+  if (state->samples.size() >= kMaxMemoryTimelineSamples) {
+    state->num_dropped_samples += 1;
+    return;
+  }
+  if (state->allocator_names.count(allocator_id) == 0) {
+    state->allocator_names.emplace(allocator_id, allocator_name);
+  }
+  state->samples.push_back({now, allocator_id, allocated_bytes, reserved_bytes});
+}
+
+}  // namespace vm
+}  // namespace oneflow
@@ -0,0 +1,139 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_ALLOCATOR_STATS_H_
+#define ONEFLOW_CORE_VM_ALLOCATOR_STATS_H_
+
+#include <atomic>
+#include <functional>
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace vm {
+
+// Free pieces are reported in bins of sizes [512 << i, 1024 << i), the last bin takes all the
+// larger pieces. These are the bins of BinAllocator.
+constexpr int32_t kAllocatorStatsNumBins = 20;
+constexpr size_t kAllocatorStatsMinBinSize = 512;
+
+struct AllocatorBinStats {
+  size_t bin_size = 0;
+  int64_t num_free_pieces = 0;
+  size_t free_bytes = 0;
+  size_t largest_free_bytes = 0;
+};
+
+struct AllocatorStatsSnapshot {
+  int64_t id = 0;
+  std::string name;
+  int64_t num_allocs = 0;
+  int64_t num_frees = 0;
+  int64_t num_ooms = 0;
+  // Memory taken from and given back to the backend.
+  int64_t num_backend_allocs = 0;
+  int64_t num_backend_frees = 0;
+  // Bytes handed out and not freed yet, counted in aligned sizes, and their high-water mark.
+  size_t allocated_bytes = 0;
+  size_t peak_allocated_bytes = 0;
+  // Bytes held from the backend and their high-water mark.
+  size_t reserved_bytes = 0;
+  size_t peak_reserved_bytes = 0;
+  // Reserved bytes that are not allocated: free pieces, pieces kept by caches and split slack.
+  size_t cached_bytes = 0;
+  // Free pieces, which new allocations can be served from.
+  size_t free_bytes = 0;
+  size_t largest_free_bytes = 0;
+  std::vector<AllocatorBinStats> bins;
+
+  void AddFreePiece(size_t size);
+  // The share of the free bytes that are not in the largest free piece. It is 0 when any
+  // allocation of at most free_bytes would fit, and tends to 1 as free memory gets scattered.
+  double fragmentation() const;
+  nlohmann::json ToJson() const;
+};
+
+// Live counters of an allocator. They are relaxed atomics, so that the lock-free paths of the
+// allocators can update them. Registered stats are reported by GetAllAllocatorStats().
+class AllocatorStats final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AllocatorStats);
+  // `add_free_pieces` reports the free pieces of the allocator to a snapshot, taking whatever
+  // lock the allocator needs for that.
+  AllocatorStats(const std::string& name,
+                 const std::function<void(AllocatorStatsSnapshot*)>& add_free_pieces);
+  ~AllocatorStats() { Unregister(); }
+
+  // Allocators register at the end of their constructor and unregister first thing in their
+  // destructor, so that snapshots never see their pieces half built.
+  void Register();
+  void Unregister();
+
+  void OnAllocate(size_t bytes);
+  void OnDeallocate(size_t bytes);
+  void OnReserve(size_t bytes);
+  void OnRelease(size_t bytes);
+  void OnOutOfMemory() { num_ooms_.fetch_add(1, std::memory_order_relaxed); }
+
+  AllocatorStatsSnapshot Snapshot() const;
+  void ResetPeaks();
+
+ private:
+  void RecordTimelineSample() const;
+
+  const int64_t id_;
+  const std::string name_;
+  const std::function<void(AllocatorStatsSnapshot*)> add_free_pieces_;
+  bool registered_;
+  std::atomic<int64_t> num_allocs_;
+  std::atomic<int64_t> num_frees_;
+  std::atomic<int64_t> num_ooms_;
+  std::atomic<int64_t> num_backend_allocs_;
+  std::atomic<int64_t> num_backend_frees_;
+  std::atomic<size_t> allocated_bytes_;
+  std::atomic<size_t> peak_allocated_bytes_;
+  std::atomic<size_t> reserved_bytes_;
+  std::atomic<size_t> peak_reserved_bytes_;
+};
+
+std::vector<AllocatorStatsSnapshot> GetAllAllocatorStats();
+void ResetAllAllocatorPeakStats();
+
+// While started, every change of the allocated or reserved bytes of an allocator is recorded
+// with a timestamp of profiler::GetTimeNow(), the clock of the profiler events.
+struct MemoryTimelineSample {
+  time_t time = 0;
+  int64_t allocator_id = 0;
+  size_t allocated_bytes = 0;
+  size_t reserved_bytes = 0;
+};
+
+class MemoryTimeline final {
+ public:
+  static void Start();
+  // Stops recording and returns the samples, and the allocator names by id.
+  static std::vector<MemoryTimelineSample> Stop(HashMap<int64_t, std::string>* allocator_names);
+  static bool IsRecording() { return MutIsRecording()->load(std::memory_order_relaxed); }
+  static void Record(int64_t allocator_id, const std::string& allocator_name,
+                     size_t allocated_bytes, size_t reserved_bytes);
+
+ private:
+  static std::atomic<bool>* MutIsRecording();
+};
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_ALLOCATOR_STATS_H_
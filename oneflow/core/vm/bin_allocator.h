@@ -16,20 +16,37 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_VM_BIN_ALLOCATOR_H_
 #define ONEFLOW_CORE_VM_BIN_ALLOCATOR_H_
 
+#include <atomic>
 #include <cstdint>
+#include <mutex>
 #include "oneflow/core/vm/allocator.h"
+#include "oneflow/core/vm/allocator_stats.h"
 #include "oneflow/core/vm/caching_allocator.h"
 #include "oneflow/core/common/util.h"
+#include "oneflow/core/common/env_var/vm.h"
 
 namespace oneflow {
 namespace vm {
 
+struct BinAllocatorThreadCacheStats {
+  // Small allocations served from a thread cache, and those that had to take the shared lock.
+  int64_t num_hits = 0;
+  int64_t num_misses = 0;
+  // Pieces given back from the thread caches to the shared bins.
+  int64_t num_flushed_pieces = 0;
+  // Bytes currently held by the thread caches.
+  size_t cached_bytes = 0;
+};
+
 template<typename ThreadLock>
 class BinAllocator final : public CachingAllocator {
  public:
-  explicit BinAllocator(size_t alignment, std::unique_ptr<Allocator>&& backend);
+  // `name` tells the allocator apart in the allocator stats.
+  BinAllocator(size_t alignment, std::unique_ptr<Allocator>&& backend,
+               const std::string& name = "BinAllocator");
   ~BinAllocator();
 
+  // As for sized deallocation, `size` has to be the size the memory was allocated with.
   Maybe<void> Allocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
   void DeviceReset() override {
@@ -38,12 +55,35 @@ class BinAllocator final : public CachingAllocator {
   }
   void Shrink() override {
     typename ThreadLock::RAIIGuard guard(thread_lock_);
+    FlushAllThreadCaches();
     DeallocateFreeBlockForGarbageCollection();
   }
 
+  BinAllocatorThreadCacheStats GetThreadCacheStats();
+  AllocatorStatsSnapshot GetStats() const { return stats_.Snapshot(); }
+
  private:
   static constexpr int32_t kInvalidBinNum = -1;
   static constexpr int32_t kBinNumSize = 20;
+  // Pieces up to this size are cached per thread, in size classes of kThreadCacheClassBytes.
+  static constexpr size_t kThreadCacheMaxPieceSize = 64 << 10;  // 64KiB
+  static constexpr size_t kThreadCacheClassBytes = 512;
+  // Pieces a thread cache has not needed for this many operations go back to the bins.
+  static constexpr int64_t kThreadCacheGcInterval = 1024;
+
+  // Free pieces of small sizes kept by one thread for one BinAllocator, so that most small
+  // allocations and deallocations skip thread_lock_ and the bins. The cached pieces are still in
+  // use from the point of view of the bins. The mutex is only contended when another thread
+  // flushes the cache. It is never held while taking thread_lock_.
+  struct ThreadCache {
+    std::mutex mutex;
+    // Cached piece pointers of each size class, oldest first.
+    std::vector<std::vector<char*>> pieces;
+    // Fewest pieces cached in each size class since the last garbage collection.
+    std::vector<size_t> low_water_marks;
+    int64_t num_ops_since_gc = 0;
+    BinAllocatorThreadCacheStats stats;
+  };
 
   // Piece is the basic memory unit of BinAllocator.
   // A Piece is either is free(is_free = true) or in used(is_free = false).
@@ -123,9 +163,45 @@ class BinAllocator final : public CachingAllocator {
   Maybe<bool> AllocateBlockToExtendTotalMem(size_t aligned_size);
   bool DeallocateFreeBlockForGarbageCollection();
 
+  // The bin allocator itself, called with thread_lock_ held.
+  Maybe<void> AllocateFromBins(char** mem_ptr, size_t size, size_t aligned_size);
+  void DeallocateToBins(char* mem_ptr, size_t size);
+
+  bool IsThreadCacheable(size_t size) const {
+    return thread_cache_size_ > 0 && size <= kThreadCacheMaxPieceSize;
+  }
+  // Size classes are exact multiples of thread_cache_class_bytes_, so a cached piece fits any
+  // request of its class.
+  size_t ThreadCacheClass4Size(size_t size) const {
+    return RoundUp(size, thread_cache_class_bytes_) / thread_cache_class_bytes_ - 1;
+  }
+  size_t ThreadCacheClassBytes(size_t size_class) const {
+    return (size_class + 1) * thread_cache_class_bytes_;
+  }
+  // A member rather than a file local counter, so that allocators created in different
+  // translation units never share an id.
+  static uint64_t NewUniqueId() {
+    static std::atomic<uint64_t> next_id(0);
+    return next_id++;
+  }
+  ThreadCache* GetThreadCache();
+  bool TryAllocateFromThreadCache(ThreadCache* cache, size_t size_class, char** mem_ptr);
+  void DeallocateToThreadCache(ThreadCache* cache, size_t size_class, char* mem_ptr);
+  // Takes the oldest `num` pieces of a size class out of the cache, with its mutex held.
+  void TakeThreadCachePieces(ThreadCache* cache, size_t size_class, size_t num,
+                             std::vector<std::pair<char*, size_t>>* pieces);
+  // Gives all the cached pieces back to the bins, called with thread_lock_ held.
+  void FlushAllThreadCaches();
+  void AddFreePiecesToStats(AllocatorStatsSnapshot* snapshot);
+
   const size_t alignment_;
   const std::unique_ptr<Allocator> backend_;
   ThreadLock thread_lock_;
+  // Tells apart the thread caches of different allocators, which might share an address.
+  const uint64_t unique_id_;
+  const size_t thread_cache_size_;
+  const size_t thread_cache_class_bytes_;
+  std::vector<std::shared_ptr<ThreadCache>> thread_caches_;
   size_t total_memory_bytes_;
   HashMap<char*, Block> mem_ptr2block_;
 
@@ -133,6 +209,7 @@ class BinAllocator final : public CachingAllocator {
   std::vector<std::unique_ptr<Piece>> pieces_;
   HashMap<char*, Piece*> ptr2piece_;
   Piece* recycle_piece_list_;
+  AllocatorStats stats_;
 };
 
 namespace {
@@ -146,12 +223,19 @@ static const size_t kPieceSplitThreshold = 128 << 20;  // 128MiB
 }  // namespace
 
 template<typename ThreadLock>
-BinAllocator<ThreadLock>::BinAllocator(size_t alignment, std::unique_ptr<Allocator>&& backend)
+BinAllocator<ThreadLock>::BinAllocator(size_t alignment, std::unique_ptr<Allocator>&& backend,
+                                       const std::string& name)
     : CachingAllocator(),
       alignment_(alignment),
       backend_(std::move(backend)),
+      unique_id_(NewUniqueId()),
+      thread_cache_size_(std::max<int64_t>(
+          ThreadLocalEnvInteger<ONEFLOW_VM_BIN_ALLOCATOR_THREAD_CACHE_SIZE>(), 0)),
+      thread_cache_class_bytes_(std::max(alignment, kThreadCacheClassBytes)),
       total_memory_bytes_(0),
-      recycle_piece_list_(nullptr) {
+      recycle_piece_list_(nullptr),
+      stats_(name, [this](AllocatorStatsSnapshot* snapshot) { AddFreePiecesToStats(snapshot); }) {
+  static_assert(kBinNumSize == kAllocatorStatsNumBins, "");
   CHECK_GE(alignment, 1);
   CHECK_EQ(1 << static_cast<int>(std::log2(alignment)), alignment);
   bins_.resize(kBinNumSize);
@@ -163,10 +247,23 @@ BinAllocator<ThreadLock>::BinAllocator(size_t alignment, std::unique_ptr<Allocat
     CHECK_EQ(BinNum4BinSize(bin_size * 2 - 1), i);
     CHECK_EQ(BinNum4BinSize(bin_size * 2), i == (kBinNumSize - 1) ? i : i + 1);
   }
+  stats_.Register();
 }
 
 template<typename ThreadLock>
 BinAllocator<ThreadLock>::~BinAllocator() {
+  stats_.Unregister();
+  // Threads may outlive the allocator, leave nothing in their caches.
+  for (const auto& cache : thread_caches_) {
+    std::unique_lock<std::mutex> lock(cache->mutex);
+    if (cache->stats.num_hits + cache->stats.num_misses > 0) {
+      VLOG(2) << "BinAllocator thread cache hits: " << cache->stats.num_hits
+              << ", misses: " << cache->stats.num_misses
+              << ", flushed pieces: " << cache->stats.num_flushed_pieces;
+    }
+    for (auto& pieces : cache->pieces) { pieces.clear(); }
+    cache->stats.cached_bytes = 0;
+  }
   if (total_memory_bytes_ == 0) {
     CHECK_EQ(mem_ptr2block_.size(), 0);
     return;
@@ -307,6 +404,7 @@ Maybe<bool> BinAllocator<ThreadLock>::AllocateBlockToExtendTotalMem(size_t align
 
   // extend sucess
   total_memory_bytes_ += final_allocate_bytes;
+  stats_.OnReserve(final_allocate_bytes);
 
   Piece* piece = AllocatePiece();
   piece->size = final_allocate_bytes;
@@ -370,8 +468,10 @@ bool BinAllocator<ThreadLock>::DeallocateFreeBlockForGarbageCollection() {
       }
       CHECK_EQ(block.size, piece_size_sum);
 
+      const size_t block_size = block.size;
       mem_ptr2block_.erase(it);
-      backend_->Deallocate(ptr, block.size);
+      backend_->Deallocate(ptr, block_size);
+      stats_.OnRelease(block_size);
     }
   }
   return total_free_bytes > 0;
@@ -379,18 +479,39 @@ bool BinAllocator<ThreadLock>::DeallocateFreeBlockForGarbageCollection() {
 
 template<typename ThreadLock>
 Maybe<void> BinAllocator<ThreadLock>::Allocate(char** mem_ptr, std::size_t size) {
-  typename ThreadLock::RAIIGuard guard(thread_lock_);
   if (size == 0) {
     *mem_ptr = nullptr;
     return Maybe<void>::Ok();
   }
-  size_t aligned_size = MemAlignedBytes(size, alignment_);
+  if (IsThreadCacheable(size)) {
+    ThreadCache* cache = GetThreadCache();
+    const size_t size_class = ThreadCacheClass4Size(size);
+    const size_t class_bytes = ThreadCacheClassBytes(size_class);
+    if (!TryAllocateFromThreadCache(cache, size_class, mem_ptr)) {
+      typename ThreadLock::RAIIGuard guard(thread_lock_);
+      JUST(AllocateFromBins(mem_ptr, size, class_bytes));
+    }
+    stats_.OnAllocate(class_bytes);
+    return Maybe<void>::Ok();
+  }
+  const size_t aligned_size = MemAlignedBytes(size, alignment_);
+  {
+    typename ThreadLock::RAIIGuard guard(thread_lock_);
+    JUST(AllocateFromBins(mem_ptr, size, aligned_size));
+  }
+  stats_.OnAllocate(aligned_size);
+  return Maybe<void>::Ok();
+}
 
+template<typename ThreadLock>
+Maybe<void> BinAllocator<ThreadLock>::AllocateFromBins(char** mem_ptr, size_t size,
+                                                       size_t aligned_size) {
   Piece* piece = FindPiece(aligned_size);
 
   if (piece == nullptr) {
     if (JUST(AllocateBlockToExtendTotalMem(aligned_size))) { piece = FindPiece(aligned_size); }
   }
+  if (piece == nullptr) { stats_.OnOutOfMemory(); }
 
   CHECK_NOTNULL_OR_RETURN(piece)
       << Error::OutOfMemoryError() << "Error! : Out of memory when allocate size : " << size
@@ -411,8 +532,19 @@ Maybe<void> BinAllocator<ThreadLock>::Allocate(char** mem_ptr, std::size_t size)
 template<typename ThreadLock>
 void BinAllocator<ThreadLock>::Deallocate(char* mem_ptr, std::size_t size) {
   if (mem_ptr == nullptr) { return; }
+  if (IsThreadCacheable(size)) {
+    const size_t size_class = ThreadCacheClass4Size(size);
+    stats_.OnDeallocate(ThreadCacheClassBytes(size_class));
+    DeallocateToThreadCache(GetThreadCache(), size_class, mem_ptr);
+    return;
+  }
+  stats_.OnDeallocate(MemAlignedBytes(size, alignment_));
   typename ThreadLock::RAIIGuard guard(thread_lock_);
+  DeallocateToBins(mem_ptr, size);
+}
 
+template<typename ThreadLock>
+void BinAllocator<ThreadLock>::DeallocateToBins(char* mem_ptr, size_t size) {
   auto it = ptr2piece_.find(mem_ptr);
   CHECK(it != ptr2piece_.end()) << "Error! : Try deallocate mem_ptr non-existent. mem ptr = "
                                 << mem_ptr << " size = " << size;
@@ -442,6 +574,120 @@ void BinAllocator<ThreadLock>::Deallocate(char* mem_ptr, std::size_t size) {
   InsertPiece2Bin(last_piece_insert_to_bin);
 }
 
+template<typename ThreadLock>
+typename BinAllocator<ThreadLock>::ThreadCache* BinAllocator<ThreadLock>::GetThreadCache() {
+  // Keyed by allocator id rather than address, the caches of destroyed allocators are never
+  // found again and go away with the thread.
+  thread_local HashMap<uint64_t, std::shared_ptr<ThreadCache>> id2cache;
+  auto it = id2cache.find(unique_id_);
+  if (it != id2cache.end()) { return it->second.get(); }
+  auto cache = std::make_shared<ThreadCache>();
+  cache->pieces.resize(ThreadCacheClass4Size(kThreadCacheMaxPieceSize) + 1);
+  cache->low_water_marks.resize(cache->pieces.size(), 0);
+  {
+    typename ThreadLock::RAIIGuard guard(thread_lock_);
+    thread_caches_.emplace_back(cache);
+  }
+  return id2cache.emplace(unique_id_, cache).first->second.get();
+}
+
+template<typename ThreadLock>
+bool BinAllocator<ThreadLock>::TryAllocateFromThreadCache(ThreadCache* cache, size_t size_class,
+                                                          char** mem_ptr) {
+  std::unique_lock<std::mutex> lock(cache->mutex);
+  cache->num_ops_since_gc += 1;
+  auto& pieces = cache->pieces.at(size_class);
+  if (pieces.empty()) {
+    cache->stats.num_misses += 1;
+    return false;
+  }
+  // The most recently freed piece is the most likely to be in cache.
+  *mem_ptr = pieces.back();
+  pieces.pop_back();
+  cache->low_water_marks.at(size_class) =
+      std::min(cache->low_water_marks.at(size_class), pieces.size());
+  cache->stats.cached_bytes -= ThreadCacheClassBytes(size_class);
+  cache->stats.num_hits += 1;
+  return true;
+}
+
+template<typename ThreadLock>
+void BinAllocator<ThreadLock>::DeallocateToThreadCache(ThreadCache* cache, size_t size_class,
+                                                       char* mem_ptr) {
+  std::vector<std::pair<char*, size_t>> flushed_pieces;
+  {
+    std::unique_lock<std::mutex> lock(cache->mutex);
+    cache->num_ops_since_gc += 1;
+    cache->pieces.at(size_class).emplace_back(mem_ptr);
+    cache->stats.cached_bytes += ThreadCacheClassBytes(size_class);
+    const bool is_full = cache->stats.cached_bytes > thread_cache_size_;
+    if (is_full || cache->num_ops_since_gc >= kThreadCacheGcInterval) {
+      for (size_t i = 0; i < cache->pieces.size(); ++i) {
+        // A full cache gives back the older half of each size class, otherwise the pieces that
+        // stayed unused since the last collection go back.
+        const size_t num = is_full ? (cache->pieces.at(i).size() + 1) / 2
+                                   : cache->low_water_marks.at(i);
+        TakeThreadCachePieces(cache, i, num, &flushed_pieces);
+        cache->low_water_marks.at(i) = cache->pieces.at(i).size();
+      }
+      cache->num_ops_since_gc = 0;
+    }
+  }
+  if (flushed_pieces.empty()) { return; }
+  typename ThreadLock::RAIIGuard guard(thread_lock_);
+  for (const auto& pair : flushed_pieces) { DeallocateToBins(pair.first, pair.second); }
+}
+
+template<typename ThreadLock>
+void BinAllocator<ThreadLock>::TakeThreadCachePieces(
+    ThreadCache* cache, size_t size_class, size_t num,
+    std::vector<std::pair<char*, size_t>>* pieces) {
+  auto& class_pieces = cache->pieces.at(size_class);
+  num = std::min(num, class_pieces.size());
+  if (num == 0) { return; }
+  const size_t class_bytes = ThreadCacheClassBytes(size_class);
+  for (size_t i = 0; i < num; ++i) { pieces->emplace_back(class_pieces.at(i), class_bytes); }
+  class_pieces.erase(class_pieces.begin(), class_pieces.begin() + num);
+  cache->stats.cached_bytes -= num * class_bytes;
+  cache->stats.num_flushed_pieces += num;
+}
+
+template<typename ThreadLock>
+void BinAllocator<ThreadLock>::FlushAllThreadCaches() {
+  std::vector<std::pair<char*, size_t>> flushed_pieces;
+  for (const auto& cache : thread_caches_) {
+    std::unique_lock<std::mutex> lock(cache->mutex);
+    for (size_t i = 0; i < cache->pieces.size(); ++i) {
+      TakeThreadCachePieces(cache.get(), i, cache->pieces.at(i).size(), &flushed_pieces);
+      cache->low_water_marks.at(i) = 0;
+    }
+  }
+  for (const auto& pair : flushed_pieces) { DeallocateToBins(pair.first, pair.second); }
+}
+
+template<typename ThreadLock>
+void BinAllocator<ThreadLock>::AddFreePiecesToStats(AllocatorStatsSnapshot* snapshot) {
+  // Pieces kept by the thread caches are not free in the bins, they count as cached only.
+  typename ThreadLock::RAIIGuard guard(thread_lock_);
+  for (const Bin& bin : bins_) {
+    for (const Piece* piece : bin.pieces) { snapshot->AddFreePiece(piece->size); }
+  }
+}
+
+template<typename ThreadLock>
+BinAllocatorThreadCacheStats BinAllocator<ThreadLock>::GetThreadCacheStats() {
+  BinAllocatorThreadCacheStats total;
+  typename ThreadLock::RAIIGuard guard(thread_lock_);
+  for (const auto& cache : thread_caches_) {
+    std::unique_lock<std::mutex> lock(cache->mutex);
+    total.num_hits += cache->stats.num_hits;
+    total.num_misses += cache->stats.num_misses;
+    total.num_flushed_pieces += cache->stats.num_flushed_pieces;
+    total.cached_bytes += cache->stats.cached_bytes;
+  }
+  return total;
+}
+
 }  // namespace vm
 }  // namespace oneflow
 
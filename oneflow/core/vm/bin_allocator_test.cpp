@@ -14,15 +14,121 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <memory>
-#ifdef WITH_CUDA
+#include <random>
+#include <thread>
 #include "gtest/gtest.h"
 #include "oneflow/core/vm/bin_allocator.h"
 #include "oneflow/core/vm/thread_safe_guard.h"
+#ifdef WITH_CUDA
 #include "oneflow/core/device/cuda_util.h"
+#endif  // WITH_CUDA
 
 namespace oneflow {
 namespace vm {
 
+class HostBackendAllocator final : public Allocator {
+ public:
+  HostBackendAllocator() = default;
+  ~HostBackendAllocator() override = default;
+
+  Maybe<void> Allocate(char** mem_ptr, std::size_t size) override {
+    *mem_ptr = static_cast<char*>(std::malloc(size));
+    return Maybe<void>::Ok();
+  }
+  void Deallocate(char* mem_ptr, std::size_t size) override { std::free(mem_ptr); }
+  void DeviceReset() override {}
+};
+
+TEST(BinAllocator, thread_cache) {
+  BinAllocator<ThreadSafeLock> allocator(kCudaMemAllocAlignSize,
+                                         std::make_unique<HostBackendAllocator>());
+  const int thread_num = 4;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&allocator, t]() {
+      std::mt19937 gen(t);
+      // Sizes mostly small enough for the thread caches, with some going to the bins directly.
+      std::uniform_int_distribution<size_t> size_dis(1, 80 << 10);
+      std::vector<std::pair<char*, size_t>> live;
+      for (int i = 0; i < 20000; ++i) {
+        if (live.size() < 64 && gen() % 2 == 0) {
+          const size_t size = size_dis(gen);
+          char* ptr = nullptr;
+          CHECK_JUST(allocator.Allocate(&ptr, size));
+          ASSERT_TRUE(ptr != nullptr);
+          std::memset(ptr, t + i, size);
+          live.emplace_back(ptr, size);
+        } else if (!live.empty()) {
+          // Memory must not be shared with any other live allocation.
+          const size_t index = gen() % live.size();
+          char* ptr = live.at(index).first;
+          const size_t size = live.at(index).second;
+          ASSERT_EQ(ptr[0], ptr[size - 1]);
+          allocator.Deallocate(ptr, size);
+          live.erase(live.begin() + index);
+        }
+      }
+      for (const auto& pair : live) { allocator.Deallocate(pair.first, pair.second); }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  BinAllocatorThreadCacheStats stats = allocator.GetThreadCacheStats();
+  ASSERT_GT(stats.num_hits, 0);
+  ASSERT_GT(stats.num_misses, 0);
+  allocator.Shrink();
+  ASSERT_EQ(allocator.GetThreadCacheStats().cached_bytes, 0);
+}
+
+TEST(BinAllocator, stats) {
+  BinAllocator<ThreadSafeLock> allocator(kCudaMemAllocAlignSize,
+                                         std::make_unique<HostBackendAllocator>(), "stats_test");
+  // Too large for the thread caches. The first allocation reserves a block of 20MiB.
+  const size_t size = 1 << 20;
+  MemoryTimeline::Start();
+  std::vector<char*> ptrs(3, nullptr);
+  for (char*& ptr : ptrs) { CHECK_JUST(allocator.Allocate(&ptr, size)); }
+  HashMap<int64_t, std::string> allocator_names;
+  const auto samples = MemoryTimeline::Stop(&allocator_names);
+  ASSERT_EQ(samples.size(), 4);
+  ASSERT_EQ(samples.back().allocated_bytes, 3 * size);
+  ASSERT_EQ(allocator_names.at(samples.back().allocator_id), "stats_test");
+
+  allocator.Deallocate(ptrs.at(1), size);
+  AllocatorStatsSnapshot stats = allocator.GetStats();
+  ASSERT_EQ(stats.num_allocs, 3);
+  ASSERT_EQ(stats.num_frees, 1);
+  ASSERT_EQ(stats.num_backend_allocs, 1);
+  ASSERT_EQ(stats.allocated_bytes, 2 * size);
+  ASSERT_EQ(stats.peak_allocated_bytes, 3 * size);
+  ASSERT_EQ(stats.reserved_bytes, 20 * size);
+  ASSERT_EQ(stats.cached_bytes, 18 * size);
+  // The hole left by the second allocation and the end of the block.
+  ASSERT_EQ(stats.free_bytes, 18 * size);
+  ASSERT_EQ(stats.largest_free_bytes, 17 * size);
+  ASSERT_DOUBLE_EQ(stats.fragmentation(), 1.0 / 18);
+  int64_t num_free_pieces = 0;
+  for (const auto& bin : stats.bins) { num_free_pieces += bin.num_free_pieces; }
+  ASSERT_EQ(num_free_pieces, 2);
+
+  bool found = false;
+  for (const auto& snapshot : GetAllAllocatorStats()) {
+    if (snapshot.id == stats.id) { found = snapshot.name == "stats_test"; }
+  }
+  ASSERT_TRUE(found);
+
+  allocator.Deallocate(ptrs.at(0), size);
+  allocator.Deallocate(ptrs.at(2), size);
+  allocator.Shrink();
+  stats = allocator.GetStats();
+  ASSERT_EQ(stats.allocated_bytes, 0);
+  ASSERT_EQ(stats.reserved_bytes, 0);
+  ASSERT_EQ(stats.peak_reserved_bytes, 20 * size);
+  ASSERT_EQ(stats.num_backend_frees, 1);
+  ASSERT_EQ(stats.fragmentation(), 0);
+}
+
+#ifdef WITH_CUDA
+
 class CudaBackendAllocator final : public CachingAllocator {
  public:
   explicit CudaBackendAllocator(int64_t device_id) : device_id_(device_id) {}
@@ -126,7 +232,7 @@ TEST(CudaBinAllocator, cuda_allocator) {
   a->Deallocate(data_ptr_1, 2048 * sizeof(float));
 }
 
+#endif  // WITH_CUDA
+
 }  // namespace vm
 }  // namespace oneflow
-
-#endif  // WITH_CUDA
@@ -34,8 +34,8 @@ std::unique_ptr<BinAllocator<ThreadSafeLock>> CreateEpBackendHostAllocator(Symbo
       Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(device_type, device_index);
   auto ep_backend_allocator =
       std::make_unique<EpBackendHostAllocator>(ep_device, ep::AllocationOptions{});
-  return std::make_unique<BinAllocator<ThreadSafeLock>>(ep::kMaxAlignmentRequirement,
-                                                        std::move(ep_backend_allocator));
+  return std::make_unique<BinAllocator<ThreadSafeLock>>(
+      ep::kMaxAlignmentRequirement, std::move(ep_backend_allocator), device->ToString() + " host");
 }
 
 }  // namespace
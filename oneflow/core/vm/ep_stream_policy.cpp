@@ -42,8 +42,8 @@ std::unique_ptr<vm::Allocator> CreateEpBackendDeviceAllocator(Symbol<Device> dev
         Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(device_type, device_index);
     auto ep_backend_allocator =
         std::make_unique<EpBackendAllocator>(ep_device, ep::AllocationOptions{});
-    return std::make_unique<BinAllocator<ThreadSafeLock>>(ep::kMaxAlignmentRequirement,
-                                                          std::move(ep_backend_allocator));
+    return std::make_unique<BinAllocator<ThreadSafeLock>>(
+        ep::kMaxAlignmentRequirement, std::move(ep_backend_allocator), device->ToString());
   }
 }
 
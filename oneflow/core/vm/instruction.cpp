@@ -36,6 +36,8 @@ void Instruction::__Init__(Stream* stream,
                            std::shared_ptr<InstructionPolicy>&& instruction_policy) {
   stream_ = stream;
   instruction_policy_ = std::move(instruction_policy);
+  enqueue_time_ = 0;
+  dispatch_time_ = 0;
   if (IsMainThread()) {
     if (auto* stack_getter = Singleton<ForeignStackGetter>::Get()) {
       foreign_frame_ = stack_getter->GetCurrentFrame();
@@ -145,6 +145,11 @@ class Instruction final : public intrusive::Base {
   StreamPolicy* mut_stream_policy();
   const StreamPolicy& stream_policy() const;
   std::shared_ptr<Frame> foreign_frame() const { return foreign_frame_; }
+  // Stamps of InstructionLatencyStats::Now(), 0 when not recorded.
+  int64_t enqueue_time() const { return enqueue_time_; }
+  int64_t dispatch_time() const { return dispatch_time_; }
+  void set_enqueue_time(int64_t val) { enqueue_time_ = val; }
+  void set_dispatch_time(int64_t val) { dispatch_time_ = val; }
 
   intrusive::Ref::RefCntType ref_cnt() const { return intrusive_ref_.ref_cnt(); }
 
@@ -191,7 +196,9 @@ class Instruction final : public intrusive::Base {
         intrusive_ref_(),
         stream_(),
         instruction_policy_(),
-        status_buffer_() {}
+        status_buffer_(),
+        enqueue_time_(0),
+        dispatch_time_(0) {}
 
   // lists
   DependenceAccessList access_list_;
@@ -204,6 +211,8 @@ class Instruction final : public intrusive::Base {
   std::shared_ptr<InstructionPolicy> instruction_policy_;
   InstructionStatusBuffer status_buffer_;
   std::shared_ptr<Frame> foreign_frame_;
+  int64_t enqueue_time_;
+  int64_t dispatch_time_;
 };
 
 using InstructionList = intrusive::List<INTRUSIVE_FIELD(Instruction, main_instruction_hook_)>;
@@ -0,0 +1,104 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/instruction_latency_stats.h"
+#include "oneflow/core/common/env_var/vm.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+struct InstructionLatencyCounters {
+  InstructionLatencyCounter pending;
+  InstructionLatencyCounter running;
+  InstructionLatencyCounter total;
+};
+
+InstructionLatencyCounters* MutInstructionLatencyCounters() {
+  // Leaked, the virtual machine may still run while static objects are destroyed.
+  static auto* counters = new InstructionLatencyCounters();
+  return counters;
+}
+
+}  // namespace
+
+void InstructionLatencyCounter::Record(int64_t nanoseconds) {
+  const int64_t microseconds = nanoseconds / 1000;
+  const int32_t bin_num =
+      microseconds <= 1 ? 0
+                        : std::min(kInstructionLatencyNumBins - 1,
+                                   static_cast<int32_t>(63 ^ __builtin_clzll(microseconds)));
+  count_.fetch_add(1, std::memory_order_relaxed);
+  total_ns_.fetch_add(nanoseconds, std::memory_order_relaxed);
+  if (nanoseconds > max_ns_.load(std::memory_order_relaxed)) {
+    max_ns_.store(nanoseconds, std::memory_order_relaxed);
+  }
+  bins_.at(bin_num).fetch_add(1, std::memory_order_relaxed);
+}
+
+void InstructionLatencyCounter::Reset() {
+  count_.store(0, std::memory_order_relaxed);
+  total_ns_.store(0, std::memory_order_relaxed);
+  max_ns_.store(0, std::memory_order_relaxed);
+  for (auto& bin : bins_) { bin.store(0, std::memory_order_relaxed); }
+}
+
+nlohmann::json InstructionLatencyCounter::ToJson() const {
+  const int64_t count = count_.load(std::memory_order_relaxed);
+  const int64_t total_ns = total_ns_.load(std::memory_order_relaxed);
+  nlohmann::json bins_json = nlohmann::json::array();
+  for (int32_t i = 0; i < kInstructionLatencyNumBins; ++i) {
+    const int64_t bin_count = bins_.at(i).load(std::memory_order_relaxed);
+    if (bin_count == 0) { continue; }
+    bins_json.push_back({{"min_us", i == 0 ? 0 : int64_t{1} << i}, {"count", bin_count}});
+  }
+  return {{"count", count},
+          {"total_us", total_ns / 1000.0},
+          {"mean_us", count == 0 ? 0.0 : total_ns / 1000.0 / count},
+          {"max_us", max_ns_.load(std::memory_order_relaxed) / 1000.0},
+          {"bins", bins_json}};
+}
+
+/*static*/ std::atomic<bool>* InstructionLatencyStats::MutIsEnabled() {
+  static std::atomic<bool> is_enabled(ThreadLocalEnvBool<ONEFLOW_VM_INSTRUCTION_LATENCY_STATS>());
+  return &is_enabled;
+}
+
+/*static*/ void InstructionLatencyStats::Reset() {
+  auto* counters = MutInstructionLatencyCounters();
+  counters->pending.Reset();
+  counters->running.Reset();
+  counters->total.Reset();
+}
+
+/*static*/ nlohmann::json InstructionLatencyStats::ToJson() {
+  const auto* counters = MutInstructionLatencyCounters();
+  return {{"enabled", IsEnabled()},
+          {"pending", counters->pending.ToJson()},
+          {"running", counters->running.ToJson()},
+          {"total", counters->total.ToJson()}};
+}
+
+/*static*/ void InstructionLatencyStats::Record(int64_t enqueue_time, int64_t dispatch_time,
+                                                int64_t complete_time) {
+  auto* counters = MutInstructionLatencyCounters();
+  counters->pending.Record(dispatch_time - enqueue_time);
+  counters->running.Record(complete_time - dispatch_time);
+  counters->total.Record(complete_time - enqueue_time);
+}
+
+}  // namespace vm
+}  // namespace oneflow
@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_INSTRUCTION_LATENCY_STATS_H_
+#define ONEFLOW_CORE_VM_INSTRUCTION_LATENCY_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace vm {
+
+// Latencies are reported in bins of [2^i, 2^(i+1)) microseconds, the first bin takes the shorter
+// ones and the last bin takes all the longer ones.
+constexpr int32_t kInstructionLatencyNumBins = 24;
+
+// Latencies of one stage of the instructions. Only the scheduler thread records them, the
+// counters are relaxed atomics so that they can be read from other threads.
+class InstructionLatencyCounter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(InstructionLatencyCounter);
+  InstructionLatencyCounter() { Reset(); }
+  ~InstructionLatencyCounter() = default;
+
+  void Record(int64_t nanoseconds);
+  void Reset();
+  nlohmann::json ToJson() const;
+
+ private:
+  std::atomic<int64_t> count_;
+  std::atomic<int64_t> total_ns_;
+  std::atomic<int64_t> max_ns_;
+  std::array<std::atomic<int64_t>, kInstructionLatencyNumBins> bins_;
+};
+
+// While enabled, the virtual machine stamps every instruction when it is enqueued, dispatched
+// to its stream and found done, and records the latencies of these stages:
+//   "pending": from VirtualMachine::Receive to the dispatch, waiting for the scheduler and for
+//              the instructions it depends on.
+//   "running": from the dispatch to the release, waking up the worker thread and computing.
+//   "total":   from VirtualMachine::Receive to the release.
+// Barrier instructions are run by the scheduler without a dispatch, and are not recorded.
+class InstructionLatencyStats final {
+ public:
+  static bool IsEnabled() { return MutIsEnabled()->load(std::memory_order_relaxed); }
+  static void SetEnabled(bool enabled) { MutIsEnabled()->store(enabled); }
+  static void Reset();
+  static nlohmann::json ToJson();
+
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+  static void Record(int64_t enqueue_time, int64_t dispatch_time, int64_t complete_time);
+
+ private:
+  static std::atomic<bool>* MutIsEnabled();
+};
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_INSTRUCTION_LATENCY_STATS_H_
@@ -38,8 +38,9 @@ std::unique_ptr<BinAllocator<ThreadSafeLock>> CreatePinedEpBackendHostAllocator(
   ep::AllocationOptions options{};
   options.SetPinnedDevice(device_type, device_index);
   auto ep_backend_allocator = std::make_unique<EpBackendHostAllocator>(ep_device, options);
-  return std::make_unique<BinAllocator<ThreadSafeLock>>(ep::kMaxAlignmentRequirement,
-                                                        std::move(ep_backend_allocator));
+  return std::make_unique<BinAllocator<ThreadSafeLock>>(
+      ep::kMaxAlignmentRequirement, std::move(ep_backend_allocator),
+      device->ToString() + " pinned host");
 }
 
 }  // namespace
@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/common/env_var/debug_mode.h"
 #include "oneflow/core/common/thread_local_guard.h"
 #include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/framework/to_string.h"
 #include "oneflow/core/profiler/util.h"
 
 #include "oneflow/core/common/env_var/remat.h"
@@ -64,7 +65,8 @@ std::vector<size_t> GroupNumToIndexes(size_t group_num) {
 
 }  // namespace
 
-RematEpAllocator::RematEpAllocator(size_t alignment, std::unique_ptr<Allocator>&& backend)
+RematEpAllocator::RematEpAllocator(size_t alignment, std::unique_ptr<Allocator>&& backend,
+                                   const std::string& name)
     : Allocator(),
       alignment_(alignment),
       backend_(std::move(backend)),
@@ -74,11 +76,14 @@ RematEpAllocator::RematEpAllocator(size_t alignment, std::unique_ptr<Allocator>&
       group_indexes_(GroupNumToIndexes(normal_group_num_)),
       cur_group_index_id_(normal_group_num_ > 1 ? 1 : 0),
       cur_group_index_id_high_cost_(0),
-      enable_left_and_right_(normal_group_num_ > 1) {
+      enable_left_and_right_(normal_group_num_ > 1),
+      stats_(name, [this](AllocatorStatsSnapshot* snapshot) { AddFreePiecesToStats(snapshot); }) {
   free_pieces_overlapping_with_group_.resize(normal_group_num_ + 1);
+  stats_.Register();
 }
 
 RematEpAllocator::~RematEpAllocator() {
+  stats_.Unregister();
   if (memory_ != nullptr) { backend_->Deallocate(static_cast<char*>(memory_), memory_size_); }
 }
 
@@ -371,6 +376,7 @@ size_t RematEpAllocator::group_index(bool high) const {
 void RematEpAllocator::InitMemory() {
   memory_size_ = Singleton<remat::Env>::Get()->budget_in_bytes();
   CHECK_JUST(backend_->Allocate(&memory_, memory_size_));
+  stats_.OnReserve(memory_size_);
   LOG(INFO) << "memory_: " << (void*)memory_ << ", size: " << memory_size_;
   const size_t small_piece_area_size =
       Singleton<remat::Env>::Get()->is_small_pieces_optimization_enabled()
@@ -668,7 +674,10 @@ Maybe<void> RematEpAllocator::Allocate(char** mem_ptr, std::size_t size) {
     }
   }
 
-  if (piece == nullptr) { DisplayAllPieces(); }
+  if (piece == nullptr) {
+    stats_.OnOutOfMemory();
+    DisplayAllPieces();
+  }
 
   CHECK_OR_RETURN(piece != nullptr) << "Error! : Out of memory when allocate size : " << size;
   CHECK_NOTNULL(piece->ptr);
@@ -678,6 +687,7 @@ Maybe<void> RematEpAllocator::Allocate(char** mem_ptr, std::size_t size) {
   *mem_ptr = piece->ptr;
   total_allocate_bytes_ += size;
   piece->is_free = false;
+  stats_.OnAllocate(piece->size);
 
   return Maybe<void>::Ok();
 }
@@ -693,6 +703,7 @@ void RematEpAllocator::Deallocate(char* mem_ptr, std::size_t size) {
   CHECK_NOTNULL(piece);
   CHECK_EQ(piece->ptr, mem_ptr);
   CHECK(!piece->is_free);
+  stats_.OnDeallocate(piece->size);
 
   if (auto* tensor = piece->tensor) {
     CHECK_JUST(remat::DisjointSet::update_after_release(tensor));
@@ -728,6 +739,13 @@ void RematEpAllocator::Deallocate(char* mem_ptr, std::size_t size) {
   CheckPieces();
 }
 
+void RematEpAllocator::AddFreePiecesToStats(AllocatorStatsSnapshot* snapshot) {
+  ReentrantThreadSafeLock::RAIIGuard guard(thread_lock_);
+  for (const auto& pair : ptr2piece_) {
+    if (pair.second->is_free) { snapshot->AddFreePiece(pair.second->size); }
+  }
+}
+
 size_t RematEpAllocator::allocated_memory() {
   CHECK_GE(total_allocate_bytes_, total_deallocate_bytes_);
   return total_allocate_bytes_ - total_deallocate_bytes_;
@@ -753,8 +771,10 @@ vm::RematEpAllocator* remat::AllocatorManager::CreateOrGetAllocator(DeviceType d
         Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(device_type, device_index);
     auto ep_backend_allocator =
         std::make_unique<vm::EpBackendAllocator>(ep_device, ep::AllocationOptions{});
-    auto allocator = std::make_unique<vm::RematEpAllocator>(ep::kMaxAlignmentRequirement,
-                                                            std::move(ep_backend_allocator));
+    auto allocator = std::make_unique<vm::RematEpAllocator>(
+        ep::kMaxAlignmentRequirement, std::move(ep_backend_allocator),
+        "remat " + *CHECK_JUST(DeviceTag4DeviceType(device_type)) + ":"
+            + std::to_string(device_index));
     allocators_.emplace(key, std::move(allocator));
     return allocators_.at(key).get();
   } else {
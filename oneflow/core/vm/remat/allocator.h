@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/common/env_var/remat.h"
 #include "oneflow/core/ep/include/device.h"
 #include "oneflow/core/vm/allocator.h"
+#include "oneflow/core/vm/allocator_stats.h"
 #include "oneflow/core/common/util.h"
 #include "nlohmann/json.hpp"
 #include "oneflow/core/vm/thread_safe_guard.h"
@@ -34,7 +35,8 @@ class RematableTensorStorage;
 class RematEpAllocator final : public Allocator {
  public:
   OF_DISALLOW_COPY_AND_MOVE(RematEpAllocator);
-  explicit RematEpAllocator(size_t alignment, std::unique_ptr<Allocator>&& backend);
+  RematEpAllocator(size_t alignment, std::unique_ptr<Allocator>&& backend,
+                   const std::string& name = "RematEpAllocator");
   ~RematEpAllocator() override;
   void DeviceReset() override;
 
@@ -45,6 +47,7 @@ class RematEpAllocator final : public Allocator {
   void DisplayAllPieces();
   nlohmann::json DumpSearchFreeMemCost();
   size_t allocated_memory();
+  AllocatorStatsSnapshot GetStats() const { return stats_.Snapshot(); }
   void set_left(bool is_left) { left = is_left; }
   bool left = true;
 
@@ -138,6 +141,9 @@ class RematEpAllocator final : public Allocator {
   std::vector<std::pair<offset_t, offset_t>> group_boundaries_;
 
   size_t group_index(bool high) const;
+  void AddFreePiecesToStats(AllocatorStatsSnapshot* snapshot);
+
+  AllocatorStats stats_;
 };
 
 class DtrEpAllocatorProxy final : public Allocator {
@@ -30,6 +30,7 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/common/foreign_lock_helper.h"
 #include "oneflow/core/thread/thread_global_id.h"
+#include "oneflow/core/thread/cpu_affinity.h"
 #include "oneflow/core/framework/transport_token.h"
 #include "oneflow/core/framework/to_string.h"
 #include "oneflow/core/framework/stream_on_independent_thread.h"
@@ -64,14 +65,22 @@ Maybe<void> ForEachThreadCtx(vm::VirtualMachineEngine* engine,
 }
 
 void GetSchedulerThreadInitializer(std::function<void()>* Initializer) {
-  *Initializer = [&]() { OF_PROFILER_NAME_THIS_HOST_THREAD("_VM::Scheduler"); };
+  *Initializer = [&]() {
+    OF_PROFILER_NAME_THIS_HOST_THREAD("_VM::Scheduler");
+    const auto& cpus = CHECK_JUST(ParseCpuList(ThreadLocalEnvString<ONEFLOW_VM_SCHEDULER_CPUS>()));
+    CHECK_JUST(SetCurrentThreadCpuAffinity(*cpus));
+  };
 }
 
 void WorkerLoop(vm::ThreadCtx* thread_ctx, const std::function<void(vm::ThreadCtx*)>& Initializer) {
   SyncVmModeGuard guard(SyncVmMode::kEnable);
   Initializer(thread_ctx);
   constexpr static size_t kExpireMicroseconds = 200;
-  while (thread_ctx->mut_notifier()->WaitAndClearNotifiedCnt() == kNotifierStatusSuccess) {
+  NotifierSpinPolicy spin_policy;
+  spin_policy.max_spin_count = ThreadLocalEnvInteger<ONEFLOW_VM_WORKER_SPIN_COUNT>();
+  spin_policy.yield_count = ThreadLocalEnvInteger<ONEFLOW_VM_WORKER_YIELD_COUNT>();
+  while (thread_ctx->mut_notifier()->WaitAndClearNotifiedCnt(spin_policy)
+         == kNotifierStatusSuccess) {
     std::chrono::time_point<std::chrono::steady_clock> start{};
     do {
       while (thread_ctx->TryReceiveAndRun()) { start = std::chrono::steady_clock::now(); }
@@ -331,7 +340,10 @@ void VirtualMachine::ScheduleLoop(const std::function<void()>& Initializer) {
   SyncVmModeGuard guard(SyncVmMode::kEnable);
   Initializer();
   MultiThreadScheduleCtx schedule_ctx{};
-  while (pending_notifier_.WaitAndClearNotifiedCnt() == kNotifierStatusSuccess) {
+  NotifierSpinPolicy spin_policy;
+  spin_policy.max_spin_count = ThreadLocalEnvInteger<ONEFLOW_VM_SCHEDULER_SPIN_COUNT>();
+  spin_policy.yield_count = ThreadLocalEnvInteger<ONEFLOW_VM_SCHEDULER_YIELD_COUNT>();
+  while (pending_notifier_.WaitAndClearNotifiedCnt(spin_policy) == kNotifierStatusSuccess) {
     OF_PROFILER_RANGE_GUARD("VirtualMachine::ScheduleLoop");
     auto start = std::chrono::steady_clock::now();
     static constexpr int kWorkingMicroseconds = 1000;
@@ -449,8 +461,17 @@ Maybe<vm::ThreadCtx*> VirtualMachine::CreateThreadCtx(Symbol<Device> device, Str
         return std::to_string(thread_uid);
       }
     }();
-    const auto& WorkerInitializer = [thread_tag](vm::ThreadCtx* thread_ctx) {
+    std::vector<int> cpus;
+    {
+      const auto& worker_cpus = JUST(ParseCpuList(ThreadLocalEnvString<ONEFLOW_VM_WORKER_CPUS>()));
+      std::unique_lock<std::mutex> lock(worker_threads_mutex_);
+      if (!worker_cpus->empty()) {
+        cpus.push_back(worker_cpus->at(worker_threads_.size() % worker_cpus->size()));
+      }
+    }
+    const auto& WorkerInitializer = [thread_tag, cpus](vm::ThreadCtx* thread_ctx) {
       OF_PROFILER_NAME_THIS_HOST_THREAD("_VM::Worker_" + thread_tag);
+      CHECK_JUST(SetCurrentThreadCpuAffinity(cpus));
     };
     auto thread = std::make_unique<std::thread>(&WorkerLoop, thread_ctx, WorkerInitializer);
     {
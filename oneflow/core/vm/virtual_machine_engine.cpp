@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/vm/caching_allocator.h"
 #include "oneflow/core/vm/fuse_instruction_policy.h"
 #include "oneflow/core/vm/release_tensor_instruction_policy.h"
+#include "oneflow/core/vm/instruction_latency_stats.h"
 #include "oneflow/core/vm/allocator.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/common/balanced_splitter.h"
@@ -110,6 +111,8 @@ void VirtualMachineEngine::MakeAndAppendFusedInstruction(
   auto instruction = intrusive::make_shared<Instruction>(
       begin->mut_stream(),
       std::make_shared<FuseInstructionPolicy>(std::move(fused_instruction_list)));
+  // The fused instruction stands for the instructions in it, since the first one was enqueued.
+  instruction->set_enqueue_time(begin->enqueue_time());
   pending_instructions->EmplaceBack(std::move(instruction));
 }
 
@@ -186,6 +189,11 @@ void VirtualMachineEngine::ReleaseFinishedInstructions(const ScheduleCtx& schedu
       auto* instruction_ptr = stream->mut_running_instruction_list()->Begin();
       if (instruction_ptr == nullptr) { break; }
       if (!(instruction_ptr->in_edges().empty() && instruction_ptr->Done())) { break; }
+      if (unlikely(instruction_ptr->dispatch_time() > 0)) {
+        InstructionLatencyStats::Record(instruction_ptr->enqueue_time(),
+                                        instruction_ptr->dispatch_time(),
+                                        InstructionLatencyStats::Now());
+      }
       ReleaseInstruction(instruction_ptr);
       // Prevent destructing instruction_ptr.
       intrusive::shared_ptr<Instruction> instruction =
@@ -319,6 +327,9 @@ void VirtualMachineEngine::DispatchInstruction(Instruction* instruction,
       }
     }
   }
+  if (unlikely(instruction->enqueue_time() > 0)) {
+    instruction->set_dispatch_time(InstructionLatencyStats::Now());
+  }
   stream->mut_running_instruction_list()->PushBack(instruction);
   if (stream->active_stream_hook().empty()) { mut_active_stream_list()->PushBack(stream); }
   // Compute
@@ -338,6 +349,12 @@ Maybe<bool> VirtualMachineEngine::Receive(InstructionList* compute_instruction_l
     OF_PROFILER_RANGE_GUARD(compute_instruction->DebugName());
   }
 #endif
+  if (unlikely(InstructionLatencyStats::IsEnabled())) {
+    const int64_t now = InstructionLatencyStats::Now();
+    INTRUSIVE_UNSAFE_FOR_EACH_PTR(compute_instruction, compute_instruction_list) {
+      compute_instruction->set_enqueue_time(now);
+    }
+  }
 
   bool old_list_empty = mut_pending_instruction_list()->MoveFrom(compute_instruction_list);
   return old_list_empty;
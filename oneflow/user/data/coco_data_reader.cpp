@@ -33,7 +33,7 @@ COCODataReader::COCODataReader(user_op::KernelInitContext* ctx) : DataReader<COC
   std::shared_ptr<const COCOMeta> meta(new COCOMeta(
       ctx->Attr<int64_t>("session_id"), ctx->Attr<std::string>("annotation_file"),
       ctx->Attr<std::string>("image_dir"), ctx->Attr<bool>("remove_images_without_annotations")));
-  std::unique_ptr<RandomAccessDataset<COCOImage>> coco_dataset_ptr(new COCODataset(ctx, meta));
+  std::unique_ptr<RandomAccessDataset<COCOImage>> coco_dataset_ptr(new COCODataset(meta));
 
   size_t world_size = 1;
   int64_t rank = 0;
@@ -51,7 +51,7 @@ COCODataReader::COCODataReader(user_op::KernelInitContext* ctx) : DataReader<COC
     loader_.reset(new BatchDataset<COCOImage>(batch_size_, std::move(loader_)));
   }
 
-  parser_.reset(new COCOParser(meta));
+  parser_.reset(new COCOParser(meta, ctx->Attr<int64_t>("session_id")));
   StartLoadThread();
 }
 
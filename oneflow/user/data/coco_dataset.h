@@ -22,8 +22,14 @@ limitations under the License.
 namespace oneflow {
 namespace data {
 
+// The dataset only fills in the index and the meta data of the image, the image file and the
+// annotations are read by COCOParser::Prepare.
 struct COCOImage {
   TensorBuffer data;
+  TensorBuffer bbox;
+  TensorBuffer label;
+  TensorBuffer segm;
+  TensorBuffer segm_index;
   int64_t index;
   int64_t id;
   int32_t height;
@@ -38,8 +44,7 @@ class COCODataset final : public RandomAccessDataset<COCOImage> {
   using SampleType = typename Base::SampleType;
   using BatchType = typename Base::BatchType;
 
-  COCODataset(user_op::KernelInitContext* ctx, const std::shared_ptr<const COCOMeta>& meta)
-      : meta_(meta), session_id_(ctx->Attr<int64_t>("session_id")) {}
+  explicit COCODataset(const std::shared_ptr<const COCOMeta>& meta) : meta_(meta) {}
   ~COCODataset() = default;
 
   BatchType At(int64_t index) const override;
@@ -47,7 +52,6 @@ class COCODataset final : public RandomAccessDataset<COCOImage> {
 
  private:
   std::shared_ptr<const COCOMeta> meta_;
-  int64_t session_id_;
 };
 
 }  // namespace data
@@ -16,10 +16,35 @@ limitations under the License.
 #include "oneflow/user/data/coco_parser.h"
 #include "oneflow/user/data/coco_data_reader.h"
 #include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
 
 namespace oneflow {
 namespace data {
 
+void COCOParser::Prepare(BatchType& batch_data) {
+  MultiThreadLoop(batch_data.size(), [&](size_t i) {
+    COCOImage& image = batch_data[i];
+    const std::string& image_file_path = meta_->GetImageFilePath(image.index);
+    PersistentInStream in_stream(session_id_, DataFS(), image_file_path);
+    int64_t file_size = DataFS()->GetFileSize(image_file_path);
+    image.data.Resize(Shape({file_size}), DataType::kChar);
+    CHECK_EQ(in_stream.ReadFully(image.data.mut_data<char>(), image.data.nbytes()), 0);
+
+    const auto& bbox_vec = meta_->GetBboxVec<float>(image.index);
+    CHECK_EQ(bbox_vec.size() % 4, 0);
+    int64_t num_bboxes = bbox_vec.size() / 4;
+    image.bbox.Resize(Shape({num_bboxes, 4}), DataType::kFloat);
+    std::copy(bbox_vec.begin(), bbox_vec.end(), image.bbox.mut_data<float>());
+
+    const auto& label_vec = meta_->GetLabelVec<int32_t>(image.index);
+    image.label.Resize(Shape({static_cast<int64_t>(label_vec.size())}), DataType::kInt32);
+    std::copy(label_vec.begin(), label_vec.end(), image.label.mut_data<int32_t>());
+
+    meta_->ReadSegmentationsToTensorBuffer<float>(image.index, &image.segm, &image.segm_index);
+  });
+}
+
 void COCOParser::Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx) {
   user_op::Tensor* image_tensor = ctx->Tensor4ArgNameAndIndex("image", 0);
   CHECK_NOTNULL(image_tensor);
@@ -30,39 +55,23 @@ void COCOParser::Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx
   user_op::Tensor* segm_tensor = ctx->Tensor4ArgNameAndIndex("gt_segm", 0);
   user_op::Tensor* segm_index_tensor = ctx->Tensor4ArgNameAndIndex("gt_segm_index", 0);
 
-  MultiThreadLoop(batch_data.size(), [&](size_t i) {
-    TensorBuffer* image_buffer = image_tensor->mut_dptr<TensorBuffer>() + i;
+  // The samples are prepared already, only move them into the outputs.
+  FOR_RANGE(size_t, i, 0, batch_data.size()) {
     COCOImage& image = batch_data[i];
-    image_buffer->Swap(image.data);
+    image_tensor->mut_dptr<TensorBuffer>()[i].Swap(image.data);
     if (image_size_tensor) {
       auto* image_size_ptr = image_size_tensor->mut_dptr<int32_t>() + i * 2;
-      image_size_ptr[0] = meta_->GetImageHeight(image.index);
-      image_size_ptr[1] = meta_->GetImageWidth(image.index);
-    }
-    if (image_id_tensor) {
-      auto* image_id_ptr = image_id_tensor->mut_dptr<int64_t>();
-      image_id_ptr[i] = image.id;
-    }
-    if (bbox_tensor) {
-      TensorBuffer* bbox_buffer = bbox_tensor->mut_dptr<TensorBuffer>() + i;
-      const auto& bbox_vec = meta_->GetBboxVec<float>(image.index);
-      CHECK_EQ(bbox_vec.size() % 4, 0);
-      int64_t num_bboxes = bbox_vec.size() / 4;
-      bbox_buffer->Resize(Shape({num_bboxes, 4}), DataType::kFloat);
-      std::copy(bbox_vec.begin(), bbox_vec.end(), bbox_buffer->mut_data<float>());
-    }
-    if (label_tensor) {
-      TensorBuffer* label_buffer = label_tensor->mut_dptr<TensorBuffer>() + i;
-      const auto& label_vec = meta_->GetLabelVec<int32_t>(image.index);
-      label_buffer->Resize(Shape({static_cast<int64_t>(label_vec.size())}), DataType::kInt32);
-      std::copy(label_vec.begin(), label_vec.end(), label_buffer->mut_data<int32_t>());
+      image_size_ptr[0] = image.height;
+      image_size_ptr[1] = image.width;
     }
+    if (image_id_tensor) { image_id_tensor->mut_dptr<int64_t>()[i] = image.id; }
+    if (bbox_tensor) { bbox_tensor->mut_dptr<TensorBuffer>()[i].Swap(image.bbox); }
+    if (label_tensor) { label_tensor->mut_dptr<TensorBuffer>()[i].Swap(image.label); }
     if (segm_tensor && segm_index_tensor) {
-      TensorBuffer* segm_buffer = segm_tensor->mut_dptr<TensorBuffer>() + i;
-      TensorBuffer* segm_index_buffer = segm_index_tensor->mut_dptr<TensorBuffer>() + i;
-      meta_->ReadSegmentationsToTensorBuffer<float>(image.index, segm_buffer, segm_index_buffer);
+      segm_tensor->mut_dptr<TensorBuffer>()[i].Swap(image.segm);
+      segm_index_tensor->mut_dptr<TensorBuffer>()[i].Swap(image.segm_index);
     }
-  });
+  }
   // dynamic batch size
   if (image_tensor->shape_view().elem_cnt() != batch_data.size()) {
     CHECK_EQ(image_tensor->shape_view().NumAxes(), 1);
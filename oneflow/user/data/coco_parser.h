@@ -30,13 +30,16 @@ class COCOParser final : public Parser<COCOImage> {
   using SampleType = typename Base::SampleType;
   using BatchType = typename Base::BatchType;
 
-  COCOParser(const std::shared_ptr<const COCOMeta>& meta) : meta_(meta){};
+  COCOParser(const std::shared_ptr<const COCOMeta>& meta, int64_t session_id)
+      : meta_(meta), session_id_(session_id){};
   ~COCOParser() = default;
 
+  void Prepare(BatchType& batch_data) override;
   void Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx) override;
 
  private:
   std::shared_ptr<const COCOMeta> meta_;
+  int64_t session_id_;
 };
 
 }  // namespace data
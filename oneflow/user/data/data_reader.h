@@ -18,14 +18,25 @@ limitations under the License.
 
 #include "oneflow/user/data/dataset.h"
 #include "oneflow/user/data/parser.h"
-#include "oneflow/core/common/buffer.h"
 
 namespace oneflow {
 
 namespace data {
 
 static const int32_t kDataReaderBatchBufferSize = 4;
-
+// Number of reads in a row that find their batch ready before the prefetch depth is lowered.
+static const int32_t kDataReaderPrefetchShrinkInterval = 64;
+
+// Loads batches on a number of worker threads ahead of the compute step. The loader is a chain of
+// stateful datasets, so the workers take turns on loader_->Next() and number the batches in the
+// order they are taken. Parser::Prepare then runs on the workers in parallel, and Read hands the
+// batches out by number, so the data read does not depend on the number of workers.
+//
+// The number of batches loaded ahead grows while Read has to wait for the workers, and goes back
+// down once it no longer does. Settings:
+//   ONEFLOW_DATA_READER_NUM_WORKERS: number of loading workers, 1 by default.
+//   ONEFLOW_DATA_READER_MAX_PREFETCH_DEPTH: upper bound of the batches loaded ahead.
+//   ONEFLOW_DATA_READER_PARSE_AHEAD: run Parser::Prepare on the workers (default) or in Read.
 template<typename LoadTarget>
 class DataReader {
  public:
@@ -33,32 +44,50 @@ class DataReader {
   using BatchType = std::vector<SampleType>;
 
   DataReader(user_op::KernelInitContext* ctx)
-      : is_closed_(false), batch_buffer_(kDataReaderBatchBufferSize) {}
+      : is_closed_(false),
+        num_reserved_(0),
+        num_ready_reads_(0),
+        next_read_seq_(0),
+        next_load_seq_(0) {
+    num_workers_ = std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_DATA_READER_NUM_WORKERS", 1), 1);
+    min_prefetch_depth_ = std::max<int64_t>(kDataReaderBatchBufferSize, num_workers_);
+    max_prefetch_depth_ = std::max<int64_t>(
+        ParseIntegerFromEnv("ONEFLOW_DATA_READER_MAX_PREFETCH_DEPTH", 4 * min_prefetch_depth_),
+        min_prefetch_depth_);
+    prefetch_depth_ = min_prefetch_depth_;
+    parse_ahead_ = ParseBooleanFromEnv("ONEFLOW_DATA_READER_PARSE_AHEAD", true);
+  }
 
   virtual ~DataReader() {
     Close();
-    if (load_thrd_.joinable()) { load_thrd_.join(); }
+    for (auto& thrd : load_thrds_) { thrd.join(); }
   }
 
   void Read(user_op::KernelComputeContext* ctx) {
-    CHECK(load_thrd_.joinable()) << "You should call StartLoadThread before read data";
+    CHECK(!load_thrds_.empty()) << "You should call StartLoadThread before read data";
     auto batch = FetchBatchData();
+    if (!parse_ahead_) { parser_->Prepare(batch); }
     parser_->Parse(batch, ctx);
   }
 
   void Close() {
-    if (!is_closed_.load()) {
-      is_closed_.store(true);
-      batch_buffer_.Close();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (is_closed_) { return; }
+      is_closed_ = true;
     }
+    slot_cond_.notify_all();
+    ready_cond_.notify_all();
   }
 
  protected:
   void StartLoadThread() {
-    if (load_thrd_.joinable()) { return; }
-    load_thrd_ = std::thread([this] {
-      while (!is_closed_.load() && LoadBatch()) {}
-    });
+    if (!load_thrds_.empty()) { return; }
+    for (int64_t i = 0; i < num_workers_; ++i) {
+      load_thrds_.emplace_back([this] {
+        while (LoadBatch()) {}
+      });
+    }
   }
 
   std::unique_ptr<Dataset<LoadTarget>> loader_;
@@ -66,19 +95,79 @@ class DataReader {
 
  private:
   BatchType FetchBatchData() {
-    BatchType batch;
-    CHECK_EQ(batch_buffer_.Pull(&batch), BufferStatus::kBufferStatusSuccess);
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = ready_batches_.find(next_read_seq_);
+    if (it == ready_batches_.end()) {
+      // The workers did not keep up, let them run further ahead.
+      if (prefetch_depth_ < max_prefetch_depth_) {
+        prefetch_depth_ += 1;
+        slot_cond_.notify_one();
+      }
+      num_ready_reads_ = 0;
+      ready_cond_.wait(lock, [&]() {
+        it = ready_batches_.find(next_read_seq_);
+        return is_closed_ || it != ready_batches_.end();
+      });
+      CHECK(!is_closed_) << "DataReader is closed";
+    } else if (++num_ready_reads_ >= kDataReaderPrefetchShrinkInterval) {
+      if (prefetch_depth_ > min_prefetch_depth_) { prefetch_depth_ -= 1; }
+      num_ready_reads_ = 0;
+    }
+    BatchType batch = std::move(it->second);
+    ready_batches_.erase(it);
+    next_read_seq_ += 1;
+    num_reserved_ -= 1;
+    lock.unlock();
+    slot_cond_.notify_one();
     return batch;
   }
 
   bool LoadBatch() {
-    BatchType batch = loader_->Next();
-    return batch_buffer_.Push(std::move(batch)) == BufferStatus::kBufferStatusSuccess;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      slot_cond_.wait(lock, [this]() { return is_closed_ || num_reserved_ < prefetch_depth_; });
+      if (is_closed_) { return false; }
+      num_reserved_ += 1;
+    }
+    int64_t seq = 0;
+    BatchType batch;
+    {
+      std::unique_lock<std::mutex> lock(load_mutex_);
+      seq = next_load_seq_++;
+      batch = loader_->Next();
+    }
+    if (parse_ahead_) { parser_->Prepare(batch); }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (is_closed_) { return false; }
+      ready_batches_.emplace(seq, std::move(batch));
+    }
+    ready_cond_.notify_one();
+    return true;
   }
 
-  std::atomic<bool> is_closed_;
-  Buffer<BatchType> batch_buffer_;
-  std::thread load_thrd_;
+  int64_t num_workers_;
+  int64_t min_prefetch_depth_;
+  int64_t max_prefetch_depth_;
+  bool parse_ahead_;
+
+  // Guards the members below, up to load_mutex_.
+  std::mutex mutex_;
+  std::condition_variable slot_cond_;
+  std::condition_variable ready_cond_;
+  bool is_closed_;
+  // Batches being loaded or loaded but not read yet, at most prefetch_depth_.
+  int64_t num_reserved_;
+  int64_t prefetch_depth_;
+  int64_t num_ready_reads_;
+  int64_t next_read_seq_;
+  std::map<int64_t, BatchType> ready_batches_;
+
+  // Serializes the calls of loader_->Next().
+  std::mutex load_mutex_;
+  int64_t next_load_seq_;
+
+  std::vector<std::thread> load_thrds_;
 };
 
 }  // namespace data
@@ -0,0 +1,144 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/data/data_reader.h"
+#include "oneflow/user/data/batch_dataset.h"
+
+namespace oneflow {
+namespace data {
+namespace test {
+
+namespace {
+
+constexpr int64_t kNumSamples = 1000;
+constexpr int32_t kBatchSize = 8;
+constexpr int64_t kNumBatches = 200;
+
+class RangeDataset final : public RandomAccessDataset<int64_t> {
+ public:
+  explicit RangeDataset(std::atomic<int64_t>* num_loaded) : num_loaded_(num_loaded) {}
+
+  BatchType At(int64_t index) const override {
+    if (num_loaded_ != nullptr) { num_loaded_->fetch_add(1); }
+    return BatchType{index};
+  }
+  size_t Size() const override { return kNumSamples; }
+
+ private:
+  std::atomic<int64_t>* num_loaded_;
+};
+
+// Takes a varying time in Prepare, so that the workers finish their batches out of order.
+class RecordingParser final : public Parser<int64_t> {
+ public:
+  explicit RecordingParser(std::vector<BatchType>* parsed) : parsed_(parsed) {}
+
+  void Prepare(BatchType& batch_data) override {
+    std::this_thread::sleep_for(std::chrono::microseconds((batch_data.front() * 37) % 500));
+    for (auto& sample : batch_data) { sample = sample * sample + 1; }
+  }
+  void Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx) override {
+    parsed_->push_back(batch_data);
+  }
+
+ private:
+  std::vector<BatchType>* parsed_;
+};
+
+class TestDataReader final : public DataReader<int64_t> {
+ public:
+  TestDataReader(std::vector<BatchType>* parsed, std::atomic<int64_t>* num_loaded)
+      : DataReader<int64_t>(nullptr) {
+    loader_.reset(new RangeDataset(num_loaded));
+    loader_.reset(new BatchDataset<int64_t>(kBatchSize, std::move(loader_)));
+    parser_.reset(new RecordingParser(parsed));
+    StartLoadThread();
+  }
+
+  void ReadBatch() { Read(nullptr); }
+};
+
+class ScopedEnv final {
+ public:
+  ScopedEnv(const std::string& name, const std::string& value) : name_(name) {
+    const char* old_value = std::getenv(name.c_str());
+    if (old_value != nullptr) { old_value_.reset(new std::string(old_value)); }
+    setenv(name.c_str(), value.c_str(), 1);
+  }
+  ~ScopedEnv() {
+    if (old_value_) {
+      setenv(name_.c_str(), old_value_->c_str(), 1);
+    } else {
+      unsetenv(name_.c_str());
+    }
+  }
+
+ private:
+  std::string name_;
+  std::unique_ptr<std::string> old_value_;
+};
+
+std::vector<std::vector<int64_t>> ReadBatches(int64_t num_workers, bool parse_ahead) {
+  ScopedEnv workers_env("ONEFLOW_DATA_READER_NUM_WORKERS", std::to_string(num_workers));
+  ScopedEnv parse_ahead_env("ONEFLOW_DATA_READER_PARSE_AHEAD", parse_ahead ? "1" : "0");
+  std::vector<std::vector<int64_t>> parsed;
+  TestDataReader reader(&parsed, nullptr);
+  for (int64_t i = 0; i < kNumBatches; ++i) { reader.ReadBatch(); }
+  return parsed;
+}
+
+}  // namespace
+
+TEST(DataReader, same_batches_for_any_number_of_workers) {
+  std::vector<std::vector<int64_t>> expected(kNumBatches);
+  for (int64_t i = 0; i < kNumBatches; ++i) {
+    for (int64_t j = 0; j < kBatchSize; ++j) {
+      int64_t sample = (i * kBatchSize + j) % kNumSamples;
+      expected[i].push_back(sample * sample + 1);
+    }
+  }
+  for (int64_t num_workers : {1, 4}) {
+    for (bool parse_ahead : {true, false}) {
+      ASSERT_EQ(ReadBatches(num_workers, parse_ahead), expected)
+          << "num_workers: " << num_workers << ", parse_ahead: " << parse_ahead;
+    }
+  }
+}
+
+TEST(DataReader, close_with_full_prefetch_window) {
+  ScopedEnv workers_env("ONEFLOW_DATA_READER_NUM_WORKERS", "4");
+  // Keeps the window from growing when the first read has to wait.
+  ScopedEnv depth_env("ONEFLOW_DATA_READER_MAX_PREFETCH_DEPTH", "0");
+  std::vector<std::vector<int64_t>> parsed;
+  std::atomic<int64_t> num_loaded(0);
+  std::unique_ptr<TestDataReader> reader(new TestDataReader(&parsed, &num_loaded));
+  reader->ReadBatch();
+  // Nothing is read anymore, so the workers stop once the prefetch window is full: the batch read
+  // and kDataReaderBatchBufferSize batches after it.
+  const int64_t num_full_loaded = (kDataReaderBatchBufferSize + 1) * kBatchSize;
+  for (int i = 0; i < 1000 && num_loaded.load() < num_full_loaded; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_EQ(num_loaded.load(), num_full_loaded);
+  // Joins the workers blocked on the window.
+  reader.reset();
+  ASSERT_EQ(parsed.size(), 1);
+}
+
+}  // namespace test
+}  // namespace data
+}  // namespace oneflow
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/user/data/data_reader.h"
 #include "oneflow/user/data/ofrecord_dataset.h"
+#include "oneflow/user/data/ofrecord_mmap_dataset.h"
 #include "oneflow/user/data/ofrecord_parser.h"
 #include "oneflow/user/data/random_shuffle_dataset.h"
 #include "oneflow/user/data/batch_dataset.h"
@@ -30,12 +31,21 @@ class OFRecordDataReader final : public DataReader<TensorBuffer> {
   OFRecordDataReader(user_op::KernelInitContext* ctx) : DataReader<TensorBuffer>(ctx) {
     batch_size_ = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
     if (auto* pool = TensorBufferPool::TryGet()) { pool->IncreasePoolSizeByBase(batch_size_); }
-    loader_.reset(new OFRecordDataset(ctx));
-    if (ctx->Attr<bool>("random_shuffle")) {
-      loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
+    if (ctx->Attr<bool>("random_access")) {
+      // Shuffles over the whole dataset on its own, without a shuffle buffer.
+      loader_.reset(new OFRecordMMapDataset(ctx));
+    } else {
+      loader_.reset(new OFRecordDataset(ctx));
+      if (ctx->Attr<bool>("random_shuffle")) {
+        loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
+      }
     }
     loader_.reset(new BatchDataset<TensorBuffer>(batch_size_, std::move(loader_)));
-    parser_.reset(new OFRecordParser());
+    if (ctx->Attr<bool>("lazy_parse")) {
+      parser_.reset(new SerializedOFRecordParser());
+    } else {
+      parser_.reset(new OFRecordParser());
+    }
     StartLoadThread();
   }
 
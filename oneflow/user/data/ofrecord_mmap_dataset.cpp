@@ -0,0 +1,157 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_mmap_dataset.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/user/data/distributed_util.h"
+#include <fstream>
+
+namespace oneflow {
+namespace data {
+
+OFRecordIndex::OFRecordIndex(const std::string& part_file, const MappedBuffer& part) {
+  auto start = std::chrono::system_clock::now();
+  const std::string index_file = part_file + ".index";
+  std::ifstream stream(index_file, std::ios::binary);
+  if (stream.is_open()) {
+    stream.close();
+    Load(index_file, part);
+  } else {
+    Scan(part);
+  }
+  std::chrono::duration<double, std::milli> elapse = std::chrono::system_clock::now() - start;
+  VLOG(2) << "Load OFRecord index of " << part_file << ", number of records: " << num_records()
+          << ", elapsed time: " << elapse.count() << " ms";
+}
+
+void OFRecordIndex::Load(const std::string& index_file, const MappedBuffer& part) {
+  std::ifstream stream(index_file, std::ios::binary);
+  CHECK(stream.is_open()) << "can't open OFRecord index file " << index_file;
+  char magic_code[kMagicCodeLen];
+  stream.read(magic_code, kMagicCodeLen);
+  CHECK(stream && std::memcmp(magic_code, kMagicCode, kMagicCodeLen) == 0)
+      << index_file << " is not an OFRecord index file";
+  uint64_t version = 0;
+  stream.read(reinterpret_cast<char*>(&version), sizeof(version));
+  CHECK_EQ(version, kVersion) << "unsupported version of OFRecord index file " << index_file;
+  uint64_t num_records = 0;
+  stream.read(reinterpret_cast<char*>(&num_records), sizeof(num_records));
+  offsets_.resize(num_records);
+  stream.read(reinterpret_cast<char*>(offsets_.data()),
+              sizeof(decltype(offsets_)::value_type) * offsets_.size());
+  CHECK(stream) << "OFRecord index file " << index_file << " is truncated";
+  // check eof
+  const auto pos = stream.tellg();
+  stream.seekg(0, std::ios_base::end);
+  CHECK_EQ(pos, stream.tellg()) << "OFRecord index file " << index_file << " has trailing bytes";
+  for (int64_t offset : offsets_) {
+    CHECK(offset >= 0 && offset + sizeof(int64_t) <= part.size())
+        << "OFRecord index file " << index_file << " does not match its part";
+  }
+}
+
+void OFRecordIndex::Scan(const MappedBuffer& part) {
+  const char* data = static_cast<const char*>(part.ptr());
+  size_t offset = 0;
+  while (offset < part.size()) {
+    CHECK_LE(offset + sizeof(int64_t), part.size()) << "truncated OFRecord part";
+    int64_t record_size = 0;
+    std::memcpy(&record_size, data + offset, sizeof(int64_t));
+    CHECK_GT(record_size, 0);
+    CHECK_LE(record_size, part.size() - offset - sizeof(int64_t)) << "truncated OFRecord part";
+    offsets_.emplace_back(offset);
+    offset += sizeof(int64_t) + record_size;
+  }
+}
+
+OFRecordMMapDataset::OFRecordMMapDataset(user_op::KernelInitContext* ctx)
+    : num_records_(0), num_read_samples_(0), current_epoch_(-1) {
+  const int32_t data_part_num = ctx->Attr<int32_t>("data_part_num");
+  const std::string& data_dir = ctx->Attr<std::string>("data_dir");
+  const std::string& part_name_prefix = ctx->Attr<std::string>("part_name_prefix");
+  const int32_t part_name_suffix_length = ctx->Attr<int32_t>("part_name_suffix_length");
+  CHECK_GT(data_part_num, 0);
+  part_record_offsets_.emplace_back(0);
+  for (int i = 0; i < data_part_num; ++i) {
+    std::string num = std::to_string(i);
+    int32_t zero_count = std::max(part_name_suffix_length - static_cast<int32_t>(num.length()), 0);
+    const std::string part_file =
+        JoinPath(data_dir, part_name_prefix + std::string(zero_count, '0') + num);
+    parts_.emplace_back(std::make_unique<const MappedBuffer>(part_file));
+    indices_.emplace_back(std::make_unique<const OFRecordIndex>(part_file, *parts_.back()));
+    num_records_ += indices_.back()->num_records();
+    part_record_offsets_.emplace_back(num_records_);
+  }
+  CHECK_GT(num_records_, 0) << "no OFRecord in " << data_dir;
+
+  // Every rank has to draw the same permutations, so the seed can't be a random one of its own.
+  shuffle_ = ctx->Attr<bool>("random_shuffle") || ctx->Attr<bool>("shuffle_after_epoch");
+  seed_ = ctx->Attr<int64_t>("seed");
+  if (seed_ == -1) { seed_ = kOneflowDatasetSeed; }
+
+  size_t world_size = 1;
+  int64_t rank = 0;
+  CHECK_JUST(InitDataSourceDistributedInfo(ctx, world_size, rank));
+  parallel_num_ = world_size;
+  parallel_id_ = rank;
+
+  // start_sample counts the samples read by all ranks together, like the global batch size does.
+  const int64_t start_sample = ctx->Attr<int64_t>("start_sample");
+  CHECK_GE(start_sample, 0);
+  CHECK_EQ(start_sample % parallel_num_, 0)
+      << "start_sample should be a multiple of the number of ranks reading the dataset";
+  num_read_samples_ = start_sample / parallel_num_;
+}
+
+OFRecordMMapDataset::BatchType OFRecordMMapDataset::Next() {
+  const int64_t position = num_read_samples_ * parallel_num_ + parallel_id_;
+  num_read_samples_ += 1;
+  const int64_t epoch = position / num_records_;
+  if (epoch != current_epoch_) { InitEpoch(epoch); }
+  const int64_t index = position % num_records_;
+  BatchType batch;
+  batch.push_back(TensorBuffer());
+  ReadRecord(shuffle_ ? shuffle_indices_.at(index) : index, &batch.back());
+  return batch;
+}
+
+void OFRecordMMapDataset::InitEpoch(int64_t epoch) {
+  current_epoch_ = epoch;
+  if (!shuffle_) { return; }
+  shuffle_indices_.resize(num_records_);
+  std::iota(shuffle_indices_.begin(), shuffle_indices_.end(), 0);
+  std::mt19937 gen(seed_ + epoch);
+  std::shuffle(shuffle_indices_.begin(), shuffle_indices_.end(), gen);
+}
+
+void OFRecordMMapDataset::ReadRecord(int64_t record_index, TensorBuffer* tensor) const {
+  const size_t part_index =
+      std::upper_bound(part_record_offsets_.begin(), part_record_offsets_.end(), record_index)
+      - part_record_offsets_.begin() - 1;
+  const MappedBuffer& part = *parts_.at(part_index);
+  const int64_t offset =
+      indices_.at(part_index)->offset(record_index - part_record_offsets_.at(part_index));
+  const char* data = static_cast<const char*>(part.ptr()) + offset;
+  int64_t record_size = 0;
+  std::memcpy(&record_size, data, sizeof(int64_t));
+  CHECK_GT(record_size, 0);
+  CHECK_LE(record_size, part.size() - offset - sizeof(int64_t)) << "truncated OFRecord part";
+  // The only copy of the record, from the page cache into the buffer.
+  tensor->Resize(Shape({record_size}), DataType::kChar);
+  std::memcpy(tensor->mut_data<char>(), data + sizeof(int64_t), record_size);
+}
+
+}  // namespace data
+}  // namespace oneflow
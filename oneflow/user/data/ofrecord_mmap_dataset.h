@@ -0,0 +1,93 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_MMAP_DATASET_H_
+#define ONEFLOW_USER_DATA_OFRECORD_MMAP_DATASET_H_
+
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/framework/op_kernel.h"
+#include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/mapped_buffer.h"
+
+namespace oneflow {
+namespace data {
+
+// Offsets of the records of an OFRecord part file, in which each record is an int64 size followed
+// by the serialized record. The offsets are read from the sidecar file `<part>.index` if there is
+// one, otherwise they are found by walking the size prefixes of the mapped part, which touches a
+// page per record. The sidecar file is laid out as
+//
+//   kMagicCode | uint64 version | uint64 number of records | int64 offset of each record
+//
+// where an offset is the position of the size prefix of the record in the part file.
+class OFRecordIndex final {
+ public:
+  OFRecordIndex(const std::string& part_file, const MappedBuffer& part);
+  ~OFRecordIndex() = default;
+
+  static constexpr char kMagicCode[] = "OFRIDX\x00\x00";
+  static constexpr size_t kMagicCodeLen = sizeof(kMagicCode) - 1;
+  static constexpr uint64_t kVersion = 1;
+
+  size_t num_records() const { return offsets_.size(); }
+  int64_t offset(size_t record_index) const { return offsets_.at(record_index); }
+
+ private:
+  void Load(const std::string& index_file, const MappedBuffer& part);
+  void Scan(const MappedBuffer& part);
+
+  std::vector<int64_t> offsets_;
+};
+
+// Reads the records of all the OFRecord parts straight from memory mapped files. Any record can be
+// read in constant time, so samples are drawn from a permutation of the whole dataset that is
+// reshuffled every epoch, instead of from a shuffle buffer over the part files, and reading can
+// resume from any sample. Sample positions are strided over the ranks, all of which use the same
+// permutations. The parts have to be on a local file system.
+class OFRecordMMapDataset final : public Dataset<TensorBuffer> {
+ public:
+  using Base = Dataset<TensorBuffer>;
+  using SampleType = typename Base::SampleType;
+  using BatchType = typename Base::BatchType;
+
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordMMapDataset);
+  explicit OFRecordMMapDataset(user_op::KernelInitContext* ctx);
+  ~OFRecordMMapDataset() = default;
+
+  BatchType Next() override;
+
+ private:
+  void InitEpoch(int64_t epoch);
+  void ReadRecord(int64_t record_index, TensorBuffer* tensor) const;
+
+  std::vector<std::unique_ptr<const MappedBuffer>> parts_;
+  std::vector<std::unique_ptr<const OFRecordIndex>> indices_;
+  // Index of the first record of each part, and the total number of records at the end.
+  std::vector<int64_t> part_record_offsets_;
+  int64_t num_records_;
+  bool shuffle_;
+  int64_t seed_;
+  int64_t parallel_num_;
+  int64_t parallel_id_;
+  // Number of samples this rank has read.
+  int64_t num_read_samples_;
+  int64_t current_epoch_;
+  std::vector<int64_t> shuffle_indices_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_MMAP_DATASET_H_
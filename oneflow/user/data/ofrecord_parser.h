@@ -47,6 +47,28 @@ class OFRecordParser final : public Parser<TensorBuffer> {
   }
 };
 
+// Hands out the records as read, serialized in tensor buffers, for the decoders to take the
+// features they need from without deserializing the whole record.
+class SerializedOFRecordParser final : public Parser<TensorBuffer> {
+ public:
+  using Base = Parser<TensorBuffer>;
+  using SampleType = typename Base::SampleType;
+  using BatchType = typename Base::BatchType;
+
+  SerializedOFRecordParser() = default;
+  ~SerializedOFRecordParser() = default;
+
+  void Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx) override {
+    user_op::Tensor* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
+    TensorBuffer* dptr = out_tensor->mut_dptr<TensorBuffer>();
+    for (size_t i = 0; i < batch_data.size(); ++i) { dptr[i].Swap(batch_data[i]); }
+    if (batch_data.size() != out_tensor->shape_view().elem_cnt()) {
+      CHECK_EQ(out_tensor->mut_shape_view().NumAxes(), 1);
+      out_tensor->mut_shape_view().Set(0, batch_data.size());
+    }
+  }
+};
+
 }  // namespace data
 }  // namespace oneflow
 
@@ -0,0 +1,156 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_view.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+// Field numbers of record.proto.
+constexpr uint32_t kOFRecordFeatureField = 1;
+constexpr uint32_t kMapEntryKeyField = 1;
+constexpr uint32_t kMapEntryValueField = 2;
+constexpr uint32_t kListValueField = 1;
+
+int64_t CountVarints(std::string_view data) {
+  int64_t count = 0;
+  for (char c : data) {
+    if ((static_cast<uint8_t>(c) & 0x80) == 0) { count += 1; }
+  }
+  return count;
+}
+
+}  // namespace
+
+int64_t OFRecordFeatureView::value_size() const {
+  if (feature_ != nullptr) {
+    switch (kind_case_) {
+      case Feature::kBytesList: return feature_->bytes_list().value_size();
+      case Feature::kFloatList: return feature_->float_list().value_size();
+      case Feature::kDoubleList: return feature_->double_list().value_size();
+      case Feature::kInt32List: return feature_->int32_list().value_size();
+      case Feature::kInt64List: return feature_->int64_list().value_size();
+      default: return 0;
+    }
+  }
+  int64_t size = 0;
+  WireReader reader(list_);
+  while (!reader.Done()) {
+    uint32_t field_number = 0;
+    uint32_t wire_type = 0;
+    reader.ReadTag(&field_number, &wire_type);
+    if (field_number != kListValueField) {
+      reader.Skip(wire_type);
+      continue;
+    }
+    if (wire_type != WireReader::kLengthDelimited || kind_case_ == Feature::kBytesList) {
+      reader.Skip(wire_type);
+      size += 1;
+      continue;
+    }
+    // Packed numeric values.
+    std::string_view packed = reader.ReadLengthDelimited();
+    switch (kind_case_) {
+      case Feature::kFloatList: size += packed.size() / sizeof(float); break;
+      case Feature::kDoubleList: size += packed.size() / sizeof(double); break;
+      default: size += CountVarints(packed);
+    }
+  }
+  return size;
+}
+
+std::string_view OFRecordFeatureView::bytes_value(int64_t i) const {
+  CHECK(has_bytes_list());
+  if (feature_ != nullptr) { return feature_->bytes_list().value(i); }
+  WireReader reader(list_);
+  while (!reader.Done()) {
+    uint32_t field_number = 0;
+    uint32_t wire_type = 0;
+    reader.ReadTag(&field_number, &wire_type);
+    if (field_number != kListValueField) {
+      reader.Skip(wire_type);
+      continue;
+    }
+    CHECK_EQ(wire_type, WireReader::kLengthDelimited);
+    std::string_view value = reader.ReadLengthDelimited();
+    if (i == 0) { return value; }
+    i -= 1;
+  }
+  LOG(FATAL) << "Bytes list value index out of range";
+  return std::string_view();
+}
+
+bool FindOFRecordFeature(const OFRecord& record, const std::string& name,
+                         OFRecordFeatureView* feature) {
+  auto it = record.feature().find(name);
+  if (it == record.feature().end()) { return false; }
+  *feature = OFRecordFeatureView(it->second);
+  return true;
+}
+
+bool FindOFRecordFeature(std::string_view serialized_record, const std::string& name,
+                         OFRecordFeatureView* feature) {
+  // A map<string, Feature> is encoded as repeated entry messages with the key as field 1 and the
+  // value as field 2. A key written twice takes the value of its last entry, as when parsing.
+  bool found = false;
+  WireReader record_reader(serialized_record);
+  while (!record_reader.Done()) {
+    uint32_t field_number = 0;
+    uint32_t wire_type = 0;
+    record_reader.ReadTag(&field_number, &wire_type);
+    if (field_number != kOFRecordFeatureField || wire_type != WireReader::kLengthDelimited) {
+      record_reader.Skip(wire_type);
+      continue;
+    }
+    std::string_view key;
+    std::string_view value;
+    WireReader entry_reader(record_reader.ReadLengthDelimited());
+    while (!entry_reader.Done()) {
+      entry_reader.ReadTag(&field_number, &wire_type);
+      if (field_number == kMapEntryKeyField && wire_type == WireReader::kLengthDelimited) {
+        key = entry_reader.ReadLengthDelimited();
+      } else if (field_number == kMapEntryValueField
+                 && wire_type == WireReader::kLengthDelimited) {
+        value = entry_reader.ReadLengthDelimited();
+      } else {
+        entry_reader.Skip(wire_type);
+      }
+    }
+    if (key != name) { continue; }
+    // The kind of a Feature is a oneof of the list messages, numbered as Feature::KindCase. The
+    // last one set wins.
+    Feature::KindCase kind_case = Feature::KIND_NOT_SET;
+    std::string_view list;
+    WireReader feature_reader(value);
+    while (!feature_reader.Done()) {
+      feature_reader.ReadTag(&field_number, &wire_type);
+      if (field_number >= Feature::kBytesList && field_number <= Feature::kInt64List
+          && wire_type == WireReader::kLengthDelimited) {
+        kind_case = static_cast<Feature::KindCase>(field_number);
+        list = feature_reader.ReadLengthDelimited();
+      } else {
+        feature_reader.Skip(wire_type);
+      }
+    }
+    *feature = OFRecordFeatureView(kind_case, list);
+    found = true;
+  }
+  return found;
+}
+
+}  // namespace data
+}  // namespace oneflow
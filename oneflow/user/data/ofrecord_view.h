@@ -0,0 +1,198 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+#define ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+
+#include <string_view>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+namespace data {
+
+// Reads the protobuf wire format. Malformed input fails a CHECK, like a failed ParseFromArray.
+class WireReader final {
+ public:
+  static constexpr uint32_t kVarint = 0;
+  static constexpr uint32_t kFixed64 = 1;
+  static constexpr uint32_t kLengthDelimited = 2;
+  static constexpr uint32_t kFixed32 = 5;
+
+  explicit WireReader(std::string_view data) : ptr_(data.data()), end_(data.data() + data.size()) {}
+
+  bool Done() const { return ptr_ == end_; }
+  void ReadTag(uint32_t* field_number, uint32_t* wire_type) {
+    const uint64_t tag = ReadVarint();
+    *field_number = static_cast<uint32_t>(tag >> 3);
+    *wire_type = static_cast<uint32_t>(tag & 7);
+  }
+  uint64_t ReadVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      CHECK(ptr_ < end_) << "Truncated varint in serialized OFRecord";
+      const uint8_t byte = static_cast<uint8_t>(*ptr_++);
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) { return value; }
+    }
+    LOG(FATAL) << "Malformed varint in serialized OFRecord";
+    return 0;
+  }
+  std::string_view ReadLengthDelimited() {
+    const uint64_t size = ReadVarint();
+    CHECK_LE(size, static_cast<uint64_t>(end_ - ptr_)) << "Truncated field in serialized OFRecord";
+    std::string_view value(ptr_, size);
+    ptr_ += size;
+    return value;
+  }
+  template<typename T>
+  T ReadFixed() {
+    CHECK_LE(sizeof(T), static_cast<size_t>(end_ - ptr_))
+        << "Truncated field in serialized OFRecord";
+    T value;
+    std::memcpy(&value, ptr_, sizeof(T));
+    ptr_ += sizeof(T);
+    return value;
+  }
+  void Skip(uint32_t wire_type) {
+    switch (wire_type) {
+      case kVarint: ReadVarint(); break;
+      case kFixed64: ReadFixed<uint64_t>(); break;
+      case kLengthDelimited: ReadLengthDelimited(); break;
+      case kFixed32: ReadFixed<uint32_t>(); break;
+      default: LOG(FATAL) << "Unsupported wire type " << wire_type << " in serialized OFRecord";
+    }
+  }
+
+ private:
+  const char* ptr_;
+  const char* end_;
+};
+
+// Read-only access to a Feature of an OFRecord, either a parsed message or a slice of a serialized
+// record. The serialized form lets decoders take the features they need straight out of the bytes
+// read from disk, without deserializing the whole record.
+class OFRecordFeatureView final {
+ public:
+  OFRecordFeatureView() : feature_(nullptr), kind_case_(Feature::KIND_NOT_SET) {}
+  explicit OFRecordFeatureView(const Feature& feature)
+      : feature_(&feature), kind_case_(feature.kind_case()) {}
+  // `list` is the serialized list message of a feature of kind `kind_case`.
+  OFRecordFeatureView(Feature::KindCase kind_case, std::string_view list)
+      : feature_(nullptr), kind_case_(kind_case), list_(list) {}
+
+  Feature::KindCase kind_case() const { return kind_case_; }
+  bool has_bytes_list() const { return kind_case_ == Feature::kBytesList; }
+  // Number of values in the list, of whichever kind.
+  int64_t value_size() const;
+  // Value i of a bytes list.
+  std::string_view bytes_value(int64_t i) const;
+  // Converts the first `n` values of a numeric list to T.
+  template<typename T>
+  void CopyValuesTo(T* dst, int64_t n) const;
+
+ private:
+  template<typename WireT, typename T>
+  void CopySerializedValuesTo(T* dst, int64_t n) const;
+
+  const Feature* feature_;
+  Feature::KindCase kind_case_;
+  std::string_view list_;
+};
+
+// Finds feature `name` of a record, returns false if there is none.
+bool FindOFRecordFeature(const OFRecord& record, const std::string& name,
+                         OFRecordFeatureView* feature);
+// Same as above on a serialized record. The other features are skipped over without being decoded,
+// and the view points into `serialized_record`, which has to outlive it. A field split over several
+// occurrences, which protobuf would merge, is not supported.
+bool FindOFRecordFeature(std::string_view serialized_record, const std::string& name,
+                         OFRecordFeatureView* feature);
+inline bool FindOFRecordFeature(const TensorBuffer& serialized_record, const std::string& name,
+                                OFRecordFeatureView* feature) {
+  return FindOFRecordFeature(
+      std::string_view(static_cast<const char*>(serialized_record.data()),
+                       serialized_record.nbytes()),
+      name, feature);
+}
+
+template<typename T>
+void OFRecordFeatureView::CopyValuesTo(T* dst, int64_t n) const {
+  if (feature_ != nullptr) {
+#define COPY_LIST_VALUES(kind, list_name)                     \
+  case Feature::kind: {                                       \
+    const auto& values = feature_->list_name().value();       \
+    CHECK_LE(n, values.size());                               \
+    std::transform(values.begin(), values.begin() + n, dst,   \
+                   [](auto v) { return static_cast<T>(v); }); \
+    return;                                                   \
+  }
+    switch (kind_case_) {
+      COPY_LIST_VALUES(kFloatList, float_list)
+      COPY_LIST_VALUES(kDoubleList, double_list)
+      COPY_LIST_VALUES(kInt32List, int32_list)
+      COPY_LIST_VALUES(kInt64List, int64_list)
+      default: UNIMPLEMENTED();
+    }
+#undef COPY_LIST_VALUES
+  }
+  switch (kind_case_) {
+    case Feature::kFloatList: CopySerializedValuesTo<float>(dst, n); return;
+    case Feature::kDoubleList: CopySerializedValuesTo<double>(dst, n); return;
+    case Feature::kInt32List: CopySerializedValuesTo<int32_t>(dst, n); return;
+    case Feature::kInt64List: CopySerializedValuesTo<int64_t>(dst, n); return;
+    default: UNIMPLEMENTED();
+  }
+}
+
+template<typename WireT, typename T>
+void OFRecordFeatureView::CopySerializedValuesTo(T* dst, int64_t n) const {
+  // Floating point values are fixed size on the wire, integers are varints. Repeated numeric
+  // fields are usually packed but the unpacked encoding is valid as well.
+  constexpr bool kIsFixed = std::is_floating_point<WireT>::value;
+  constexpr uint32_t kScalarWireType =
+      kIsFixed ? (sizeof(WireT) == 4 ? WireReader::kFixed32 : WireReader::kFixed64)
+               : WireReader::kVarint;
+  auto ReadValue = [](WireReader* reader) -> WireT {
+    if constexpr (kIsFixed) {
+      return reader->ReadFixed<WireT>();
+    } else {
+      return static_cast<WireT>(reader->ReadVarint());
+    }
+  };
+  int64_t i = 0;
+  WireReader reader(list_);
+  while (!reader.Done() && i < n) {
+    uint32_t field_number = 0;
+    uint32_t wire_type = 0;
+    reader.ReadTag(&field_number, &wire_type);
+    if (field_number != 1) {
+      reader.Skip(wire_type);
+    } else if (wire_type == WireReader::kLengthDelimited) {
+      WireReader packed(reader.ReadLengthDelimited());
+      while (!packed.Done() && i < n) { dst[i++] = static_cast<T>(ReadValue(&packed)); }
+    } else {
+      CHECK_EQ(wire_type, kScalarWireType) << "Unexpected wire type in serialized OFRecord";
+      dst[i++] = static_cast<T>(ReadValue(&reader));
+    }
+  }
+  CHECK_EQ(i, n) << "Serialized OFRecord feature has less than " << n << " values";
+}
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
@@ -0,0 +1,93 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/data/ofrecord_view.h"
+
+namespace oneflow {
+namespace data {
+namespace test {
+
+namespace {
+
+OFRecord MakeRecord() {
+  OFRecord record;
+  auto* features = record.mutable_feature();
+  (*features)["encoded"].mutable_bytes_list()->add_value(std::string("\x00\xff\x01jpeg", 7));
+  (*features)["names"].mutable_bytes_list()->add_value("first");
+  (*features)["names"].mutable_bytes_list()->add_value("second");
+  for (float v : {1.5f, -2.25f, 3.0f}) { (*features)["float"].mutable_float_list()->add_value(v); }
+  (*features)["double"].mutable_double_list()->add_value(0.125);
+  for (int32_t v : {7, -1, 1 << 30}) { (*features)["label"].mutable_int32_list()->add_value(v); }
+  for (int64_t v : {-(int64_t{1} << 40), int64_t{300}}) {
+    (*features)["int64"].mutable_int64_list()->add_value(v);
+  }
+  (*features)["empty"].mutable_int64_list();
+  return record;
+}
+
+template<typename T>
+std::vector<T> CopyValues(const OFRecordFeatureView& feature) {
+  std::vector<T> values(feature.value_size());
+  feature.CopyValuesTo(values.data(), values.size());
+  return values;
+}
+
+void CheckSameFeature(const OFRecordFeatureView& parsed, const OFRecordFeatureView& serialized) {
+  ASSERT_EQ(parsed.kind_case(), serialized.kind_case());
+  ASSERT_EQ(parsed.value_size(), serialized.value_size());
+  if (parsed.has_bytes_list()) {
+    for (int64_t i = 0; i < parsed.value_size(); ++i) {
+      ASSERT_EQ(parsed.bytes_value(i), serialized.bytes_value(i));
+    }
+  } else {
+    ASSERT_EQ(CopyValues<double>(parsed), CopyValues<double>(serialized));
+    ASSERT_EQ(CopyValues<int64_t>(parsed), CopyValues<int64_t>(serialized));
+  }
+}
+
+}  // namespace
+
+TEST(OFRecordView, same_as_parsed) {
+  const OFRecord record = MakeRecord();
+  const std::string serialized = record.SerializeAsString();
+  for (const auto& pair : record.feature()) {
+    OFRecordFeatureView parsed;
+    OFRecordFeatureView lazy;
+    ASSERT_TRUE(FindOFRecordFeature(record, pair.first, &parsed));
+    ASSERT_TRUE(FindOFRecordFeature(std::string_view(serialized), pair.first, &lazy));
+    CheckSameFeature(parsed, lazy);
+  }
+  OFRecordFeatureView feature;
+  ASSERT_FALSE(FindOFRecordFeature(std::string_view(serialized), "missing", &feature));
+  ASSERT_TRUE(FindOFRecordFeature(std::string_view(serialized), "encoded", &feature));
+  ASSERT_EQ(feature.bytes_value(0), std::string_view("\x00\xff\x01jpeg", 7));
+  ASSERT_TRUE(FindOFRecordFeature(std::string_view(serialized), "label", &feature));
+  ASSERT_EQ(CopyValues<int32_t>(feature), (std::vector<int32_t>{7, -1, 1 << 30}));
+}
+
+TEST(OFRecordView, unpacked_values) {
+  // Int32List {value: 5, value: -2} with unpacked encoding, followed by a packed chunk {3}.
+  std::string list("\x08\x05\x08\xfe\xff\xff\xff\xff\xff\xff\xff\xff\x01\x0a\x01\x03", 16);
+  Feature feature;
+  ASSERT_TRUE(feature.mutable_int32_list()->ParseFromString(list));
+  OFRecordFeatureView lazy(Feature::kInt32List, list);
+  CheckSameFeature(OFRecordFeatureView(feature), lazy);
+  ASSERT_EQ(CopyValues<int32_t>(lazy), (std::vector<int32_t>{5, -2, 3}));
+}
+
+}  // namespace test
+}  // namespace data
+}  // namespace oneflow
@@ -31,6 +31,10 @@ class Parser {
   Parser() = default;
   virtual ~Parser() = default;
 
+  // Does the part of parsing that does not need the kernel context on the batch in place, so that
+  // DataReader can run it on its loading workers ahead of Parse. It may be called on different
+  // batches concurrently.
+  virtual void Prepare(BatchType& batch_data) {}
   virtual void Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx) = 0;
 };
 
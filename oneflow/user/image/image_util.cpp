@@ -33,6 +33,8 @@ void ImageUtil::ConvertColor(const std::string& input_color, const cv::Mat& inpu
                              const std::string& output_color, cv::Mat& output_img) {
   if (input_color == "BGR" && output_color == "RGB") {
     cv::cvtColor(input_img, output_img, cv::COLOR_BGR2RGB);
+  } else if (input_color == "RGB" && output_color == "BGR") {
+    cv::cvtColor(input_img, output_img, cv::COLOR_RGB2BGR);
   } else {
     UNIMPLEMENTED();
   }
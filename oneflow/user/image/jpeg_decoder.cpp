@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <csetjmp>
 #include <cstddef>
 #include <iostream>
 
@@ -21,86 +22,140 @@ limitations under the License.
 
 namespace oneflow {
 
-class LibjpegCtx {
- public:
-  explicit LibjpegCtx(struct jpeg_decompress_struct* compress_info)
-      : compress_info_(compress_info) {}
-  ~LibjpegCtx() { jpeg_destroy_decompress(compress_info_); }
-  OF_DISALLOW_COPY_AND_MOVE(LibjpegCtx);
-  struct jpeg_decompress_struct* compress_info() {
-    return compress_info_;
-  }
+namespace {
 
- private:
-  struct jpeg_decompress_struct* compress_info_;
+// libjpeg reports corrupt data as fatal errors, and the default error_exit exits the process.
+// Jump back to JpegPartialDecodeRandomCropScaledImage instead, which returns false so that the
+// caller falls back to OpenCV.
+struct JpegErrorMgr {
+  struct jpeg_error_mgr pub;
+  jmp_buf setjmp_buffer;
 };
 
-bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
-                                      RandomCropGenerator* random_crop_gen,
-                                      unsigned char* workspace, size_t workspace_size,
-                                      cv::Mat* out_mat) {
-  struct jpeg_decompress_struct compress_info {};
-  struct jpeg_error_mgr jpeg_err {};
-  compress_info.err = jpeg_std_error(&jpeg_err);
-  jpeg_create_decompress(&compress_info);
-  if (compress_info.err->msg_code != 0) { return false; }
-
-  LibjpegCtx ctx_guard(&compress_info);
-
-  jpeg_mem_src(ctx_guard.compress_info(), data, length);
-  if (ctx_guard.compress_info()->err->msg_code != 0) { return false; }
+void JpegErrorExit(j_common_ptr info) {
+  longjmp(reinterpret_cast<JpegErrorMgr*>(info->err)->setjmp_buffer, 1);
+}
 
-  int rc = jpeg_read_header(ctx_guard.compress_info(), TRUE);
+// Every libjpeg call that may fail is made here, and no object with a destructor is alive across
+// them, since the error jumps over this frame.
+bool DecodeRandomCropScaled(struct jpeg_decompress_struct* compress_info, const unsigned char* data,
+                            size_t length, RandomCropGenerator* random_crop_gen, int min_width,
+                            int min_height, unsigned char* workspace, size_t workspace_size,
+                            cv::Mat* out_mat) {
+  jpeg_mem_src(compress_info, data, length);
+  int rc = jpeg_read_header(compress_info, TRUE);
   if (rc != JPEG_HEADER_OK) { return false; }
+  // The output is always 3-channel RGB, leave color spaces libjpeg cannot convert, e.g. CMYK, to
+  // OpenCV.
+  const J_COLOR_SPACE jpeg_color_space = compress_info->jpeg_color_space;
+  if (jpeg_color_space != JCS_YCbCr && jpeg_color_space != JCS_GRAYSCALE
+      && jpeg_color_space != JCS_RGB) {
+    return false;
+  }
+  compress_info->out_color_space = JCS_RGB;
 
-  jpeg_start_decompress(ctx_guard.compress_info());
-  int width = ctx_guard.compress_info()->output_width;
-  int height = ctx_guard.compress_info()->output_height;
-  int pixel_size = ctx_guard.compress_info()->output_components;
-
-  unsigned int u_crop_x = 0, u_crop_y = 0, u_crop_w = width, u_crop_h = height;
+  // The crop window is generated on the full resolution image, so that scaling does not change
+  // the distribution of the crops.
+  const int image_width = compress_info->image_width;
+  const int image_height = compress_info->image_height;
+  int crop_x = 0, crop_y = 0, crop_w = image_width, crop_h = image_height;
   if (random_crop_gen) {
     CropWindow crop;
-    random_crop_gen->GenerateCropWindow({height, width}, &crop);
-    u_crop_y = crop.anchor.At(0);
-    u_crop_x = crop.anchor.At(1);
-    u_crop_h = crop.shape.At(0);
-    u_crop_w = crop.shape.At(1);
+    random_crop_gen->GenerateCropWindow({image_height, image_width}, &crop);
+    crop_y = crop.anchor.At(0);
+    crop_x = crop.anchor.At(1);
+    crop_h = crop.shape.At(0);
+    crop_w = crop.shape.At(1);
+  }
+
+  // libjpeg can scale the image by scale_num / 8 in the IDCT almost for free, pick the smallest
+  // scale that keeps the crop window at least min_width x min_height.
+  int scale_num = 8;
+  if (min_width > 0 && min_height > 0) {
+    while (scale_num > 1 && crop_w * (scale_num - 1) >= min_width * 8
+           && crop_h * (scale_num - 1) >= min_height * 8) {
+      scale_num -= 1;
+    }
+  }
+  compress_info->scale_num = scale_num;
+  compress_info->scale_denom = 8;
+
+  jpeg_start_decompress(compress_info);
+  int width = compress_info->output_width;
+  int height = compress_info->output_height;
+  int pixel_size = compress_info->output_components;
+
+  unsigned int u_crop_x = crop_x, u_crop_y = crop_y, u_crop_w = crop_w, u_crop_h = crop_h;
+  if (scale_num != 8) {
+    u_crop_x = std::min(crop_x * scale_num / 8, width - 1);
+    u_crop_y = std::min(crop_y * scale_num / 8, height - 1);
+    u_crop_w = std::min(((crop_x + crop_w) * scale_num + 7) / 8, width) - u_crop_x;
+    u_crop_h = std::min(((crop_y + crop_h) * scale_num + 7) / 8, height) - u_crop_y;
   }
 
   unsigned int tmp_w = u_crop_w;
-  jpeg_crop_scanline(ctx_guard.compress_info(), &u_crop_x, &tmp_w);
-  if (jpeg_skip_scanlines(ctx_guard.compress_info(), u_crop_y) != u_crop_y) { return false; }
+  jpeg_crop_scanline(compress_info, &u_crop_x, &tmp_w);
+  if (jpeg_skip_scanlines(compress_info, u_crop_y) != u_crop_y) { return false; }
 
   int row_offset = (tmp_w - u_crop_w) * pixel_size;
   int out_row_stride = u_crop_w * pixel_size;
-  std::vector<unsigned char> decode_output_buf;
+  // Scanline buffer reused by the images decoded on the same thread.
+  thread_local std::vector<unsigned char> decode_output_buf;
   unsigned char* decode_output_pointer = nullptr;
   size_t image_space_size = width * pixel_size;
 
   if (image_space_size > workspace_size) {
-    decode_output_buf.resize(image_space_size);
+    if (decode_output_buf.size() < image_space_size) { decode_output_buf.resize(image_space_size); }
     decode_output_pointer = decode_output_buf.data();
   } else {
     decode_output_pointer = workspace;
   }
   out_mat->create(u_crop_h, u_crop_w, CV_8UC3);
 
-  while (ctx_guard.compress_info()->output_scanline < u_crop_y + u_crop_h) {
+  while (compress_info->output_scanline < u_crop_y + u_crop_h) {
     unsigned char* buffer_array[1];
     buffer_array[0] = decode_output_pointer;
-    unsigned int read_line_index = ctx_guard.compress_info()->output_scanline;
-    jpeg_read_scanlines(ctx_guard.compress_info(), buffer_array, 1);
+    unsigned int read_line_index = compress_info->output_scanline;
+    jpeg_read_scanlines(compress_info, buffer_array, 1);
     memcpy(out_mat->data + (read_line_index - u_crop_y) * out_row_stride,
            decode_output_pointer + row_offset, out_row_stride);
   }
 
-  jpeg_skip_scanlines(ctx_guard.compress_info(), height - u_crop_y - u_crop_h);
-  jpeg_finish_decompress(ctx_guard.compress_info());
-
+  jpeg_skip_scanlines(compress_info, height - u_crop_y - u_crop_h);
+  jpeg_finish_decompress(compress_info);
   return true;
 }
 
+}  // namespace
+
+bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
+                                      RandomCropGenerator* random_crop_gen,
+                                      unsigned char* workspace, size_t workspace_size,
+                                      cv::Mat* out_mat) {
+  return JpegPartialDecodeRandomCropScaledImage(data, length, random_crop_gen, 0, 0, workspace,
+                                                workspace_size, out_mat);
+}
+
+bool JpegPartialDecodeRandomCropScaledImage(const unsigned char* data, size_t length,
+                                            RandomCropGenerator* random_crop_gen, int min_width,
+                                            int min_height, unsigned char* workspace,
+                                            size_t workspace_size, cv::Mat* out_mat) {
+  struct jpeg_decompress_struct compress_info {};
+  JpegErrorMgr jpeg_err{};
+  compress_info.err = jpeg_std_error(&jpeg_err.pub);
+  jpeg_err.pub.error_exit = JpegErrorExit;
+  if (setjmp(jpeg_err.setjmp_buffer)) {
+    jpeg_destroy_decompress(&compress_info);
+    return false;
+  }
+  jpeg_create_decompress(&compress_info);
+  const bool is_decoded =
+      DecodeRandomCropScaled(&compress_info, data, length, random_crop_gen, min_width, min_height,
+                             workspace, workspace_size, out_mat);
+  jpeg_destroy_decompress(&compress_info);
+  return is_decoded;
+}
+
 void OpenCvPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
                                         RandomCropGenerator* random_crop_gen,
                                         const std::string& color_space, cv::Mat& out_mat) {
@@ -112,7 +167,7 @@ void OpenCvPartialDecodeRandomCropImage(const unsigned char* data, size_t length
 
   // random crop
   if (random_crop_gen != nullptr) {
-    CHECK(image.data != nullptr);
+    CHECK(image.data != nullptr) << "Failed to decode image";
     cv::Mat image_roi;
     CropWindow crop;
     random_crop_gen->GenerateCropWindow({H, W}, &crop);
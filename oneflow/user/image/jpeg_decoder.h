@@ -27,6 +27,14 @@ bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
                                       unsigned char* workspace, size_t workspace_size,
                                       cv::Mat* out_mat);
 
+// Same as JpegPartialDecodeRandomCropImage, but lets libjpeg scale the image down in the IDCT as
+// long as the crop window stays at least min_width x min_height, for callers that resize the crop
+// to that size anyway. The output is 3-channel RGB.
+bool JpegPartialDecodeRandomCropScaledImage(const unsigned char* data, size_t length,
+                                            RandomCropGenerator* random_crop_gen, int min_width,
+                                            int min_height, unsigned char* workspace,
+                                            size_t workspace_size, cv::Mat* out_mat);
+
 void OpenCvPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
                                         RandomCropGenerator* random_crop_gen,
                                         const std::string& color_space, cv::Mat& out_mat);
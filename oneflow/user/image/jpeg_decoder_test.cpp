@@ -93,4 +93,42 @@ TEST(JPEG, decoder) {
   }
 }
 
+TEST(JPEG, corrupt_data) {
+  std::vector<unsigned char> jpg;
+  GenerateImage(jpg, 64, 64);
+  const auto& CorruptMarker = [&](unsigned char marker, size_t offset, unsigned char value) {
+    std::vector<unsigned char> corrupt = jpg;
+    for (size_t i = 0; i + offset < corrupt.size(); ++i) {
+      if (corrupt[i] == 0xFF && corrupt[i + 1] == marker) {
+        corrupt[i + offset] = value;
+        break;
+      }
+    }
+    return corrupt;
+  };
+  std::vector<std::vector<unsigned char>> corrupt_jpgs;
+  corrupt_jpgs.emplace_back(CorruptMarker(0xD8, 0, 0));  // no SOI
+  // Sample precision of SOF0, libjpeg only decodes 8 bits.
+  corrupt_jpgs.emplace_back(CorruptMarker(0xC0, 4, 12));
+  // Code counts of the first DHT, which add up to more codes than the table holds.
+  std::vector<unsigned char> bad_huffman = jpg;
+  for (size_t i = 2; i + 21 < bad_huffman.size(); ++i) {
+    if (bad_huffman[i] == 0xFF && bad_huffman[i + 1] == 0xC4) {
+      std::fill(bad_huffman.begin() + i + 5, bad_huffman.begin() + i + 21, 0xFF);
+      break;
+    }
+  }
+  corrupt_jpgs.emplace_back(bad_huffman);
+  for (const auto& corrupt : corrupt_jpgs) {
+    cv::Mat image_mat;
+    // Reported as a failure instead of exiting the process, so that callers fall back to OpenCV.
+    ASSERT_FALSE(JpegPartialDecodeRandomCropImage(corrupt.data(), corrupt.size(), nullptr,
+                                                  nullptr, 0, &image_mat));
+    RandomCropGenerator random_crop_gen({0.1, 0.9}, {0.4, 0.6}, 1, 1);
+    ASSERT_FALSE(JpegPartialDecodeRandomCropScaledImage(corrupt.data(), corrupt.size(),
+                                                        &random_crop_gen, 8, 8, nullptr, 0,
+                                                        &image_mat));
+  }
+}
+
 }  // namespace oneflow
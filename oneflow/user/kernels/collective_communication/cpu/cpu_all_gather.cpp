@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/user/kernels/collective_communication/cpu/cpu_communication_context.h"
 #include "oneflow/user/kernels/collective_communication/include/all_gather.h"
 #include "oneflow/user/kernels/collective_communication/cpu/cpu_collective_communication_util.h"
+#include "oneflow/user/kernels/collective_communication/cpu/cpu_shm_group.h"
 
 namespace oneflow {
 
@@ -26,6 +27,24 @@ namespace ccl {
 
 namespace {
 
+// Each rank copies a piece of its input into its shared memory buffer, then the pieces of all
+// buffers into the output.
+Maybe<void> ShmAllGather(const void* in, void* out, size_t chunk_size, CpuShmGroup* shm_group) {
+  std::unique_lock<std::mutex> lock(*shm_group->mut_mutex());
+  const char* char_in = reinterpret_cast<const char*>(in);
+  char* char_out = reinterpret_cast<char*>(out);
+  for (size_t offset = 0; offset < chunk_size; offset += shm_group->buffer_size()) {
+    const size_t size = std::min(shm_group->buffer_size(), chunk_size - offset);
+    std::memcpy(shm_group->mut_buffer(shm_group->local_id()), char_in + offset, size);
+    shm_group->Barrier();
+    for (int64_t i = 0; i < shm_group->local_size(); ++i) {
+      std::memcpy(char_out + i * chunk_size + offset, shm_group->mut_buffer(i), size);
+    }
+    shm_group->Barrier();
+  }
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> AllGatherImpl(const void* in, void* out, size_t elem_cnt, DataType dtype,
                           Symbol<ParallelDesc> parallel_desc) {
   int64_t parallel_num = parallel_desc->parallel_num();
@@ -35,6 +54,10 @@ Maybe<void> AllGatherImpl(const void* in, void* out, size_t elem_cnt, DataType d
   }
   char* char_out = reinterpret_cast<char*>(out);
   size_t chunk_size = elem_cnt * GetSizeOfDataType(dtype);
+  if (CpuShmGroup::IsEnabled(parallel_desc)) {
+    const auto& shm_group = JUST(CpuShmGroup::Get(parallel_desc));
+    if (shm_group->is_intra_node()) { return ShmAllGather(in, out, chunk_size, shm_group.get()); }
+  }
   BalancedSplitter bs(chunk_size * parallel_num, parallel_num);
   const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
   CHECK_OR_RETURN(opt_parallel_id->has_value()) << kOfBugIssueUploadPrompt;
@@ -14,11 +14,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/common/data_type.h"
+#include "oneflow/core/common/env_var/ccl.h"
 #include "oneflow/core/job/rank_group.h"
 #include "oneflow/core/framework/transport_util.h"
 #include "oneflow/user/kernels/collective_communication/cpu/cpu_communication_context.h"
 #include "oneflow/user/kernels/collective_communication/include/all_reduce.h"
 #include "oneflow/user/kernels/collective_communication/cpu/cpu_collective_communication_util.h"
+#include "oneflow/user/kernels/collective_communication/cpu/cpu_shm_group.h"
 
 namespace oneflow {
 
@@ -26,6 +28,21 @@ namespace ccl {
 
 namespace {
 
+using MessageCtxPtr = std::shared_ptr<NaiveAsyncTransportCtx>;
+
+// A transport context of a single message, which sends from or receives into `ptr`. Each chunk
+// gets its own, so that many can be in flight and be waited for one by one.
+MessageCtxPtr NewMessageCtx(const TransportToken& transport_token, const void* ptr, size_t size) {
+  const auto& Prepare = [ptr, size](void** buffer, std::size_t* buffer_size,
+                                    std::function<void()>* Cb) -> Maybe<void> {
+    *buffer = const_cast<void*>(ptr);
+    *buffer_size = size;
+    *Cb = [] {};
+    return Maybe<void>::Ok();
+  };
+  return std::make_shared<NaiveAsyncTransportCtx>(transport_token, Prepare, Prepare);
+}
+
 template<typename T, ReduceType reduce_type>
 struct AllReduceImpl final {
   static Maybe<void> Call(const void* void_in, void* void_out, size_t elem_cnt,
@@ -37,83 +54,211 @@ struct AllReduceImpl final {
     }
     const T* in = reinterpret_cast<const T*>(void_in);
     T* out = reinterpret_cast<T*>(void_out);
-    BalancedSplitter bs(elem_cnt, parallel_num);
-    auto recv_buffer = std::make_unique<T[]>(bs.At(0).size());
+    if (CpuShmGroup::IsEnabled(parallel_desc)) {
+      const auto& shm_group = JUST(CpuShmGroup::Get(parallel_desc));
+      return HierarchicalAllReduce(in, out, elem_cnt, shm_group.get());
+    }
     Optional<int64_t> parallel_id;
     JUST(GetTensorDevice4CurrentProcessCtx(parallel_desc, &parallel_id));
+    // Small messages are bound by latency, recursive doubling takes log2(parallel_num) steps
+    // instead of the 2 * (parallel_num - 1) of the ring.
+    if (elem_cnt * sizeof(T)
+        <= ThreadLocalEnvInteger<ONEFLOW_CCL_CPU_ALL_REDUCE_RECURSIVE_DOUBLING_MAX_BYTES>()) {
+      return RecursiveDoubling(in, out, elem_cnt, parallel_desc, JUST(parallel_id));
+    }
+    return PipelinedRing(in, out, elem_cnt, parallel_desc, JUST(parallel_id));
+  }
+
+ private:
+  // The ranks on a host copy a piece of their input into their shared memory buffers, each
+  // reduces a slice of the piece over all buffers into the buffer of the leader, the leaders
+  // all-reduce the piece between hosts, and every rank copies the result out.
+  static Maybe<void> HierarchicalAllReduce(const T* in, T* out, size_t elem_cnt,
+                                           CpuShmGroup* shm_group) {
+    std::unique_lock<std::mutex> lock(*shm_group->mut_mutex());
+    const size_t piece_elem_cnt = shm_group->buffer_size() / sizeof(T);
+    T* result = reinterpret_cast<T*>(shm_group->mut_buffer(0));
+    for (size_t offset = 0; offset < elem_cnt; offset += piece_elem_cnt) {
+      const size_t size = std::min(piece_elem_cnt, elem_cnt - offset);
+      std::memcpy(shm_group->mut_buffer(shm_group->local_id()), in + offset, size * sizeof(T));
+      shm_group->Barrier();
+      const Range range = BalancedSplitter(size, shm_group->local_size()).At(shm_group->local_id());
+      for (int64_t i = 1; i < shm_group->local_size(); ++i) {
+        const T* buffer = reinterpret_cast<const T*>(shm_group->mut_buffer(i));
+        ReduceFunctor<T, reduce_type>::Call(range.size(), result + range.begin(),
+                                            result + range.begin(), buffer + range.begin());
+      }
+      shm_group->Barrier();
+      if (!shm_group->is_intra_node()) {
+        if (shm_group->is_leader()) {
+          JUST(Call(result, result, size, shm_group->inter_node_parallel_desc()));
+        }
+        shm_group->Barrier();
+      }
+      std::memcpy(out + offset, result, size * sizeof(T));
+      // The leader writes the next piece into the buffer the others are reading.
+      shm_group->Barrier();
+    }
+    return Maybe<void>::Ok();
+  }
+
+  // Ring reduce-scatter then all-gather, with partitions sent in chunks. A chunk is reduced and
+  // forwarded to the next rank as soon as it arrives, while the following chunks are still on
+  // their way. Both ends post the messages of a step chunk by chunk and step by step, which is
+  // the order the transport matches them in.
+  static Maybe<void> PipelinedRing(const T* in, T* out, size_t elem_cnt,
+                                   Symbol<ParallelDesc> parallel_desc, int64_t parallel_id) {
+    const int64_t parallel_num = parallel_desc->parallel_num();
+    BalancedSplitter bs(elem_cnt, parallel_num);
+    const size_t chunk_elem_cnt = std::max<size_t>(
+        ThreadLocalEnvInteger<ONEFLOW_CCL_CPU_ALL_REDUCE_CHUNK_BYTES>() / sizeof(T), 1);
+    const auto& ChunkNum = [&](int64_t part_id) -> size_t {
+      return RoundUp(bs.At(part_id).size(), chunk_elem_cnt) / chunk_elem_cnt;
+    };
+    const auto& ChunkSize = [&](int64_t part_id, size_t chunk_id) -> size_t {
+      return std::min(chunk_elem_cnt, bs.At(part_id).size() - chunk_id * chunk_elem_cnt);
+    };
+    const auto& ChunkOffset = [&](int64_t part_id, size_t chunk_id) -> size_t {
+      return bs.At(part_id).begin() + chunk_id * chunk_elem_cnt;
+    };
     const auto& rank_group = JUST(RankGroup::New(parallel_desc));
     TransportToken transport_token =
         JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
-    for (int64_t i = 0, part_id = JUST(parallel_id); i < parallel_num - 1;
-         ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = nullptr;
-      if (i == 0) {
-        send_ptr = &in[bs.At(send_part_id).begin()];
-      } else {
-        send_ptr = &out[bs.At(send_part_id).begin()];
-      }
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = recv_buffer.get();
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
+    std::vector<MessageCtxPtr> send_ctxs;
+    const auto& Send = [&](const T* ptr, size_t size) -> Maybe<void> {
+      send_ctxs.emplace_back(NewMessageCtx(transport_token, ptr, size * sizeof(T)));
+      JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token,
+                                               send_ctxs.back().get()));
+      return Maybe<void>::Ok();
+    };
+    const auto& Recv = [&](T* ptr, size_t size) -> Maybe<NaiveAsyncTransportCtx> {
+      auto ctx = NewMessageCtx(transport_token, ptr, size * sizeof(T));
+      JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, ctx.get()));
+      return ctx;
+    };
+    const auto& WaitSends = [&]() -> Maybe<void> {
+      for (const auto& ctx : send_ctxs) { JUST(ctx->WaitDone()); }
+      send_ctxs.clear();
+      return Maybe<void>::Ok();
+    };
+
+    // Reduce-scatter. At step i this rank receives part parallel_id - i - 1 and reduces it into
+    // out, then sends it on at step i + 1. The parts of two steps are received at a time.
+    std::unique_ptr<T[]> recv_buffers[2];
+    for (auto& buffer : recv_buffers) { buffer = std::make_unique<T[]>(bs.At(0).size()); }
+    const auto& RecvPartId = [&](int64_t step) -> int64_t {
+      return (parallel_id - step - 1 + parallel_num) % parallel_num;
+    };
+    const auto& PostRecvs = [&](int64_t step) -> Maybe<std::vector<MessageCtxPtr>> {
+      std::vector<MessageCtxPtr> recv_ctxs;
+      const int64_t part_id = RecvPartId(step);
+      for (size_t j = 0; j < ChunkNum(part_id); ++j) {
+        recv_ctxs.emplace_back(JUST(Recv(recv_buffers[step % 2].get() + j * chunk_elem_cnt,
+                                         ChunkSize(part_id, j))));
       }
-      JUST(ctx.WaitDone());
-      const T* cur_in = &in[bs.At(recv_part_id).begin()];
-      T* cur_out = &out[bs.At(recv_part_id).begin()];
-      if (recv_size > 0) {
-        ReduceFunctor<T, reduce_type>::Call(recv_size, cur_out, cur_in, recv_ptr);
+      return recv_ctxs;
+    };
+    for (size_t j = 0; j < ChunkNum(parallel_id); ++j) {
+      JUST(Send(&in[ChunkOffset(parallel_id, j)], ChunkSize(parallel_id, j)));
+    }
+    auto recv_ctxs = *JUST(PostRecvs(0));
+    for (int64_t i = 0; i < parallel_num - 1; ++i) {
+      std::vector<MessageCtxPtr> next_recv_ctxs;
+      if (i + 1 < parallel_num - 1) { next_recv_ctxs = *JUST(PostRecvs(i + 1)); }
+      const int64_t part_id = RecvPartId(i);
+      for (size_t j = 0; j < ChunkNum(part_id); ++j) {
+        JUST(recv_ctxs.at(j)->WaitDone());
+        const size_t offset = ChunkOffset(part_id, j);
+        const size_t size = ChunkSize(part_id, j);
+        ReduceFunctor<T, reduce_type>::Call(size, &out[offset], &in[offset],
+                                            recv_buffers[i % 2].get() + j * chunk_elem_cnt);
+        if (i + 1 < parallel_num - 1) { JUST(Send(&out[offset], size)); }
       }
+      recv_ctxs = std::move(next_recv_ctxs);
     }
-    for (int64_t i = 0, part_id = RingIncrease(JUST(parallel_id), parallel_num);
-         i < parallel_num - 1; ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = &out[bs.At(send_part_id).begin()];
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = &out[bs.At(recv_part_id).begin()];
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
+    // The parts sent above are overwritten by the all-gather.
+    JUST(WaitSends());
+
+    // All-gather. At step i this rank receives part parallel_id - i straight into out, and sends
+    // it on at step i + 1. Every part has its own place, so all receives are posted at once.
+    const int64_t reduced_part_id = RingIncrease(parallel_id, parallel_num);
+    for (size_t j = 0; j < ChunkNum(reduced_part_id); ++j) {
+      JUST(Send(&out[ChunkOffset(reduced_part_id, j)], ChunkSize(reduced_part_id, j)));
+    }
+    std::vector<std::vector<MessageCtxPtr>> gather_ctxs(parallel_num - 1);
+    for (int64_t i = 0; i < parallel_num - 1; ++i) {
+      const int64_t part_id = RecvPartId(i - 1);
+      for (size_t j = 0; j < ChunkNum(part_id); ++j) {
+        gather_ctxs.at(i).emplace_back(
+            JUST(Recv(&out[ChunkOffset(part_id, j)], ChunkSize(part_id, j))));
       }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
+    }
+    for (int64_t i = 0; i < parallel_num - 1; ++i) {
+      const int64_t part_id = RecvPartId(i - 1);
+      for (size_t j = 0; j < ChunkNum(part_id); ++j) {
+        JUST(gather_ctxs.at(i).at(j)->WaitDone());
+        if (i + 1 < parallel_num - 1) {
+          JUST(Send(&out[ChunkOffset(part_id, j)], ChunkSize(part_id, j)));
+        }
       }
-      JUST(ctx.WaitDone());
     }
+    JUST(WaitSends());
+    return Maybe<void>::Ok();
+  }
+
+  // Recursive doubling: in step k every rank exchanges its whole buffer with the rank 2^k away
+  // and reduces. With a parallel_num that is not a power of two, the first 2 * remain ranks are
+  // folded in pairs before and get the result from their pair after. The operands of each
+  // reduction are the same on both partners, so all ranks end up with identical results.
+  static Maybe<void> RecursiveDoubling(const T* in, T* out, size_t elem_cnt,
+                                       Symbol<ParallelDesc> parallel_desc, int64_t parallel_id) {
+    if (in != out) { std::memcpy(out, in, elem_cnt * sizeof(T)); }
+    if (elem_cnt == 0) { return Maybe<void>::Ok(); }
+    const int64_t parallel_num = parallel_desc->parallel_num();
+    int64_t pow2_num = 1;
+    while (pow2_num * 2 <= parallel_num) { pow2_num *= 2; }
+    const int64_t remain = parallel_num - pow2_num;
+    const size_t size = elem_cnt * sizeof(T);
+    auto recv_buffer = std::make_unique<T[]>(elem_cnt);
+    TransportToken transport_token =
+        JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+    const auto& SendTo = [&](int64_t peer_parallel_id) -> Maybe<NaiveAsyncTransportCtx> {
+      auto ctx = NewMessageCtx(transport_token, out, size);
+      const int64_t rank = JUST(parallel_desc->MachineId4ParallelId(peer_parallel_id));
+      JUST(TransportUtil::SendDataToRank(rank, transport_token, ctx.get()));
+      return ctx;
+    };
+    const auto& RecvFrom = [&](int64_t peer_parallel_id,
+                               T* ptr) -> Maybe<NaiveAsyncTransportCtx> {
+      auto ctx = NewMessageCtx(transport_token, ptr, size);
+      const int64_t rank = JUST(parallel_desc->MachineId4ParallelId(peer_parallel_id));
+      JUST(TransportUtil::ReceiveDataFromRank(rank, transport_token, ctx.get()));
+      return ctx;
+    };
+
+    const bool is_folded = parallel_id < 2 * remain;
+    if (is_folded && parallel_id % 2 == 0) {
+      JUST(JUST(SendTo(parallel_id + 1))->WaitDone());
+      JUST(JUST(RecvFrom(parallel_id + 1, out))->WaitDone());
+      return Maybe<void>::Ok();
+    }
+    if (is_folded) {
+      JUST(JUST(RecvFrom(parallel_id - 1, recv_buffer.get()))->WaitDone());
+      ReduceFunctor<T, reduce_type>::Call(elem_cnt, out, recv_buffer.get(), out);
+    }
+    const int64_t new_id = is_folded ? parallel_id / 2 : parallel_id - remain;
+    for (int64_t mask = 1; mask < pow2_num; mask *= 2) {
+      const int64_t peer_new_id = new_id ^ mask;
+      const int64_t peer_parallel_id =
+          peer_new_id < remain ? peer_new_id * 2 + 1 : peer_new_id + remain;
+      auto recv_ctx = JUST(RecvFrom(peer_parallel_id, recv_buffer.get()));
+      auto send_ctx = JUST(SendTo(peer_parallel_id));
+      JUST(recv_ctx->WaitDone());
+      // out is reduced into only once the peer has all of it.
+      JUST(send_ctx->WaitDone());
+      ReduceFunctor<T, reduce_type>::Call(elem_cnt, out, out, recv_buffer.get());
+    }
+    if (is_folded) { JUST(JUST(SendTo(parallel_id - 1))->WaitDone()); }
     return Maybe<void>::Ok();
   }
 };
@@ -0,0 +1,117 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/framework/transport_util.h"
+#include "oneflow/user/kernels/collective_communication/cpu/cpu_communication_context.h"
+#include "oneflow/user/kernels/collective_communication/include/all_to_all.h"
+
+namespace oneflow {
+
+namespace ccl {
+
+namespace {
+
+std::shared_ptr<NaiveAsyncTransportCtx> NewMessageCtx(const TransportToken& transport_token,
+                                                      const void* ptr, size_t size) {
+  const auto& Prepare = [ptr, size](void** buffer, std::size_t* buffer_size,
+                                    std::function<void()>* Cb) -> Maybe<void> {
+    *buffer = const_cast<void*>(ptr);
+    *buffer_size = size;
+    *Cb = [] {};
+    return Maybe<void>::Ok();
+  };
+  return std::make_shared<NaiveAsyncTransportCtx>(transport_token, Prepare, Prepare);
+}
+
+// All messages are posted before any is waited for. At step i a rank sends to the rank i after it
+// and receives from the rank i before it, so the ranks do not all start on the same peer. Empty
+// messages are skipped on both ends, the counts of a pair agree.
+Maybe<void> AllToAllImpl(const void* in, const std::vector<int64_t>& send_offsets,
+                         const std::vector<int64_t>& send_elem_cnt, void* out,
+                         const std::vector<int64_t>& recv_offsets,
+                         const std::vector<int64_t>& recv_elem_cnt, size_t size_of_dtype,
+                         Symbol<ParallelDesc> parallel_desc) {
+  const int64_t parallel_num = parallel_desc->parallel_num();
+  CHECK_EQ_OR_RETURN(send_offsets.size(), parallel_num);
+  CHECK_EQ_OR_RETURN(send_elem_cnt.size(), parallel_num);
+  CHECK_EQ_OR_RETURN(recv_offsets.size(), parallel_num);
+  CHECK_EQ_OR_RETURN(recv_elem_cnt.size(), parallel_num);
+  const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
+  CHECK_OR_RETURN(opt_parallel_id->has_value()) << kOfBugIssueUploadPrompt;
+  const int64_t parallel_id = JUST(*opt_parallel_id);
+  const char* char_in = reinterpret_cast<const char*>(in);
+  char* char_out = reinterpret_cast<char*>(out);
+  TransportToken transport_token = JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  std::vector<std::shared_ptr<NaiveAsyncTransportCtx>> ctxs;
+  for (int64_t i = 1; i < parallel_num; ++i) {
+    const int64_t dst = (parallel_id + i) % parallel_num;
+    const int64_t src = (parallel_id - i + parallel_num) % parallel_num;
+    if (send_elem_cnt.at(dst) > 0) {
+      ctxs.emplace_back(NewMessageCtx(transport_token,
+                                      char_in + send_offsets.at(dst) * size_of_dtype,
+                                      send_elem_cnt.at(dst) * size_of_dtype));
+      const int64_t rank = JUST(parallel_desc->MachineId4ParallelId(dst));
+      JUST(TransportUtil::SendDataToRank(rank, transport_token, ctxs.back().get()));
+    }
+    if (recv_elem_cnt.at(src) > 0) {
+      ctxs.emplace_back(NewMessageCtx(transport_token,
+                                      char_out + recv_offsets.at(src) * size_of_dtype,
+                                      recv_elem_cnt.at(src) * size_of_dtype));
+      const int64_t rank = JUST(parallel_desc->MachineId4ParallelId(src));
+      JUST(TransportUtil::ReceiveDataFromRank(rank, transport_token, ctxs.back().get()));
+    }
+  }
+  CHECK_EQ_OR_RETURN(send_elem_cnt.at(parallel_id), recv_elem_cnt.at(parallel_id));
+  std::memcpy(char_out + recv_offsets.at(parallel_id) * size_of_dtype,
+              char_in + send_offsets.at(parallel_id) * size_of_dtype,
+              send_elem_cnt.at(parallel_id) * size_of_dtype);
+  for (const auto& ctx : ctxs) { JUST(ctx->WaitDone()); }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+class CpuAllToAll final : public AllToAll {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuAllToAll);
+  CpuAllToAll() : size_of_dtype_(0) {}
+  ~CpuAllToAll() = default;
+
+  void Init(DataType datatype) override {
+    CHECK(IsTriviallyCopyableDataType(datatype));
+    this->size_of_dtype_ = GetSizeOfDataType(datatype);
+  }
+
+  void Launch(ep::Stream* stream, const void* in, const std::vector<int64_t>& send_offsets,
+              const std::vector<int64_t>& send_elem_cnt, void* out,
+              const std::vector<int64_t>& recv_offsets, const std::vector<int64_t>& recv_elem_cnt,
+              const std::shared_ptr<CommunicationContext>& communication_ctx) const override {
+    const auto& cpu_communication_ctx =
+        std::dynamic_pointer_cast<CpuCommunicationContext>(communication_ctx);
+    CHECK(cpu_communication_ctx) << kOfBugIssueUploadPrompt;
+    CHECK_JUST(AllToAllImpl(in, send_offsets, send_elem_cnt, out, recv_offsets, recv_elem_cnt,
+                            size_of_dtype_, cpu_communication_ctx->parallel_desc()));
+  }
+
+ private:
+  size_t size_of_dtype_;
+};
+
+REGISTER_COLLECTIVE_COMMUNICATION(DeviceType::kCPU, AllToAll, CpuAllToAll);
+
+}  // namespace ccl
+
+}  // namespace oneflow
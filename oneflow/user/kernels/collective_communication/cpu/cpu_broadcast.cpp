@@ -19,11 +19,54 @@ limitations under the License.
 #include "oneflow/core/framework/transport_util.h"
 #include "oneflow/user/kernels/collective_communication/cpu/cpu_communication_context.h"
 #include "oneflow/user/kernels/collective_communication/include/broadcast.h"
+#include "oneflow/user/kernels/collective_communication/cpu/cpu_shm_group.h"
 
 namespace oneflow {
 
 namespace ccl {
 
+namespace {
+
+// The root copies a piece of its input into its shared memory buffer, the others copy it out.
+Maybe<void> ShmBroadcast(const void* in, void* out, size_t buffer_size, int64_t root,
+                         CpuShmGroup* shm_group) {
+  std::unique_lock<std::mutex> lock(*shm_group->mut_mutex());
+  const auto& local_ranks = shm_group->local_ranks();
+  const int64_t root_id =
+      std::find(local_ranks.begin(), local_ranks.end(), root) - local_ranks.begin();
+  CHECK_LT_OR_RETURN(root_id, local_ranks.size()) << kOfBugIssueUploadPrompt;
+  const bool is_root = shm_group->local_id() == root_id;
+  for (size_t offset = 0; offset < buffer_size; offset += shm_group->buffer_size()) {
+    const size_t size = std::min(shm_group->buffer_size(), buffer_size - offset);
+    if (is_root) {
+      std::memcpy(shm_group->mut_buffer(root_id), reinterpret_cast<const char*>(in) + offset,
+                  size);
+    }
+    shm_group->Barrier();
+    if (!is_root) {
+      std::memcpy(reinterpret_cast<char*>(out) + offset, shm_group->mut_buffer(root_id), size);
+    }
+    shm_group->Barrier();
+  }
+  if (is_root && in != out) { std::memcpy(out, in, buffer_size); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> BroadcastImpl(const void* in, void* out, size_t buffer_size, int64_t root,
+                          Symbol<ParallelDesc> parallel_desc) {
+  if (CpuShmGroup::IsEnabled(parallel_desc)) {
+    const auto& shm_group = JUST(CpuShmGroup::Get(parallel_desc));
+    if (shm_group->is_intra_node()) {
+      return ShmBroadcast(in, out, buffer_size, root, shm_group.get());
+    }
+  }
+  const auto& transport_token =
+      JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  return CpuBroadcast(in, out, buffer_size, root, parallel_desc, transport_token);
+}
+
+}  // namespace
+
 // Use CpuBroadcastImpl to avoid name conflict
 class CpuBroadcastImpl final : public Broadcast {
  public:
@@ -42,10 +85,8 @@ class CpuBroadcastImpl final : public Broadcast {
         std::dynamic_pointer_cast<CpuCommunicationContext>(communication_ctx);
     CHECK(cpu_communication_ctx);
     size_t buffer_size = elem_cnt * size_of_dtype_;
-    const auto& transport_token =
-        CHECK_JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
-    CHECK_JUST(CpuBroadcast(in, out, buffer_size, root, cpu_communication_ctx->parallel_desc(),
-                            transport_token));
+    CHECK_JUST(
+        BroadcastImpl(in, out, buffer_size, root, cpu_communication_ctx->parallel_desc()));
   }
 
  private:
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/user/kernels/collective_communication/cpu/cpu_communication_context.h"
 #include "oneflow/user/kernels/collective_communication/include/reduce_scatter.h"
 #include "oneflow/user/kernels/collective_communication/cpu/cpu_collective_communication_util.h"
+#include "oneflow/user/kernels/collective_communication/cpu/cpu_shm_group.h"
 
 namespace oneflow {
 
@@ -38,6 +39,12 @@ struct ReduceScatterImpl final {
 
     const T* in = reinterpret_cast<const T*>(void_in);
     T* out = reinterpret_cast<T*>(void_out);
+    if (CpuShmGroup::IsEnabled(parallel_desc)) {
+      const auto& shm_group = JUST(CpuShmGroup::Get(parallel_desc));
+      if (shm_group->is_intra_node()) {
+        return ShmReduceScatter(in, out, elem_cnt, shm_group.get());
+      }
+    }
 
     BalancedSplitter bs(elem_cnt * parallel_num, parallel_num);
     const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
@@ -88,6 +95,35 @@ struct ReduceScatterImpl final {
     }
     return Maybe<void>::Ok();
   }
+
+ private:
+  // Each rank copies a piece of every part of its input into its shared memory buffer, then
+  // reduces the pieces of its own part over all buffers into the output.
+  static Maybe<void> ShmReduceScatter(const T* in, T* out, size_t elem_cnt,
+                                      CpuShmGroup* shm_group) {
+    std::unique_lock<std::mutex> lock(*shm_group->mut_mutex());
+    const int64_t local_size = shm_group->local_size();
+    const size_t piece_elem_cnt = shm_group->buffer_size() / sizeof(T) / local_size;
+    CHECK_GT_OR_RETURN(piece_elem_cnt, 0) << "ONEFLOW_CCL_CPU_SHM_BUFFER_BYTES is too small";
+    const auto& Buffer = [&](int64_t i) { return reinterpret_cast<T*>(shm_group->mut_buffer(i)); };
+    for (size_t offset = 0; offset < elem_cnt; offset += piece_elem_cnt) {
+      const size_t size = std::min(piece_elem_cnt, elem_cnt - offset);
+      for (int64_t i = 0; i < local_size; ++i) {
+        std::memcpy(Buffer(shm_group->local_id()) + i * size, in + i * elem_cnt + offset,
+                    size * sizeof(T));
+      }
+      shm_group->Barrier();
+      const size_t part_offset = shm_group->local_id() * size;
+      ReduceFunctor<T, reduce_type>::Call(size, out + offset, Buffer(0) + part_offset,
+                                          Buffer(1) + part_offset);
+      for (int64_t i = 2; i < local_size; ++i) {
+        ReduceFunctor<T, reduce_type>::Call(size, out + offset, out + offset,
+                                            Buffer(i) + part_offset);
+      }
+      shm_group->Barrier();
+    }
+    return Maybe<void>::Ok();
+  }
 };
 
 #define MAKE_ALL_REDUCE_ENTRY(func_name, T, reduce_type) func_name<T, reduce_type>::Call
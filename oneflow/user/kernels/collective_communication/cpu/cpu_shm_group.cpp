@@ -0,0 +1,187 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "oneflow/user/kernels/collective_communication/cpu/cpu_shm_group.h"
+#include "oneflow/core/common/env_var/ccl.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/parallel_desc.h"
+
+namespace oneflow {
+
+namespace ccl {
+
+// Lives at the start of the shared memory, followed by the buffers of the ranks.
+struct CpuShmGroupHeader {
+  std::atomic<int64_t> num_arrived;
+  std::atomic<int64_t> generation;
+};
+
+namespace {
+
+constexpr size_t kHeaderSize = 4096;
+constexpr size_t kBufferAlignSize = 4096;
+// Iterations a rank spins in a barrier before it starts yielding the CPU.
+constexpr int64_t kBarrierSpinCount = 4096;
+
+// Process ranks of `parallel_desc` on this host.
+std::vector<int64_t> GetLocalRanks(const ParallelDesc& parallel_desc) {
+  std::vector<int64_t> local_ranks;
+  for (int64_t rank : parallel_desc.sorted_machine_ids()) {
+    if (GlobalProcessCtx::NodeId(rank) == GlobalProcessCtx::ThisNodeId()) {
+      local_ranks.emplace_back(rank);
+    }
+  }
+  return local_ranks;
+}
+
+// The first rank of `parallel_desc` on each host, if there are several hosts.
+Maybe<Symbol<ParallelDesc>> GetInterNodeParallelDesc(const ParallelDesc& parallel_desc) {
+  ParallelConf parallel_conf;
+  parallel_conf.set_device_tag(parallel_desc.device_tag());
+  std::set<int64_t> node_ids;
+  for (int64_t rank : parallel_desc.sorted_machine_ids()) {
+    if (!node_ids.emplace(GlobalProcessCtx::NodeId(rank)).second) { continue; }
+    const auto& device_ids = parallel_desc.sorted_dev_phy_ids(rank);
+    CHECK_EQ_OR_RETURN(device_ids.size(), 1) << kOfBugIssueUploadPrompt;
+    parallel_conf.add_device_name(std::string("@") + std::to_string(rank) + ":"
+                                  + std::to_string(device_ids.front()));
+  }
+  if (node_ids.size() == 1) { return Symbol<ParallelDesc>(); }
+  return SymbolOf(ParallelDesc(parallel_conf));
+}
+
+std::string GetCtrlKey(const ParallelDesc& parallel_desc) {
+  std::ostringstream oss;
+  oss << "cpu_shm_group_key";
+  for (int64_t rank : parallel_desc.sorted_machine_ids()) { oss << "," << rank; }
+  oss << ",node" << GlobalProcessCtx::ThisNodeId();
+  return oss.str();
+}
+
+}  // namespace
+
+/*static*/ bool CpuShmGroup::IsEnabled(Symbol<ParallelDesc> parallel_desc) {
+  if (!ThreadLocalEnvBool<ONEFLOW_CCL_CPU_ENABLE_SHM>()) { return false; }
+  if (parallel_desc->parallel_num() != parallel_desc->sorted_machine_ids().size()) {
+    return false;
+  }
+  if (!parallel_desc->HasMachineId(GlobalProcessCtx::Rank())) { return false; }
+  return GetLocalRanks(*parallel_desc).size() > 1;
+}
+
+/*static*/ Maybe<CpuShmGroup> CpuShmGroup::Get(Symbol<ParallelDesc> parallel_desc) {
+  thread_local HashMap<Symbol<ParallelDesc>, std::shared_ptr<CpuShmGroup>> parallel_desc2group;
+  auto iter = parallel_desc2group.find(parallel_desc);
+  if (iter != parallel_desc2group.end()) { return iter->second; }
+  CHECK_OR_RETURN(IsEnabled(parallel_desc)) << kOfBugIssueUploadPrompt;
+  // Placements of the same ranks share a group, whatever thread they are used on.
+  struct GroupSlot {
+    std::mutex mutex;
+    std::shared_ptr<CpuShmGroup> group;
+  };
+  static std::mutex mutex;
+  static HashMap<std::string, std::shared_ptr<GroupSlot>> key2slot;
+  const std::string key = GetCtrlKey(*parallel_desc);
+  std::shared_ptr<GroupSlot> slot;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::shared_ptr<GroupSlot>& slot_in_map = key2slot[key];
+    if (!slot_in_map) { slot_in_map = std::make_shared<GroupSlot>(); }
+    slot = slot_in_map;
+  }
+  // Attaching waits for the other ranks, so only the threads that get the same group wait here,
+  // the setup of other groups may be what those ranks are busy with.
+  std::unique_lock<std::mutex> slot_lock(slot->mutex);
+  std::shared_ptr<CpuShmGroup>& group = slot->group;
+  if (!group) {
+    const auto& local_ranks = GetLocalRanks(*parallel_desc);
+    const int64_t local_id =
+        std::find(local_ranks.begin(), local_ranks.end(), GlobalProcessCtx::Rank())
+        - local_ranks.begin();
+    const size_t buffer_size =
+        RoundUp(ThreadLocalEnvInteger<ONEFLOW_CCL_CPU_SHM_BUFFER_BYTES>(), kBufferAlignSize);
+    std::shared_ptr<CpuShmGroup> new_group(new CpuShmGroup(
+        local_ranks, local_id, buffer_size, JUST(GetInterNodeParallelDesc(*parallel_desc))));
+    JUST(new_group->Attach(key));
+    group = new_group;
+  }
+  parallel_desc2group.emplace(parallel_desc, group);
+  return group;
+}
+
+CpuShmGroup::CpuShmGroup(const std::vector<int64_t>& local_ranks, int64_t local_id,
+                         size_t buffer_size, Symbol<ParallelDesc> inter_node_parallel_desc)
+    : local_ranks_(local_ranks),
+      local_id_(local_id),
+      buffer_size_(buffer_size),
+      inter_node_parallel_desc_(inter_node_parallel_desc),
+      header_(nullptr) {}
+
+Maybe<void> CpuShmGroup::Attach(const std::string& key) {
+  const size_t shm_size = kHeaderSize + local_size() * buffer_size_;
+  if (is_leader()) {
+    auto shared_memory = ipc::SharedMemory::Open(shm_size, /*create=*/true);
+    if (shared_memory.IsOk()) {
+      // Set up before the name is published, the other ranks arrive at the first barrier as soon
+      // as they have mapped the segment.
+      header_ = new (JUST(shared_memory)->mut_buf()) CpuShmGroupHeader();
+      header_->num_arrived.store(0);
+      header_->generation.store(0);
+    }
+    // The other ranks wait for a name, an empty one tells them the setup failed.
+    Singleton<CtrlClient>::Get()->PushKV(key, shared_memory.IsOk() ? JUST(shared_memory)->name()
+                                                                   : std::string());
+    shared_memory_ = JUST_MSG(shared_memory, "set ONEFLOW_CCL_CPU_ENABLE_SHM=0 to do CPU "
+                                             "collectives without shared memory");
+  } else {
+    std::string shm_name;
+    Singleton<CtrlClient>::Get()->PullKV(key, &shm_name);
+    CHECK_OR_RETURN(!shm_name.empty())
+        << "rank " << local_ranks_.front() << " failed to create shared memory for CPU "
+        << "collectives, set ONEFLOW_CCL_CPU_ENABLE_SHM=0 to do them without shared memory";
+    shared_memory_ = JUST(ipc::SharedMemory::Open(shm_name, /*create=*/false));
+    CHECK_EQ_OR_RETURN(shared_memory_->size(), shm_size)
+        << "ONEFLOW_CCL_CPU_SHM_BUFFER_BYTES differs between ranks";
+    header_ = reinterpret_cast<CpuShmGroupHeader*>(shared_memory_->mut_buf());
+  }
+  // Once all ranks have mapped it, nobody opens it by name anymore.
+  Barrier();
+  if (is_leader()) { JUST(shared_memory_->Unlink()); }
+  return Maybe<void>::Ok();
+}
+
+char* CpuShmGroup::mut_buffer(int64_t local_id) {
+  CHECK_GE(local_id, 0);
+  CHECK_LT(local_id, local_size());
+  return shared_memory_->mut_buf() + kHeaderSize + local_id * buffer_size_;
+}
+
+void CpuShmGroup::Barrier() {
+  const int64_t generation = header_->generation.load(std::memory_order_acquire);
+  if (header_->num_arrived.fetch_add(1, std::memory_order_acq_rel) == local_size() - 1) {
+    header_->num_arrived.store(0, std::memory_order_relaxed);
+    header_->generation.store(generation + 1, std::memory_order_release);
+    return;
+  }
+  for (int64_t i = 0; header_->generation.load(std::memory_order_acquire) == generation; ++i) {
+    if (i >= kBarrierSpinCount) { std::this_thread::yield(); }
+  }
+}
+
+}  // namespace ccl
+
+}  // namespace oneflow
@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_COLLECTIVE_COMMUNICATION_CPU_CPU_SHM_GROUP_H_
+#define ONEFLOW_USER_KERNELS_COLLECTIVE_COMMUNICATION_CPU_CPU_SHM_GROUP_H_
+
+#include <mutex>
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/symbol.h"
+#include "oneflow/core/ipc/shared_memory.h"
+
+namespace oneflow {
+
+class ParallelDesc;
+
+namespace ccl {
+
+struct CpuShmGroupHeader;
+
+// The ranks of a placement that run on this host, attached to one shared memory segment with a
+// buffer per rank. CPU collectives copy through these buffers instead of sending loopback
+// messages through the transport, and only go through the transport between hosts.
+//
+// Like the transport, a group relies on all its ranks issuing the collectives of a placement in
+// the same order. Collectives of the same group in one process are serialized by mutex().
+class CpuShmGroup final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuShmGroup);
+  ~CpuShmGroup() = default;
+
+  // Whether the collectives of `parallel_desc` can use a group: each rank has a single device,
+  // this process is one of them, and some other rank runs on this host.
+  static bool IsEnabled(Symbol<ParallelDesc> parallel_desc);
+  // The group of `parallel_desc` on this host. The first call is collective over the ranks of
+  // the group, they set up the shared memory together.
+  static Maybe<CpuShmGroup> Get(Symbol<ParallelDesc> parallel_desc);
+
+  int64_t local_size() const { return local_ranks_.size(); }
+  // Index of this rank in local_ranks().
+  int64_t local_id() const { return local_id_; }
+  // Process ranks of the group in ascending order, the first one leads the group.
+  const std::vector<int64_t>& local_ranks() const { return local_ranks_; }
+  bool is_leader() const { return local_id_ == 0; }
+  // Whether all ranks of the placement are in the group.
+  bool is_intra_node() const { return !inter_node_parallel_desc_; }
+  // The leaders of the groups of all hosts, to reduce between hosts. Only set if the placement
+  // spans several hosts.
+  Symbol<ParallelDesc> inter_node_parallel_desc() const { return inter_node_parallel_desc_; }
+
+  size_t buffer_size() const { return buffer_size_; }
+  char* mut_buffer(int64_t local_id);
+  std::mutex* mut_mutex() { return &mutex_; }
+
+  // Waits for all ranks of the group, and makes their writes to the buffers visible.
+  void Barrier();
+
+ private:
+  CpuShmGroup(const std::vector<int64_t>& local_ranks, int64_t local_id, size_t buffer_size,
+              Symbol<ParallelDesc> inter_node_parallel_desc);
+  Maybe<void> Attach(const std::string& key);
+
+  const std::vector<int64_t> local_ranks_;
+  const int64_t local_id_;
+  const size_t buffer_size_;
+  const Symbol<ParallelDesc> inter_node_parallel_desc_;
+  std::shared_ptr<ipc::SharedMemory> shared_memory_;
+  CpuShmGroupHeader* header_;
+  std::mutex mutex_;
+};
+
+}  // namespace ccl
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_COLLECTIVE_COMMUNICATION_CPU_CPU_SHM_GROUP_H_
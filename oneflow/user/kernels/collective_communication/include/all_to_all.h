@@ -0,0 +1,51 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_COLLECTIVE_COMMUNICATION_INCLUDE_ALL_TO_ALL_H_
+#define ONEFLOW_USER_KERNELS_COLLECTIVE_COMMUNICATION_INCLUDE_ALL_TO_ALL_H_
+
+#include "oneflow/user/kernels/collective_communication/include/collective_communication.h"
+
+namespace oneflow {
+
+namespace ccl {
+
+// Each rank sends send_elem_cnt[i] elements at send_offsets[i] of in to the i-th rank of the
+// communicator, and receives recv_elem_cnt[i] elements from it into recv_offsets[i] of out. The
+// counts of a pair of ranks must agree on both ends.
+class AllToAll : public CollectiveCommunication {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AllToAll);
+  AllToAll() = default;
+  ~AllToAll() override = default;
+
+  virtual void Init(DataType dtype) = 0;
+
+  virtual void Launch(ep::Stream* stream, const void* in, const std::vector<int64_t>& send_offsets,
+                      const std::vector<int64_t>& send_elem_cnt, void* out,
+                      const std::vector<int64_t>& recv_offsets,
+                      const std::vector<int64_t>& recv_elem_cnt,
+                      const std::shared_ptr<CommunicationContext>& communicator) const = 0;
+};
+
+inline bool IsAllToAllRegistered(DeviceType device_type) {
+  return IsClassRegistered<DeviceType, AllToAll>(device_type);
+}
+
+}  // namespace ccl
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_COLLECTIVE_COMMUNICATION_INCLUDE_ALL_TO_ALL_H_
@@ -0,0 +1,268 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/one_embedding_data_shuffle.h"
+
+namespace oneflow {
+
+namespace {
+
+// The cuda kernels pass num_unique_matrix between the ops through the EmbeddingState, here it is
+// read from the host tensors directly.
+class CpuDataShuffleKernelState final : public user_op::OpKernelState {
+ public:
+  explicit CpuDataShuffleKernelState(user_op::KernelInitContext* ctx) {
+    communication_ctx_ =
+        ccl::NewCommunicationContext(DeviceType::kCPU, SymbolOf(ctx->parallel_desc()));
+  }
+  ~CpuDataShuffleKernelState() override = default;
+
+  const std::shared_ptr<ccl::CommunicationContext>& communication_ctx() const {
+    return communication_ctx_;
+  }
+
+ private:
+  std::shared_ptr<ccl::CommunicationContext> communication_ctx_;
+};
+
+void CheckCpuQuantizedCommDisabled() {
+  CHECK(!ParseBooleanFromEnv("ONEFLOW_ONE_EMBEDDING_ENABLE_QUANTIZED_COMM", false))
+      << "quantized communication of one_embedding is not supported on cpu";
+}
+
+}  // namespace
+
+template<typename K, typename U, typename IDX>
+class CpuIdShuffleKernel final : public user_op::OpKernel {
+ public:
+  CpuIdShuffleKernel() = default;
+  ~CpuIdShuffleKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuDataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuDataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    const user_op::Tensor* ids = ctx->Tensor4ArgNameAndIndex("ids", 0);
+    user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_num_unique = ctx->Tensor4ArgNameAndIndex("cur_rank_num_unique", 0);
+    user_op::Tensor* cur_rank_unique_ids = ctx->Tensor4ArgNameAndIndex("cur_rank_unique_ids", 0);
+    user_op::Tensor* cur_rank_unique_table_ids =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_table_ids", 0);
+    user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    const int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+    const bool has_padding_idx = ctx->Attr<bool>("has_padding_idx");
+    const bool has_table_ids = ctx->has_input("table_ids", 0);
+    const bool need_process_table_ids = (has_table_ids || num_tables > 1);
+    const int64_t num_ids = ids->shape_view().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+
+    std::vector<U> generated_table_ids;
+    data_shuffle::CpuIdShuffleDataPtrs<K, U, IDX> data_ptrs;
+    data_ptrs.ids_ptr = ids->dptr<K>();
+    if (has_table_ids) {
+      data_ptrs.table_ids_ptr = ctx->Tensor4ArgNameAndIndex("table_ids", 0)->dptr<U>();
+    } else if (need_process_table_ids) {
+      generated_table_ids.resize(num_ids);
+      for (int64_t i = 0; i < num_ids; ++i) {
+        generated_table_ids[i] = static_cast<U>(i % num_tables);
+      }
+      data_ptrs.table_ids_ptr = generated_table_ids.data();
+    } else {
+      data_ptrs.table_ids_ptr = nullptr;
+    }
+    data_ptrs.num_unique_matrix_ptr = num_unique_matrix->mut_dptr<IDX>();
+    data_ptrs.inverse_unique_partition_indices_ptr =
+        inverse_unique_partition_indices->mut_dptr<IDX>();
+    data_ptrs.cur_rank_unique_ids_ptr = cur_rank_unique_ids->mut_dptr<K>();
+    data_ptrs.cur_rank_unique_table_ids_ptr = cur_rank_unique_table_ids->mut_dptr<U>();
+    data_ptrs.cur_rank_inverse_indices_ptr = cur_rank_inverse_indices->mut_dptr<IDX>();
+
+    const uint32_t num_unique = data_shuffle::CpuIdShuffle<K, U, IDX>(
+        ctx->stream(), kernel_state->communication_ctx(), data_ptrs, num_ids, parallel_id,
+        parallel_num, num_unique_matrix->data_type(), ids->data_type(),
+        cur_rank_unique_table_ids->data_type(), need_process_table_ids, has_padding_idx,
+        padding_idx);
+    *cur_rank_num_unique->mut_dptr<IDX>() = static_cast<IDX>(num_unique);
+    // The rows past num_unique are not used, zero them so that ops gathering by the whole buffer,
+    // which check the indices on cpu, do not read garbage.
+    const int64_t cur_rank_unique_ids_cnt = cur_rank_unique_ids->shape_view().elem_cnt();
+    std::memset(data_ptrs.cur_rank_unique_ids_ptr + num_unique, 0,
+                (cur_rank_unique_ids_cnt - num_unique) * sizeof(K));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define CPU_DATA_SHUFFLE_ID_DATA_TYPE_SEQ           \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define CPU_DATA_SHUFFLE_TABLE_ID_DATA_TYPE_SEQ     \
+  OF_PP_MAKE_TUPLE_SEQ(uint8_t, DataType::kUInt8)   \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int8_t, DataType::kInt8)     \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define CPU_DATA_SHUFFLE_IDX_DATA_TYPE_SEQ          \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_ID_SHUFFLE_KERNEL(k_dtype_pair, table_id_dtype_pair, idx_dtype_pair)      \
+  REGISTER_USER_KERNEL("id_shuffle")                                                           \
+      .SetCreateFn<CpuIdShuffleKernel<OF_PP_PAIR_FIRST(k_dtype_pair),                          \
+                                      OF_PP_PAIR_FIRST(table_id_dtype_pair),                   \
+                                      OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                     \
+      .SetIsMatchedHob(                                                                        \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                       \
+          && (user_op::HobDataType("ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))               \
+          && (user_op::HobDataType("cur_rank_unique_table_ids", 0)                             \
+              == OF_PP_PAIR_SECOND(table_id_dtype_pair))                                       \
+          && (user_op::HobDataType("num_unique_matrix", 0)                                     \
+              == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ID_SHUFFLE_KERNEL, CPU_DATA_SHUFFLE_ID_DATA_TYPE_SEQ,
+                                 CPU_DATA_SHUFFLE_TABLE_ID_DATA_TYPE_SEQ,
+                                 CPU_DATA_SHUFFLE_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class CpuEmbeddingShuffleKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingShuffleKernel() = default;
+  ~CpuEmbeddingShuffleKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuDataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuDataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    CheckCpuQuantizedCommDisabled();
+    const user_op::Tensor* cur_rank_embeddings =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_embeddings", 0);
+    const user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const int64_t num_ids = inverse_unique_partition_indices->shape_view().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    CHECK_EQ(num_unique_matrix->shape_view().elem_cnt(), parallel_num * parallel_num);
+    data_shuffle::CpuShuffleEmbeddings<T, IDX>(
+        ctx->stream(), kernel_state->communication_ctx(), parallel_id, parallel_num, num_ids,
+        embedding_size, embeddings->data_type(), num_unique_matrix->dptr<IDX>(),
+        cur_rank_embeddings->shape_view().elem_cnt() / embedding_size,
+        cur_rank_embeddings->dptr<T>(), cur_rank_inverse_indices->dptr<IDX>(),
+        inverse_unique_partition_indices->dptr<IDX>(), embeddings->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)                      \
+  REGISTER_USER_KERNEL("embedding_shuffle")                                                      \
+      .SetCreateFn<CpuEmbeddingShuffleKernel<OF_PP_PAIR_FIRST(t_dtype_pair),                     \
+                                             OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                \
+      .SetIsMatchedHob(                                                                          \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                         \
+          && (user_op::HobDataType("cur_rank_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair)) \
+          && (user_op::HobAttr<bool>("skip_last_gather") == false)                               \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_DATA_SHUFFLE_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class CpuEmbeddingGradientShuffleKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingGradientShuffleKernel() = default;
+  ~CpuEmbeddingGradientShuffleKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuDataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuDataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    CheckCpuQuantizedCommDisabled();
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    const user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_unique_embedding_grad =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_embedding_grad", 0);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const int64_t num_ids = inverse_unique_partition_indices->shape_view().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    CHECK_EQ(num_unique_matrix->shape_view().elem_cnt(), parallel_num * parallel_num);
+    // The number of unique ids is not known here, so the whole output is zeroed whether
+    // only_zero_valid_grad is set or not.
+    const int64_t out_elem_cnt = cur_rank_unique_embedding_grad->shape_view().elem_cnt();
+    std::memset(cur_rank_unique_embedding_grad->mut_dptr(), 0, out_elem_cnt * sizeof(T));
+    data_shuffle::CpuShuffleEmbeddingsGrad<T, IDX>(
+        ctx->stream(), kernel_state->communication_ctx(), parallel_id, parallel_num, num_ids,
+        embedding_size, embedding_grad->data_type(), num_unique_matrix->dptr<IDX>(),
+        embedding_grad->dptr<T>(), inverse_unique_partition_indices->dptr<IDX>(),
+        cur_rank_inverse_indices->dptr<IDX>(), out_elem_cnt / embedding_size,
+        cur_rank_unique_embedding_grad->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)             \
+  REGISTER_USER_KERNEL("embedding_gradient_shuffle")                                             \
+      .SetCreateFn<CpuEmbeddingGradientShuffleKernel<OF_PP_PAIR_FIRST(t_dtype_pair),             \
+                                                     OF_PP_PAIR_FIRST(idx_dtype_pair)>>()        \
+      .SetIsMatchedHob(                                                                          \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                         \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))      \
+          && (user_op::HobAttr<bool>("skip_first_scatter") == false)                             \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, CPU_DATA_SHUFFLE_IDX_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
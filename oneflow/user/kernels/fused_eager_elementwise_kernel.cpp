@@ -0,0 +1,206 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cstring>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/fused_eager_elementwise_kernel.h"
+
+namespace oneflow {
+
+namespace {
+
+// Elements of each value computed at a time, so that the steps of a program read the values made
+// by the previous steps from cache.
+constexpr int64_t kBlockSize = 1024;
+
+template<typename T>
+void RunStep(FusedEagerElementwiseOpcode opcode, const T* x, const T* y, T scalar, T* z,
+             int64_t n) {
+  const T zero = static_cast<T>(0);
+  const T one = static_cast<T>(1);
+  switch (opcode) {
+    case FusedEagerElementwiseOpcode::kRelu:
+      // Same as the relu primitive, NaN is kept.
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] <= zero ? zero : x[i]; }
+      break;
+    case FusedEagerElementwiseOpcode::kSigmoid:
+      for (int64_t i = 0; i < n; ++i) { z[i] = one / (one + std::exp(-x[i])); }
+      break;
+    case FusedEagerElementwiseOpcode::kTanh:
+      for (int64_t i = 0; i < n; ++i) { z[i] = std::tanh(x[i]); }
+      break;
+    case FusedEagerElementwiseOpcode::kExp:
+      for (int64_t i = 0; i < n; ++i) { z[i] = std::exp(x[i]); }
+      break;
+    case FusedEagerElementwiseOpcode::kNegative:
+      for (int64_t i = 0; i < n; ++i) { z[i] = -x[i]; }
+      break;
+    case FusedEagerElementwiseOpcode::kAbs:
+      for (int64_t i = 0; i < n; ++i) { z[i] = std::abs(x[i]); }
+      break;
+    case FusedEagerElementwiseOpcode::kSqrt:
+      for (int64_t i = 0; i < n; ++i) { z[i] = std::sqrt(x[i]); }
+      break;
+    case FusedEagerElementwiseOpcode::kRsqrt:
+      for (int64_t i = 0; i < n; ++i) { z[i] = one / std::sqrt(x[i]); }
+      break;
+    case FusedEagerElementwiseOpcode::kSquare:
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] * x[i]; }
+      break;
+    case FusedEagerElementwiseOpcode::kReciprocal:
+      for (int64_t i = 0; i < n; ++i) { z[i] = one / x[i]; }
+      break;
+    case FusedEagerElementwiseOpcode::kSilu:
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] / (one + std::exp(-x[i])); }
+      break;
+    case FusedEagerElementwiseOpcode::kScalarAdd:
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] + scalar; }
+      break;
+    case FusedEagerElementwiseOpcode::kScalarMul:
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] * scalar; }
+      break;
+    case FusedEagerElementwiseOpcode::kScalarDiv:
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] / scalar; }
+      break;
+    case FusedEagerElementwiseOpcode::kAdd:
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] + y[i]; }
+      break;
+    case FusedEagerElementwiseOpcode::kSub:
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] - y[i]; }
+      break;
+    case FusedEagerElementwiseOpcode::kMul:
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] * y[i]; }
+      break;
+    case FusedEagerElementwiseOpcode::kDiv:
+      for (int64_t i = 0; i < n; ++i) { z[i] = x[i] / y[i]; }
+      break;
+  }
+}
+
+template<typename T>
+class FusedEagerElementwiseKernel final : public user_op::OpKernel {
+ public:
+  FusedEagerElementwiseKernel() = default;
+  ~FusedEagerElementwiseKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto& opcodes = ctx->Attr<std::vector<int32_t>>("opcodes");
+    const auto& operands = ctx->Attr<std::vector<int32_t>>("operands");
+    const auto& scalars = ctx->Attr<std::vector<int64_t>>("scalars");
+    const auto& output_values = ctx->Attr<std::vector<int32_t>>("output_values");
+    const int32_t num_inputs = ctx->input_size("in");
+    const int32_t num_steps = opcodes.size();
+    const int32_t num_values = num_inputs + num_steps;
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("out", 0)->shape_view().elem_cnt();
+
+    std::vector<T> step_scalars(num_steps);
+    for (int32_t i = 0; i < num_steps; ++i) {
+      double scalar = 0;
+      std::memcpy(&scalar, &scalars.at(i), sizeof(scalar));
+      step_scalars.at(i) = static_cast<T>(scalar);
+    }
+    std::vector<const T*> input_ptrs(num_inputs);
+    std::vector<bool> is_broadcast_input(num_inputs);
+    for (int32_t i = 0; i < num_inputs; ++i) {
+      const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", i);
+      input_ptrs.at(i) = in->dptr<T>();
+      is_broadcast_input.at(i) = in->shape_view().elem_cnt() != elem_cnt;
+    }
+    std::vector<T*> output_ptrs(num_values, nullptr);
+    for (size_t i = 0; i < output_values.size(); ++i) {
+      output_ptrs.at(output_values.at(i)) = ctx->Tensor4ArgNameAndIndex("out", i)->mut_dptr<T>();
+    }
+    // Values that are not outputs live in block sized slots, which are reused once the last step
+    // reading a value is done.
+    std::vector<int32_t> last_use(num_values, -1);
+    for (int32_t i = 0; i < num_steps; ++i) {
+      last_use.at(operands.at(2 * i)) = i;
+      if (operands.at(2 * i + 1) >= 0) { last_use.at(operands.at(2 * i + 1)) = i; }
+    }
+    std::vector<int32_t> input_slots(num_inputs, -1);
+    std::vector<int32_t> step_slots(num_steps, -1);
+    std::vector<int32_t> free_slots;
+    int32_t num_slots = 0;
+    for (int32_t i = 0; i < num_inputs; ++i) {
+      if (is_broadcast_input.at(i)) { input_slots.at(i) = num_slots++; }
+    }
+    for (int32_t i = 0; i < num_steps; ++i) {
+      if (output_ptrs.at(num_inputs + i) == nullptr) {
+        if (free_slots.empty()) {
+          step_slots.at(i) = num_slots++;
+        } else {
+          step_slots.at(i) = free_slots.back();
+          free_slots.pop_back();
+        }
+      }
+      const int32_t x = operands.at(2 * i);
+      const int32_t y = operands.at(2 * i + 1);
+      for (int32_t operand : {x, y == x ? -1 : y}) {
+        if (operand >= num_inputs && last_use.at(operand) == i
+            && step_slots.at(operand - num_inputs) >= 0) {
+          free_slots.emplace_back(step_slots.at(operand - num_inputs));
+        }
+      }
+    }
+
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    cpu_stream->ParallelFor(0, elem_cnt, [&](int64_t begin, int64_t end) {
+      std::vector<T> slots(num_slots * kBlockSize);
+      std::vector<const T*> value_ptrs(num_values);
+      for (int32_t i = 0; i < num_inputs; ++i) {
+        if (is_broadcast_input.at(i)) {
+          T* slot = slots.data() + input_slots.at(i) * kBlockSize;
+          std::fill(slot, slot + kBlockSize, *input_ptrs.at(i));
+          value_ptrs.at(i) = slot;
+        }
+      }
+      for (int64_t offset = begin; offset < end; offset += kBlockSize) {
+        const int64_t n = std::min(kBlockSize, end - offset);
+        for (int32_t i = 0; i < num_inputs; ++i) {
+          if (!is_broadcast_input.at(i)) { value_ptrs.at(i) = input_ptrs.at(i) + offset; }
+        }
+        for (int32_t i = 0; i < num_steps; ++i) {
+          const int32_t value = num_inputs + i;
+          T* z = output_ptrs.at(value) != nullptr
+                     ? output_ptrs.at(value) + offset
+                     : slots.data() + step_slots.at(i) * kBlockSize;
+          const int32_t y = operands.at(2 * i + 1);
+          RunStep<T>(static_cast<FusedEagerElementwiseOpcode>(opcodes.at(i)),
+                     value_ptrs.at(operands.at(2 * i)), y >= 0 ? value_ptrs.at(y) : nullptr,
+                     step_scalars.at(i), z, n);
+          value_ptrs.at(value) = z;
+        }
+      }
+    });
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_FUSED_EAGER_ELEMENTWISE_KERNEL(data_type, cpp_type)  \
+  REGISTER_USER_KERNEL("fused_eager_elementwise")                     \
+      .SetCreateFn<FusedEagerElementwiseKernel<cpp_type>>()           \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == data_type))
+
+REGISTER_FUSED_EAGER_ELEMENTWISE_KERNEL(DataType::kFloat, float);
+REGISTER_FUSED_EAGER_ELEMENTWISE_KERNEL(DataType::kDouble, double);
+
+}  // namespace oneflow
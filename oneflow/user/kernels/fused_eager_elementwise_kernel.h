@@ -0,0 +1,60 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_FUSED_EAGER_ELEMENTWISE_KERNEL_H_
+#define ONEFLOW_USER_KERNELS_FUSED_EAGER_ELEMENTWISE_KERNEL_H_
+
+#include <cstdint>
+
+namespace oneflow {
+
+// Steps of the programs run by fused_eager_elementwise. Values 0 to n - 1 of a program are its n
+// inputs `in`, step i makes value n + i from the values operands[2 * i] and operands[2 * i + 1],
+// the latter is -1 unless the step is binary, and from the double whose bits are scalars[i]. Output
+// `out` j is the value output_values[j]. Inputs of one element are broadcast to `shape`.
+enum class FusedEagerElementwiseOpcode : int32_t {
+  // y = f(x)
+  kRelu = 0,
+  kSigmoid,
+  kTanh,
+  kExp,
+  kNegative,
+  kAbs,
+  kSqrt,
+  kRsqrt,
+  kSquare,
+  kReciprocal,
+  kSilu,
+  // y = f(x, scalar)
+  kScalarAdd,
+  kScalarMul,
+  kScalarDiv,
+  // z = f(x, y)
+  kAdd,
+  kSub,
+  kMul,
+  kDiv,
+};
+
+constexpr int32_t kFusedEagerElementwiseNumOpcodes =
+    static_cast<int32_t>(FusedEagerElementwiseOpcode::kDiv) + 1;
+
+inline bool IsBinaryFusedEagerElementwiseOpcode(FusedEagerElementwiseOpcode opcode) {
+  return opcode >= FusedEagerElementwiseOpcode::kAdd;
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_FUSED_EAGER_ELEMENTWISE_KERNEL_H_
@@ -14,25 +14,60 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
-#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/user/image/image_util.h"
+#include "oneflow/user/image/jpeg_decoder.h"
 #include <opencv2/opencv.hpp>
 
 namespace oneflow {
 
 namespace {
 
+// Whether the bytes are a JPEG stream that libjpeg can decode to the same image as OpenCV. OpenCV
+// applies the Exif orientation while libjpeg does not, so images with Exif data are left to OpenCV.
+bool IsJpegWithoutExif(const unsigned char* data, size_t length) {
+  if (length < 4 || data[0] != 0xFF || data[1] != 0xD8) { return false; }
+  size_t pos = 2;
+  while (pos + 4 <= length && data[pos] == 0xFF) {
+    const unsigned char marker = data[pos + 1];
+    // Start of scan, the headers are over.
+    if (marker == 0xDA) { return true; }
+    const size_t segment_length = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+    if (marker == 0xE1 && pos + 10 <= length && std::memcmp(data + pos + 4, "Exif\0", 6) == 0) {
+      return false;
+    }
+    pos += 2 + segment_length;
+  }
+  return false;
+}
+
 void DecodeImage(const TensorBuffer& raw_bytes, TensorBuffer* image_buffer,
                  const std::string& color_space, DataType data_type) {
   // should only support kChar, but numpy ndarray maybe cannot convert to char*
   CHECK(raw_bytes.data_type() == DataType::kChar || raw_bytes.data_type() == DataType::kInt8
         || raw_bytes.data_type() == DataType::kUInt8);
-  cv::_InputArray raw_bytes_arr(raw_bytes.data<char>(), raw_bytes.elem_cnt());
-  cv::Mat image_mat = cv::imdecode(
-      raw_bytes_arr, (ImageUtil::IsColor(color_space) ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE)
-                         | cv::IMREAD_ANYDEPTH);
-  if (ImageUtil::IsColor(color_space) && color_space != "BGR") {
-    ImageUtil::ConvertColor("BGR", image_mat, color_space, image_mat);
+  // Decode scratch reused by the images decoded on the same thread.
+  thread_local cv::Mat image_mat;
+  const unsigned char* data = reinterpret_cast<const unsigned char*>(raw_bytes.data<char>());
+  const size_t length = raw_bytes.elem_cnt();
+  if (data_type == DataType::kUInt8 && ImageUtil::IsColor(color_space)
+      && IsJpegWithoutExif(data, length)
+      && JpegPartialDecodeRandomCropImage(data, length, nullptr, nullptr, 0, &image_mat)) {
+    // libjpeg decode output RGB
+    if (color_space != "RGB") { ImageUtil::ConvertColor("RGB", image_mat, color_space, image_mat); }
+  } else {
+    // imdecode leaves its output as it was when it fails, which would be the previous image of
+    // this thread or the partial output of libjpeg.
+    image_mat.release();
+    cv::_InputArray raw_bytes_arr(raw_bytes.data<char>(), raw_bytes.elem_cnt());
+    cv::imdecode(raw_bytes_arr,
+                 (ImageUtil::IsColor(color_space) ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE)
+                     | cv::IMREAD_ANYDEPTH,
+                 &image_mat);
+    CHECK(!image_mat.empty()) << "Failed to decode image";
+    if (ImageUtil::IsColor(color_space) && color_space != "BGR") {
+      ImageUtil::ConvertColor("BGR", image_mat, color_space, image_mat);
+    }
   }
   if (data_type == DataType::kUInt8) {
     image_mat.convertTo(image_mat, CV_8U);
@@ -77,9 +112,21 @@ class ImageDecodeKernel final : public user_op::OpKernel {
     const std::string& color_space = ctx->Attr<std::string>("color_space");
     const DataType data_type = ctx->Attr<DataType>("data_type");
 
-    MultiThreadLoop(in_tensor->shape_view().elem_cnt(), [&](size_t i) {
-      DecodeImage(in_img_buf[i], out_img_buf + i, color_space, data_type);
-    });
+    // Image sizes vary a lot within a batch, so the workers take images one by one instead of
+    // being given equal slices of the batch.
+    const int64_t num_images = in_tensor->shape_view().elem_cnt();
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const int64_t num_workers =
+        std::min<int64_t>(num_images, cpu_stream->device()->GetNumThreads());
+    std::atomic<int64_t> next_image(0);
+    cpu_stream->ParallelFor(
+        0, num_workers,
+        [&](int64_t, int64_t) {
+          for (int64_t i = next_image.fetch_add(1); i < num_images; i = next_image.fetch_add(1)) {
+            DecodeImage(in_img_buf[i], out_img_buf + i, color_space, data_type);
+          }
+        },
+        1);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -0,0 +1,228 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/memory_format.pb.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/image/image_util.h"
+#include "oneflow/user/image/jpeg_decoder.h"
+#include "oneflow/user/kernels/random_crop_kernel_state.h"
+#include <opencv2/opencv.hpp>
+
+namespace oneflow {
+
+namespace {
+
+class DecodeCropResizeNormalizeState final : public user_op::OpKernelState {
+ public:
+  explicit DecodeCropResizeNormalizeState(user_op::KernelInitContext* ctx) {
+    if (ctx->Attr<bool>("random_crop")) {
+      crop_generators_ = CreateRandomCropKernelState(
+          ctx, ctx->TensorDesc4ArgNameAndIndex("in", 0)->shape().elem_cnt());
+    }
+    const size_t C = ImageUtil::IsColor(ctx->Attr<std::string>("color_space")) ? 3 : 1;
+    std::vector<float> mean_vec = ctx->Attr<std::vector<float>>("mean");
+    std::vector<float> std_vec = ctx->Attr<std::vector<float>>("std");
+    if (mean_vec.size() == 1) { mean_vec.resize(C, mean_vec.at(0)); }
+    if (std_vec.size() == 1) { std_vec.resize(C, std_vec.at(0)); }
+    CHECK_EQ(mean_vec.size(), C);
+    CHECK_EQ(std_vec.size(), C);
+    // (x - mean) / std is computed as x * scale + bias.
+    for (size_t c = 0; c < C; ++c) {
+      scale_vec_.emplace_back(1.0f / std_vec.at(c));
+      bias_vec_.emplace_back(-mean_vec.at(c) / std_vec.at(c));
+    }
+  }
+  ~DecodeCropResizeNormalizeState() override = default;
+
+  RandomCropGenerator* GetCropGenerator(int64_t i) const {
+    return crop_generators_ ? crop_generators_->GetGenerator(i) : nullptr;
+  }
+  const std::vector<float>& scale_vec() const { return scale_vec_; }
+  const std::vector<float>& bias_vec() const { return bias_vec_; }
+
+ private:
+  std::shared_ptr<RandomCropKernelState> crop_generators_;
+  std::vector<float> scale_vec_;
+  std::vector<float> bias_vec_;
+};
+
+void GetEncodedImage(const user_op::Tensor* in, int64_t i, const std::string& name,
+                     const unsigned char** data, size_t* length) {
+  if (in->data_type() == DataType::kOFRecord) {
+    const OFRecord& record = in->dptr<OFRecord>()[i];
+    CHECK(record.feature().find(name) != record.feature().end())
+        << "Field " << name << " not found";
+    const Feature& feature = record.feature().at(name);
+    CHECK(feature.has_bytes_list());
+    CHECK(feature.bytes_list().value_size() == 1);
+    const std::string& src_data = feature.bytes_list().value(0);
+    *data = reinterpret_cast<const unsigned char*>(src_data.data());
+    *length = src_data.size();
+  } else {
+    const TensorBuffer& buffer = in->dptr<TensorBuffer>()[i];
+    *data = static_cast<const unsigned char*>(buffer.data());
+    *length = buffer.nbytes();
+  }
+}
+
+// Decodes the crop window of the image and resizes it to the target size. libjpeg decodes to RGB,
+// the OpenCV fallback to BGR, `is_bgr` tells which one was used.
+void DecodeCropResize(const unsigned char* data, size_t length, RandomCropGenerator* crop_gen,
+                      int target_width, int target_height, cv::Mat* resized, bool* is_bgr) {
+  // Decode scratch reused by the images decoded on the same thread.
+  thread_local cv::Mat decoded;
+  if (JpegPartialDecodeRandomCropScaledImage(data, length, crop_gen, target_width, target_height,
+                                             nullptr, 0, &decoded)) {
+    *is_bgr = false;
+  } else {
+    OpenCvPartialDecodeRandomCropImage(data, length, crop_gen, "BGR", decoded);
+    *is_bgr = true;
+  }
+  CHECK(!decoded.empty()) << "Failed to decode image";
+  cv::resize(decoded, *resized, cv::Size(target_width, target_height), 0, 0, cv::INTER_LINEAR);
+}
+
+// Normalizes the interleaved uint8 image into the output layout, mirrored if asked. Output
+// channel c is read from source channel src_channel[c], so that color order conversion does not
+// need a pass of its own. The inner loops write contiguous output rows and vectorize well.
+template<MemoryFormat layout, bool mirror>
+void NormalizeImage(const uint8_t* src, int64_t H, int64_t W, int64_t C,
+                    const int64_t* src_channel, const float* scale, const float* bias,
+                    float* dst) {
+  for (int64_t h = 0; h < H; ++h) {
+    const uint8_t* src_row = src + h * W * C;
+    if (layout == MemoryFormat::kContiguous) {
+      for (int64_t c = 0; c < C; ++c) {
+        const uint8_t* src_channel_row = src_row + src_channel[c];
+        const float s = scale[c];
+        const float b = bias[c];
+        float* dst_row = dst + (c * H + h) * W;
+        for (int64_t w = 0; w < W; ++w) {
+          const int64_t src_w = mirror ? W - 1 - w : w;
+          dst_row[w] = static_cast<float>(src_channel_row[src_w * C]) * s + b;
+        }
+      }
+    } else {
+      float* dst_row = dst + h * W * C;
+      for (int64_t w = 0; w < W; ++w) {
+        const uint8_t* src_pixel = src_row + (mirror ? W - 1 - w : w) * C;
+        for (int64_t c = 0; c < C; ++c) {
+          dst_row[w * C + c] = static_cast<float>(src_pixel[src_channel[c]]) * scale[c] + bias[c];
+        }
+      }
+    }
+  }
+}
+
+template<MemoryFormat layout>
+void NormalizeImage(bool mirror, const uint8_t* src, int64_t H, int64_t W, int64_t C,
+                    const int64_t* src_channel, const float* scale, const float* bias,
+                    float* dst) {
+  if (mirror) {
+    NormalizeImage<layout, true>(src, H, W, C, src_channel, scale, bias, dst);
+  } else {
+    NormalizeImage<layout, false>(src, H, W, C, src_channel, scale, bias, dst);
+  }
+}
+
+}  // namespace
+
+class ImageDecoderRandomCropResizeNormalizeKernel final : public user_op::OpKernel {
+ public:
+  ImageDecoderRandomCropResizeNormalizeKernel() = default;
+  ~ImageDecoderRandomCropResizeNormalizeKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<DecodeCropResizeNormalizeState>(ctx);
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    const auto* op_state = dynamic_cast<DecodeCropResizeNormalizeState*>(state);
+    CHECK_NOTNULL(op_state);
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* mirror =
+        ctx->has_input("mirror", 0) ? ctx->Tensor4ArgNameAndIndex("mirror", 0) : nullptr;
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const int64_t num_images = in->shape_view().elem_cnt();
+    CHECK_GT(num_images, 0);
+    CHECK_EQ(out->shape_view().At(0), num_images);
+    if (mirror != nullptr) { CHECK_EQ(mirror->shape_view().elem_cnt(), num_images); }
+    const std::string& name = ctx->Attr<std::string>("name");
+    const std::string& color_space = ctx->Attr<std::string>("color_space");
+    const bool is_color = ImageUtil::IsColor(color_space);
+    const int64_t C = is_color ? 3 : 1;
+    const int64_t H = ctx->Attr<int64_t>("target_height");
+    const int64_t W = ctx->Attr<int64_t>("target_width");
+    const bool channels_last = ctx->Attr<std::string>("output_layout") == "NHWC";
+    const float* scale = op_state->scale_vec().data();
+    const float* bias = op_state->bias_vec().data();
+    float* out_ptr = out->mut_dptr<float>();
+
+    // Image sizes vary a lot within a batch, so the workers take images one by one instead of
+    // being given equal slices of the batch.
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const int64_t num_workers =
+        std::min<int64_t>(num_images, cpu_stream->device()->GetNumThreads());
+    std::atomic<int64_t> next_image(0);
+    cpu_stream->ParallelFor(
+        0, num_workers,
+        [&](int64_t, int64_t) {
+          thread_local cv::Mat resized;
+          thread_local cv::Mat gray;
+          for (int64_t i = next_image.fetch_add(1); i < num_images; i = next_image.fetch_add(1)) {
+            const unsigned char* data = nullptr;
+            size_t length = 0;
+            GetEncodedImage(in, i, name, &data, &length);
+            bool is_bgr = false;
+            DecodeCropResize(data, length, op_state->GetCropGenerator(i), W, H, &resized,
+                             &is_bgr);
+            const cv::Mat* image = &resized;
+            int64_t src_channel[3] = {0, 1, 2};
+            if (!is_color) {
+              cv::cvtColor(resized, gray, is_bgr ? cv::COLOR_BGR2GRAY : cv::COLOR_RGB2GRAY);
+              image = &gray;
+            } else if (is_bgr != (color_space == "BGR")) {
+              std::swap(src_channel[0], src_channel[2]);
+            }
+            CHECK(image->isContinuous());
+            const bool mirror_i = mirror != nullptr && mirror->dptr<int8_t>()[i] != 0;
+            float* out_i = out_ptr + i * H * W * C;
+            if (channels_last) {
+              NormalizeImage<MemoryFormat::kChannelsLast>(mirror_i, image->ptr<uint8_t>(), H, W,
+                                                          C, src_channel, scale, bias, out_i);
+            } else {
+              NormalizeImage<MemoryFormat::kContiguous>(mirror_i, image->ptr<uint8_t>(), H, W, C,
+                                                        src_channel, scale, bias, out_i);
+            }
+          }
+        },
+        1);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("image_decoder_random_crop_resize_normalize")
+    .SetCreateFn<ImageDecoderRandomCropResizeNormalizeKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
+                     && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                         || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
+                     && (user_op::HobDataType("out", 0) == DataType::kFloat));
+
+}  // namespace oneflow
@@ -0,0 +1,329 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_ONE_EMBEDDING_DATA_SHUFFLE_H_
+#define ONEFLOW_USER_KERNELS_ONE_EMBEDDING_DATA_SHUFFLE_H_
+
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/embedding/hash_functions.cuh"
+#include "oneflow/user/kernels/collective_communication/include/communication_context.h"
+#include "oneflow/user/kernels/collective_communication/include/all_gather.h"
+#include "oneflow/user/kernels/collective_communication/include/all_to_all.h"
+
+namespace oneflow {
+
+namespace data_shuffle {
+
+// Cpu counterpart of one_embedding_data_shuffle.cuh, with the same buffer layouts: partition p of
+// the partitioned unique ids starts at p * num_ids, num_unique_matrix[i * parallel_num + j] is the
+// number of unique ids rank i sends to rank j, and padding ids get an inverse index out of range.
+
+constexpr size_t kCpuRowsGrainSize = 256;
+
+template<typename IDX>
+constexpr IDX CpuPaddingInverseIndex() {
+  return static_cast<IDX>(0xffffffff);
+}
+
+template<typename K, typename U, typename IDX>
+struct CpuIdShuffleDataPtrs {
+  const K* ids_ptr;
+  const U* table_ids_ptr;
+  IDX* num_unique_matrix_ptr;
+  IDX* inverse_unique_partition_indices_ptr;
+  K* cur_rank_unique_ids_ptr;
+  U* cur_rank_unique_table_ids_ptr;
+  IDX* cur_rank_inverse_indices_ptr;
+};
+
+// Ids are partitioned by embedding::ShardingHash like the cuda kernels, so a key is owned by the
+// same rank on both devices.
+template<typename K, typename U, typename IDX>
+void CpuUniqueAndPartition(int64_t num_ids, int64_t num_partition, const K* ids,
+                           const U* table_ids, IDX* num_partitioned_unique,
+                           K* partitioned_unique_ids, U* partitioned_unique_table_ids,
+                           IDX* inverse_unique_partition_indices, const bool has_padding_idx,
+                           const int64_t padding_idx) {
+  std::fill(num_partitioned_unique, num_partitioned_unique + num_partition, 0);
+  HashMap<K, IDX> key_to_index;
+  key_to_index.reserve(num_ids);
+  for (int64_t i = 0; i < num_ids; ++i) {
+    const K key = ids[i];
+    if (has_padding_idx && static_cast<int64_t>(key) == padding_idx) {
+      inverse_unique_partition_indices[i] = CpuPaddingInverseIndex<IDX>();
+      continue;
+    }
+    auto it = key_to_index.find(key);
+    if (it == key_to_index.end()) {
+      const int64_t partition_id =
+          num_partition == 1 ? 0 : embedding::ShardingHash()(key) % num_partition;
+      const int64_t index = partition_id * num_ids + num_partitioned_unique[partition_id];
+      num_partitioned_unique[partition_id] += 1;
+      partitioned_unique_ids[index] = key;
+      if (table_ids != nullptr) { partitioned_unique_table_ids[index] = table_ids[i]; }
+      it = key_to_index.emplace(key, static_cast<IDX>(index)).first;
+    }
+    inverse_unique_partition_indices[i] = it->second;
+  }
+}
+
+template<typename IDX>
+void CpuMakeShuffleParams(const IDX* host_num_unique_matrix, const int64_t row_size,
+                          int64_t parallel_id, int64_t parallel_num,
+                          std::vector<int64_t>* scatter_offset_vec,
+                          std::vector<int64_t>* scatter_elem_cnt_vec,
+                          std::vector<int64_t>* gather_offset_vec,
+                          std::vector<int64_t>* gather_elem_cnt_vec) {
+  scatter_offset_vec->resize(parallel_num);
+  scatter_elem_cnt_vec->resize(parallel_num);
+  gather_offset_vec->resize(parallel_num);
+  gather_elem_cnt_vec->resize(parallel_num);
+  int64_t gather_offset = 0;
+  int64_t scatter_offset = 0;
+  for (int64_t i = 0; i < parallel_num; ++i) {
+    const int64_t scatter_elem_cnt =
+        host_num_unique_matrix[parallel_id * parallel_num + i] * row_size;
+    const int64_t gather_elem_cnt =
+        host_num_unique_matrix[i * parallel_num + parallel_id] * row_size;
+    scatter_offset_vec->at(i) = scatter_offset;
+    scatter_elem_cnt_vec->at(i) = scatter_elem_cnt;
+    gather_offset_vec->at(i) = gather_offset;
+    gather_elem_cnt_vec->at(i) = gather_elem_cnt;
+    scatter_offset += scatter_elem_cnt;
+    gather_offset += gather_elem_cnt;
+  }
+}
+
+// Number of ids the current rank receives from all the ranks.
+template<typename IDX>
+int64_t CpuCurRankNumIds(const IDX* host_num_unique_matrix, int64_t parallel_id,
+                         int64_t parallel_num) {
+  int64_t cur_rank_num_ids = 0;
+  for (int64_t i = 0; i < parallel_num; ++i) {
+    cur_rank_num_ids += host_num_unique_matrix[i * parallel_num + parallel_id];
+  }
+  return cur_rank_num_ids;
+}
+
+// Number of unique ids of the current rank, summed over all the partitions.
+template<typename IDX>
+int64_t CpuUniquePartitionedNumIds(const IDX* host_num_unique_matrix, int64_t parallel_id,
+                                   int64_t parallel_num) {
+  int64_t unique_partitioned_num_ids = 0;
+  for (int64_t i = 0; i < parallel_num; ++i) {
+    unique_partitioned_num_ids += host_num_unique_matrix[parallel_id * parallel_num + i];
+  }
+  return unique_partitioned_num_ids;
+}
+
+// Rows with an index out of [0, num_in_rows) are zero filled, this covers the padding ids.
+template<typename T, typename IDX>
+void CpuGatherRows(ep::Stream* stream, int64_t num_indices, const IDX* indices,
+                   int64_t num_in_rows, int64_t row_size, const T* in, T* out) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_indices,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t index = static_cast<int64_t>(indices[i]);
+          T* dst = out + i * row_size;
+          if (index < 0 || index >= num_in_rows) {
+            std::memset(dst, 0, row_size * sizeof(T));
+          } else {
+            std::memcpy(dst, in + index * row_size, row_size * sizeof(T));
+          }
+        }
+      },
+      kCpuRowsGrainSize);
+}
+
+// Every thread owns a range of output rows and only adds the input rows that map into it, so no
+// two threads write the same row. Indices out of [0, num_out_rows) are dropped.
+template<typename T, typename IDX>
+void CpuUnsortedSegmentSumRows(ep::Stream* stream, int64_t num_indices, const IDX* indices,
+                               const T* in, int64_t num_out_rows, int64_t row_size, T* out) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_out_rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = 0; i < num_indices; ++i) {
+          const int64_t index = static_cast<int64_t>(indices[i]);
+          if (index < begin || index >= end) { continue; }
+          const T* src = in + i * row_size;
+          T* dst = out + index * row_size;
+          for (int64_t j = 0; j < row_size; ++j) { dst[j] += src[j]; }
+        }
+      },
+      kCpuRowsGrainSize);
+}
+
+template<typename T>
+void CpuShuffleData(ep::Stream* stream, const std::shared_ptr<ccl::CommunicationContext>& comm,
+                    DataType data_type, const std::vector<int64_t>& send_offsets,
+                    const std::vector<int64_t>& send_elem_cnt, const T* send_data,
+                    const std::vector<int64_t>& recv_offsets,
+                    const std::vector<int64_t>& recv_elem_cnt, T* recv_data) {
+  std::unique_ptr<ccl::AllToAll> all_to_all =
+      ccl::NewCollectiveCommunication<ccl::AllToAll>(DeviceType::kCPU, data_type);
+  CHECK(all_to_all);
+  all_to_all->Launch(stream, send_data, send_offsets, send_elem_cnt, recv_data, recv_offsets,
+                     recv_elem_cnt, comm);
+}
+
+// Returns the number of unique ids of the current rank. The ids and the table ids are exchanged
+// with AllToAll over the communication context, the counts with AllGather.
+template<typename K, typename U, typename IDX>
+uint32_t CpuIdShuffle(ep::Stream* stream, const std::shared_ptr<ccl::CommunicationContext>& comm,
+                      const CpuIdShuffleDataPtrs<K, U, IDX>& data_ptrs, int64_t num_ids,
+                      int64_t parallel_id, int64_t parallel_num, DataType num_unique_matrix_dtype,
+                      DataType ids_dtype, DataType table_ids_dtype, bool need_process_table_ids,
+                      const bool has_padding_idx, const int64_t padding_idx) {
+  const U* table_ids_ptr = need_process_table_ids ? data_ptrs.table_ids_ptr : nullptr;
+  std::vector<IDX> num_partitioned_unique(parallel_num);
+  std::vector<K> partitioned_unique_ids(parallel_num * num_ids);
+  std::vector<U> partitioned_unique_table_ids(need_process_table_ids ? parallel_num * num_ids : 0);
+  CpuUniqueAndPartition<K, U, IDX>(num_ids, parallel_num, data_ptrs.ids_ptr, table_ids_ptr,
+                                   num_partitioned_unique.data(), partitioned_unique_ids.data(),
+                                   partitioned_unique_table_ids.data(),
+                                   data_ptrs.inverse_unique_partition_indices_ptr,
+                                   has_padding_idx, padding_idx);
+
+  std::unique_ptr<ccl::AllGather> all_gather =
+      ccl::NewCollectiveCommunication<ccl::AllGather>(DeviceType::kCPU, num_unique_matrix_dtype);
+  CHECK(all_gather);
+  all_gather->Launch(stream, num_partitioned_unique.data(), data_ptrs.num_unique_matrix_ptr,
+                     parallel_num, comm);
+  const IDX* host_num_unique_matrix = data_ptrs.num_unique_matrix_ptr;
+
+  if (parallel_num > 1) {
+    // Makes the partitions contiguous, partition p then starts right after partition p - 1.
+    std::vector<int64_t> partition_offsets(parallel_num);
+    int64_t offset = 0;
+    for (int64_t i = 0; i < parallel_num; ++i) {
+      partition_offsets[i] = offset;
+      offset += num_partitioned_unique[i];
+    }
+    IDX* inverse = data_ptrs.inverse_unique_partition_indices_ptr;
+    for (int64_t i = 0; i < num_ids; ++i) {
+      if (inverse[i] == CpuPaddingInverseIndex<IDX>()) { continue; }
+      const int64_t index = static_cast<int64_t>(inverse[i]);
+      const int64_t partition_id = index / num_ids;
+      inverse[i] = static_cast<IDX>(partition_offsets[partition_id] + index
+                                    - partition_id * num_ids);
+    }
+  }
+
+  std::vector<int64_t> send_offsets;
+  std::vector<int64_t> send_elem_cnt;
+  std::vector<int64_t> recv_offsets;
+  std::vector<int64_t> recv_elem_cnt;
+  CpuMakeShuffleParams(host_num_unique_matrix, 1, parallel_id, parallel_num, &send_offsets,
+                       &send_elem_cnt, &recv_offsets, &recv_elem_cnt);
+  // The partitioned unique ids are not contiguous, partition i starts at i * num_ids.
+  for (int64_t i = 0; i < parallel_num; ++i) { send_offsets.at(i) = i * num_ids; }
+  const int64_t received_elem_cnt =
+      recv_offsets.at(parallel_num - 1) + recv_elem_cnt.at(parallel_num - 1);
+  std::vector<K> received_ids(received_elem_cnt);
+  std::vector<U> received_table_ids(need_process_table_ids ? received_elem_cnt : 0);
+  CpuShuffleData(stream, comm, ids_dtype, send_offsets, send_elem_cnt,
+                 partitioned_unique_ids.data(), recv_offsets, recv_elem_cnt, received_ids.data());
+  if (need_process_table_ids) {
+    CpuShuffleData(stream, comm, table_ids_dtype, send_offsets, send_elem_cnt,
+                   partitioned_unique_table_ids.data(), recv_offsets, recv_elem_cnt,
+                   received_table_ids.data());
+  }
+
+  IDX cur_rank_num_unique = 0;
+  CpuUniqueAndPartition<K, U, IDX>(
+      received_elem_cnt, 1, received_ids.data(),
+      need_process_table_ids ? received_table_ids.data() : nullptr, &cur_rank_num_unique,
+      data_ptrs.cur_rank_unique_ids_ptr, data_ptrs.cur_rank_unique_table_ids_ptr,
+      data_ptrs.cur_rank_inverse_indices_ptr, has_padding_idx, padding_idx);
+  if (!need_process_table_ids) {
+    std::memset(data_ptrs.cur_rank_unique_table_ids_ptr, 0, received_elem_cnt * sizeof(U));
+  }
+  return static_cast<uint32_t>(cur_rank_num_unique);
+}
+
+// Sends the embeddings of the unique ids of the current rank back to the ranks that asked for
+// them, then expands them to the ids of this rank.
+template<typename T, typename IDX>
+void CpuShuffleEmbeddings(ep::Stream* stream,
+                          const std::shared_ptr<ccl::CommunicationContext>& comm,
+                          int64_t parallel_id, int64_t parallel_num, int64_t num_ids,
+                          int64_t embedding_size, DataType data_type,
+                          const IDX* host_num_unique_matrix, int64_t cur_rank_num_rows,
+                          const T* cur_rank_embeddings, const IDX* cur_rank_inverse_indices,
+                          const IDX* inverse_unique_partition_indices, T* embeddings) {
+  std::vector<int64_t> send_offsets;
+  std::vector<int64_t> send_elem_cnt;
+  std::vector<int64_t> recv_offsets;
+  std::vector<int64_t> recv_elem_cnt;
+  CpuMakeShuffleParams(host_num_unique_matrix, embedding_size, parallel_id, parallel_num,
+                       &recv_offsets, &recv_elem_cnt, &send_offsets, &send_elem_cnt);
+  const int64_t cur_rank_num_ids =
+      CpuCurRankNumIds(host_num_unique_matrix, parallel_id, parallel_num);
+  const int64_t unique_partitioned_num_ids =
+      CpuUniquePartitionedNumIds(host_num_unique_matrix, parallel_id, parallel_num);
+  std::vector<T> reverse_unique_cur_rank_embeddings(cur_rank_num_ids * embedding_size);
+  CpuGatherRows(stream, cur_rank_num_ids, cur_rank_inverse_indices, cur_rank_num_rows,
+                embedding_size, cur_rank_embeddings, reverse_unique_cur_rank_embeddings.data());
+  std::vector<T> received_embeddings(unique_partitioned_num_ids * embedding_size);
+  CpuShuffleData(stream, comm, data_type, send_offsets, send_elem_cnt,
+                 reverse_unique_cur_rank_embeddings.data(), recv_offsets, recv_elem_cnt,
+                 received_embeddings.data());
+  CpuGatherRows(stream, num_ids, inverse_unique_partition_indices, unique_partitioned_num_ids,
+                embedding_size, received_embeddings.data(), embeddings);
+}
+
+// Reverse of CpuShuffleEmbeddings: the gradients of the ids of this rank are summed per unique id,
+// sent to the ranks that own the ids and summed again there. cur_rank_unique_embedding_grad must
+// be zeroed by the caller.
+template<typename T, typename IDX>
+void CpuShuffleEmbeddingsGrad(ep::Stream* stream,
+                              const std::shared_ptr<ccl::CommunicationContext>& comm,
+                              int64_t parallel_id, int64_t parallel_num, int64_t num_ids,
+                              int64_t embedding_size, DataType data_type,
+                              const IDX* host_num_unique_matrix, const T* embedding_grad,
+                              const IDX* inverse_unique_partition_indices,
+                              const IDX* cur_rank_inverse_indices, int64_t cur_rank_num_rows,
+                              T* cur_rank_unique_embedding_grad) {
+  std::vector<int64_t> send_offsets;
+  std::vector<int64_t> send_elem_cnt;
+  std::vector<int64_t> recv_offsets;
+  std::vector<int64_t> recv_elem_cnt;
+  CpuMakeShuffleParams(host_num_unique_matrix, embedding_size, parallel_id, parallel_num,
+                       &send_offsets, &send_elem_cnt, &recv_offsets, &recv_elem_cnt);
+  const int64_t cur_rank_num_ids =
+      CpuCurRankNumIds(host_num_unique_matrix, parallel_id, parallel_num);
+  const int64_t unique_partitioned_num_ids =
+      CpuUniquePartitionedNumIds(host_num_unique_matrix, parallel_id, parallel_num);
+  std::vector<T> unique_partition_embedding_grad(unique_partitioned_num_ids * embedding_size);
+  CpuUnsortedSegmentSumRows(stream, num_ids, inverse_unique_partition_indices, embedding_grad,
+                            unique_partitioned_num_ids, embedding_size,
+                            unique_partition_embedding_grad.data());
+  std::vector<T> received_embedding_grad(cur_rank_num_ids * embedding_size);
+  CpuShuffleData(stream, comm, data_type, send_offsets, send_elem_cnt,
+                 unique_partition_embedding_grad.data(), recv_offsets, recv_elem_cnt,
+                 received_embedding_grad.data());
+  CpuUnsortedSegmentSumRows(stream, cur_rank_num_ids, cur_rank_inverse_indices,
+                            received_embedding_grad.data(), cur_rank_num_rows, embedding_size,
+                            cur_rank_unique_embedding_grad);
+}
+
+}  // namespace data_shuffle
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_ONE_EMBEDDING_DATA_SHUFFLE_H_
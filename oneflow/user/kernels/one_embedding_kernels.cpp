@@ -0,0 +1,558 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/embedding/embedding_manager.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/primitive/cast.h"
+#include "oneflow/user/kernels/one_embedding_initializer.h"
+#include "oneflow/user/kernels/one_embedding_data_shuffle.h"
+#include <random>
+
+namespace oneflow {
+
+namespace {
+
+constexpr size_t kRowsGrainSize = 256;
+
+class CpuEmbeddingKernelState final : public user_op::OpKernelState {
+ public:
+  CpuEmbeddingKernelState(user_op::KernelInitContext* ctx, const std::string& ids_name,
+                          const std::string& state_initializer) {
+    const std::string& embedding_name = ctx->Attr<std::string>("embedding_name");
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    key_value_store_ = Singleton<embedding::EmbeddingManager>::Get()->GetKeyValueStore(
+        embedding_name, parallel_id);
+    uint32_t max_query_length = ctx->TensorDesc4ArgNameAndIndex(ids_name, 0)->shape().elem_cnt();
+    key_value_store_->ReserveQueryLength(max_query_length);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const int64_t line_size = ctx->Attr<int64_t>("line_size");
+    ParseInitializers(line_size, embedding_size, state_initializer,
+                      ctx->Attr<std::string>("embedding_tables"), &initializer_param_,
+                      &initializer_index_);
+  }
+  ~CpuEmbeddingKernelState() override = default;
+
+  // Only the fused lookup shuffles the ids between ranks, after which a rank may look up the
+  // unique ids of all the ranks at once.
+  void InitIdShuffle(user_op::KernelInitContext* ctx, const std::string& ids_name) {
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    if (parallel_num == 1) { return; }
+    key_value_store_->ReserveQueryLength(
+        ctx->TensorDesc4ArgNameAndIndex(ids_name, 0)->shape().elem_cnt() * parallel_num);
+    communication_ctx_ =
+        ccl::NewCommunicationContext(DeviceType::kCPU, SymbolOf(ctx->parallel_desc()));
+  }
+
+  embedding::KeyValueStore* KeyValueStore() { return key_value_store_; }
+  const int8_t* InitializerIndex() const { return initializer_index_.data(); }
+  const EmbeddingInitializer* Initializers() const { return initializer_param_.data(); }
+  const std::shared_ptr<ccl::CommunicationContext>& communication_ctx() const {
+    return communication_ctx_;
+  }
+
+ private:
+  embedding::KeyValueStore* key_value_store_;
+  std::shared_ptr<ccl::CommunicationContext> communication_ctx_;
+  std::vector<EmbeddingInitializer> initializer_param_;
+  std::vector<int8_t> initializer_index_;
+};
+
+class CpuEmbeddingPutKernelState final : public user_op::OpKernelState {
+ public:
+  explicit CpuEmbeddingPutKernelState(user_op::KernelInitContext* ctx) {
+    const std::string& embedding_name = ctx->Attr<std::string>("embedding_name");
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    key_value_store_ = Singleton<embedding::EmbeddingManager>::Get()->GetKeyValueStore(
+        embedding_name, parallel_id);
+    uint32_t max_query_length =
+        ctx->TensorDesc4ArgNameAndIndex("unique_ids", 0)->shape().elem_cnt();
+    key_value_store_->ReserveQueryLength(max_query_length);
+  }
+  ~CpuEmbeddingPutKernelState() override = default;
+
+  embedding::KeyValueStore* KeyValueStore() { return key_value_store_; }
+
+ private:
+  embedding::KeyValueStore* key_value_store_;
+};
+
+// Every missing row draws from its own generator seeded by (seed, id), so the initial value of a
+// key does not depend on how rows are split between threads.
+template<typename T, typename K, typename U>
+void InitMissingRows(ep::CpuStream* stream, uint64_t seed, const int64_t line_size,
+                     const EmbeddingInitializer* initializer_param,
+                     const int8_t* initializer_index, const K* unique_ids, const U* table_ids,
+                     uint32_t num_missing, const uint32_t* missing_indices, T* values) {
+  stream->ParallelFor(
+      0, num_missing,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const uint32_t index = missing_indices[i];
+          const int32_t table_idx =
+              table_ids == nullptr ? 0 : static_cast<int32_t>(table_ids[index]);
+          std::seed_seq seq{seed, static_cast<uint64_t>(unique_ids[index])};
+          std::mt19937_64 gen(seq);
+          T* row = values + index * line_size;
+          for (int64_t col = 0; col < line_size; ++col) {
+            const EmbeddingInitializer& initializer =
+                initializer_param[initializer_index[table_idx * line_size + col]];
+            float value;
+            if (initializer.type == InitializerType::kUniform) {
+              std::uniform_real_distribution<float> dist(initializer.uniform_param.low,
+                                                         initializer.uniform_param.high);
+              value = dist(gen);
+            } else if (initializer.type == InitializerType::kNormal) {
+              std::normal_distribution<float> dist(initializer.normal_param.mean,
+                                                   initializer.normal_param.std);
+              value = dist(gen);
+            } else if (initializer.type == InitializerType::kConstant) {
+              value = initializer.constant_param.value;
+            } else if (initializer.type == InitializerType::kTruncNormal) {
+              std::normal_distribution<float> dist(initializer.trunc_normal_param.mean,
+                                                   initializer.trunc_normal_param.std);
+              do {
+                value = dist(gen);
+              } while (value < initializer.trunc_normal_param.a
+                       || value > initializer.trunc_normal_param.b);
+            } else {
+              UNIMPLEMENTED();
+            }
+            row[col] = static_cast<T>(value);
+          }
+        }
+      },
+      kRowsGrainSize);
+}
+
+template<typename T, typename K, typename U>
+void CpuLookupAndInitMissing(ep::CpuStream* stream, CpuEmbeddingKernelState* kernel_state,
+                             uint64_t seed, uint32_t num_unique, const int64_t line_size,
+                             const bool put_to_store, const K* unique_ids, const U* table_ids,
+                             T* values) {
+  embedding::KeyValueStore* store = kernel_state->KeyValueStore();
+  uint32_t num_missing = 0;
+  std::vector<uint32_t> missing_indices(num_unique);
+  store->Get(stream, num_unique, unique_ids, values, &num_missing, missing_indices.data());
+  if (num_missing > 0) {
+    InitMissingRows<T, K, U>(stream, seed, line_size, kernel_state->Initializers(),
+                             kernel_state->InitializerIndex(), unique_ids, table_ids, num_missing,
+                             missing_indices.data(), values);
+  }
+  if (put_to_store) { store->Put(stream, num_unique, unique_ids, values); }
+}
+
+// Copies the leading embedding_size columns of each line, rows are contiguous so this is a plain
+// row-wise memcpy when the types match.
+template<typename T, typename V>
+void CpuCopyValuesToEmbeddings(ep::CpuStream* stream, int64_t num_rows,
+                               const int64_t embedding_size, const int64_t line_size,
+                               const T* values, V* embeddings) {
+  stream->ParallelFor(
+      0, num_rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const T* src = values + i * line_size;
+          V* dst = embeddings + i * embedding_size;
+          if (std::is_same<T, V>::value) {
+            std::memcpy(dst, src, embedding_size * sizeof(T));
+          } else {
+            for (int64_t j = 0; j < embedding_size; ++j) { dst[j] = static_cast<V>(src[j]); }
+          }
+        }
+      },
+      kRowsGrainSize);
+}
+
+template<typename K, typename V, typename IDX>
+uint32_t CpuUniqueKeyValuePair(const int64_t num_keys, const K* keys, const V* values,
+                               K* unique_keys, V* unique_values, IDX* inverse_indices,
+                               const bool has_padding_idx, const int64_t padding_idx) {
+  HashMap<K, IDX> key_to_index;
+  key_to_index.reserve(num_keys);
+  uint32_t num_unique = 0;
+  for (int64_t i = 0; i < num_keys; ++i) {
+    const K key = keys[i];
+    if (has_padding_idx && static_cast<int64_t>(key) == padding_idx) {
+      // Out of range of [0, num_keys), so the padding rows are dropped by the segment sum in
+      // backward and zero filled in the fused lookup.
+      inverse_indices[i] = static_cast<IDX>(num_keys);
+      continue;
+    }
+    auto it = key_to_index.emplace(key, static_cast<IDX>(num_unique));
+    if (it.second) {
+      unique_keys[num_unique] = key;
+      if (values != nullptr) { unique_values[num_unique] = values[i]; }
+      num_unique += 1;
+    }
+    inverse_indices[i] = it.first->second;
+  }
+  return num_unique;
+}
+
+}  // namespace
+
+template<typename K, typename V, typename IDX>
+class CpuUniqueKeyValuePairKernel final : public user_op::OpKernel {
+ public:
+  CpuUniqueKeyValuePairKernel() = default;
+  ~CpuUniqueKeyValuePairKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* keys = ctx->Tensor4ArgNameAndIndex("keys", 0);
+    user_op::Tensor* num_unique = ctx->Tensor4ArgNameAndIndex("num_unique", 0);
+    user_op::Tensor* unique_keys = ctx->Tensor4ArgNameAndIndex("unique_keys", 0);
+    user_op::Tensor* unique_values = ctx->Tensor4ArgNameAndIndex("unique_values", 0);
+    user_op::Tensor* inverse_indices = ctx->Tensor4ArgNameAndIndex("inverse_indices", 0);
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    const int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+    const bool has_padding_idx = ctx->Attr<bool>("has_padding_idx");
+    const int64_t num_keys = keys->shape_view().elem_cnt();
+    const bool has_values = ctx->has_input("values", 0);
+    std::vector<V> values_buffer;
+    const V* values_ptr = nullptr;
+    if (has_values) {
+      values_ptr = ctx->Tensor4ArgNameAndIndex("values", 0)->dptr<V>();
+    } else if (num_tables > 1) {
+      values_buffer.resize(num_keys);
+      for (int64_t i = 0; i < num_keys; ++i) { values_buffer[i] = static_cast<V>(i % num_tables); }
+      values_ptr = values_buffer.data();
+    }
+    const uint32_t num_unique_ids = CpuUniqueKeyValuePair<K, V, IDX>(
+        num_keys, keys->dptr<K>(), values_ptr, unique_keys->mut_dptr<K>(),
+        values_ptr == nullptr ? nullptr : unique_values->mut_dptr<V>(),
+        inverse_indices->mut_dptr<IDX>(), has_padding_idx, padding_idx);
+    if (values_ptr == nullptr) {
+      std::memset(unique_values->mut_dptr(), 0, num_unique_ids * sizeof(V));
+    }
+    *num_unique->mut_dptr<IDX>() = static_cast<IDX>(num_unique_ids);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define CPU_ID_DATA_TYPE_SEQ                        \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define CPU_TABLE_ID_DATA_TYPE_SEQ                  \
+  OF_PP_MAKE_TUPLE_SEQ(uint8_t, DataType::kUInt8)   \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int8_t, DataType::kInt8)     \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define CPU_IDX_DATA_TYPE_SEQ                       \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define CPU_EMBEDDING_DATA_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(float, DataType::kFloat)
+
+#define REGISTER_CPU_UNIQUE_KEY_VALUE_PAIR_KERNEL(k_dtype_pair, value_dtype_pair, idx_dtype_pair) \
+  REGISTER_USER_KERNEL("unique_key_value_pair")                                                   \
+      .SetCreateFn<CpuUniqueKeyValuePairKernel<OF_PP_PAIR_FIRST(k_dtype_pair),                    \
+                                               OF_PP_PAIR_FIRST(value_dtype_pair),                \
+                                               OF_PP_PAIR_FIRST(idx_dtype_pair)>>()               \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("keys", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))                 \
+          && (user_op::HobDataType("inverse_indices", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))    \
+          && (user_op::HobDataType("unique_values", 0) == OF_PP_PAIR_SECOND(value_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_UNIQUE_KEY_VALUE_PAIR_KERNEL, CPU_ID_DATA_TYPE_SEQ,
+                                 CPU_TABLE_ID_DATA_TYPE_SEQ, CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename K, typename U, typename IDX>
+class CpuEmbeddingLookupKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingLookupKernel() = default;
+  ~CpuEmbeddingLookupKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuEmbeddingKernelState>(
+        ctx, "unique_ids", ctx->Attr<std::string>("state_initializer"));
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuEmbeddingKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    auto* stream = ctx->stream()->As<ep::CpuStream>();
+    const user_op::Tensor* num_unique_ids = ctx->Tensor4ArgNameAndIndex("num_unique_ids", 0);
+    const user_op::Tensor* unique_ids = ctx->Tensor4ArgNameAndIndex("unique_ids", 0);
+    const user_op::Tensor* table_ids = ctx->Tensor4ArgNameAndIndex("table_ids", 0);
+    user_op::Tensor* unique_values = ctx->Tensor4ArgNameAndIndex("unique_values", 0);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const int64_t line_size = ctx->Attr<int64_t>("line_size");
+    const int64_t seed = ctx->Attr<int64_t>("seed");
+    const uint32_t num_unique = static_cast<uint32_t>(*num_unique_ids->dptr<IDX>());
+    CpuLookupAndInitMissing<T, K, U>(stream, kernel_state, seed, num_unique, line_size, false,
+                                     unique_ids->dptr<K>(), table_ids->dptr<U>(),
+                                     unique_values->mut_dptr<T>());
+    if (ctx->has_output("embeddings", 0)) {
+      user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+      CHECK_EQ(embeddings->data_type(), unique_values->data_type());
+      CpuCopyValuesToEmbeddings<T, T>(stream, num_unique, embedding_size, line_size,
+                                      unique_values->dptr<T>(), embeddings->mut_dptr<T>());
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_LOOKUP_KERNEL(t_dtype_pair, k_dtype_pair, table_dtype_pair,     \
+                                             idx_dtype_pair)                                   \
+  REGISTER_USER_KERNEL("embedding_lookup")                                                     \
+      .SetCreateFn<CpuEmbeddingLookupKernel<                                                   \
+          OF_PP_PAIR_FIRST(t_dtype_pair), OF_PP_PAIR_FIRST(k_dtype_pair),                      \
+          OF_PP_PAIR_FIRST(table_dtype_pair), OF_PP_PAIR_FIRST(idx_dtype_pair)>>()             \
+      .SetIsMatchedHob(                                                                        \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                       \
+          && (user_op::HobDataType("unique_values", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))     \
+          && (user_op::HobDataType("unique_ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))        \
+          && (user_op::HobDataType("table_ids", 0) == OF_PP_PAIR_SECOND(table_dtype_pair))     \
+          && (user_op::HobDataType("num_unique_ids", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_LOOKUP_KERNEL, CPU_EMBEDDING_DATA_TYPE_SEQ,
+                                 CPU_ID_DATA_TYPE_SEQ, CPU_TABLE_ID_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename IDX>
+class CpuEmbeddingPutKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingPutKernel() = default;
+  ~CpuEmbeddingPutKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuEmbeddingPutKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuEmbeddingPutKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    const user_op::Tensor* num_unique_ids = ctx->Tensor4ArgNameAndIndex("num_unique_ids", 0);
+    const user_op::Tensor* unique_ids = ctx->Tensor4ArgNameAndIndex("unique_ids", 0);
+    const user_op::Tensor* unique_embeddings = ctx->Tensor4ArgNameAndIndex("unique_embeddings", 0);
+    const uint32_t num_unique = static_cast<uint32_t>(*num_unique_ids->dptr<IDX>());
+    kernel_state->KeyValueStore()->Put(ctx->stream(), num_unique, unique_ids->dptr(),
+                                       unique_embeddings->dptr());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_PUT_KERNEL(dtype, typeproto)           \
+  REGISTER_USER_KERNEL("embedding_put")                               \
+      .SetCreateFn<CpuEmbeddingPutKernel<dtype>>()                    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("num_unique_ids", 0) == typeproto));
+
+OF_PP_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_PUT_KERNEL, CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename K, typename T, typename V>
+class CpuOneEmbeddingFusedLookupKernel final : public user_op::OpKernel {
+ public:
+  CpuOneEmbeddingFusedLookupKernel() = default;
+  ~CpuOneEmbeddingFusedLookupKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    // Same as the cuda kernel, this op has no optimizer info, so the optimizer states are
+    // initialized to constant 0.
+    std::string state_initializer;
+    MakeConstantInitializerAttr(ctx->Attr<int64_t>("embedding_size"),
+                                ctx->Attr<int64_t>("line_size"), {}, &state_initializer);
+    auto state = std::make_shared<CpuEmbeddingKernelState>(ctx, "ids", state_initializer);
+    state->InitIdShuffle(ctx, "ids");
+    return state;
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    using U = uint8_t;
+    auto* kernel_state = dynamic_cast<CpuEmbeddingKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    auto* stream = ctx->stream()->As<ep::CpuStream>();
+    const user_op::Tensor* ids = ctx->Tensor4ArgNameAndIndex("ids", 0);
+    user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    CHECK_LE(num_tables, 256) << num_tables;
+    const int64_t num_ids = ids->shape_view().elem_cnt();
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const int64_t line_size = ctx->Attr<int64_t>("line_size");
+    const int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+    const bool has_padding_idx = ctx->Attr<bool>("has_padding_idx");
+    const bool is_full_cache = ctx->Attr<bool>("is_full_cache");
+    const int64_t seed = ctx->Attr<int64_t>("seed");
+
+    std::vector<U> table_ids;
+    if (ctx->has_input("table_ids", 0)) {
+      const user_op::Tensor* table_ids_tensor = ctx->Tensor4ArgNameAndIndex("table_ids", 0);
+      CHECK_EQ(table_ids_tensor->shape_view().elem_cnt(), num_ids);
+      table_ids.resize(num_ids);
+      // use table_id default data_type uint8, cast other data_types to uint8.
+      std::unique_ptr<ep::primitive::Cast> cast_primitive =
+          ep::primitive::NewPrimitive<ep::primitive::CastFactory>(
+              DeviceType::kCPU, table_ids_tensor->data_type(), DataType::kUInt8);
+      CHECK(cast_primitive);
+      cast_primitive->Launch(ctx->stream(), table_ids_tensor->dptr(), table_ids.data(), num_ids);
+    } else if (num_tables > 1) {
+      table_ids.resize(num_ids);
+      for (int64_t i = 0; i < num_ids; ++i) { table_ids[i] = static_cast<U>(i % num_tables); }
+    }
+    const U* table_ids_ptr = table_ids.empty() ? nullptr : table_ids.data();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    if (parallel_num > 1) {
+      ComputeWithIdShuffle(ctx, kernel_state, num_ids, table_ids_ptr);
+      return;
+    }
+
+    std::vector<K> unique_ids(num_ids);
+    std::vector<U> unique_table_ids(table_ids_ptr == nullptr ? 0 : num_ids);
+    std::vector<uint32_t> inverse_indices(num_ids);
+    const uint32_t num_unique = CpuUniqueKeyValuePair<K, U, uint32_t>(
+        num_ids, ids->dptr<K>(), table_ids_ptr, unique_ids.data(),
+        table_ids_ptr == nullptr ? nullptr : unique_table_ids.data(), inverse_indices.data(),
+        has_padding_idx, padding_idx);
+
+    std::vector<V> values(static_cast<size_t>(num_unique) * line_size);
+    CpuLookupAndInitMissing<V, K, U>(stream, kernel_state, seed, num_unique, line_size,
+                                     !is_full_cache, unique_ids.data(),
+                                     table_ids_ptr == nullptr ? nullptr : unique_table_ids.data(),
+                                     values.data());
+
+    T* embeddings_ptr = embeddings->mut_dptr<T>();
+    stream->ParallelFor(
+        0, num_ids,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const uint32_t index = inverse_indices[i];
+            T* dst = embeddings_ptr + i * embedding_size;
+            if (index >= num_unique) {
+              std::memset(dst, 0, embedding_size * sizeof(T));
+              continue;
+            }
+            const V* src = values.data() + static_cast<int64_t>(index) * line_size;
+            if (std::is_same<T, V>::value) {
+              std::memcpy(dst, src, embedding_size * sizeof(T));
+            } else {
+              for (int64_t j = 0; j < embedding_size; ++j) { dst[j] = static_cast<T>(src[j]); }
+            }
+          }
+        },
+        kRowsGrainSize);
+  }
+
+  // Same steps as the cuda kernel: the unique ids are sent to the ranks owning them, looked up
+  // there, and the embeddings are sent back.
+  void ComputeWithIdShuffle(user_op::KernelComputeContext* ctx,
+                            CpuEmbeddingKernelState* kernel_state, const int64_t num_ids,
+                            const uint8_t* table_ids_ptr) const {
+    using U = uint8_t;
+    using IDX = uint32_t;
+    auto* stream = ctx->stream()->As<ep::CpuStream>();
+    const user_op::Tensor* ids = ctx->Tensor4ArgNameAndIndex("ids", 0);
+    user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const int64_t line_size = ctx->Attr<int64_t>("line_size");
+    const int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+    const bool has_padding_idx = ctx->Attr<bool>("has_padding_idx");
+    const bool is_full_cache = ctx->Attr<bool>("is_full_cache");
+    const int64_t seed = ctx->Attr<int64_t>("seed");
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    const bool need_process_table_ids = (table_ids_ptr != nullptr);
+    const int64_t cur_rank_max_num_ids = num_ids * parallel_num;
+
+    std::vector<IDX> num_unique_matrix(parallel_num * parallel_num);
+    std::vector<IDX> inverse_unique_partition_indices(num_ids);
+    std::vector<K> cur_rank_unique_ids(cur_rank_max_num_ids);
+    std::vector<U> cur_rank_unique_table_ids(cur_rank_max_num_ids);
+    std::vector<IDX> cur_rank_inverse_indices(cur_rank_max_num_ids);
+    data_shuffle::CpuIdShuffleDataPtrs<K, U, IDX> data_ptrs;
+    data_ptrs.ids_ptr = ids->dptr<K>();
+    data_ptrs.table_ids_ptr = table_ids_ptr;
+    data_ptrs.num_unique_matrix_ptr = num_unique_matrix.data();
+    data_ptrs.inverse_unique_partition_indices_ptr = inverse_unique_partition_indices.data();
+    data_ptrs.cur_rank_unique_ids_ptr = cur_rank_unique_ids.data();
+    data_ptrs.cur_rank_unique_table_ids_ptr = cur_rank_unique_table_ids.data();
+    data_ptrs.cur_rank_inverse_indices_ptr = cur_rank_inverse_indices.data();
+    const uint32_t num_unique = data_shuffle::CpuIdShuffle<K, U, IDX>(
+        stream, kernel_state->communication_ctx(), data_ptrs, num_ids, parallel_id, parallel_num,
+        DataType::kUInt32, ids->data_type(), DataType::kUInt8, need_process_table_ids,
+        has_padding_idx, padding_idx);
+
+    std::vector<V> values(static_cast<size_t>(num_unique) * line_size);
+    CpuLookupAndInitMissing<V, K, U>(
+        stream, kernel_state, seed, num_unique, line_size, !is_full_cache,
+        cur_rank_unique_ids.data(),
+        need_process_table_ids ? cur_rank_unique_table_ids.data() : nullptr, values.data());
+    std::vector<T> cur_rank_embeddings(static_cast<size_t>(num_unique) * embedding_size);
+    CpuCopyValuesToEmbeddings<V, T>(stream, num_unique, embedding_size, line_size, values.data(),
+                                    cur_rank_embeddings.data());
+    data_shuffle::CpuShuffleEmbeddings<T, IDX>(
+        stream, kernel_state->communication_ctx(), parallel_id, parallel_num, num_ids,
+        embedding_size, embeddings->data_type(), num_unique_matrix.data(), num_unique,
+        cur_rank_embeddings.data(), cur_rank_inverse_indices.data(),
+        inverse_unique_partition_indices.data(), embeddings->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_ONE_EMBEDDING_FUSED_LOOKUP_KERNEL(k_dtype_pair, t_dtype_pair, v_dtype_pair) \
+  REGISTER_USER_KERNEL("one_embedding_fused_lookup")                                             \
+      .SetCreateFn<CpuOneEmbeddingFusedLookupKernel<OF_PP_PAIR_FIRST(k_dtype_pair),              \
+                                                    OF_PP_PAIR_FIRST(t_dtype_pair),              \
+                                                    OF_PP_PAIR_FIRST(v_dtype_pair)>>()           \
+      .SetIsMatchedHob(                                                                          \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                         \
+          && (user_op::HobDataType("ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))                 \
+          && (user_op::HobDataType("embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))          \
+          && (user_op::HobAttr<DataType>("dtype") == OF_PP_PAIR_SECOND(v_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_FUSED_LOOKUP_KERNEL,
+                                 CPU_ID_DATA_TYPE_SEQ, CPU_EMBEDDING_DATA_TYPE_SEQ,
+                                 CPU_EMBEDDING_DATA_TYPE_SEQ)
+
+class CpuOneEmbeddingFusedLookupGradKernel final : public user_op::OpKernel {
+ public:
+  CpuOneEmbeddingFusedLookupGradKernel() = default;
+  ~CpuOneEmbeddingFusedLookupGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    // do nothing
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("one_embedding_fused_lookup_grad")
+    .SetCreateFn<CpuOneEmbeddingFusedLookupGradKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU));
+
+}  // namespace oneflow
@@ -0,0 +1,335 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr size_t kRowsGrainSize = 256;
+
+// The inputs shared by all the one_embedding update ops, the optional tensors are resolved to
+// values here because on cpu they can be read directly.
+template<typename T>
+struct CpuEmbeddingUpdateParams {
+  uint32_t num_unique;
+  int64_t line_size;
+  int64_t embedding_size;
+  T scale;
+  float learning_rate;
+  bool skip;
+  const T* unique_embeddings;
+  T* updated_unique_embeddings;
+};
+
+template<typename T, typename IDX>
+CpuEmbeddingUpdateParams<T> GetCpuEmbeddingUpdateParams(user_op::KernelComputeContext* ctx) {
+  CpuEmbeddingUpdateParams<T> params{};
+  const user_op::Tensor* num_unique_ids = ctx->Tensor4ArgNameAndIndex("num_unique_ids", 0);
+  const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+  CHECK_EQ(embedding_grad->shape_view().NumAxes(), 2);
+  params.num_unique = static_cast<uint32_t>(*num_unique_ids->dptr<IDX>());
+  params.line_size = ctx->Attr<int64_t>("line_size");
+  params.embedding_size = ctx->Attr<int64_t>("embedding_size");
+  params.scale = static_cast<T>(ctx->Attr<double>("scale"));
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const user_op::Tensor* scale_by_tensor = ctx->Tensor4ArgNameAndIndex("scale_by_tensor", 0);
+    CHECK_EQ(scale_by_tensor->shape_view().elem_cnt(), 1);
+    params.scale *= *scale_by_tensor->dptr<T>();
+  }
+  if (ctx->has_input("down_scale_by_tensor", 0)) {
+    const user_op::Tensor* down_scale_by_tensor =
+        ctx->Tensor4ArgNameAndIndex("down_scale_by_tensor", 0);
+    CHECK_EQ(down_scale_by_tensor->shape_view().elem_cnt(), 1);
+    params.scale /= *down_scale_by_tensor->dptr<T>();
+  }
+  params.learning_rate = ctx->Attr<float>("learning_rate_val");
+  if (ctx->has_input("learning_rate", 0)) {
+    params.learning_rate = *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>();
+  }
+  params.skip = false;
+  if (ctx->has_input("skip_if", 0)) {
+    const user_op::Tensor* skip_if = ctx->Tensor4ArgNameAndIndex("skip_if", 0);
+    CHECK_EQ(skip_if->shape_view().elem_cnt(), 1);
+    params.skip = (*skip_if->dptr<int64_t>() != 0);
+  }
+  params.unique_embeddings = ctx->Tensor4ArgNameAndIndex("unique_embeddings", 0)->dptr<T>();
+  params.updated_unique_embeddings =
+      ctx->Tensor4ArgNameAndIndex("updated_unique_embeddings", 0)->mut_dptr<T>();
+  return params;
+}
+
+// Copies the unique lines to the output and then calls update_row(row, updated_line) for each
+// row in parallel, the state columns of a line follow the embedding_size model columns.
+template<typename T, typename F>
+void CpuEmbeddingUpdate(ep::Stream* stream, const CpuEmbeddingUpdateParams<T>& params,
+                        const F& update_row) {
+  const int64_t line_size = params.line_size;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, params.num_unique,
+      [&](int64_t begin, int64_t end) {
+        std::memcpy(params.updated_unique_embeddings + begin * line_size,
+                    params.unique_embeddings + begin * line_size,
+                    (end - begin) * line_size * sizeof(T));
+        if (params.skip) { return; }
+        for (int64_t row = begin; row < end; ++row) {
+          update_row(row, params.updated_unique_embeddings + row * line_size);
+        }
+      },
+      kRowsGrainSize);
+}
+
+}  // namespace
+
+template<typename T, typename G, typename IDX>
+class CpuSgdEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuSgdEmbeddingUpdateKernel() = default;
+  ~CpuSgdEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const CpuEmbeddingUpdateParams<T> params = GetCpuEmbeddingUpdateParams<T, IDX>(ctx);
+    CHECK_EQ(params.line_size, params.embedding_size);
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const G* model_diff = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0)->dptr<G>();
+    const int64_t embedding_size = params.embedding_size;
+    CpuEmbeddingUpdate<T>(ctx->stream(), params, [&](int64_t row, T* line) {
+      const G* row_diff = model_diff + row * embedding_size;
+      for (int64_t col = 0; col < embedding_size; ++col) {
+        SGDUpdateFunctor<T, G>()(row_diff + col, line + col, params.scale, l1, l2, weight_decay,
+                                 params.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define CPU_IDX_DATA_TYPE_SEQ                       \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL(op_type_name, kernel, t_dtype_pair, g_type_pair, \
+                                                 idx_dtype_pair)                                  \
+  REGISTER_USER_KERNEL(op_type_name)                                                              \
+      .SetCreateFn<kernel<OF_PP_PAIR_FIRST(t_dtype_pair), OF_PP_PAIR_FIRST(g_type_pair),          \
+                          OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                                    \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("num_unique_ids", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))     \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(g_type_pair))        \
+          && (user_op::HobDataType("unique_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair)));
+
+#define REGISTER_CPU_ONE_EMBEDDING_SGD_UPDATE_KERNEL(t_dtype_pair, g_type_pair, idx_dtype_pair) \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_sgd_update",                         \
+                                           CpuSgdEmbeddingUpdateKernel, t_dtype_pair,          \
+                                           g_type_pair, idx_dtype_pair)
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_SGD_UPDATE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename G, typename IDX>
+class CpuMomentumEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuMomentumEmbeddingUpdateKernel() = default;
+  ~CpuMomentumEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const CpuEmbeddingUpdateParams<T> params = GetCpuEmbeddingUpdateParams<T, IDX>(ctx);
+    CHECK_EQ(params.line_size, params.embedding_size * 2);
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const auto beta = ctx->Attr<float>("beta");
+    // Same as the cuda kernel, dampening, nesterov and maximize are not supported yet.
+    const float dampening = 0.0;
+    const bool nesterov = false;
+    const bool maximize = false;
+    const G* model_diff = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0)->dptr<G>();
+    const int64_t embedding_size = params.embedding_size;
+    CpuEmbeddingUpdate<T>(ctx->stream(), params, [&](int64_t row, T* line) {
+      const G* row_diff = model_diff + row * embedding_size;
+      T* momentum = line + embedding_size;
+      for (int64_t col = 0; col < embedding_size; ++col) {
+        MomentumUpdateFunctor<T, G>()(row_diff + col, line + col, momentum + col, params.scale,
+                                      l1, l2, beta, dampening, nesterov, maximize, weight_decay,
+                                      params.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_ONE_EMBEDDING_MOMENTUM_UPDATE_KERNEL(t_dtype_pair, g_type_pair, \
+                                                          idx_dtype_pair)            \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_momentum_update",         \
+                                           CpuMomentumEmbeddingUpdateKernel,        \
+                                           t_dtype_pair, g_type_pair, idx_dtype_pair)
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_MOMENTUM_UPDATE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename G, typename IDX>
+class CpuAdamEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuAdamEmbeddingUpdateKernel() = default;
+  ~CpuAdamEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const CpuEmbeddingUpdateParams<T> params = GetCpuEmbeddingUpdateParams<T, IDX>(ctx);
+    CHECK_EQ(params.line_size, params.embedding_size * 3);
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const auto beta1 = ctx->Attr<float>("beta1");
+    const auto beta2 = ctx->Attr<float>("beta2");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    float bias_correction1 = ctx->Attr<float>("bias_correction1_val");
+    if (ctx->has_input("bias_correction1", 0)) {
+      bias_correction1 = *ctx->Tensor4ArgNameAndIndex("bias_correction1", 0)->dptr<float>();
+    }
+    float bias_correction2 = ctx->Attr<float>("bias_correction2_val");
+    if (ctx->has_input("bias_correction2", 0)) {
+      bias_correction2 = *ctx->Tensor4ArgNameAndIndex("bias_correction2", 0)->dptr<float>();
+    }
+    const G* model_diff = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0)->dptr<G>();
+    const int64_t embedding_size = params.embedding_size;
+    CpuEmbeddingUpdate<T>(ctx->stream(), params, [&](int64_t row, T* line) {
+      const G* row_diff = model_diff + row * embedding_size;
+      T* m = line + embedding_size;
+      T* v = line + 2 * embedding_size;
+      for (int64_t col = 0; col < embedding_size; ++col) {
+        AdamUpdateFunctor<T, G>()(row_diff + col, line + col, m + col, v + col, nullptr,
+                                  params.scale, l1, l2, beta1, beta2, epsilon, weight_decay, false,
+                                  bias_correction1, bias_correction2, params.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_ONE_EMBEDDING_ADAM_UPDATE_KERNEL(t_dtype_pair, g_type_pair, idx_dtype_pair) \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_adam_update",                         \
+                                           CpuAdamEmbeddingUpdateKernel, t_dtype_pair,          \
+                                           g_type_pair, idx_dtype_pair)
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_ADAM_UPDATE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename G, typename IDX>
+class CpuAdagradEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuAdagradEmbeddingUpdateKernel() = default;
+  ~CpuAdagradEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CpuEmbeddingUpdateParams<T> params = GetCpuEmbeddingUpdateParams<T, IDX>(ctx);
+    CHECK_EQ(params.line_size, params.embedding_size * 2);
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const auto lr_decay = ctx->Attr<float>("lr_decay");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    int64_t train_step = ctx->Attr<int64_t>("train_step_val");
+    if (ctx->has_input("train_step", 0)) {
+      train_step = *ctx->Tensor4ArgNameAndIndex("train_step", 0)->dptr<int64_t>() + 1;
+    }
+    params.learning_rate = params.learning_rate / (1 + (train_step - 1) * lr_decay);
+    const G* model_diff = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0)->dptr<G>();
+    const int64_t embedding_size = params.embedding_size;
+    CpuEmbeddingUpdate<T>(ctx->stream(), params, [&](int64_t row, T* line) {
+      const G* row_diff = model_diff + row * embedding_size;
+      T* sum = line + embedding_size;
+      for (int64_t col = 0; col < embedding_size; ++col) {
+        AdagradUpdateFunctor<T, G>()(row_diff + col, line + col, sum + col, params.scale, l1, l2,
+                                     epsilon, weight_decay, params.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_ONE_EMBEDDING_ADAGRAD_UPDATE_KERNEL(t_dtype_pair, g_type_pair, \
+                                                         idx_dtype_pair)            \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_adagrad_update",         \
+                                           CpuAdagradEmbeddingUpdateKernel,        \
+                                           t_dtype_pair, g_type_pair, idx_dtype_pair)
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_ADAGRAD_UPDATE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename G, typename IDX>
+class CpuFtrlEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuFtrlEmbeddingUpdateKernel() = default;
+  ~CpuFtrlEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const CpuEmbeddingUpdateParams<T> params = GetCpuEmbeddingUpdateParams<T, IDX>(ctx);
+    CHECK_EQ(params.line_size, params.embedding_size * 3)
+        << "The line_size should be equal to 3 x embedding_size. ";
+    const float l1 = 0.0;
+    const float l2 = 0.0;
+    const float weight_decay = ctx->Attr<float>("weight_decay");
+    CHECK_EQ(weight_decay, static_cast<float>(0.0))
+        << "Currently not support for setting weight decay. ";
+    const float lr_power = ctx->Attr<float>("lr_power");
+    const float lambda1 = ctx->Attr<float>("lambda1");
+    const float lambda2 = ctx->Attr<float>("lambda2");
+    const float beta = ctx->Attr<float>("beta");
+    const G* model_diff = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0)->dptr<G>();
+    const int64_t embedding_size = params.embedding_size;
+    CpuEmbeddingUpdate<T>(ctx->stream(), params, [&](int64_t row, T* line) {
+      const G* row_diff = model_diff + row * embedding_size;
+      T* accumulate = line + embedding_size;
+      T* z = line + 2 * embedding_size;
+      for (int64_t col = 0; col < embedding_size; ++col) {
+        FtrlUpdateFunctor<T, G>()(row_diff + col, line + col, accumulate + col, z + col,
+                                  params.scale, l1, l2, lr_power, lambda1, lambda2, beta,
+                                  weight_decay, params.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_ONE_EMBEDDING_FTRL_UPDATE_KERNEL(t_dtype_pair, g_type_pair, idx_dtype_pair) \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_ftrl_update",                         \
+                                           CpuFtrlEmbeddingUpdateKernel, t_dtype_pair,          \
+                                           g_type_pair, idx_dtype_pair)
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_FTRL_UPDATE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
@@ -43,6 +43,9 @@ class RandomCropKernelState final : public user_op::OpKernelState {
 };
 
 std::shared_ptr<RandomCropKernelState> CreateRandomCropKernelState(user_op::KernelInitContext* ctx);
+// Same as above, but with `size` generators instead of one for each element of "out".
+std::shared_ptr<RandomCropKernelState> CreateRandomCropKernelState(user_op::KernelInitContext* ctx,
+                                                                   int32_t size);
 
 }  // namespace oneflow
 
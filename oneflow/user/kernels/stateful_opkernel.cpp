@@ -905,6 +905,7 @@ Maybe<void> StatefulOpKernel::ChooseOpKernel(eager::CallContext* call_ctx,
   }
 
   UserKernelRegContext reg_ctx(reg_ctx_helper_.get(), call_ctx);
+  std::unique_lock<std::mutex> lock(kernel_mutex_);
   for (const auto& pair : dtype2cached_kernels_[primary_dtype]) {
     if (likely(pair.first->is_matched_hob->get(reg_ctx))) {
       *need_temp_storage = pair.first->need_temp_storage;
@@ -957,6 +958,7 @@ void StatefulOpKernel::TryInitOpKernelStateAndCache(eager::CallContext* call_ctx
 
 const user_op::InferTmpSizeFn& StatefulOpKernel::GetInferTmpSizeFn(
     const user_op::OpKernel* op_kernel) const {
+  std::unique_lock<std::mutex> lock(kernel_mutex_);
   return *infer_tmp_size_fn_map_.at(op_kernel);
 }
 
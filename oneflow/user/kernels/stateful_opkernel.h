@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_USER_KERNELS_STATEFUL_OPKERNEL_H_
 #define ONEFLOW_USER_KERNELS_STATEFUL_OPKERNEL_H_
 
+#include <mutex>
 #include "oneflow/core/eager/eager_blob_object.h"
 #include "oneflow/core/common/tensor_meta.h"
 #include "oneflow/core/kernel/kernel.h"
@@ -121,6 +122,8 @@ class StatefulOpKernel final {
   std::shared_ptr<const ArgTuple> output_arg_tuple_;
   user_op::TensorDescInferFn tensor_desc_infer_fn_;
   user_op::DataTypeInferFn data_type_infer_fn_;
+  // Guards the chosen kernels, ops may be called by several threads at a time.
+  mutable std::mutex kernel_mutex_;
   // NOTE: every device has its own stateful local opkernel instance,
   // so only group kernels by dtype
   std::array<std::vector<std::pair<const user_op::OpKernelRegistryResult*,
@@ -0,0 +1,116 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+#include "oneflow/user/kernels/fused_eager_elementwise_kernel.h"
+
+namespace oneflow {
+
+namespace {
+
+bool IsBroadcastInput(const user_op::TensorDesc& in, const Shape& shape) {
+  return in.shape().elem_cnt() == 1 && in.shape() != shape;
+}
+
+// The program is checked here rather than by a check fn, the op is built without its attrs and
+// gets them from the interpreting context.
+Maybe<void> CheckProgram(user_op::InferContext* ctx) {
+  const auto& opcodes = ctx->Attr<std::vector<int32_t>>("opcodes");
+  const auto& operands = ctx->Attr<std::vector<int32_t>>("operands");
+  const auto& scalars = ctx->Attr<std::vector<int64_t>>("scalars");
+  const auto& output_values = ctx->Attr<std::vector<int32_t>>("output_values");
+  const int32_t num_inputs = ctx->input_size("in");
+  const int32_t num_steps = opcodes.size();
+  CHECK_EQ_OR_RETURN(operands.size(), 2 * opcodes.size());            // NOLINT
+  CHECK_EQ_OR_RETURN(scalars.size(), opcodes.size());                 // NOLINT
+  CHECK_EQ_OR_RETURN(output_values.size(), ctx->output_size("out"));  // NOLINT
+  for (int32_t i = 0; i < num_steps; ++i) {
+    CHECK_OR_RETURN(opcodes.at(i) >= 0 && opcodes.at(i) < kFusedEagerElementwiseNumOpcodes)
+        << Error::RuntimeError() << "invalid opcode " << opcodes.at(i);
+    const int32_t step_value = num_inputs + i;
+    const int32_t x = operands.at(2 * i);
+    const int32_t y = operands.at(2 * i + 1);
+    CHECK_OR_RETURN(x >= 0 && x < step_value);  // NOLINT
+    const auto opcode = static_cast<FusedEagerElementwiseOpcode>(opcodes.at(i));
+    if (IsBinaryFusedEagerElementwiseOpcode(opcode)) {
+      CHECK_OR_RETURN(y >= 0 && y < step_value);  // NOLINT
+    } else {
+      CHECK_EQ_OR_RETURN(y, -1);  // NOLINT
+    }
+  }
+  // Outputs are made by steps, inputs are not copied.
+  for (int32_t value : output_values) {
+    CHECK_OR_RETURN(value >= num_inputs && value < num_inputs + num_steps);  // NOLINT
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+/* static */ Maybe<void> FusedEagerElementwiseOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  JUST(CheckProgram(ctx));
+  const Shape& shape = ctx->Attr<Shape>("shape");
+  for (int64_t i = 0; i < ctx->input_size("in"); ++i) {
+    const auto& in = ctx->InputTensorDesc("in", i);
+    CHECK_OR_RETURN(in.shape() == shape || in.shape().elem_cnt() == 1)
+        << Error::RuntimeError() << "input " << i << " of " << ctx->op_name() << " has shape "
+        << in.shape().ToString() << ", which can not be broadcast to " << shape.ToString();
+  }
+  for (int64_t i = 0; i < ctx->output_size("out"); ++i) {
+    ctx->MutOutputTensorDesc("out", i)->set_shape(shape);
+  }
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> FusedEagerElementwiseOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> FusedEagerElementwiseOp::GetSbp(user_op::SbpContext* ctx) {
+  const Shape& shape = ctx->Attr<Shape>("shape");
+  std::vector<user_op::OpArg> split_inputs;
+  std::vector<user_op::OpArg> broadcast_inputs;
+  for (int64_t i = 0; i < ctx->user_op_conf().input_size("in"); ++i) {
+    const auto& in = ctx->LogicalTensorDesc4InputArgNameAndIndex("in", i);
+    (IsBroadcastInput(in, shape) ? broadcast_inputs : split_inputs).emplace_back("in", i);
+  }
+  for (int64_t axis = 0; axis < shape.NumAxes(); ++axis) {
+    ctx->NewBuilder()
+        .Split(split_inputs, axis)
+        .Broadcast(broadcast_inputs)
+        .Split(ctx->outputs(), axis)
+        .Build();
+  }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedEagerElementwiseOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("in", 0);
+  for (int64_t i = 1; i < ctx->input_size("in"); ++i) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("in", i), data_type)
+        << Error::RuntimeError() << ctx->op_name()
+        << " expected all tensors to have the same type, but found "
+        << DataType_Name(ctx->InputDType("in", i)) << " and " << DataType_Name(data_type);
+  }
+  for (int64_t i = 0; i < ctx->output_size("out"); ++i) {
+    ctx->SetOutputDType("out", i, data_type);
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
@@ -250,4 +250,90 @@ namespace oneflow {
   return Maybe<void>::Ok();
 }
 
+/* static */ Maybe<void> ImageDecoderRandomCropResizeNormalizeOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
+  CHECK_OR_RETURN(in_tensor.shape().NumAxes() == 1 && in_tensor.shape().At(0) >= 1);
+  if (ctx->has_input("mirror", 0)) {
+    const user_op::TensorDesc& mirror_tensor = ctx->InputTensorDesc("mirror", 0);
+    CHECK_OR_RETURN(mirror_tensor.shape().NumAxes() == 1
+                    && in_tensor.shape().At(0) == mirror_tensor.shape().At(0));
+  }
+  int64_t N = in_tensor.shape().At(0);
+  int64_t H = ctx->Attr<int64_t>("target_height");
+  int64_t W = ctx->Attr<int64_t>("target_width");
+  int64_t C = ImageUtil::IsColor(ctx->Attr<std::string>("color_space")) ? 3 : 1;
+  user_op::TensorDesc* out_tensor = ctx->MutOutputTensorDesc("out", 0);
+  const std::string& output_layout = ctx->Attr<std::string>("output_layout");
+  if (output_layout == "NCHW") {
+    out_tensor->set_shape(Shape({N, C, H, W}));
+  } else if (output_layout == "NHWC") {
+    out_tensor->set_shape(Shape({N, H, W, C}));
+  } else {
+    return Error::CheckFailedError() << "output_layout: " << output_layout << " is not supported";
+  }
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> ImageDecoderRandomCropResizeNormalizeOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> ImageDecoderRandomCropResizeNormalizeOp::GetSbp(
+    user_op::SbpContext* ctx) {
+  ctx->NewBuilder().Split(ctx->inputs(), 0).Split(ctx->outputs(), 0).Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> ImageDecoderRandomCropResizeNormalizeOp::CheckAttr(
+    const user_op::UserOpDefWrapper& def, const user_op::UserOpConfWrapper& conf) {
+  bool check_failed = false;
+  std::ostringstream err;
+  err << "Illegal attr value for " << conf.op_type_name() << " op, op_name: " << conf.op_name();
+  int64_t target_width = conf.attr<int64_t>("target_width");
+  int64_t target_height = conf.attr<int64_t>("target_height");
+  if (target_width <= 0 || target_height <= 0) {
+    err << ", target_width: " << target_width << ", target_height: " << target_height;
+    check_failed = true;
+  }
+  int64_t C = ImageUtil::IsColor(conf.attr<std::string>("color_space")) ? 3 : 1;
+  const auto& mean_vec = conf.attr<std::vector<float>>("mean");
+  const auto& std_vec = conf.attr<std::vector<float>>("std");
+  if ((mean_vec.size() != 1 && mean_vec.size() != C)
+      || (std_vec.size() != 1 && std_vec.size() != C)) {
+    err << ", mean size: " << mean_vec.size() << ", std size: " << std_vec.size()
+        << " (mean and std must have 1 or " << C << " elements)";
+    check_failed = true;
+  }
+  if (check_failed) { return oneflow::Error::CheckFailedError() << err.str(); }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> ImageDecoderRandomCropResizeNormalizeOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  user_op::InputArgModifier* in_modifier = GetInputArgModifierFn("in", 0);
+  CHECK_NOTNULL_OR_RETURN(in_modifier);
+  in_modifier->set_requires_grad(false);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> ImageDecoderRandomCropResizeNormalizeOp::InferDataType(
+    user_op::InferContext* ctx) {
+  const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
+  CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord
+                  || in_tensor.data_type() == DataType::kTensorBuffer)
+      << "InferDataType Failed. Expected " << DataType_Name(DataType::kOFRecord) << " or "
+      << DataType_Name(DataType::kTensorBuffer) << ", but got "
+      << DataType_Name(in_tensor.data_type());
+  if (ctx->has_input("mirror", 0)) {
+    const user_op::TensorDesc& mirror_tensor = ctx->InputTensorDesc("mirror", 0);
+    CHECK_EQ_OR_RETURN(mirror_tensor.data_type(), DataType::kInt8)
+        << "InferDataType Failed. Expected " << DataType_Name(DataType::kInt8) << ", but got "
+        << DataType_Name(mirror_tensor.data_type());
+  }
+  ctx->SetOutputDType("out", 0, DataType::kFloat);
+  return Maybe<void>::Ok();
+}
+
 }  // namespace oneflow
@@ -19,6 +19,16 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+// Records are OFRecords or, from an OFRecordReader with lazy_parse, serialized OFRecords in tensor
+// buffers.
+bool IsRecordDataType(DataType data_type) {
+  return data_type == DataType::kOFRecord || data_type == DataType::kTensorBuffer;
+}
+
+}  // namespace
+
 /* static */ Maybe<void> OfrecordRawDecoderOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out_tensor = ctx->MutOutputTensorDesc("out", 0);
@@ -51,7 +61,7 @@ namespace oneflow {
 /* static */ Maybe<void> OfrecordRawDecoderOp::InferDataType(user_op::InferContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out_tensor = ctx->MutOutputTensorDesc("out", 0);
-  CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+  CHECK_OR_RETURN(IsRecordDataType(in_tensor.data_type()));
   out_tensor->set_data_type(ctx->Attr<DataType>("data_type"));
   return Maybe<void>::Ok();
 }
@@ -84,7 +94,7 @@ namespace oneflow {
 /* static */ Maybe<void> OfrecordBytesDecoderOp::InferDataType(user_op::InferContext* ctx) {
   const user_op::TensorDesc& in = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out = ctx->MutOutputTensorDesc("out", 0);
-  CHECK_OR_RETURN(in.data_type() == DataType::kOFRecord);
+  CHECK_OR_RETURN(IsRecordDataType(in.data_type()));
   out->set_data_type(DataType::kTensorBuffer);
   return Maybe<void>::Ok();
 }
@@ -118,7 +128,7 @@ namespace oneflow {
 /* static */ Maybe<void> OfrecordImageDecoderOp::InferDataType(user_op::InferContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out_tensor = ctx->MutOutputTensorDesc("out", 0);
-  CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+  CHECK_OR_RETURN(IsRecordDataType(in_tensor.data_type()));
   out_tensor->set_data_type(DataType::kTensorBuffer);
   return Maybe<void>::Ok();
 }
@@ -154,7 +164,7 @@ namespace oneflow {
     user_op::InferContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out_tensor = ctx->MutOutputTensorDesc("out", 0);
-  CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+  CHECK_OR_RETURN(IsRecordDataType(in_tensor.data_type()));
   out_tensor->set_data_type(DataType::kTensorBuffer);
   return Maybe<void>::Ok();
 }
@@ -64,7 +64,8 @@ namespace oneflow {
     user_op::ComputeComplexityFnContext* ctx) {
   // Don't support broadcast.
   return double(ctx->Shape4ArgNameAndIndex("out", 0).elem_cnt()
-                * GetSizeOfDataType(DataType::kOFRecord))
+                * GetSizeOfDataType(ctx->Attr<bool>("lazy_parse") ? DataType::kTensorBuffer
+                                                                  : DataType::kOFRecord))
          / ctx->parallel_desc().hierarchy()->elem_cnt();
 }
 
@@ -85,7 +86,10 @@ namespace oneflow {
 }
 
 /* static */ Maybe<void> OFRecordReaderOp::InferDataType(user_op::InferContext* ctx) {
-  ctx->SetOutputDType("out", 0, DataType::kOFRecord);
+  // With lazy_parse the records are not deserialized, out holds the serialized records in tensor
+  // buffers and the ofrecord decoders read the features they need straight from them.
+  const bool lazy_parse = ctx->Attr<bool>("lazy_parse");
+  ctx->SetOutputDType("out", 0, lazy_parse ? DataType::kTensorBuffer : DataType::kOFRecord);
   return Maybe<void>::Ok();
 }
 
@@ -88,6 +88,7 @@ from oneflow.nn.modules.dataset import (
     COCOReader,
     CoinFlip,
     CropMirrorNormalize,
+    ImageDecoderRandomCropResizeNormalize,
     OFRecordImageDecoder,
     OFRecordImageDecoderRandomCrop,
     OFRecordImageGpuDecoderRandomCropResize,
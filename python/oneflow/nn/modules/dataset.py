@@ -55,6 +55,9 @@ class OFRecordReader(Module):
         placement: flow.placement = None,
         sbp: Union[flow.sbp.sbp, List[flow.sbp.sbp]] = None,
         name: Optional[str] = None,
+        lazy_parse: bool = False,
+        random_access: bool = False,
+        start_sample: int = 0,
     ):
         super().__init__()
 
@@ -68,6 +71,12 @@ class OFRecordReader(Module):
         self.random_shuffle = random_shuffle
         self.shuffle_buffer_size = shuffle_buffer_size
         self.shuffle_after_epoch = shuffle_after_epoch
+        # Output the records serialized, the OFRecord decoders only read the features they need
+        self.lazy_parse = lazy_parse
+        # Read the parts memory mapped, shuffle over the whole dataset every epoch
+        # and start from sample start_sample, counted over all ranks
+        self.random_access = random_access
+        self.start_sample = start_sample
 
         self.placement = placement
         if placement is None:
@@ -104,6 +113,9 @@ class OFRecordReader(Module):
                 random_shuffle=self.random_shuffle,
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 seed=self.seed,
+                lazy_parse=self.lazy_parse,
+                random_access=self.random_access,
+                start_sample=self.start_sample,
                 sbp=self.sbp,
                 placement=self.placement,
             )
@@ -119,6 +131,9 @@ class OFRecordReader(Module):
                 random_shuffle=self.random_shuffle,
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 seed=self.seed,
+                lazy_parse=self.lazy_parse,
+                random_access=self.random_access,
+                start_sample=self.start_sample,
                 device=self.device,
             )
         return res
@@ -480,6 +495,110 @@ class OFRecordImageDecoder(Module):
         return res
 
 
+class ImageDecoderRandomCropResizeNormalize(Module):
+    r"""
+    Decodes a batch of encoded images, takes a random crop of each image, resizes the crop to
+    ``(target_height, target_width)``, mirrors it if asked and normalizes it into a float tensor,
+    all in one pass per image. This replaces the chain of ``OFRecordImageDecoderRandomCrop``,
+    ``ImageResize`` and ``CropMirrorNormalize``.
+
+    JPEG images are decoded with libjpeg, which scales the crop window down while decoding when
+    it is much larger than the target size. Other formats are decoded with OpenCV.
+
+    Args:
+        target_width (int): Width of the output images.
+        target_height (int): Height of the output images.
+        blob_name (str, optional): Name of the image feature when the input is OFRecord, unused
+            when the input is a tensor buffer of encoded images. Default: ""
+        random_crop (bool, optional): Whether to take a random crop, otherwise the whole image is
+            resized. Default: True
+        color_space (str, optional): The color space of the output images. Default: "BGR"
+        num_attempts (int, optional): Maximum number of attempts to generate a crop window.
+            Default: 10
+        random_seed (int, optional): Seed of the crop windows. Default: None
+        random_area (list of float, optional): Range of the area of the crop window relative to
+            the image. Default: [0.08, 1.0]
+        random_aspect_ratio (list of float, optional): Range of the aspect ratio of the crop
+            window. Default: [0.75, 1.333333]
+        mean (float or list of float, optional): Mean pixel values for image normalization.
+            Default: [0.0]
+        std (float or list of float, optional): Standard deviation values for image
+            normalization. Default: [1.0]
+
+    """
+
+    def __init__(
+        self,
+        target_width: int,
+        target_height: int,
+        blob_name: str = "",
+        random_crop: bool = True,
+        color_space: str = "BGR",
+        num_attempts: int = 10,
+        random_seed: Optional[int] = None,
+        random_area: Sequence[float] = [0.08, 1.0],
+        random_aspect_ratio: Sequence[float] = [0.75, 1.333333],
+        mean: Sequence[float] = [0.0],
+        std: Sequence[float] = [1.0],
+    ):
+        super().__init__()
+        if os.getenv("ONEFLOW_ENABLE_NHWC") == "1":
+            self.output_layout = "NHWC"
+        else:
+            self.output_layout = "NCHW"
+        self.target_width = target_width
+        self.target_height = target_height
+        self.blob_name = blob_name
+        self.random_crop = random_crop
+        self.color_space = color_space
+        self.num_attempts = num_attempts
+        assert len(random_area) == 2
+        self.random_area = random_area
+        assert len(random_aspect_ratio) == 2
+        self.random_aspect_ratio = random_aspect_ratio
+        self.mean = mean
+        self.std = std
+        (self.seed, self.has_seed) = local_gen_random_seed(random_seed)
+        self._op_with_mirror = (
+            flow.stateful_op("image_decoder_random_crop_resize_normalize")
+            .Input("in")
+            .Input("mirror")
+            .Output("out")
+            .Build()
+        )
+        self._op_no_mirror = (
+            flow.stateful_op("image_decoder_random_crop_resize_normalize")
+            .Input("in")
+            .Output("out")
+            .Build()
+        )
+
+    def forward(self, input, mirror=None):
+        if mirror is not None:
+            op = self._op_with_mirror
+            inputs = (input, mirror)
+        else:
+            op = self._op_no_mirror
+            inputs = (input,)
+        return _C.dispatch_image_decoder_random_crop_resize_normalize(
+            op,
+            inputs,
+            target_width=self.target_width,
+            target_height=self.target_height,
+            name=self.blob_name,
+            random_crop=self.random_crop,
+            random_area=self.random_area,
+            random_aspect_ratio=self.random_aspect_ratio,
+            num_attempts=self.num_attempts,
+            seed=self.seed,
+            has_seed=self.has_seed,
+            color_space=self.color_space,
+            output_layout=self.output_layout,
+            mean=self.mean,
+            std=self.std,
+        )
+
+
 class OFRecordImageGpuDecoderRandomCropResize(Module):
     def __init__(
         self,
@@ -54,7 +54,7 @@ def _check_initializer(initializer):
 def _check_cache(cache):
     assert isinstance(cache, dict)
     assert cache.__contains__("policy")
-    assert cache["policy"] in ["lru", "full"]
+    assert cache["policy"] in ["lru", "lfu", "full"]
     cache_memory_budget_mb = 0
     if cache.__contains__("cache_memory_budget_mb"):
         cache_memory_budget_mb = cache["cache_memory_budget_mb"]
@@ -103,6 +103,9 @@ def _init(
         key_value_store_options["storage_dim"] = storage_dim
     else:
         key_value_store_options["storage_dim"] = scale_factor * embedding_dim
+    device_type = store_options.get("device_type", "cuda")
+    assert device_type in ["cuda", "cpu"]
+    key_value_store_options["device_type"] = device_type
     # kv store
     assert store_options.__contains__("kv_store")
     kv_store = store_options["kv_store"]
@@ -138,6 +141,17 @@ def _init(
         persistent_table["capacity_hint"] = (
             persistent_table["capacity_hint"] // parallel_num
         )
+    if persistent_table.__contains__("io_engine"):
+        assert persistent_table["io_engine"] in ["aio", "io_uring"]
+    if persistent_table.__contains__("io_uring_sq_poll"):
+        assert isinstance(persistent_table["io_uring_sq_poll"], bool)
+    if persistent_table.__contains__("max_snapshot_chain_length"):
+        assert isinstance(persistent_table["max_snapshot_chain_length"], int)
+        assert persistent_table["max_snapshot_chain_length"] >= 0
+    if persistent_table.__contains__("max_space_amplification"):
+        max_space_amplification = persistent_table["max_space_amplification"]
+        assert isinstance(max_space_amplification, (int, float))
+        assert max_space_amplification == 0 or max_space_amplification >= 1
     key_value_store_options["kv_store"] = kv_store
     # initializer
     if tables is not None:
@@ -201,6 +215,7 @@ class Embedding(Module):
             default_initializer,
         )
         self.storage_dim = key_value_store_options["storage_dim"]
+        self.device_type = key_value_store_options["device_type"]
         self.embedding_name = key_value_store_options["name"]
         self.seed = seed
         self.is_full_cache = (
@@ -224,7 +239,7 @@ class Embedding(Module):
     def _save_to_state_dict(self, destination, prefix, keep_vars):
         super()._save_to_state_dict(destination, prefix, keep_vars)
         snapshot_timestamp_tensor = flow.tensor(
-            datetime.datetime.now().timestamp(), dtype=flow.float64, device="cuda"
+            datetime.datetime.now().timestamp(), dtype=flow.float64, device=self.device_type
         )
         # Broadcast timestamp tensor from master rank.
         flow.comm.broadcast(snapshot_timestamp_tensor, src=0)
@@ -298,6 +313,33 @@ class Embedding(Module):
         """
         self.handler.LoadSnapshot(snapshot_name)
 
+    def cache_statistics(self, reset=False):
+        """Get the lookup counters of the cache on the current rank since the last reset.
+        The counters are only collected for `lru` and `lfu` caches, a `full` cache always reports zeros.
+
+        Args:
+            reset (bool, optional): whether to reset the counters after reading them. Default: False.
+
+        Returns:
+            dict: num_query_keys, num_cache_missing_keys, num_store_missing_keys and cache_hit_rate.
+        """
+        (
+            num_query_keys,
+            num_cache_missing_keys,
+            num_store_missing_keys,
+        ) = self.handler.GetCacheStatistics()
+        if reset:
+            self.handler.ResetCacheStatistics()
+        hit_rate = (
+            1.0 - num_cache_missing_keys / num_query_keys if num_query_keys > 0 else 0.0
+        )
+        return {
+            "num_query_keys": num_query_keys,
+            "num_cache_missing_keys": num_cache_missing_keys,
+            "num_store_missing_keys": num_store_missing_keys,
+            "cache_hit_rate": hit_rate,
+        }
+
     def forward(self, ids, table_ids=None):
         """Embedding lookup operation
 
@@ -606,6 +648,7 @@ def make_cached_ssd_store_options(
     storage_dim=-1,
     physical_block_size=4096,
     host_cache_budget_mb=0,
+    cache_policy="lru",
 ):
     """make SSD use GPU and host as cache store_options param of MultiTableEmbedding. If cache_budget_mb > 0 and host_cache_budget_mb > 0, use GPU and host memory as multi-level cache.
 
@@ -617,6 +660,7 @@ def make_cached_ssd_store_options(
         storage_dim (int, optional): number of elements in embedding storage, if set storage_dim, the size_factor param will be invalid. if SGD update, and momentum = 0, storage_dim should be embedding_size*1, if momentum > 0, storage_dim should be embedding_size*2. if Adam, storage_dim should be embedding_size*3. Defaults to -1.
         physical_block_size (int, optional): physical_block_size should be sector size. Defaults to 4096.
         host_cache_budget_mb (int): the MB budget of host memory as cache per rank. Defaults to 0.
+        cache_policy (str, optional): "lru" or "lfu". "lfu" only admits a new id into a full cache set when it is accessed more frequently than the id it would evict, which keeps one-hit ids from flushing the cache. Defaults to "lru".
 
     Returns:
         dict: SSD use GPU and host as cache store_options param of MultiTableEmbedding
@@ -634,6 +678,7 @@ def make_cached_ssd_store_options(
     """
     assert isinstance(persistent_path, (str, list, tuple))
     assert cache_budget_mb > 0 or host_cache_budget_mb > 0
+    assert cache_policy in ["lru", "lfu"]
     if capacity is not None:
         assert capacity > 0
     else:
@@ -643,7 +688,7 @@ def make_cached_ssd_store_options(
     if cache_budget_mb > 0:
         cache_list.append(
             {
-                "policy": "lru",
+                "policy": cache_policy,
                 "cache_memory_budget_mb": cache_budget_mb,
                 "value_memory_kind": "device",
             }
@@ -651,7 +696,7 @@ def make_cached_ssd_store_options(
     if host_cache_budget_mb > 0:
         cache_list.append(
             {
-                "policy": "lru",
+                "policy": cache_policy,
                 "cache_memory_budget_mb": host_cache_budget_mb,
                 "value_memory_kind": "host",
             }
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 
+import json
 import oneflow._oneflow_internal
 from oneflow.profiler.profiler import (
     profile,
@@ -34,6 +35,11 @@ __all__ = [
     "kineto_available",
     "tensorboard_trace_handler",
     "ProfilerAction",
+    "memory_stats",
+    "reset_peak_memory_stats",
+    "enable_instruction_latency_stats",
+    "instruction_latency_stats",
+    "reset_instruction_latency_stats",
 ]
 
 
@@ -55,3 +61,38 @@ def profiler_stop():
 
 def kineto_available():
     return True
+
+
+def memory_stats():
+    """
+    Returns a list of the statistics of every live allocator, each a dict of the bytes
+    in use ("allocated_bytes"), held from the device ("reserved_bytes"), their peaks,
+    allocation counts, and the free pieces by size bin with their "fragmentation".
+    """
+    return json.loads(oneflow._oneflow_internal.profiler.GetAllocatorStats())
+
+
+def reset_peak_memory_stats():
+    oneflow._oneflow_internal.profiler.ResetAllocatorPeakStats()
+
+
+def enable_instruction_latency_stats(enabled=True):
+    """
+    Starts or stops recording the latencies of the virtual machine instructions. It can
+    also be started from the beginning with ONEFLOW_VM_INSTRUCTION_LATENCY_STATS=1.
+    """
+    oneflow._oneflow_internal.profiler.EnableInstructionLatencyStats(enabled)
+
+
+def instruction_latency_stats():
+    """
+    Returns the latencies of the recorded instructions by stage: "pending" from being
+    enqueued to being dispatched to a stream, "running" from the dispatch to being found
+    done, and "total". Each is a dict of "count", "mean_us", "max_us", "total_us" and the
+    "bins" of a log2 histogram in microseconds.
+    """
+    return json.loads(oneflow._oneflow_internal.profiler.GetInstructionLatencyStats())
+
+
+def reset_instruction_latency_stats():
+    oneflow._oneflow_internal.profiler.ResetInstructionLatencyStats()
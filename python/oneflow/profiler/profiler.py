@@ -53,6 +53,7 @@ class profile:
         record_shapes: bool = False,
         record_attrs: bool = False,
         record_bandwidth_for_cuda: bool = False,
+        profile_memory: bool = False,
     ) -> None:
         self.activities = set(activities) if activities else supported_activities()
         assert (
@@ -69,7 +70,9 @@ class profile:
                 record_bandwidth_for_cuda == False
             ), "record_bandwidth_for_cuda = True can only work with cuda."
         self.record_bandwidth_for_cuda = record_bandwidth_for_cuda
+        self.profile_memory = profile_memory
         self.profile_events: Optional[Events] = None
+        self.memory_timeline: Optional[str] = None
 
     def __enter__(self):
         oneflow._oneflow_internal.profiler.EnableProfiler(
@@ -78,10 +81,15 @@ class profile:
             self.record_shapes,
             self.record_attrs,
             self.record_bandwidth_for_cuda,
+            self.profile_memory,
         )
         return self
 
     def __exit__(self, exc_type, exc_val, exc_tb):
+        if self.profile_memory:
+            self.memory_timeline = (
+                oneflow._oneflow_internal.profiler.DumpMemoryTimeline()
+            )
         self.profile_events = Events(
             oneflow._oneflow_internal.profiler.DisableProfilerAndReturnResult()
         )
@@ -101,6 +109,18 @@ class profile:
         self.__check_finish()
         return self.profile_events
 
+    def export_memory_timeline(self, path: str) -> None:
+        """
+        Writes the allocated and reserved bytes of every allocator over the time of
+        the profile, along with the recorded events, as a Chrome trace json that can be
+        opened in chrome://tracing or Perfetto. Requires `profile_memory=True`.
+        """
+        self.__check_finish()
+        if self.memory_timeline is None:
+            raise RuntimeError("Profiler didn't run with profile_memory=True")
+        with open(path, "w") as f:
+            f.write(self.memory_timeline)
+
 
 class record_function:
     def __init__(self, name: str) -> None:
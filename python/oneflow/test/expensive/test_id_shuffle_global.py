@@ -28,8 +28,8 @@ parallel_num = 2
 max_id = 1000
 
 
-def get_tensors(batch_size, num_tables):
-    placement = flow.placement(type="cuda", ranks=list(range(parallel_num)))
+def get_tensors(batch_size, num_tables, device):
+    placement = flow.placement(type=device, ranks=list(range(parallel_num)))
     ids = np.random.randint(0, max_id, (batch_size, num_tables), dtype=np.int64)
     ids_tensor = flow.tensor(ids, requires_grad=False).to_global(
         placement=placement, sbp=flow.sbp.split(0)
@@ -43,9 +43,9 @@ def get_tensors(batch_size, num_tables):
     return ids_tensor, table_ids_tensor
 
 
-def _test_id_shuffle(test_case, has_table_id, num_tables):
+def _test_id_shuffle(test_case, has_table_id, num_tables, device):
     batch_size = int(1024 / parallel_num)
-    placement = flow.placement(type="cuda", ranks=list(range(parallel_num)))
+    placement = flow.placement(type=device, ranks=list(range(parallel_num)))
 
     class TestGraph(flow.nn.Graph):
         def __init__(self):
@@ -71,7 +71,7 @@ def _test_id_shuffle(test_case, has_table_id, num_tables):
 
     graph = TestGraph()
     for i in range(10):
-        ids_tensor, table_ids_tensor = get_tensors(batch_size, num_tables)
+        ids_tensor, table_ids_tensor = get_tensors(batch_size, num_tables, device)
         if not has_table_id:
             table_ids_tensor = None
         graph(ids_tensor, table_ids_tensor)
@@ -162,9 +162,9 @@ def embedding_shuffle_quantize(np_data, np_dtype):
     return np_data
 
 
-def _test_embedding_shuffle(test_case, dtype, enable_quantize):
+def _test_embedding_shuffle(test_case, dtype, enable_quantize, device):
     batch_size = int(1024 / parallel_num)
-    placement = flow.placement(type="cuda", ranks=list(range(parallel_num)))
+    placement = flow.placement(type=device, ranks=list(range(parallel_num)))
     num_tables = 26
     embedding_size = 128
     enable_quantized_comm = enable_quantize and embedding_size < 1025
@@ -207,7 +207,7 @@ def _test_embedding_shuffle(test_case, dtype, enable_quantize):
 
     graph = TestGraph()
     for i in range(10):
-        ids_tensor, table_ids_tensor = get_tensors(batch_size, num_tables)
+        ids_tensor, table_ids_tensor = get_tensors(batch_size, num_tables, device)
         graph(ids_tensor, table_ids_tensor, data_tensor)
     embeddings = graph(ids_tensor, table_ids_tensor, data_tensor)
     global_ids = ids_tensor.numpy()
@@ -221,10 +221,12 @@ def _test_embedding_shuffle(test_case, dtype, enable_quantize):
     test_case.assertTrue(np.array_equal(embeddings.numpy(), np_embeddings))
 
 
-def _test_embedding_gradient_shuffle(test_case, enable_quantize, fp16, embedding_size):
+def _test_embedding_gradient_shuffle(
+    test_case, enable_quantize, fp16, embedding_size, device
+):
     np_tolerance = 0
     batch_size = int(1024 / parallel_num)
-    placement = flow.placement(type="cuda", ranks=list(range(parallel_num)))
+    placement = flow.placement(type=device, ranks=list(range(parallel_num)))
     num_tables = 26
     enable_quantized_comm = enable_quantize and embedding_size < 1025
     if enable_quantized_comm:
@@ -277,9 +279,9 @@ def _test_embedding_gradient_shuffle(test_case, enable_quantize, fp16, embedding
 
     graph = TestGraph()
     for i in range(10):
-        ids_tensor, table_ids_tensor = get_tensors(batch_size, num_tables)
+        ids_tensor, table_ids_tensor = get_tensors(batch_size, num_tables, device)
         graph(ids_tensor, table_ids_tensor, embedding_grad_tensor)
-    ids_tensor, table_ids_tensor = get_tensors(batch_size, num_tables)
+    ids_tensor, table_ids_tensor = get_tensors(batch_size, num_tables, device)
     (
         cur_rank_unique_embedding_grad,
         local_cur_rank_num_unique,
@@ -351,6 +353,7 @@ class DataShuffleTestCase(flow.unittest.TestCase):
         arg_dict = OrderedDict()
         arg_dict["has_table_id"] = [True, False]
         arg_dict["num_tables"] = [1, 26]
+        arg_dict["device"] = ["cuda"]
         for kwargs in GenArgDict(arg_dict):
             _test_id_shuffle(test_case, **kwargs)
 
@@ -358,6 +361,7 @@ class DataShuffleTestCase(flow.unittest.TestCase):
         arg_dict = OrderedDict()
         arg_dict["dtype"] = [flow.float32, flow.float16]
         arg_dict["enable_quantize"] = [True, False]
+        arg_dict["device"] = ["cuda"]
 
         for kwargs in GenArgDict(arg_dict):
             _test_embedding_shuffle(test_case, **kwargs)
@@ -367,6 +371,36 @@ class DataShuffleTestCase(flow.unittest.TestCase):
         arg_dict["enable_quantize"] = [True, False]
         arg_dict["fp16"] = [True, False]
         arg_dict["embedding_size"] = [128, 17]
+        arg_dict["device"] = ["cuda"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_embedding_gradient_shuffle(test_case, **kwargs)
+
+
+# The cpu kernels have no quantized communication and no float16.
+@flow.unittest.skip_unless_1n2d()
+class CpuDataShuffleTestCase(flow.unittest.TestCase):
+    def test_id_shuffle(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["has_table_id"] = [True, False]
+        arg_dict["num_tables"] = [1, 26]
+        arg_dict["device"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_id_shuffle(test_case, **kwargs)
+
+    def test_embedding_shuffle(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["dtype"] = [flow.float32]
+        arg_dict["enable_quantize"] = [False]
+        arg_dict["device"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_embedding_shuffle(test_case, **kwargs)
+
+    def test_embedding_gradient_shuffle(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["enable_quantize"] = [False]
+        arg_dict["fp16"] = [False]
+        arg_dict["embedding_size"] = [128, 17]
+        arg_dict["device"] = ["cpu"]
         for kwargs in GenArgDict(arg_dict):
             _test_embedding_gradient_shuffle(test_case, **kwargs)
 
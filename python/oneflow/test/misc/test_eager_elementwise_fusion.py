@@ -0,0 +1,83 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+
+# Read once per thread, so it is set before any op runs.
+os.environ["ONEFLOW_EAGER_ELEMENTWISE_FUSION"] = "1"
+
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerElementwiseFusion(flow.unittest.TestCase):
+    def test_chain(test_case):
+        x_np = np.random.randn(3, 1000).astype(np.float32)
+        a_np = np.random.randn(3, 1000).astype(np.float32)
+        x = flow.tensor(x_np)
+        a = flow.tensor(a_np)
+        y = (flow.sigmoid(x * a + 2.0) - x / 3.0).relu()
+        expected = np.maximum(1 / (1 + np.exp(-(x_np * a_np + 2.0))) - x_np / 3.0, 0)
+        test_case.assertTrue(np.allclose(y.numpy(), expected, 1e-5, 1e-5))
+
+    def test_relu_keeps_nan(test_case):
+        x_np = np.array([-1.0, np.nan, 0.0, 2.0, -np.nan], dtype=np.float32)
+        x = flow.tensor(x_np)
+        y = (x * 2.0 + 1.0).relu()
+        expected = np.where(np.isnan(x_np), np.nan, np.maximum(x_np * 2.0 + 1.0, 0))
+        test_case.assertTrue(np.allclose(y.numpy(), expected, equal_nan=True))
+
+    def test_kept_intermediate(test_case):
+        x_np = np.random.randn(4, 5).astype(np.float64)
+        x = flow.tensor(x_np)
+        z = x * 2
+        y = flow.exp(z) + z
+        test_case.assertTrue(np.allclose(y.numpy(), np.exp(x_np * 2) + x_np * 2))
+        test_case.assertTrue(np.allclose(z.numpy(), x_np * 2))
+
+    def test_broadcast_scalar_tensor(test_case):
+        x_np = np.random.randn(8, 8).astype(np.float32)
+        x = flow.tensor(x_np)
+        s = flow.tensor(1.5, dtype=flow.float32)
+        y = flow.tanh(x * s)
+        test_case.assertTrue(np.allclose(y.numpy(), np.tanh(x_np * 1.5), 1e-5, 1e-5))
+
+    def test_view_and_inplace(test_case):
+        x_np = np.random.randn(2, 6).astype(np.float32)
+        x = flow.tensor(x_np)
+        z = x + 1
+        v = z.view(3, 4)
+        w = v * 2
+        z.add_(1)
+        test_case.assertTrue(np.allclose(w.numpy(), (x_np + 1).reshape(3, 4) * 2))
+        test_case.assertTrue(np.allclose(z.numpy(), x_np + 2))
+
+    def test_grad(test_case):
+        x = flow.randn(4, 4, requires_grad=True)
+        y = (flow.sigmoid(x) * x).sum()
+        y.backward()
+        s = 1 / (1 + np.exp(-x.numpy()))
+        test_case.assertTrue(
+            np.allclose(x.grad.numpy(), s + x.numpy() * s * (1 - s), 1e-5, 1e-5)
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
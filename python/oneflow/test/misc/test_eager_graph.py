@@ -0,0 +1,81 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerGraph(flow.unittest.TestCase):
+    def test_replay_same_as_eager(test_case):
+        linear = flow.nn.Linear(8, 4)
+
+        def fn(x, y):
+            z = flow.relu(linear(x)) * y
+            return z.sum(dim=1), z + 1
+
+        graph = flow.utils.eager_graph.capture(fn, flow.randn(3, 8), flow.randn(3, 4))
+        test_case.assertGreater(graph.op_size, 0)
+        for _ in range(3):
+            x = flow.randn(3, 8)
+            y = flow.randn(3, 4)
+            with flow.no_grad():
+                expected = fn(x, y)
+            outputs = graph(x, y)
+            test_case.assertEqual(len(outputs), 2)
+            for output, expected_output in zip(outputs, expected):
+                test_case.assertTrue(
+                    np.allclose(output.numpy(), expected_output.numpy(), 1e-5, 1e-5)
+                )
+
+    def test_constants_are_captured_by_reference(test_case):
+        weight = flow.ones(4)
+        graph = flow.utils.eager_graph.capture(lambda x: x * weight, flow.ones(4))
+        weight.fill_(2.0)
+        test_case.assertTrue(np.allclose(graph(flow.ones(4)).numpy(), np.full(4, 2.0)))
+
+    def test_inplace_input(test_case):
+        def fn(x):
+            x.add_(1)
+            return x * 2
+
+        graph = flow.utils.eager_graph.capture(fn, flow.zeros(4))
+        x = flow.zeros(4)
+        y = graph(x)
+        test_case.assertTrue(np.allclose(x.numpy(), np.ones(4)))
+        test_case.assertTrue(np.allclose(y.numpy(), np.full(4, 2.0)))
+
+    def test_input_meta_mismatch(test_case):
+        graph = flow.utils.eager_graph.capture(lambda x: x + 1, flow.ones(4))
+        with test_case.assertRaises(Exception):
+            graph(flow.ones(5))
+
+    def test_abort_capture(test_case):
+        def fn(x):
+            raise ValueError("abort")
+
+        with test_case.assertRaises(ValueError):
+            flow.utils.eager_graph.capture(fn, flow.ones(4))
+        # The failed capture does not leave the thread capturing.
+        graph = flow.utils.eager_graph.capture(lambda x: x + 1, flow.ones(4))
+        test_case.assertTrue(np.allclose(graph(flow.ones(4)).numpy(), np.full(4, 2.0)))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,100 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import subprocess
+import sys
+
+# Read once per thread, so it is set before backward runs.
+os.environ["ONEFLOW_EAGER_PARALLEL_BACKWARD"] = "1"
+
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+# The grad ops of the branches run for the first time in the backward threads, all at once, so
+# that they race on choosing the kernels of the op.
+_SAME_OP_BRANCHES = """
+import numpy as np
+import oneflow as flow
+
+x_np = np.random.randn(64, 32).astype(np.float32)
+x = flow.tensor(x_np, requires_grad=True)
+branches = [flow.tanh(x * (i + 1)).sum() + flow.sigmoid(x + i).sum() for i in range(32)]
+sum(branches).backward()
+expected = np.zeros_like(x_np)
+for i in range(32):
+    expected += (i + 1) * (1 - np.tanh(x_np * (i + 1)) ** 2)
+    s = 1 / (1 + np.exp(-(x_np + i)))
+    expected += s * (1 - s)
+assert np.allclose(x.grad.numpy(), expected, 1e-4, 1e-4)
+"""
+
+class _Square(flow.autograd.Function):
+    @staticmethod
+    def forward(ctx, x):
+        ctx.save_for_backward(x)
+        return x * x
+
+    @staticmethod
+    def backward(ctx, dy):
+        (x,) = ctx.saved_tensors
+        return dy * 2 * x
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestParallelBackward(flow.unittest.TestCase):
+    def test_branches(test_case):
+        x_np = np.random.randn(4, 8).astype(np.float32)
+        w_np = [np.random.randn(8, 8).astype(np.float32) for _ in range(4)]
+        x = flow.tensor(x_np, requires_grad=True)
+        ws = [flow.tensor(w, requires_grad=True) for w in w_np]
+        # Branches that are ready at the same time, joined by a sum.
+        y = sum(flow.matmul(x, w).relu().sum() for w in ws)
+        y.backward()
+
+        x_grad = np.zeros_like(x_np)
+        for w, w_tensor in zip(w_np, ws):
+            mask = (np.matmul(x_np, w) > 0).astype(np.float32)
+            test_case.assertTrue(
+                np.allclose(w_tensor.grad.numpy(), np.matmul(x_np.T, mask), 1e-4, 1e-4)
+            )
+            x_grad += np.matmul(mask, w.T)
+        test_case.assertTrue(np.allclose(x.grad.numpy(), x_grad, 1e-4, 1e-4))
+
+    def test_hooks_and_autograd_function(test_case):
+        x_np = np.random.randn(16).astype(np.float32)
+        x = flow.tensor(x_np, requires_grad=True)
+        a = _Square.apply(x)
+        b = flow.sin(x)
+        b.register_hook(lambda grad: grad * 3)
+        c = (a * 2).sum() + b.sum()
+        (x_grad,) = flow.autograd.grad(c, [x])
+        expected = 4 * x_np + 3 * np.cos(x_np)
+        test_case.assertTrue(np.allclose(x_grad.numpy(), expected, 1e-5, 1e-5))
+
+    def test_same_op_branches_in_new_process(test_case):
+        env = os.environ.copy()
+        env["ONEFLOW_EAGER_PARALLEL_BACKWARD_THREAD_NUM"] = "8"
+        for _ in range(3):
+            p = subprocess.run([sys.executable, "-c", _SAME_OP_BRANCHES], env=env)
+            test_case.assertEqual(p.returncode, 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
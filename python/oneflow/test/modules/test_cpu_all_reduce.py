@@ -0,0 +1,76 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+
+# Read once per thread, so they are set before any collective runs. Without shared memory the
+# all-reduce goes through the transport: messages of at most 8 bytes use recursive doubling,
+# larger ones the ring, in chunks of 16 floats.
+os.environ["ONEFLOW_CCL_CPU_ENABLE_SHM"] = "0"
+os.environ["ONEFLOW_CCL_CPU_ALL_REDUCE_RECURSIVE_DOUBLING_MAX_BYTES"] = "8"
+os.environ["ONEFLOW_CCL_CPU_ALL_REDUCE_CHUNK_BYTES"] = "64"
+
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+_CASES = [
+    # recursive doubling, fewer elements than ranks
+    (np.float32, 1),
+    (np.float32, 2),
+    (np.int8, 8),
+    # ring, fewer elements than ranks
+    (np.float64, 2),
+    (np.float32, 3),
+    # ring, parts of one chunk and of several chunks with a smaller last one
+    (np.float32, 40),
+    (np.float32, 1000),
+]
+
+
+def _check_all_reduce(test_case, ranks):
+    rank = flow.env.get_rank()
+    placement = flow.placement("cpu", ranks=ranks)
+    for dtype, elem_cnt in _CASES:
+        arrays = [(np.arange(elem_cnt) % 7 + r * 10).astype(dtype) for r in ranks]
+        x = flow.tensor(arrays[ranks.index(rank)] if rank in ranks else arrays[0])
+        y = x.to_global(placement, flow.sbp.partial_sum)
+        y = y.to_global(sbp=flow.sbp.broadcast).to_local()
+        if rank not in ranks:
+            continue
+        test_case.assertEqual(y.numpy().dtype, dtype)
+        test_case.assertTrue(np.array_equal(y.numpy(), np.sum(arrays, axis=0)))
+
+
+@flow.unittest.skip_unless_1n2d()
+class TestCpuAllReduce1n2d(flow.unittest.TestCase):
+    def test_all_reduce(test_case):
+        _check_all_reduce(test_case, [0, 1])
+
+
+@flow.unittest.skip_unless_1n4d()
+class TestCpuAllReduce1n4d(flow.unittest.TestCase):
+    def test_all_reduce(test_case):
+        _check_all_reduce(test_case, [0, 1, 2, 3])
+
+    def test_all_reduce_of_three_ranks(test_case):
+        _check_all_reduce(test_case, [0, 1, 2])
+
+
+if __name__ == "__main__":
+    unittest.main()
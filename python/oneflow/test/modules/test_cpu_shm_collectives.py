@@ -0,0 +1,93 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+
+# Read once per thread, so they are set before any collective runs. A small buffer makes the
+# larger tensors go through shared memory in several pieces.
+os.environ["ONEFLOW_CCL_CPU_ENABLE_SHM"] = "1"
+os.environ["ONEFLOW_CCL_CPU_SHM_BUFFER_BYTES"] = "4096"
+
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+# Element counts per rank: less than a buffer, one buffer, and several buffers.
+_ELEM_CNTS = [4, 1024, 3000]
+
+
+def _rank_array(rank, elem_cnt, parallel_num):
+    return (np.arange(elem_cnt * parallel_num) % 97 + rank * 1000).astype(np.float32)
+
+
+def _check_collectives(test_case, ranks):
+    rank = flow.env.get_rank()
+    parallel_num = len(ranks)
+    placement = flow.placement("cpu", ranks=ranks)
+    for elem_cnt in _ELEM_CNTS:
+        arrays = [_rank_array(r, elem_cnt, parallel_num) for r in ranks]
+        x = flow.tensor(arrays[ranks.index(rank)] if rank in ranks else arrays[0])
+        partial = x.to_global(placement, flow.sbp.partial_sum)
+        split = x[:elem_cnt].to_global(placement, flow.sbp.split(0))
+
+        # all_reduce
+        all_reduced = partial.to_global(sbp=flow.sbp.broadcast).to_local()
+        # reduce_scatter
+        reduce_scattered = partial.to_global(sbp=flow.sbp.split(0)).to_local()
+        # all_gather
+        all_gathered = split.to_global(sbp=flow.sbp.broadcast).to_local()
+        # broadcast, over all the ranks of the world
+        broadcasted = x.clone()
+        flow.comm.broadcast(broadcasted, ranks[-1])
+
+        if rank not in ranks:
+            continue
+        index = ranks.index(rank)
+        expected_sum = np.sum(arrays, axis=0)
+        test_case.assertTrue(np.allclose(all_reduced.numpy(), expected_sum))
+        test_case.assertTrue(
+            np.allclose(
+                reduce_scattered.numpy(),
+                expected_sum[index * elem_cnt : (index + 1) * elem_cnt],
+            )
+        )
+        test_case.assertTrue(
+            np.allclose(
+                all_gathered.numpy(), np.concatenate([a[:elem_cnt] for a in arrays])
+            )
+        )
+        test_case.assertTrue(np.allclose(broadcasted.numpy(), arrays[-1]))
+
+
+@flow.unittest.skip_unless_1n2d()
+class TestCpuShmCollectives1n2d(flow.unittest.TestCase):
+    def test_collectives(test_case):
+        _check_collectives(test_case, [0, 1])
+
+
+@flow.unittest.skip_unless_1n4d()
+class TestCpuShmCollectives1n4d(flow.unittest.TestCase):
+    def test_collectives(test_case):
+        _check_collectives(test_case, [0, 1, 2, 3])
+
+    def test_collectives_of_three_ranks(test_case):
+        _check_collectives(test_case, [0, 1, 2])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -16,6 +16,11 @@ limitations under the License.
 
 import math
 import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
 import unittest
 
 import cv2
@@ -359,6 +364,52 @@ class TestCocoReader(flow.unittest.TestCase):
                     np.array_equal(segm_index_list[i], sample["poly_index"])
                 )
 
+    def test_coco_reader_with_workers(test_case):
+        # The reader settings are read when the reader kernel is created, so each of them runs in
+        # its own process.
+        outputs = []
+        for num_workers in ("1", "4"):
+            for parse_ahead in ("1", "0"):
+                env = dict(os.environ)
+                env["ONEFLOW_DATA_READER_NUM_WORKERS"] = num_workers
+                env["ONEFLOW_DATA_READER_PARSE_AHEAD"] = parse_ahead
+                p = subprocess.run(
+                    [sys.executable, "-c", _READ_COCO_BATCHES],
+                    env=env,
+                    stdout=subprocess.PIPE,
+                )
+                test_case.assertEqual(p.returncode, 0)
+                outputs.append(p.stdout)
+        test_case.assertTrue(len(outputs[0]) > 0)
+        for output in outputs[1:]:
+            test_case.assertEqual(output, outputs[0])
+
+
+_READ_COCO_BATCHES = """
+import hashlib
+import oneflow as flow
+import oneflow.unittest
+
+coco_reader = flow.nn.COCOReader(
+    annotation_file=flow.unittest.dataset_dir(
+        "mscoco_2017/annotations/instances_val2017.json"
+    ),
+    image_dir=flow.unittest.dataset_dir("mscoco_2017/val2017"),
+    batch_size=2,
+    shuffle=True,
+    random_seed=123,
+    stride_partition=True,
+)
+image_decoder = flow.nn.image.decode(dtype=flow.float)
+for _ in range(20):
+    (image, image_id, image_size, gt_bbox, gt_label, gt_segm, _) = coco_reader()
+    digest = hashlib.md5()
+    for t in (image_decoder(image), image_id, image_size, gt_bbox, gt_label, gt_segm):
+        for array in t.numpy():
+            digest.update(array.tobytes())
+    print(image_id.numpy().tolist(), digest.hexdigest())
+"""
+
 
 @flow.unittest.skip_unless_1n1d()
 class TestOFRecordBytesDecoder(flow.unittest.TestCase):
@@ -383,5 +434,169 @@ class TestOFRecordBytesDecoder(flow.unittest.TestCase):
         test_case.assertTrue(np.array_equal(img, gt_np))
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestOFRecordLazyParse(flow.unittest.TestCase):
+    def test_lazy_parse(test_case):
+        batch_size = 8
+
+        def read(lazy_parse):
+            record_reader = flow.nn.OFRecordReader(
+                flow.unittest.dataset_dir("imagenette/ofrecord"),
+                batch_size=batch_size,
+                part_name_suffix_length=5,
+                lazy_parse=lazy_parse,
+            )
+            record = record_reader()
+            image = flow.nn.OFRecordImageDecoder("encoded", color_space="RGB")(record)
+            encoded = flow.nn.OFRecordBytesDecoder("encoded")(record)
+            label = flow.nn.OFRecordRawDecoder(
+                "class/label", shape=(), dtype=flow.int32
+            )(record)
+            return record, image.numpy(), encoded.numpy(), label.numpy()
+
+        record, image, encoded, label = read(lazy_parse=False)
+        lazy_record, lazy_image, lazy_encoded, lazy_label = read(lazy_parse=True)
+        test_case.assertEqual(record.dtype, flow.record)
+        test_case.assertEqual(lazy_record.dtype, flow.tensor_buffer)
+        for i in range(batch_size):
+            test_case.assertTrue(np.array_equal(image[i], lazy_image[i]))
+            test_case.assertTrue(np.array_equal(encoded[i], lazy_encoded[i]))
+        test_case.assertTrue(np.array_equal(label, lazy_label))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestOFRecordRandomAccess(flow.unittest.TestCase):
+    def test_random_access(test_case):
+        batch_size = 8
+        data_dir = tempfile.mkdtemp()
+        part_file = os.path.join(data_dir, "part-00000")
+        shutil.copyfile(
+            os.path.join(
+                flow.unittest.dataset_dir("imagenette/ofrecord"), "part-00000"
+            ),
+            part_file,
+        )
+
+        def read(num_batches, **kwargs):
+            record_reader = flow.nn.OFRecordReader(
+                data_dir, batch_size=batch_size, part_name_suffix_length=5, **kwargs
+            )
+            bytes_decoder = flow.nn.OFRecordBytesDecoder("encoded")
+            return [bytes_decoder(record_reader()).numpy() for _ in range(num_batches)]
+
+        def assert_same_batches(batches, expected_batches):
+            for batch, expected_batch in zip(batches, expected_batches):
+                for encoded, expected_encoded in zip(batch, expected_batch):
+                    test_case.assertTrue(np.array_equal(encoded, expected_encoded))
+
+        # Without shuffling, the records come in file order as from a stream.
+        expected_batches = read(2)
+        assert_same_batches(read(2, random_access=True), expected_batches)
+
+        # Offsets from a sidecar index file instead of a scan of the part.
+        offsets = []
+        with open(part_file, "rb") as f:
+            data = f.read()
+        offset = 0
+        while offset < len(data):
+            offsets.append(offset)
+            offset += 8 + struct.unpack_from("<q", data, offset)[0]
+        with open(part_file + ".index", "wb") as f:
+            f.write(b"OFRIDX\x00\x00")
+            f.write(struct.pack("<QQ", 1, len(offsets)))
+            f.write(struct.pack("<%dq" % len(offsets), *offsets))
+        assert_same_batches(read(2, random_access=True), expected_batches)
+
+        # Resuming from a sample gives the samples read after it from the start.
+        shuffled_batches = read(3, random_access=True, random_shuffle=True, random_seed=1)
+        resumed_batches = read(
+            1,
+            random_access=True,
+            random_shuffle=True,
+            random_seed=1,
+            start_sample=2 * batch_size,
+        )
+        assert_same_batches(resumed_batches, shuffled_batches[2:])
+        shutil.rmtree(data_dir)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestImageDecoderRandomCropResizeNormalize(flow.unittest.TestCase):
+    def test_image_decoder_random_crop_resize_normalize(test_case):
+        batch_size = 4
+        height = 224
+        width = 224
+        rgb_mean = [123.68, 116.779, 103.939]
+        rgb_std = [58.393, 57.12, 57.375]
+        record_reader = flow.nn.OFRecordReader(
+            flow.unittest.dataset_dir("imagenette/ofrecord"),
+            batch_size=batch_size,
+            data_part_num=1,
+            part_name_suffix_length=5,
+            shuffle_after_epoch=False,
+        )
+        val_record = record_reader()
+        decode_resize_normalize = flow.nn.ImageDecoderRandomCropResizeNormalize(
+            width,
+            height,
+            blob_name="encoded",
+            random_crop=False,
+            color_space="RGB",
+            mean=rgb_mean,
+            std=rgb_std,
+        )
+        image = decode_resize_normalize(val_record)
+        test_case.assertEqual(image.shape, (batch_size, 3, height, width))
+        test_case.assertEqual(image.dtype, flow.float32)
+        image_np = image.numpy()
+        test_case.assertTrue(np.all(np.isfinite(image_np)))
+        mirror = flow.tensor([1, 0, 1, 0], dtype=flow.int8)
+        mirrored_image_np = decode_resize_normalize(val_record, mirror).numpy()
+        test_case.assertTrue(
+            np.array_equal(mirrored_image_np[0], image_np[0, :, :, ::-1])
+        )
+        test_case.assertTrue(np.array_equal(mirrored_image_np[1], image_np[1]))
+
+        # The same images from encoded bytes instead of records.
+        bytes_decoder = flow.nn.OFRecordBytesDecoder("encoded")
+        image_from_bytes_np = decode_resize_normalize(bytes_decoder(val_record)).numpy()
+        test_case.assertTrue(np.array_equal(image_from_bytes_np, image_np))
+
+        random_crop_resize_normalize = flow.nn.ImageDecoderRandomCropResizeNormalize(
+            width,
+            height,
+            blob_name="encoded",
+            color_space="BGR",
+            random_seed=1,
+            mean=rgb_mean[::-1],
+            std=rgb_std[::-1],
+        )
+        image = random_crop_resize_normalize(val_record)
+        test_case.assertEqual(image.shape, (batch_size, 3, height, width))
+
+    def test_fall_back_to_opencv(test_case):
+        # libjpeg turns down the PNG, which OpenCV decodes instead.
+        y, x = np.mgrid[0:48, 0:64]
+        image = np.stack([x * 4, y * 5, (x + y) * 2], axis=-1).astype(np.uint8)
+        encoded = [
+            cv2.imencode(".png", image)[1].reshape(-1),
+            cv2.imencode(".jpg", image)[1].reshape(-1),
+        ]
+        padded = np.zeros((len(encoded), max(e.size for e in encoded)), dtype=np.int8)
+        for i, e in enumerate(encoded):
+            padded[i, : e.size] = e.view(np.int8)
+        images_buffer = flow.tensor_to_tensor_buffer(
+            flow.tensor(padded, dtype=flow.int8), instance_dims=1
+        )
+        decode_resize_normalize = flow.nn.ImageDecoderRandomCropResizeNormalize(
+            32, 32, random_crop=False, color_space="BGR"
+        )
+        out = decode_resize_normalize(images_buffer).numpy()
+        test_case.assertEqual(out.shape, (2, 3, 32, 32))
+        expected = cv2.resize(image, (32, 32), interpolation=cv2.INTER_LINEAR)
+        test_case.assertTrue(np.allclose(out[0], expected.transpose(2, 0, 1), atol=1))
+        test_case.assertTrue(np.all(np.isfinite(out[1])))
+
+
 if __name__ == "__main__":
     unittest.main()
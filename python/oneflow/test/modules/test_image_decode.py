@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 
+import subprocess
+import sys
 import unittest
 
 import cv2
@@ -57,6 +59,42 @@ class TestImageDecode(flow.unittest.TestCase):
             test_case.assertTrue(len(cv2_decoded_image.shape) == 3)
             test_case.assertTrue(np.allclose(of_decoded_image, cv2_decoded_image))
 
+    def test_corrupt_image_after_valid_one(test_case):
+        # One thread decodes both images, so the corrupt one must not come out as the PNG
+        # left in the decode buffer of the thread.
+        code = _DECODE_VALID_THEN_CORRUPT.replace("CORRUPT", "True")
+        p = subprocess.run([sys.executable, "-c", code], stderr=subprocess.PIPE)
+        test_case.assertNotEqual(p.returncode, 0)
+        test_case.assertIn(b"Failed to decode image", p.stderr)
+        code = _DECODE_VALID_THEN_CORRUPT.replace("CORRUPT", "False")
+        p = subprocess.run([sys.executable, "-c", code])
+        test_case.assertEqual(p.returncode, 0)
+
+
+_DECODE_VALID_THEN_CORRUPT = """
+import cv2
+import numpy as np
+import oneflow as flow
+
+flow.set_num_threads(1)
+y, x = np.mgrid[0:48, 0:64]
+image = np.stack([x * 4, y * 5, (x + y) * 2], axis=-1).astype(np.uint8)
+encoded = [cv2.imencode(".png", image)[1].reshape(-1)]
+if CORRUPT:
+    encoded.append(np.frombuffer(b"not an image" * 8, dtype=np.uint8))
+else:
+    encoded.append(cv2.imencode(".png", image[::-1])[1].reshape(-1))
+padded = np.zeros((len(encoded), max(e.size for e in encoded)), dtype=np.int8)
+for i, e in enumerate(encoded):
+    padded[i, : e.size] = e.view(np.int8)
+images_buffer = flow.tensor_to_tensor_buffer(
+    flow.tensor(padded, dtype=flow.int8), instance_dims=1
+)
+decoded = flow.nn.image.decode(color_space="BGR")(images_buffer).numpy()
+assert np.array_equal(decoded[0], image)
+assert np.array_equal(decoded[1], image[::-1])
+"""
+
 
 if __name__ == "__main__":
     unittest.main()
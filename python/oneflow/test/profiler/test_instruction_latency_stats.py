@@ -0,0 +1,51 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+import oneflow.unittest
+import oneflow as flow
+import oneflow.profiler
+
+
+class TestInstructionLatencyStats(flow.unittest.TestCase):
+    def test_instruction_latency_stats(test_case):
+        oneflow.profiler.reset_instruction_latency_stats()
+        oneflow.profiler.enable_instruction_latency_stats()
+        try:
+            x = flow.randn(64, 64)
+            for _ in range(10):
+                x = flow.relu(x) + 1
+            x.numpy()
+        finally:
+            oneflow.profiler.enable_instruction_latency_stats(False)
+        # Waits for the recorded instructions to be released.
+        oneflow._oneflow_internal.eager.Sync()
+        stats = oneflow.profiler.instruction_latency_stats()
+        test_case.assertFalse(stats["enabled"])
+        for stage in ["pending", "running", "total"]:
+            test_case.assertGreater(stats[stage]["count"], 0)
+            test_case.assertEqual(
+                sum(b["count"] for b in stats[stage]["bins"]), stats[stage]["count"]
+            )
+        test_case.assertGreaterEqual(
+            stats["total"]["max_us"], stats["running"]["mean_us"]
+        )
+        oneflow.profiler.reset_instruction_latency_stats()
+        stats = oneflow.profiler.instruction_latency_stats()
+        test_case.assertEqual(stats["total"]["count"], 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,73 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import json
+import os
+import tempfile
+import unittest
+import oneflow.unittest
+import oneflow as flow
+import oneflow.profiler
+
+
+class TestProfileMemory(flow.unittest.TestCase):
+    def test_memory_stats(test_case):
+        x = flow.randn(256, 1024)
+        y = (x * 2).sum()
+        test_case.assertEqual(y.numpy().size, 1)
+        stats = oneflow.profiler.memory_stats()
+        test_case.assertGreater(len(stats), 0)
+        for item in stats:
+            test_case.assertGreaterEqual(
+                item["peak_allocated_bytes"], item["allocated_bytes"]
+            )
+            test_case.assertGreaterEqual(item["reserved_bytes"], item["cached_bytes"])
+            test_case.assertGreaterEqual(item["fragmentation"], 0.0)
+            test_case.assertLess(item["fragmentation"], 1.0)
+        test_case.assertTrue(any(item["num_allocs"] > 0 for item in stats))
+        oneflow.profiler.reset_peak_memory_stats()
+        for item in oneflow.profiler.memory_stats():
+            test_case.assertEqual(
+                item["peak_allocated_bytes"], item["allocated_bytes"]
+            )
+
+    def test_export_memory_timeline(test_case):
+        with oneflow.profiler.profile(profile_memory=True) as prof:
+            with oneflow.profiler.record_function("allocate"):
+                x = flow.randn(512, 1024)
+                y = flow.relu(x)
+                y.numpy()
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            path = os.path.join(tmp_dir, "memory_timeline.json")
+            prof.export_memory_timeline(path)
+            with open(path) as f:
+                trace = json.load(f)
+        events = trace["traceEvents"]
+        counters = [e for e in events if e["ph"] == "C"]
+        test_case.assertGreater(len(counters), 0)
+        test_case.assertIn("allocated_bytes", counters[0]["args"])
+        test_case.assertTrue(
+            any(e["ph"] == "X" and e["name"] == "allocate" for e in events)
+        )
+
+    def test_export_memory_timeline_without_profile_memory(test_case):
+        with oneflow.profiler.profile() as prof:
+            flow.randn(4, 4).numpy()
+        with test_case.assertRaises(RuntimeError):
+            prof.export_memory_timeline("unused.json")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -19,3 +19,4 @@ from oneflow.utils import global_view
 from oneflow.utils import model_zoo
 from . import checkpoint
 from . import hooks
+from . import eager_graph
@@ -0,0 +1,82 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+from typing import Callable
+
+import oneflow
+from oneflow.framework.tensor_tuple_util import convert_to_tensor_tuple
+
+__all__ = ["EagerGraph", "capture"]
+
+
+class EagerGraph(object):
+    r"""Eager local ops captured once and replayed on new inputs.
+
+    Capturing runs a function eagerly under ``oneflow.no_grad()`` and records the ops
+    it runs. Calling the graph runs the recorded ops again on inputs of the same shapes,
+    strides, dtypes and devices, without interpreting them again. Tensors the function
+    uses besides its inputs, like module parameters, are captured by reference.
+
+    The function must only compute on tensors: python control flow, ops whose output
+    shapes depend on the data, and views of the inputs or intermediate tensors can not
+    be captured.
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> linear = flow.nn.Linear(4, 4)
+        >>> fn = lambda x: linear(x).relu()
+        >>> graph = flow.utils.eager_graph.capture(fn, flow.ones(2, 4))
+        >>> y = graph(flow.randn(2, 4))
+        >>> y.shape
+        oneflow.Size([2, 4])
+
+    """
+
+    def __init__(self):
+        self._c_eager_graph = oneflow._oneflow_internal.EagerGraph()
+        self._is_single_output = False
+
+    def capture(self, fn: Callable, *inputs):
+        """Runs ``fn(*inputs)`` and records its ops, returns the outputs of ``fn``."""
+        with oneflow.no_grad():
+            self._c_eager_graph.begin_capture(convert_to_tensor_tuple(inputs))
+            try:
+                outputs = fn(*inputs)
+            except BaseException:
+                self._c_eager_graph.abort_capture()
+                raise
+            self._is_single_output = isinstance(outputs, oneflow.Tensor)
+            self._c_eager_graph.end_capture(convert_to_tensor_tuple(outputs))
+        return outputs
+
+    @property
+    def op_size(self):
+        return self._c_eager_graph.op_size
+
+    def __call__(self, *inputs):
+        outputs = self._c_eager_graph.replay(convert_to_tensor_tuple(inputs))
+        if self._is_single_output:
+            return outputs[0]
+        return tuple(outputs)
+
+
+def capture(fn: Callable, *inputs) -> EagerGraph:
+    r"""Captures the eager ops of ``fn(*inputs)`` into an :class:`EagerGraph`."""
+    graph = EagerGraph()
+    graph.capture(fn, *inputs)
+    return graph